@@ -6,6 +6,7 @@ class SmokingTimerBox {
         this.currentState = {};
         this.websocket = null;
         this.aiSession = null;
+        this.pendingAIJobs = {}; // jobId -> { finish, progress }, until the reply arrives
         this.setupStatus = null; // NEW: Track setup status
         
         this.initializeWebSocket();
@@ -34,9 +35,22 @@ class SmokingTimerBox {
         
         this.websocket.onmessage = (event) => {
             try {
-                const status = JSON.parse(event.data);
-                this.currentState = status;
-                this.updateDisplay(status);
+                const message = JSON.parse(event.data);
+                
+                // Status snapshots are sent bare; other topics are wrapped
+                // as { type, data }, and only AI replies are for this page
+                if (message.type) {
+                    const pending = this.pendingAIJobs[message.data.jobId];
+                    if (pending && message.type === 'aiReply') {
+                        pending.finish(message.data);
+                    } else if (pending && message.type === 'aiPartial') {
+                        pending.progress(message.data.text);
+                    }
+                    return;
+                }
+                
+                this.currentState = message;
+                this.updateDisplay(message);
             } catch (error) {
                 console.error('WebSocket message parsing error:', error);
             }
@@ -762,12 +776,24 @@ class SmokingTimerBox {
             this.addChatMessage(messagesContainer, message, true);
             userMessageInput.value = '';
             
-            // Send to AI
-            const response = await this.apiCall('/api/ai/chat', 'POST', { message: message });
+            // Send to AI; the reply is produced in the background and shown
+            // word by word while it streams in
+            let replyDiv = null;
+            const showPartial = (text) => {
+                if (!replyDiv) {
+                    replyDiv = this.addChatMessage(messagesContainer, '', false);
+                }
+                this.setChatMessage(replyDiv, text, false);
+                messagesContainer.scrollTop = messagesContainer.scrollHeight;
+            };
+            const job = await this.apiCall('/api/ai/chat', 'POST', { message: message, sessionId: this.aiSession.id });
+            const response = job && job.success ? await this.waitForAIReply(job, showPartial) : null;
             
-            if (response && response.success) {
+            if (response && !response.success) {
+                this.addChatMessage(messagesContainer, 'The counselor took too long to answer. Please try again.', false);
+            } else if (response) {
                 // Add AI response
-                this.addChatMessage(messagesContainer, response.message, false);
+                showPartial(response.message);
                 
                 // Update session status
                 this.aiSession.messageCount = response.messageCount;
@@ -791,7 +817,7 @@ class SmokingTimerBox {
         
         // Complete session
         completeBtn.addEventListener('click', async () => {
-            const result = await this.apiCall('/api/emergency/ai/complete', 'POST');
+            const result = await this.apiCall(`/api/emergency/ai/complete?sessionId=${this.aiSession.id}`, 'POST');
             if (result && result.success) {
                 chatModal.remove();
                 this.showMessage(`Emergency unlock granted with ${result.penalty} minute penalty.`, 'success');
@@ -811,12 +837,43 @@ class SmokingTimerBox {
         this.startAISessionTimer(timerDisplay, statusDisplay);
     }
 
+    waitForAIReply(job, progress) {
+        if (job.status === 'done' || job.status === 'timeout') {
+            return Promise.resolve(job);
+        }
+        
+        // Pushed over /ws when ready, with the text so far while it streams;
+        // polling covers a closed socket or a reply that was replaced before
+        // this page received it
+        return new Promise((resolve) => {
+            const finish = (reply) => {
+                clearInterval(poll);
+                delete this.pendingAIJobs[job.jobId];
+                resolve(reply);
+            };
+            const poll = setInterval(async () => {
+                const reply = await this.apiCall(`/api/ai/job?id=${job.jobId}`);
+                if (!reply || reply.status === 'done' || reply.status === 'timeout') {
+                    finish(reply);
+                } else if (reply.partial) {
+                    progress(reply.partial);
+                }
+            }, 3000);
+            this.pendingAIJobs[job.jobId] = { finish, progress };
+        });
+    }
+
     addChatMessage(container, message, isUser) {
         const messageDiv = document.createElement('div');
         messageDiv.className = isUser ? 'user-message' : 'ai-message';
-        messageDiv.innerHTML = `<strong>${isUser ? 'You' : 'AI Counselor'}:</strong> ${message}`;
+        this.setChatMessage(messageDiv, message, isUser);
         container.appendChild(messageDiv);
         container.scrollTop = container.scrollHeight;
+        return messageDiv;
+    }
+
+    setChatMessage(messageDiv, message, isUser) {
+        messageDiv.innerHTML = `<strong>${isUser ? 'You' : 'AI Counselor'}:</strong> ${message}`;
     }
 
     startAISessionTimer(timerDisplay, statusDisplay) {
@@ -3,6 +3,8 @@ class SettingsManager {
     constructor() {
         this.apiBase = '';
         this.currentSettings = {};
+        this.settingsVersion = 0;
+        this.scanSocket = null;
         this.aiSession = null;
         
         this.initializeEventListeners();
@@ -139,15 +141,42 @@ class SettingsManager {
         }
     }
 
+    async saveSettings(patch) {
+        // One request, one transaction on the device: either every field in
+        // the patch is stored or none of them is
+        try {
+            const response = await fetch('/api/settings', {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/json' },
+                body: JSON.stringify(patch)
+            });
+
+            const result = await response.json();
+            if (result.success) {
+                this.settingsVersion = result.version;
+            }
+            return result;
+        } catch (error) {
+            console.error('Settings save error:', error);
+            return { success: false, error: 'Connection error. Please check your connection.' };
+        }
+    }
+
     async loadAllSettings() {
         try {
-            await Promise.all([
-                this.loadCostSettings(),
-                this.loadWiFiSettings(),
-                this.loadAISettings(),
-                this.loadSecuritySettings(),
-                this.loadTimerSettings()
+            const [settings] = await Promise.all([
+                this.apiCall('/api/settings'),
+                this.loadWiFiSettings()
             ]);
+
+            if (settings) {
+                this.currentSettings = settings;
+                this.settingsVersion = settings.version || 0;
+                this.applyCostSettings(settings.cost || {});
+                this.applyAISettings(settings.ai || {});
+                this.applySecuritySettings(settings.security || {});
+                this.applyTimerSettings(settings.timer || {});
+            }
             
             console.log('✅ All settings loaded');
         } catch (error) {
@@ -167,9 +196,8 @@ class SettingsManager {
         }
     }
 
-    async loadAISettings() {
+    applyAISettings(aiSettings) {
         try {
-            const aiSettings = await this.apiCall('/api/ai/config');
             if (aiSettings) {
                 const enableAI = document.getElementById('enableAI');
                 if (enableAI) enableAI.checked = aiSettings.enabled || false;
@@ -180,6 +208,18 @@ class SettingsManager {
                 const apiKey = document.getElementById('aiApiKey');
                 if (apiKey) apiKey.value = aiSettings.apiKey || '';
                 
+                const localUrl = document.getElementById('aiLocalUrl');
+                if (localUrl) localUrl.value = aiSettings.localUrl || '';
+                
+                const localModel = document.getElementById('aiLocalModel');
+                if (localModel) localModel.value = aiSettings.localModel || 'llama3.2';
+                
+                const localConnectTimeout = document.getElementById('aiLocalConnectTimeout');
+                if (localConnectTimeout) localConnectTimeout.value = aiSettings.localConnectTimeout || 2000;
+                
+                const localTimeout = document.getElementById('aiLocalTimeout');
+                if (localTimeout) localTimeout.value = aiSettings.localTimeout || 15;
+                
                 const delayMinutes = document.getElementById('delayMinutes');
                 if (delayMinutes) delayMinutes.value = aiSettings.delayMinutes || 10;
                 
@@ -194,9 +234,8 @@ class SettingsManager {
         }
     }
 
-    async loadSecuritySettings() {
+    applySecuritySettings(securitySettings) {
         try {
-            const securitySettings = await this.apiCall('/api/security/config');
             if (securitySettings) {
                 // Load allowed networks
                 let allowedNetworks = [];
@@ -225,12 +264,9 @@ class SettingsManager {
         }
     }
 
-    async loadCostSettings() {
+    applyCostSettings(settings) {
         try {
-            const response = await fetch('/api/cost-config');
-            if (response.ok) {
-                const settings = await response.json();
-                
+            if (settings) {
                 const productNameEl = document.getElementById('productName');
                 if (productNameEl) productNameEl.value = settings.productName || '';
                 
@@ -257,12 +293,9 @@ class SettingsManager {
         }
     }
 
-    async loadTimerSettings() {
+    applyTimerSettings(settings) {
         try {
-            const response = await fetch('/api/config');
-            if (response.ok) {
-                const settings = await response.json();
-                
+            if (settings) {
                 const timerModeEl = document.getElementById('timerMode');
                 if (timerModeEl) {
                     timerModeEl.value = settings.timerMode || 0;
@@ -334,19 +367,29 @@ class SettingsManager {
             return;
         }
 
+        const localUrl = document.getElementById('aiLocalUrl').value.trim();
+        if (enableAI && provider === 'local' && !localUrl) {
+            this.showMessage('Please enter the URL of your model server.', 'error');
+            return;
+        }
+
         const aiConfig = {
             enabled: enableAI,
             provider: provider,
             apiKey: apiKey,
             delayMinutes: delayMinutes,
-            personality: personality
+            personality: personality,
+            localUrl: localUrl,
+            localModel: document.getElementById('aiLocalModel').value.trim() || 'llama3.2',
+            localConnectTimeout: parseInt(document.getElementById('aiLocalConnectTimeout').value),
+            localTimeout: parseInt(document.getElementById('aiLocalTimeout').value)
         };
 
-        const result = await this.apiCall('/api/ai/config', 'POST', aiConfig);
-        if (result && result.success) {
+        const result = await this.saveSettings({ ai: aiConfig });
+        if (result.success) {
             this.showMessage('AI settings saved successfully!', 'success');
         } else {
-            this.showMessage('Failed to save AI settings.', 'error');
+            this.showMessage(result.error || 'Failed to save AI settings.', 'error');
         }
     }
 
@@ -356,16 +399,16 @@ class SettingsManager {
         const blockOnPublic = document.getElementById('blockOnPublic').checked;
 
         const securityConfig = {
-            allowedNetworks: JSON.stringify(allowedNetworks),
-            blockedNetworks: JSON.stringify(blockedNetworks),
+            allowedNetworks: allowedNetworks,
+            blockedNetworks: blockedNetworks,
             blockOnPublic: blockOnPublic
         };
 
-        const result = await this.apiCall('/api/security/config', 'POST', securityConfig);
-        if (result && result.success) {
+        const result = await this.saveSettings({ security: securityConfig });
+        if (result.success) {
             this.showMessage('Security settings saved successfully!', 'success');
         } else {
-            this.showMessage('Failed to save security settings.', 'error');
+            this.showMessage(result.error || 'Failed to save security settings.', 'error');
         }
     }
 
@@ -392,32 +435,21 @@ class SettingsManager {
         const formData = new FormData(e.target);
         const costType = formData.get('costType');
         
-        const data = new URLSearchParams({
+        const cost = {
             productName: formData.get('productName') || '',
             currency: formData.get('currency') || 'EUR',
-            usePackPrice: costType === 'pack' ? 'true' : 'false',
-            cigaretteCost: formData.get('costPerCigarette') || '0.50',
-            packCost: formData.get('costPerPack') || '10.00',
-            cigarettesPerPack: formData.get('cigarettesPerPack') || '20'
-        });
-
-        try {
-            const response = await fetch('/api/cost-config', {
-                method: 'POST',
-                headers: { 'Content-Type': 'application/x-www-form-urlencoded' },
-                body: data
-            });
+            usePackPrice: costType === 'pack',
+            cigaretteCost: parseFloat(formData.get('costPerCigarette') || '0.50'),
+            packCost: parseFloat(formData.get('costPerPack') || '10.00'),
+            cigarettesPerPack: parseInt(formData.get('cigarettesPerPack') || '20')
+        };
 
-            const result = await response.json();
-            
-            if (result.success) {
-                this.showMessage('Settings saved successfully!', 'success');
-            } else {
-                this.showMessage(result.error || 'Failed to save settings', 'error');
-            }
-        } catch (error) {
-            console.error('Cost settings error:', error);
-            this.showMessage('Failed to save cost settings', 'error');
+        const result = await this.saveSettings({ cost: cost });
+        
+        if (result.success) {
+            this.showMessage('Settings saved successfully!', 'success');
+        } else {
+            this.showMessage(result.error || 'Failed to save settings', 'error');
         }
     }
 
@@ -457,29 +489,18 @@ class SettingsManager {
         
         const formData = new FormData(e.target);
         
-        const data = new URLSearchParams({
-            timerMode: formData.get('timerMode') || '0',
-            intervalMinutes: formData.get('intervalMinutes') || '30',
-            dailyLimit: formData.get('dailyLimit') || '10'
-        });
-
-        try {
-            const response = await fetch('/api/config', {
-                method: 'POST',
-                headers: { 'Content-Type': 'application/x-www-form-urlencoded' },
-                body: data
-            });
+        const timer = {
+            timerMode: parseInt(formData.get('timerMode') || '0'),
+            intervalMinutes: parseInt(formData.get('intervalMinutes') || '30'),
+            dailyLimit: parseInt(formData.get('dailyLimit') || '10')
+        };
 
-            const result = await response.json();
-            
-            if (result.success) {
-                this.showMessage('Timer settings saved successfully!', 'success');
-            } else {
-                this.showMessage(result.error || 'Failed to save timer settings', 'error');
-            }
-        } catch (error) {
-            console.error('Timer settings error:', error);
-            this.showMessage('Failed to save timer settings', 'error');
+        const result = await this.saveSettings({ timer: timer });
+        
+        if (result.success) {
+            this.showMessage('Timer settings saved successfully!', 'success');
+        } else {
+            this.showMessage(result.error || 'Failed to save timer settings', 'error');
         }
     }
 
@@ -502,45 +523,66 @@ class SettingsManager {
     }
 
     async saveLanguagePreference(language) {
-        try {
-            const response = await fetch('/api/language', {
-                method: 'POST',
-                headers: { 'Content-Type': 'application/x-www-form-urlencoded' },
-                body: new URLSearchParams({ language })
-            });
-
-            const result = await response.json();
-            
-            if (!result.success) {
-                console.error('Failed to save language preference:', result.error);
-            }
-        } catch (error) {
-            console.error('Language save error:', error);
+        const result = await this.saveSettings({ language: { currentLanguage: language } });
+        
+        if (!result.success) {
+            console.error('Failed to save language preference:', result.error);
         }
     }
 
     async scanWiFiNetworks() {
+        // The box answers from its scan cache immediately and pushes fresh
+        // results over the WebSocket once a background scan finishes
+        this.listenForScanResults();
+
+        const result = await this.apiCall('/api/wifi/scan?refresh=1');
+        if (result) {
+            this.showScanResults(result);
+        }
+    }
+
+    listenForScanResults() {
+        if (this.scanSocket && this.scanSocket.readyState <= WebSocket.OPEN) {
+            return;
+        }
+
+        const protocol = window.location.protocol === 'https:' ? 'wss:' : 'ws:';
+        this.scanSocket = new WebSocket(`${protocol}//${window.location.host}/ws`);
+
+        this.scanSocket.onmessage = (event) => {
+            try {
+                const message = JSON.parse(event.data);
+                if (message.type === 'wifiScan') {
+                    this.showScanResults(message.data);
+                }
+            } catch (error) {
+                console.error('Scan result parsing error:', error);
+            }
+        };
+
+        this.scanSocket.onclose = () => {
+            this.scanSocket = null;
+        };
+    }
+
+    showScanResults(result) {
         const scanButton = document.getElementById('scanWiFi');
         if (scanButton) {
-            scanButton.disabled = true;
-            scanButton.textContent = 'Scanning...';
+            scanButton.disabled = result.scanning;
+            scanButton.textContent = result.scanning ? 'Scanning...' : 'Scan Networks';
         }
 
-        try {
-            const result = await this.apiCall('/api/wifi/scan');
-            if (result && result.networks) {
-                this.populateNetworkDropdown(result.networks);
-                this.showMessage(`Found ${result.networks.length} networks`, 'info');
+        const networks = result.networks || [];
+        if (networks.length > 0) {
+            this.populateNetworkDropdown(networks);
+        }
+
+        if (!result.scanning) {
+            if (networks.length > 0) {
+                this.showMessage(`Found ${networks.length} networks`, 'info');
             } else {
                 this.showMessage('No networks found', 'warning');
             }
-        } catch (error) {
-            this.showMessage('Failed to scan networks', 'error');
-        } finally {
-            if (scanButton) {
-                scanButton.disabled = false;
-                scanButton.textContent = 'Scan Networks';
-            }
         }
     }
 
@@ -569,12 +611,16 @@ class SettingsManager {
             dropdown.appendChild(option);
         });
         
-        dropdown.addEventListener('change', (e) => {
-            const ssidInput = document.getElementById('wifiSSID');
-            if (ssidInput) {
-                ssidInput.value = e.target.value;
-            }
-        });
+        // The list is refreshed as scan results arrive; bind only once
+        if (!dropdown.dataset.bound) {
+            dropdown.dataset.bound = 'true';
+            dropdown.addEventListener('change', (e) => {
+                const ssidInput = document.getElementById('wifiSSID');
+                if (ssidInput) {
+                    ssidInput.value = e.target.value;
+                }
+            });
+        }
     }
 
     populateNetworkList(containerId, networks) {
@@ -614,6 +660,30 @@ class SettingsManager {
         if (apiKeyGroup) {
             apiKeyGroup.style.display = provider === 'openai' ? 'block' : 'none';
         }
+        const localAIGroup = document.getElementById('localAIGroup');
+        if (localAIGroup) {
+            localAIGroup.style.display = provider === 'local' ? 'block' : 'none';
+            if (provider === 'local') {
+                this.showLocalAIHealth();
+            }
+        }
+    }
+
+    async showLocalAIHealth() {
+        const status = document.getElementById('localAIHealth');
+        try {
+            const local = await this.apiCall('/api/ai/local', 'GET');
+            if (!status || !local) return;
+            const labels = {
+                up: `✅ Reachable (${local.latencyMs} ms)`,
+                'no-model': `⚠️ Reachable, but ${local.model} is not installed`,
+                down: `❌ Unreachable${local.error ? ' (' + local.error + ')' : ''}`,
+                unchecked: 'Not checked yet'
+            };
+            status.textContent = labels[local.health] || '';
+        } catch (error) {
+            console.error('Failed to load local AI health:', error);
+        }
     }
 
     async testAIGatekeeper() {
@@ -37,16 +37,125 @@
 // AI Emergency Gatekeeper Settings
 #define AI_MIN_MESSAGES 5           // Minimum messages before unlock allowed
 #define AI_MAX_SESSION_TIME 1800    // 30 minutes max session time
+#define AI_SESSION_SLOTS 3          // Sessions in progress at once, each with its own transcript
+#define AI_SESSION_TRIGGER_MAX 16   // Longest trigger name kept for a session, with its NUL
 
 // Statistics and Progress Tracking
 #define DEFAULT_CIGARETTE_COST 0.50 // Default cost per cigarette in dollars
 #define STATISTICS_UPDATE_INTERVAL 300000 // Update statistics every 5 minutes
 
+// Settings API
+#define SETTINGS_MAX_BODY_SIZE 4096   // Largest accepted /api/settings body in bytes
+#define SETTINGS_MAX_PENDING 40       // Most keys a single settings transaction can stage
+#define API_MAX_BODY_SIZE 1024        // Largest accepted body on the other JSON POST routes
+#define AI_MAX_MESSAGE_LENGTH 500     // Longest /api/ai/chat message in characters
+
+// Live Status Streams (/ws and /api/events)
+#define STREAM_MAX_CLIENTS 4            // Per stream type; extra clients are turned away
+#define STREAM_STATUS_INTERVAL 5000     // Status snapshot cadence in milliseconds
+#define STREAM_HEARTBEAT_INTERVAL 15000 // Ping / SSE keep-alive interval in milliseconds
+#define STREAM_CLIENT_TIMEOUT 45000     // Clients silent for this long are dropped
+
+// WiFi Scan Cache
+#define WIFI_SCAN_CACHE_TTL 30000       // Cached results younger than this are served as-is
+#define WIFI_SCAN_ENTRY_TTL 120000      // Networks unseen for this long are dropped
+#define WIFI_SCAN_TIMEOUT 15000         // Give up on a scan that runs longer than this
+#define WIFI_SCAN_MAX_NETWORKS 20
+#define WIFI_SCAN_RSSI_SMOOTHING 0.5f   // Weight of the newest RSSI reading
+
+// Rate Limiting and Admission Control
+#define RATE_LIMIT_MAX_BUCKETS 16         // (client IP, endpoint class) pairs tracked at once
+#define RATE_LIMIT_READ_BURST 20
+#define RATE_LIMIT_READ_PER_MINUTE 240
+#define RATE_LIMIT_WRITE_BURST 10
+#define RATE_LIMIT_WRITE_PER_MINUTE 60
+#define RATE_LIMIT_AI_BURST 3
+#define RATE_LIMIT_AI_PER_MINUTE 6
+#define ADMISSION_MIN_FREE_HEAP 20480     // Below this every request is shed
+#define ADMISSION_MIN_FREE_BLOCK 8192     // Largest allocatable block
+#define ADMISSION_MIN_AI_HEAP 51200       // AI calls need room for a TLS session
+#define ADMISSION_RETRY_AFTER 5           // Seconds, sent with 503 responses
+
+// AI Worker (answers /api/ai/chat off the web server task)
+#define AI_JOB_SLOTS 4                    // Jobs queued, running or awaiting pickup at once
+#define AI_JOB_TIMEOUT 20000              // A job not answered within this many ms fails
+#define AI_JOB_KEEP 60000                 // Finished jobs can be polled for this long
+#define AI_WORKER_STACK 12288             // A TLS handshake needs a deep stack
+#define AI_WORKER_PRIORITY 1              // Below the web server task
+#define AI_WORKER_CORE 0                  // loop() runs on core 1
+#define AI_CONNECTION_IDLE 45000          // Close the provider connection after this many ms unused, before its server does
+#define AI_HANDSHAKE_TIMEOUT 10           // Seconds a TLS handshake may take
+#define AI_OPENAI_CONNECT_TIMEOUT 5000    // Ms to reach OpenAI; well inside AI_JOB_TIMEOUT, so a fallback still gets there
+#define AI_OPENAI_REPLY_TIMEOUT 8000      // Ms OpenAI may go quiet mid-reply
+#define AI_STREAM_LINE_MAX 768           // Longest server-sent event line kept; longer ones are skipped
+#define AI_HISTORY_BYTES 3072            // Emergency session transcript kept verbatim (~750 tokens)
+#define AI_HISTORY_TURNS 16               // Most messages kept verbatim
+#define AI_SUMMARY_BYTES 640              // Running summary of the messages that no longer fit
+#define AI_SUMMARY_LINE 96                // Longest summary line for one compacted message
+#define AI_CANNED_REPLY_MAX 640           // Buffer for a built-in counselor reply, NUL included
+#define INTENT_MAX_NODES 1536             // Keyword automaton for chat messages, 8 bytes of RAM each
+#define AI_OPENAI_MODEL "gpt-3.5-turbo"    // Model asked for from OpenAI
+#define AI_CACHE_ENTRIES 64               // Provider replies cached in PSRAM
+#define AI_CACHE_ENTRIES_INTERNAL 8       // The same, on boards without PSRAM
+#define AI_CACHE_REPLY_BYTES 1024         // Room per cached reply; longer ones are not cached
+#define AI_CACHE_TTL 21600000UL           // A cached reply is reused for this many ms (6 hours)
+#define AI_BREAKER_WINDOW 8               // Provider calls a circuit breaker judges by (at most 16)
+#define AI_BREAKER_MIN_CALLS 4            // Calls in the window before the failure rate counts
+#define AI_BREAKER_FAILURE_PERCENT 50     // Failed share of the window that opens the breaker
+#define AI_BREAKER_CONSECUTIVE 2          // Failures in a row that open it regardless
+#define AI_BREAKER_SLOW_MS 12000          // A reply that took longer counts as failed
+#define AI_BREAKER_OPEN_MS 30000          // Calls skip the provider this long after it opens
+#define AI_BREAKER_OPEN_MAX_MS 300000     // The wait doubles up to this while probes fail
+#define AI_LOCAL_MODEL "llama3.2"         // Default model on the local model server
+#define AI_LOCAL_CONNECT_TIMEOUT 2000     // Default ms to reach the local model server
+#define AI_LOCAL_REPLY_TIMEOUT 15         // Default seconds the local model may go quiet mid-reply
+#define AI_LOCAL_HEALTH_INTERVAL 60000    // Check the local model server this often while it is the provider
+
+// Metrics (/api/dev/metrics)
+#define METRICS_MAX_ROUTES 48
+#define METRICS_HISTOGRAM_BUCKETS 18      // Bucket i holds durations below 128 us << i (up to 8.4 s); the last is +Inf
+#define METRICS_HISTOGRAM_BASE_SHIFT 7    // 128 us
+
+// Loop Profiler (/api/dev/perf)
+#define LOOP_INTERVAL 50                  // Target loop period in milliseconds
+#define PERF_MAX_TASKS 24
+
+// Logging (/ws/log and /api/dev/logs)
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 3                       // 0 off, 1 error, 2 warning, 3 info, 4 debug; set with -D LOG_LEVEL=n
+#endif
+#ifndef LOG_SERIAL
+#define LOG_SERIAL 1                      // Echo records to Serial from loop()
+#endif
+#define LOG_RING_SIZE 8192                // Bytes of binary records kept in RAM
+#define LOG_MAX_RECORD 192                // Largest encoded record
+#define LOG_MAX_STRING 64                 // String arguments are truncated to this
+#define LOG_LINE_SIZE 256                 // Formatted line buffer
+#define LOG_MAX_CLIENTS 2
+#define LOG_SEND_BATCH 16                 // Records per client per loop() pass
+
+// Input Trace (/api/dev/trace, replayed by the simulator)
+#define TRACE_RING_SIZE 16384             // Bytes of input records kept in RAM while recording
+#define TRACE_MAX_RECORD 4608             // Larger requests are left out and counted as dropped
+#define TRACE_STALL_MS 100                // Loop gaps this much past LOOP_INTERVAL are recorded
+#define TRACE_REDACTED "********"         // Stands in for passwords and API keys
+
+// Network Bring-up (runs in the background after boot)
+#define WIFI_FAST_CONNECT_TIMEOUT 4000  // Reconnect to the cached access point and channel
+#define WIFI_CONNECT_TIMEOUT 15000      // Full connect before falling back to AP mode
+#define WIFI_RETRY_INTERVAL 300000      // AP mode tries the stored network again this often
+#define NTP_SYNC_TIMEOUT 10000          // Reported as late after this; SNTP keeps retrying
+#define BOOT_MAX_PHASES 16
+
 // Button Settings
 #define BUTTON_DEBOUNCE_DELAY 50 // Debounce delay for button in milliseconds
 
-// Data Storage Keys
+// Data Storage Keys (NVS keys are limited to 15 characters)
 #define PREF_NAMESPACE "smoking_box"
+#define KEY_WIFI_SSID "wifi_ssid"
+#define KEY_WIFI_PASSWORD "wifi_password"
+#define KEY_WIFI_BSSID "wifi_bssid"
+#define KEY_WIFI_CHANNEL "wifi_channel"
 #define KEY_TIMER_MODE "timer_mode"
 #define KEY_INTERVAL_MINUTES "interval_min"
 #define KEY_DAILY_LIMIT "daily_limit"
@@ -60,32 +169,40 @@
 #define KEY_WEEKLY_DAY "weekly_day"
 #define KEY_CUSTOM_INTERVALS "custom_intervals"
 #define KEY_LAST_SCHEDULED_UNLOCK "last_scheduled"
+#define KEY_CONFIG_VERSION "config_version"
 
 // Language and Cost Configuration Keys
-#define KEY_CURRENT_LANGUAGE "current_language"
-#define KEY_SUPPORTED_LANGUAGES "supported_languages"
+#define KEY_CURRENT_LANGUAGE "language"
+#define KEY_SUPPORTED_LANGUAGES "languages"
 #define KEY_PRODUCT_NAME "product_name"
 #define KEY_CURRENCY "currency"
 #define KEY_USE_PACK_PRICE "use_pack_price"
 #define KEY_CIGARETTE_COST "cigarette_cost"
 #define KEY_PACK_COST "pack_cost"
-#define KEY_CIGARETTES_PER_PACK "cigarettes_per_pack"
+#define KEY_CIGARETTES_PER_PACK "cigs_per_pack"
 
 // Servo Calibration Keys
-#define KEY_SERVO_LOCKED_POS "servo_locked_pos"
-#define KEY_SERVO_UNLOCKED_POS "servo_unlocked_pos"
+#define KEY_SERVO_LOCKED_POS "servo_locked"
+#define KEY_SERVO_UNLOCKED_POS "servo_unlocked"
 
 // Network Security Keys
 #define KEY_BLOCK_ON_PUBLIC "block_on_public"
-#define KEY_ALLOWED_NETWORKS "allowed_networks"
-#define KEY_BLOCKED_NETWORKS "blocked_networks"
+#define KEY_ALLOWED_NETWORKS "allowed_nets"
+#define KEY_BLOCKED_NETWORKS "blocked_nets"
 
 // AI Configuration Keys
 #define KEY_AI_ENABLED "ai_enabled"
 #define KEY_AI_PROVIDER "ai_provider"
 #define KEY_AI_PERSONALITY "ai_personality"
-#define KEY_AI_DELAY_MINUTES "ai_delay_minutes"
+#define KEY_AI_DELAY_MINUTES "ai_delay_min"
 #define KEY_AI_API_KEY "ai_api_key"
+#define KEY_AI_LOCAL_URL "ai_local_url"
+#define KEY_AI_LOCAL_MODEL "ai_local_model"
+#define KEY_AI_LOCAL_CONNECT "ai_local_conn"
+#define KEY_AI_LOCAL_TIMEOUT "ai_local_tmo"
+
+// Developer Keys
+#define KEY_TRACE_ENABLED "trace_enabled"
 
 // Progress Tracking Keys
 #define KEY_SMOKING_GOAL "smoking_goal"
@@ -0,0 +1,232 @@
+#include "bench.h"
+#include <ArduinoJson.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#define BENCH_BATCH_MIN_NS 2000000ULL   // Batches of at least 2 ms
+#define BENCH_MAX_SAMPLES 50
+#define BENCH_ALLOC_SLACK 0.5           // Extra allocs/op tolerated
+
+// ---- Allocation counting ----
+// The executable's malloc family overrides glibc's, so every allocation in
+// the process comes through here; only the benchmark thread's are counted.
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+
+static __thread bool counting = false;
+static __thread uint64_t allocCount = 0;
+static __thread uint64_t allocBytes = 0;
+
+extern "C" void* malloc(size_t size) {
+    if (counting) {
+        allocCount++;
+        allocBytes += size;
+    }
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    if (counting) {
+        allocCount++;
+        allocBytes += count * size;
+    }
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    if (counting) {
+        allocCount++;
+        allocBytes += size;
+    }
+    return __libc_realloc(pointer, size);
+}
+
+static uint64_t hostNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ---- Runner ----
+
+void BenchSuite::add(const char* name, BenchFunction fn) {
+    entries.push_back({name, fn});
+}
+
+BenchResult BenchSuite::measure(const Entry& entry, uint32_t minTimeMs) {
+    // Warm caches and lazily built state
+    for (int i = 0; i < 3; i++) {
+        entry.fn();
+    }
+
+    // Grow the batch until one batch is long enough to time reliably
+    uint64_t batch = 1;
+    uint64_t batchNs = 0;
+    while (true) {
+        uint64_t start = hostNanos();
+        for (uint64_t i = 0; i < batch; i++) {
+            entry.fn();
+        }
+        batchNs = hostNanos() - start;
+        if (batchNs >= BENCH_BATCH_MIN_NS || batch >= (1ULL << 30)) break;
+        batch *= 2;
+    }
+
+    uint64_t samples = ((uint64_t)minTimeMs * 1000000ULL) / (batchNs > 0 ? batchNs : 1);
+    samples = std::max<uint64_t>(3, std::min<uint64_t>(samples, BENCH_MAX_SAMPLES));
+
+    std::vector<double> perOp;
+    allocCount = 0;
+    allocBytes = 0;
+    for (uint64_t s = 0; s < samples; s++) {
+        counting = true;
+        uint64_t start = hostNanos();
+        for (uint64_t i = 0; i < batch; i++) {
+            entry.fn();
+        }
+        uint64_t elapsed = hostNanos() - start;
+        counting = false;
+        perOp.push_back((double)elapsed / batch);
+    }
+
+    std::sort(perOp.begin(), perOp.end());
+
+    BenchResult result;
+    result.name = entry.name;
+    result.iterations = batch * samples;
+    result.nsPerOp = perOp[perOp.size() / 2];
+    result.allocsPerOp = (double)allocCount / result.iterations;
+    result.bytesPerOp = (double)allocBytes / result.iterations;
+    return result;
+}
+
+static bool loadBaseline(const char* path, std::map<String, BenchResult>& baseline) {
+    std::ifstream file(path);
+    if (!file) {
+        // A comparison against nothing would always pass
+        fprintf(stderr, "bench: no baseline at %s\n", path);
+        return false;
+    }
+    std::stringstream content;
+    content << file.rdbuf();
+
+    DynamicJsonDocument doc(16384);
+    DeserializationError error = deserializeJson(doc, content.str().c_str());
+    if (error) {
+        fprintf(stderr, "bench: baseline %s: %s\n", path, error.c_str());
+        return false;
+    }
+
+    for (JsonObject item : doc["results"].as<JsonArray>()) {
+        BenchResult result;
+        result.name = item["name"].as<String>();
+        result.iterations = item["iterations"] | 0ULL;
+        result.nsPerOp = item["ns_per_op"] | 0.0;
+        result.allocsPerOp = item["allocs_per_op"] | 0.0;
+        result.bytesPerOp = item["bytes_per_op"] | 0.0;
+        baseline[result.name] = result;
+    }
+    return true;
+}
+
+static bool saveResults(const char* path, const std::vector<BenchResult>& results) {
+    DynamicJsonDocument doc(16384);
+    doc["unit"] = "ns";
+    JsonArray list = doc.createNestedArray("results");
+    for (const BenchResult& result : results) {
+        JsonObject item = list.createNestedObject();
+        item["name"] = result.name;
+        item["iterations"] = result.iterations;
+        item["ns_per_op"] = round(result.nsPerOp * 10) / 10;
+        item["ops_per_sec"] = round(1e9 / result.nsPerOp);
+        item["allocs_per_op"] = round(result.allocsPerOp * 100) / 100;
+        item["bytes_per_op"] = round(result.bytesPerOp);
+    }
+
+    String text;
+    serializeJsonPretty(doc, text);
+    std::ofstream file(path);
+    if (!file) {
+        fprintf(stderr, "bench: cannot write %s\n", path);
+        return false;
+    }
+    file << text.c_str() << "\n";
+    return true;
+}
+
+int BenchSuite::run(int argc, char** argv) {
+    const char* filter = NULL;
+    const char* jsonPath = NULL;
+    const char* baselinePath = NULL;
+    uint32_t minTimeMs = 300;
+    double tolerance = 20;
+
+    for (int i = 1; i < argc; i++) {
+        String option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL) {
+            fprintf(stderr, "bench: %s needs a value\n", argv[i]);
+            return 2;
+        }
+        if (option == "--filter") filter = value;
+        else if (option == "--json") jsonPath = value;
+        else if (option == "--baseline") baselinePath = value;
+        else if (option == "--min-time") minTimeMs = atoi(value);
+        else if (option == "--tolerance") tolerance = atof(value);
+        else {
+            fprintf(stderr, "usage: %s [--filter TEXT] [--min-time MS] [--json FILE] [--baseline FILE] [--tolerance PCT]\n", argv[0]);
+            return 2;
+        }
+        i++;
+    }
+
+    std::map<String, BenchResult> baseline;
+    if (baselinePath != NULL && !loadBaseline(baselinePath, baseline)) {
+        return 2;
+    }
+
+    printf("%-46s %12s %12s %10s %10s  %s\n", "benchmark", "ns/op", "ops/s", "allocs/op", "bytes/op", baselinePath ? "vs baseline" : "");
+
+    std::vector<BenchResult> results;
+    int regressions = 0;
+
+    for (const Entry& entry : entries) {
+        if (filter != NULL && strstr(entry.name, filter) == NULL) continue;
+
+        BenchResult result = measure(entry, minTimeMs);
+        results.push_back(result);
+
+        String verdict;
+        auto previous = baseline.find(result.name);
+        if (previous != baseline.end() && previous->second.nsPerOp > 0) {
+            double change = (result.nsPerOp / previous->second.nsPerOp - 1) * 100;
+            char text[48];
+            snprintf(text, sizeof(text), "%+.1f%%", change);
+            verdict = text;
+            if (change > tolerance || result.allocsPerOp > previous->second.allocsPerOp + BENCH_ALLOC_SLACK) {
+                verdict += " REGRESSION";
+                regressions++;
+            }
+        } else if (baselinePath != NULL) {
+            verdict = "new";
+        }
+
+        printf("%-46s %12.1f %12.0f %10.2f %10.0f  %s\n", result.name.c_str(), result.nsPerOp,
+               1e9 / result.nsPerOp, result.allocsPerOp, result.bytesPerOp, verdict.c_str());
+        fflush(stdout);
+    }
+
+    if (jsonPath != NULL && !saveResults(jsonPath, results)) {
+        return 2;
+    }
+
+    if (regressions > 0) {
+        printf("%d benchmark(s) regressed by more than %.0f%%\n", regressions, tolerance);
+        return 1;
+    }
+    return 0;
+}
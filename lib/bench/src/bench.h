@@ -0,0 +1,54 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+
+// Minimal micro-benchmark runner for the native build. Each benchmark is
+// timed on the host clock in batches large enough to swamp timer overhead;
+// the median batch gives ns/op. Heap allocations made by the benchmark
+// thread are counted through malloc, which covers new, String and
+// ArduinoJson alike.
+//
+//   --filter TEXT     only benchmarks whose name contains TEXT
+//   --min-time MS     sampling time per benchmark (default 300)
+//   --json FILE       write the results as JSON (use it to record a baseline)
+//   --baseline FILE   compare against a previous --json file
+//   --tolerance PCT   slowdown that counts as a regression (default 20)
+//
+// Exits with 1 when a benchmark regressed against the baseline.
+
+typedef std::function<void()> BenchFunction;
+
+struct BenchResult {
+    String name;
+    uint64_t iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+class BenchSuite {
+public:
+    void add(const char* name, BenchFunction fn);
+    int run(int argc, char** argv);
+
+private:
+    struct Entry {
+        const char* name;
+        BenchFunction fn;
+    };
+
+    std::vector<Entry> entries;
+
+    BenchResult measure(const Entry& entry, uint32_t minTimeMs);
+};
+
+// Keeps the compiler from discarding a result nobody reads
+template<typename T>
+inline void benchKeep(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+#endif // BENCH_H
@@ -0,0 +1,163 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <ESPAsyncWebServer.h>
+#include <unistd.h>
+#include "native_hal.h"
+#include "bench.h"
+#include "config.h"
+#include "timer.h"
+#include "display.h"
+#include "metered_preferences.h"
+#include "settings_store.h"
+#include "screens.h"
+
+// Hot paths of the firmware, measured on the host against the native HAL
+// with the configuration of a box that has been in use for a month:
+// daily schedule, statistics, allowed/blocked network lists and a station
+// connection to the home network.
+//
+//   pio run -e bench
+//   .pio/build/bench/program --baseline lib/bench/baseline.json
+
+extern MeteredPreferences preferences;
+extern Timer timer;
+extern Display display;
+extern AsyncWebServer server;
+
+String getStatusJSON();
+bool isEmergencyAllowedOnCurrentNetwork();
+
+#define BENCH_EPOCH 1767259800UL   // 2026-01-01 09:30 UTC
+
+static const char* CONFIG_BODY =
+    "{\"timerMode\":4,\"intervalMinutes\":60,\"dailyLimit\":8,"
+    "\"scheduleHour\":22,\"scheduleMinute\":0,\"unlockDuration\":30,\"weekDay\":0}";
+
+static void seedConfiguration() {
+    Preferences seed;
+    seed.begin(PREF_NAMESPACE, false);
+    seed.putString(KEY_WIFI_SSID, "HomeNetwork");
+    seed.putString(KEY_WIFI_PASSWORD, "correct horse");
+    seed.putInt(KEY_TIMER_MODE, DAILY_SCHEDULE);
+    seed.putInt(KEY_INTERVAL_MINUTES, 60);
+    seed.putInt(KEY_DAILY_LIMIT, 8);
+    seed.putInt(KEY_DAILY_HOUR, 22);
+    seed.putInt(KEY_DAILY_MINUTE, 0);
+    seed.putInt(KEY_UNLOCK_DURATION, 30);
+    seed.putInt(KEY_EMERGENCY_COUNT, 1);
+    seed.putInt(KEY_TOTAL_CIGARETTES, 143);
+    seed.putULong64(KEY_DAYS_SMOKE_FREE, 12);
+    seed.putFloat(KEY_MONEY_SAVED, 71.5);
+    seed.putULong64(KEY_TOTAL_DAYS, 30);
+    seed.putInt(KEY_LONGEST_STREAK, 9);
+    seed.putBool(KEY_AI_ENABLED, true);
+    seed.putBool(KEY_BLOCK_ON_PUBLIC, true);
+    // The home network last: the allowed-list scan runs to the end
+    seed.putString(KEY_ALLOWED_NETWORKS, "[\"Office-5G\",\"Parents\",\"Studio\",\"Gym\",\"HomeNetwork\"]");
+    seed.putString(KEY_BLOCKED_NETWORKS, "[\"Airport Free WiFi\",\"Neighbour\",\"Hotel Lobby\"]");
+    seed.end();
+}
+
+static void startFirmware() {
+    // In-process only, on a virtual clock synced to a fixed date
+    char* args[] = {(char*)"bench", (char*)"--port", (char*)"0", (char*)"--virtual-time"};
+    hal.begin(4, args);
+    hal.setWallClock(BENCH_EPOCH);
+    hal.syncWallClock();
+
+    seedConfiguration();
+    setup();
+
+    WiFi.begin("HomeNetwork", "correct horse");
+    hal.advance(2000000);
+    if (WiFi.status() != WL_CONNECTED) {
+        fprintf(stderr, "bench: station did not connect\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    startFirmware();
+
+    BenchSuite suite;
+
+    suite.add("getStatusJSON", [] {
+        String status = getStatusJSON();
+        benchKeep(status);
+    });
+
+    suite.add("isEmergencyAllowedOnCurrentNetwork", [] {
+        bool allowed = isEmergencyAllowedOnCurrentNetwork();
+        benchKeep(allowed);
+    });
+
+    suite.add("Timer::getTimeUntilNextScheduledUnlock/daily", [] {
+        unsigned long seconds = timer.getTimeUntilNextScheduledUnlock();
+        benchKeep(seconds);
+    });
+
+    // The route's decode and validation, without the NVS commit
+    suite.add("/api/config decode", [] {
+        DynamicJsonDocument doc(API_MAX_BODY_SIZE);
+        deserializeJson(doc, CONFIG_BODY);
+        SettingsTransaction transaction;
+        String error;
+        bool valid = stageSettingsSection("timer", doc.as<JsonVariantConst>(), transaction, error);
+        benchKeep(valid);
+    });
+
+    suite.add("POST /api/config (route)", [] {
+        NativeRequest request;
+        request.method = HTTP_POST;
+        request.url = "/api/config";
+        request.body = CONFIG_BODY;
+        NativeResponse response = server.handle(request);
+        benchKeep(response);
+    });
+
+    suite.add("GET /api/status (route)", [] {
+        NativeResponse response = server.handle(HTTP_GET, "/api/status");
+        benchKeep(response);
+    });
+
+    suite.add("Display::showCountdown", [] {
+        display.showCountdown(45296);
+    });
+
+    // Per-frame cost of every screen lib/screens has a golden image for,
+    // I2C flush included, on a panel of its own
+    static Display screen;
+    screen.begin();
+    static std::vector<String> screenNames;
+    screenNames.reserve(screenCases().size());
+    for (size_t i = 0; i < screenCases().size(); i++) {
+        screenNames.push_back(String("Display/") + screenCases()[i].name);
+        suite.add(screenNames.back().c_str(), [i] {
+            static size_t prepared = SIZE_MAX;
+            const ScreenCase& testCase = screenCases()[i];
+            if (prepared != i) {
+                prepareScreen(testCase);
+                prepared = i;
+            }
+            testCase.draw(screen);
+        });
+    }
+
+    // Registered last: switches the schedule for the rest of the run
+    suite.add("Timer::getTimeUntilNextScheduledUnlock/weekly", [] {
+        static bool weekly = false;
+        if (!weekly) {
+            preferences.putInt(KEY_TIMER_MODE, WEEKLY_SCHEDULE);
+            timer.setWeeklySchedule(3, 22, 0, 30);
+            weekly = true;
+        }
+        unsigned long seconds = timer.getTimeUntilNextScheduledUnlock();
+        benchKeep(seconds);
+    });
+
+    int status = suite.run(argc, argv);
+    fflush(stdout);
+    _exit(status);
+}
@@ -0,0 +1,9 @@
+# Extra script for the fuzz envs: sanitizer flags have to reach the link
+# line as well, and libFuzzer only comes with clang
+Import("env")
+
+sanitizers = [flag for flag in env.get("CCFLAGS", []) if isinstance(flag, str) and flag.startswith("-fsanitize")]
+env.Append(LINKFLAGS=[flag for flag in sanitizers if flag not in env.get("LINKFLAGS", [])])
+
+if "-fsanitize=fuzzer" in sanitizers:
+    env.Replace(CC="clang", CXX="clang++")
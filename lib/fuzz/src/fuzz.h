@@ -0,0 +1,32 @@
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fuzz target for the POST routes that decode a JSON body. Each input is
+// sent as the body of one request to the route named by FUZZ_ROUTE, through
+// the real server, admission control and handler code on the native HAL:
+//
+//   config     /api/config
+//   ai         /api/ai/config
+//   security   /api/security/config
+//   chat       /api/ai/chat (inside an open emergency session)
+//   wifi       /api/wifi/connect
+//   settings   /api/settings
+//
+// A hash of the input picks how the body is split into onBody chunks and,
+// for one input in eight, sends it form-encoded instead of as JSON, so the
+// same bytes are tried against every reassembly path. One loop() pass after
+// each request lets the timer and display consume whatever was stored.
+//
+// A route that leaves a request without a response aborts; ASan and UBSan
+// catch the rest.
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv);
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+#define FUZZ_EPOCH 1767259800UL      // 2026-01-01 09:30 UTC
+#define FUZZ_STEP_US 10000000ULL     // Virtual time per input; refills the AI rate limit
+
+#endif // FUZZ_H
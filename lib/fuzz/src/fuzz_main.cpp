@@ -0,0 +1,113 @@
+#include "fuzz.h"
+
+#ifdef FUZZ_LIBFUZZER
+
+// The HAL's weak main() would be linked in place of libFuzzer's, so hand
+// over to the fuzzer explicitly; it still calls LLVMFuzzerInitialize
+extern "C" int LLVMFuzzerRunDriver(int* argc, char*** argv, int (*callback)(const uint8_t* data, size_t size));
+
+int main(int argc, char** argv) {
+    return LLVMFuzzerRunDriver(&argc, &argv, LLVMFuzzerTestOneInput);
+}
+
+#else
+
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Driver for builds without libFuzzer: replays files through the fuzz
+// target, which is enough for the seed corpus, crash reproducers and AFL.
+//
+//   pio run -e fuzz
+//   FUZZ_ROUTE=config .pio/build/fuzz/program lib/fuzz/corpus/config
+//   FUZZ_ROUTE=config afl-fuzz -i lib/fuzz/corpus/config -o findings -- .pio/build/fuzz/program @@
+//
+// Arguments are files or directories of files; with none, one input is read
+// from stdin.
+
+static bool readInput(FILE* file, std::vector<uint8_t>& input) {
+    input.clear();
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        input.insert(input.end(), buffer, buffer + n);
+    }
+    return !ferror(file);
+}
+
+static bool runFile(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL) {
+        fprintf(stderr, "fuzz: cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> input;
+    bool ok = readInput(file, input);
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "fuzz: cannot read %s\n", path.c_str());
+        return false;
+    }
+
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+    return true;
+}
+
+static bool collect(const std::string& path, std::vector<std::string>& files) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        fprintf(stderr, "fuzz: no such file %s\n", path.c_str());
+        return false;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        files.push_back(path);
+        return true;
+    }
+
+    DIR* dir = opendir(path.c_str());
+    if (dir == NULL) return false;
+
+    // Sorted, so a replay is the same sequence every time
+    std::vector<std::string> entries;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        entries.push_back(path + "/" + entry->d_name);
+    }
+    closedir(dir);
+    std::sort(entries.begin(), entries.end());
+    files.insert(files.end(), entries.begin(), entries.end());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    LLVMFuzzerInitialize(&argc, &argv);
+
+    if (argc < 2) {
+        std::vector<uint8_t> input;
+        if (!readInput(stdin, input)) return 2;
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        fflush(stdout);
+        _exit(0);
+    }
+
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        if (!collect(argv[i], files)) _exit(2);
+    }
+
+    for (const std::string& path : files) {
+        if (!runFile(path)) _exit(2);
+    }
+
+    fprintf(stderr, "fuzz: %u input(s) ok\n", (unsigned)files.size());
+    _exit(0);
+}
+
+#endif // FUZZ_LIBFUZZER
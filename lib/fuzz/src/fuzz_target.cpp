@@ -0,0 +1,102 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <ESPAsyncWebServer.h>
+#include <stdlib.h>
+#include "native_hal.h"
+#include "fuzz.h"
+#include "config.h"
+#include "emergency_sessions.h"
+
+extern AsyncWebServer server;
+
+uint32_t startEmergencySession(const String& trigger);
+
+struct FuzzRoute {
+    const char* name;
+    const char* url;
+    bool session;    // A JSON body gets the live session's ID
+};
+
+static const FuzzRoute kRoutes[] = {
+    {"config", "/api/config", false},
+    {"ai", "/api/ai/config", false},
+    {"security", "/api/security/config", false},
+    {"chat", "/api/ai/chat", true},
+    {"wifi", "/api/wifi/connect", false},
+    {"settings", "/api/settings", false}
+};
+
+static const FuzzRoute* fuzzRoute = NULL;
+static uint32_t fuzzSession = 0;
+
+static uint32_t inputHash(const uint8_t* data, size_t size) {
+    // FNV-1a: the same input always gets the same chunking
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv) {
+    const char* name = getenv("FUZZ_ROUTE");
+    if (name == NULL) name = "config";
+
+    for (const FuzzRoute& route : kRoutes) {
+        if (strcmp(route.name, name) == 0) fuzzRoute = &route;
+    }
+    if (fuzzRoute == NULL) {
+        fprintf(stderr, "fuzz: unknown FUZZ_ROUTE %s (config, ai, security, chat, wifi, settings)\n", name);
+        exit(2);
+    }
+
+    // In-process only, on a virtual clock synced to a fixed date
+    char* args[] = {(*argv)[0], (char*)"--port", (char*)"0", (char*)"--virtual-time"};
+    hal.begin(4, args);
+    hal.setSerialOutput(NULL);
+    hal.setWallClock(FUZZ_EPOCH);
+    hal.syncWallClock();
+
+    // The chat route only answers inside a session, with the offline provider
+    Preferences seed;
+    seed.begin(PREF_NAMESPACE, false);
+    seed.putBool(KEY_AI_ENABLED, true);
+    seed.putString(KEY_AI_PROVIDER, "simple");
+    seed.end();
+
+    setup();
+    fuzzSession = startEmergencySession("stress");
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    hal.advance(FUZZ_STEP_US);
+    // Sessions expire after AI_MAX_SESSION_TIME; the chat route needs one
+    if (emergencySessions.count() == 0) {
+        fuzzSession = startEmergencySession("stress");
+    }
+
+    uint32_t hash = inputHash(data, size);
+
+    NativeRequest request;
+    request.method = HTTP_POST;
+    request.url = fuzzRoute->url;
+    request.body = String((const char*)data, size);
+    // Chat messages name the live session, as the web page's do; the
+    // corpus cannot, since session IDs are random
+    if (fuzzRoute->session && size > 0 && data[0] == '{') {
+        request.body = "{\"sessionId\":\"" + String(fuzzSession, HEX) + "\"," + request.body.substring(1);
+    }
+    request.contentType = (hash & 7) == 0 ? "application/x-www-form-urlencoded" : "application/json";
+    // Whole body, or chunks of 1..64 bytes
+    request.chunkSize = (hash & 8) ? 0 : 1 + ((hash >> 4) & 63);
+
+    NativeResponse response = server.handle(request);
+    if (response.code == 0) {
+        fprintf(stderr, "fuzz: %s left the request without a response\n", fuzzRoute->url);
+        abort();
+    }
+
+    loop();
+    return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef ADAFRUIT_SSD1306_H
+#define ADAFRUIT_SSD1306_H
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_EXTERNALVCC 0x01
+
+// Monochrome panel stand-in. The buffer uses the SSD1306 page layout (one
+// byte is eight vertical pixels); display() hands the frame to NativeHal.
+class Adafruit_SSD1306 : public Adafruit_GFX {
+public:
+    Adafruit_SSD1306(uint8_t w, uint8_t h, TwoWire* wire = &Wire, int8_t resetPin = -1);
+    ~Adafruit_SSD1306();
+
+    bool begin(uint8_t vccState = SSD1306_SWITCHCAPVCC, uint8_t address = 0, bool reset = true, bool periphBegin = true);
+    void display();
+    void clearDisplay();
+    void invertDisplay(bool invert) { inverted = invert; }
+    void dim(bool dimmed) { (void)dimmed; }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    bool getPixel(int16_t x, int16_t y) const;
+    uint8_t* getBuffer() { return buffer; }
+    size_t bufferSize() const { return (size_t)_width * ((_height + 7) / 8); }
+    bool isInverted() const { return inverted; }
+
+private:
+    uint8_t* buffer;
+    bool inverted;
+};
+
+#endif // ADAFRUIT_SSD1306_H
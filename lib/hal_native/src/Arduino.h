@@ -0,0 +1,131 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+// Arduino core stand-in for the native build. Timing, GPIO and the chip
+// queries are served by NativeHal (native_hal.h).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include "WString.h"
+#include "IPAddress.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define PROGMEM
+#define PI 3.1415926535897932384626433832795
+
+using std::min;
+using std::max;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1, const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* text) { return text == NULL ? 0 : write((const uint8_t*)text, strlen(text)); }
+
+    size_t print(const String& value) { return write((const uint8_t*)value.c_str(), value.length()); }
+    size_t print(const char* value) { return write(value); }
+    size_t print(char value) { return write((uint8_t)value); }
+    template<typename T> size_t print(T value) { return print(String(value)); }
+
+    size_t println() { return write("\r\n"); }
+    template<typename T> size_t println(T value) { return print(value) + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    void setTimeout(unsigned long timeout) { (void)timeout; }
+};
+
+// Writes to NativeHal::getSerialOutput(), stdout by default
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void end() {}
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    void flush();
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// Heap and chip queries; the heap figures are the ones NativeHal is told
+// to report, so low-memory paths can be exercised off-device
+class EspClass {
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getHeapSize();
+    uint32_t getPsramSize();
+    uint32_t getFreePsram();
+    uint32_t getFlashChipSize() { return 8 * 1024 * 1024; }
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint64_t getEfuseMac() { return 0x0000AABBCCDDEEFFULL; }
+    const char* getSdkVersion() { return "native"; }
+    void restart();
+};
+
+extern EspClass ESP;
+
+// No PSRAM off-device; ps_malloc() is plain malloc()
+bool psramFound();
+void* ps_malloc(size_t size);
+
+void setup();
+void loop();
+
+#endif // ARDUINO_H
@@ -0,0 +1,53 @@
+#ifndef ASYNCTCP_H
+#define ASYNCTCP_H
+
+#include <Arduino.h>
+#include <deque>
+#include <mutex>
+#include <string>
+
+// Every server callback runs with this lock held, as every callback runs
+// in the async_tcp task on the ESP32. Code that injects requests or
+// writes to sockets from another thread takes it too.
+std::recursive_mutex& asyncTcpLock();
+
+// One TCP connection. Outgoing data is queued per write and drained by the
+// server thread; space() models the lwIP send window the firmware checks
+// before queueing more. A client without a socket (fd -1) belongs to an
+// in-process request and is drained by whoever issued it.
+class AsyncClient {
+public:
+    static const size_t SEND_WINDOW = 5744;   // TCP_SND_BUF on the ESP32
+
+    AsyncClient(int fd = -1, IPAddress ip = IPAddress(127, 0, 0, 1))
+        : socketFd(fd), ip(ip), queuedBytes(0), closeRequested(false), abortRequested(false) {}
+
+    IPAddress remoteIP() const { return ip; }
+    bool connected() const { return !closeRequested; }
+    // close(true) aborts: whatever is still queued is dropped
+    void close(bool now = false) { closeRequested = true; abortRequested = abortRequested || now; }
+    size_t space() const { return queuedBytes >= SEND_WINDOW ? 0 : SEND_WINDOW - queuedBytes; }
+    bool canSend() const { return space() > 0; }
+    size_t add(const char* data, size_t size);
+    bool send() { return true; }
+
+    // Native side
+    int fd() const { return socketFd; }
+    bool closing() const { return closeRequested; }
+    bool aborting() const { return abortRequested; }
+    size_t queuedWrites() const { return outbox.size(); }
+    size_t pendingBytes() const { return queuedBytes; }
+    bool flush();                             // false once the socket fails
+    void shutdown();                          // Closes the socket, drops the queue
+    std::string drain();                      // In-process clients
+
+private:
+    int socketFd;
+    IPAddress ip;
+    std::deque<std::string> outbox;
+    size_t queuedBytes;
+    bool closeRequested;
+    bool abortRequested;
+};
+
+#endif // ASYNCTCP_H
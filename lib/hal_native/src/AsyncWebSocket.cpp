@@ -0,0 +1,360 @@
+#include "AsyncWebSocket.h"
+#include <chrono>
+
+#define WS_MAX_FRAME_SIZE 65536
+
+static const char* WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+static uint64_t hostMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void sha1(const std::string& message, uint8_t digest[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    std::string data = message;
+    uint64_t bits = (uint64_t)message.size() * 8;
+    data += (char)0x80;
+    while (data.size() % 64 != 56) data += (char)0x00;
+    for (int i = 7; i >= 0; i--) data += (char)((bits >> (i * 8)) & 0xFF);
+
+    for (size_t block = 0; block < data.size(); block += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t* p = (const uint8_t*)data.data() + block + i * 4;
+            w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+        }
+        for (int i = 16; i < 80; i++) {
+            uint32_t v = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+            w[i] = (v << 1) | (v >> 31);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+            uint32_t temp = ((a << 5) | (a >> 27)) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = (b << 30) | (b >> 2);
+            b = a;
+            a = temp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        digest[i * 4] = h[i] >> 24;
+        digest[i * 4 + 1] = h[i] >> 16;
+        digest[i * 4 + 2] = h[i] >> 8;
+        digest[i * 4 + 3] = h[i];
+    }
+}
+
+static String base64(const uint8_t* data, size_t len) {
+    static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = data[i] << 16;
+        if (i + 1 < len) v |= data[i + 1] << 8;
+        if (i + 2 < len) v |= data[i + 2];
+        out += alphabet[(v >> 18) & 0x3F];
+        out += alphabet[(v >> 12) & 0x3F];
+        out += i + 1 < len ? alphabet[(v >> 6) & 0x3F] : '=';
+        out += i + 2 < len ? alphabet[v & 0x3F] : '=';
+    }
+    return String(out);
+}
+
+// ---- AsyncWebSocketClient ----
+
+AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebSocket* server, AsyncClient* client, uint32_t id)
+    : _server(server), _client(client), _id(id), _status(WS_CONNECTED), _disconnectedAt(0), _messageOpcode(WS_TEXT) {}
+
+AsyncWebSocketClient::~AsyncWebSocketClient() {
+    delete _client;
+}
+
+void AsyncWebSocketClient::sendFrame(uint8_t opcode, const uint8_t* data, size_t len) {
+    std::string frame;
+    frame += (char)(0x80 | opcode);
+    if (len < 126) {
+        frame += (char)len;
+    } else if (len < 65536) {
+        frame += (char)126;
+        frame += (char)(len >> 8);
+        frame += (char)(len & 0xFF);
+    } else {
+        frame += (char)127;
+        for (int i = 7; i >= 0; i--) frame += (char)(((uint64_t)len >> (i * 8)) & 0xFF);
+    }
+    frame.append((const char*)data, len);
+    _client->add(frame.data(), frame.size());
+}
+
+void AsyncWebSocketClient::text(const char* message, size_t len) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    // A full queue drops the message, as the library does
+    if (queueIsFull()) return;
+    sendFrame(WS_TEXT, (const uint8_t*)message, len);
+}
+
+void AsyncWebSocketClient::binary(const uint8_t* message, size_t len) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    if (queueIsFull()) return;
+    sendFrame(WS_BINARY, message, len);
+}
+
+void AsyncWebSocketClient::ping(const uint8_t* data, size_t len) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    if (_status != WS_CONNECTED) return;
+    sendFrame(WS_PING, data, len);
+}
+
+void AsyncWebSocketClient::close(uint16_t code, const char* message) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    if (_status != WS_CONNECTED) return;
+
+    std::string payload;
+    if (code != 0) {
+        payload += (char)(code >> 8);
+        payload += (char)(code & 0xFF);
+        if (message != NULL) payload += message;
+    }
+    sendFrame(WS_DISCONNECT, (const uint8_t*)payload.data(), payload.size());
+    _status = WS_DISCONNECTING;
+    _client->close();
+}
+
+void AsyncWebSocketClient::disconnected() {
+    if (_status == WS_DISCONNECTED) return;
+    _status = WS_DISCONNECTED;
+    _disconnectedAt = hostMillis();
+    _server->handleEvent(this, WS_EVT_DISCONNECT, NULL, NULL, 0);
+}
+
+void AsyncWebSocketClient::receive(const uint8_t* data, size_t len) {
+    _input.append((const char*)data, len);
+
+    while (_input.size() >= 2 && _status != WS_DISCONNECTED) {
+        const uint8_t* p = (const uint8_t*)_input.data();
+        bool final = (p[0] & 0x80) != 0;
+        uint8_t opcode = p[0] & 0x0F;
+        bool masked = (p[1] & 0x80) != 0;
+        uint64_t payloadLen = p[1] & 0x7F;
+        size_t headerLen = 2;
+
+        if (payloadLen == 126) {
+            if (_input.size() < 4) return;
+            payloadLen = ((uint64_t)p[2] << 8) | p[3];
+            headerLen = 4;
+        } else if (payloadLen == 127) {
+            if (_input.size() < 10) return;
+            payloadLen = 0;
+            for (int i = 0; i < 8; i++) payloadLen = (payloadLen << 8) | p[2 + i];
+            headerLen = 10;
+        }
+
+        if (payloadLen > WS_MAX_FRAME_SIZE || _message.size() + payloadLen > WS_MAX_FRAME_SIZE) {
+            close(1009, "Message too big");
+            _input.clear();
+            return;
+        }
+
+        size_t maskOffset = headerLen;
+        if (masked) headerLen += 4;
+        if (_input.size() < headerLen + payloadLen) return;
+
+        AwsFrameInfo info = {};
+        info.final = final;
+        info.masked = masked;
+        info.opcode = opcode;
+        std::string payload = _input.substr(headerLen, payloadLen);
+        if (masked) {
+            memcpy(info.mask, p + maskOffset, 4);
+            for (size_t i = 0; i < payload.size(); i++) payload[i] ^= info.mask[i % 4];
+        }
+        _input.erase(0, headerLen + payloadLen);
+
+        switch (opcode) {
+            case WS_DISCONNECT:
+                if (_status == WS_CONNECTED) {
+                    uint16_t code = payload.size() >= 2 ? ((uint8_t)payload[0] << 8) | (uint8_t)payload[1] : 1000;
+                    close(code);
+                } else {
+                    _client->close();
+                }
+                return;
+
+            case WS_PING:
+                if (_status == WS_CONNECTED) {
+                    sendFrame(WS_PONG, (const uint8_t*)payload.data(), payload.size());
+                }
+                break;
+
+            case WS_PONG:
+                _server->handleEvent(this, WS_EVT_PONG, NULL, (uint8_t*)&payload[0], payload.size());
+                break;
+
+            case WS_TEXT:
+            case WS_BINARY:
+            case WS_CONTINUATION:
+                if (opcode != WS_CONTINUATION) {
+                    _messageOpcode = opcode;
+                    _message.clear();
+                }
+                _message += payload;
+                if (final) {
+                    // Handlers get the whole message, NUL-terminated like text
+                    // frames in the library
+                    info.message_opcode = _messageOpcode;
+                    info.opcode = _messageOpcode;
+                    info.len = _message.size();
+                    std::string message;
+                    message.swap(_message);
+                    _server->handleEvent(this, WS_EVT_DATA, &info, (uint8_t*)&message[0], message.size());
+                }
+                break;
+
+            default:
+                close(1002, "Protocol error");
+                return;
+        }
+    }
+}
+
+// ---- AsyncWebSocket ----
+
+AsyncWebSocket::AsyncWebSocket(const String& url) : _url(url), _enabled(true), _nextId(1) {}
+
+AsyncWebSocket::~AsyncWebSocket() {
+    for (AsyncWebSocketClient* client : _clients) delete client;
+}
+
+size_t AsyncWebSocket::count() const {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    size_t connected = 0;
+    for (AsyncWebSocketClient* client : _clients) {
+        if (client->status() == WS_CONNECTED) connected++;
+    }
+    return connected;
+}
+
+AsyncWebSocketClient* AsyncWebSocket::client(uint32_t id) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    for (AsyncWebSocketClient* client : _clients) {
+        if (client->id() == id && client->status() == WS_CONNECTED) return client;
+    }
+    return NULL;
+}
+
+bool AsyncWebSocket::availableForWriteAll() {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    for (AsyncWebSocketClient* client : _clients) {
+        if (client->status() == WS_CONNECTED && client->queueIsFull()) return false;
+    }
+    return true;
+}
+
+void AsyncWebSocket::close(uint32_t id, uint16_t code, const char* message) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    AsyncWebSocketClient* target = client(id);
+    if (target != NULL) target->close(code, message);
+}
+
+void AsyncWebSocket::closeAll(uint16_t code, const char* message) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    for (AsyncWebSocketClient* client : _clients) client->close(code, message);
+}
+
+void AsyncWebSocket::cleanupClients(uint16_t maxClients) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    if (count() <= maxClients) return;
+    for (AsyncWebSocketClient* client : _clients) {
+        if (client->status() == WS_CONNECTED) {
+            client->close();
+            return;
+        }
+    }
+}
+
+void AsyncWebSocket::ping(uint32_t id, const uint8_t* data, size_t len) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    AsyncWebSocketClient* target = client(id);
+    if (target != NULL) target->ping(data, len);
+}
+
+void AsyncWebSocket::pingAll(const uint8_t* data, size_t len) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    for (AsyncWebSocketClient* client : _clients) client->ping(data, len);
+}
+
+void AsyncWebSocket::text(uint32_t id, const char* message, size_t len) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    AsyncWebSocketClient* target = client(id);
+    if (target != NULL) target->text(message, len);
+}
+
+void AsyncWebSocket::textAll(const char* message, size_t len) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    for (AsyncWebSocketClient* client : _clients) {
+        if (client->status() == WS_CONNECTED) client->text(message, len);
+    }
+}
+
+bool AsyncWebSocket::canHandle(AsyncWebServerRequest* request) {
+    if (!_enabled || request->method() != HTTP_GET || request->url() != _url) {
+        return false;
+    }
+    AsyncWebHeader* upgrade = request->getHeader("Upgrade");
+    if (upgrade == NULL || !request->hasHeader("Sec-WebSocket-Key")) {
+        return false;
+    }
+    String value = upgrade->value();
+    value.toLowerCase();
+    return value == "websocket";
+}
+
+void AsyncWebSocket::handleRequest(AsyncWebServerRequest* request) {
+    request->send(new AsyncWebSocketResponse(request->getHeader("Sec-WebSocket-Key")->value(), this));
+}
+
+AsyncWebSocketClient* AsyncWebSocket::attachClient(AsyncClient* tcp) {
+    AsyncWebSocketClient* client = new AsyncWebSocketClient(this, tcp, _nextId++);
+    _clients.push_back(client);
+    handleEvent(client, WS_EVT_CONNECT, NULL, NULL, 0);
+    return client;
+}
+
+void AsyncWebSocket::handleEvent(AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len) {
+    if (_eventHandler) {
+        _eventHandler(this, client, type, arg, data, len);
+    }
+}
+
+void AsyncWebSocket::reapClients(unsigned long graceMs) {
+    // Disconnected clients linger briefly so a pointer fetched with client()
+    // just before the disconnect stays valid
+    uint64_t now = hostMillis();
+    for (auto it = _clients.begin(); it != _clients.end();) {
+        if ((*it)->status() == WS_DISCONNECTED && now - (*it)->disconnectedAt() > graceMs) {
+            delete *it;
+            it = _clients.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+AsyncWebSocketResponse::AsyncWebSocketResponse(const String& key, AsyncWebSocket* server)
+    : AsyncWebServerResponse(101), _server(server) {
+    uint8_t digest[20];
+    sha1((key + WS_GUID).str(), digest);
+    addHeader("Upgrade", "websocket");
+    addHeader("Connection", "Upgrade");
+    addHeader("Sec-WebSocket-Accept", base64(digest, sizeof(digest)));
+}
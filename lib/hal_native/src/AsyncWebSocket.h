@@ -0,0 +1,127 @@
+#ifndef ASYNCWEBSOCKET_H
+#define ASYNCWEBSOCKET_H
+
+#include <Arduino.h>
+#include "ESPAsyncWebServer.h"
+
+// RFC 6455 server side of the ESPAsyncWebServer stand-in: text, binary,
+// ping/pong and close frames, with the library's event callback and
+// per-client message queue limit.
+
+#define WS_MAX_QUEUED_MESSAGES 32
+
+typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
+typedef enum { WS_DISCONNECTED, WS_CONNECTED, WS_DISCONNECTING } AwsClientStatus;
+typedef enum { WS_CONTINUATION, WS_TEXT, WS_BINARY, WS_DISCONNECT = 0x08, WS_PING, WS_PONG } AwsFrameType;
+
+typedef struct {
+    uint8_t message_opcode;
+    uint32_t num;
+    uint8_t final;
+    uint8_t masked;
+    uint8_t opcode;
+    uint64_t len;
+    uint8_t mask[4];
+    uint64_t index;
+} AwsFrameInfo;
+
+class AsyncWebSocket;
+
+class AsyncWebSocketClient {
+public:
+    AsyncWebSocketClient(AsyncWebSocket* server, AsyncClient* client, uint32_t id);
+    ~AsyncWebSocketClient();
+
+    uint32_t id() const { return _id; }
+    AwsClientStatus status() const { return _status; }
+    AsyncClient* client() { return _client; }
+    IPAddress remoteIP() const { return _client->remoteIP(); }
+    AsyncWebSocket* server() { return _server; }
+
+    void close(uint16_t code = 0, const char* message = NULL);
+    void ping(const uint8_t* data = NULL, size_t len = 0);
+    void keepAlivePeriod(uint16_t seconds) { (void)seconds; }
+    bool queueIsFull() const { return _status != WS_CONNECTED || _client->queuedWrites() >= WS_MAX_QUEUED_MESSAGES; }
+    size_t queueLen() const { return _client->queuedWrites(); }
+    bool canSend() const { return !queueIsFull() && _client->canSend(); }
+
+    void text(const char* message, size_t len);
+    void text(const char* message) { text(message, strlen(message)); }
+    void text(const String& message) { text(message.c_str(), message.length()); }
+    void binary(const uint8_t* message, size_t len);
+
+    // Native side
+    void receive(const uint8_t* data, size_t len);    // Bytes off the socket
+    void disconnected();                              // Socket gone
+    unsigned long disconnectedAt() const { return _disconnectedAt; }
+
+private:
+    AsyncWebSocket* _server;
+    AsyncClient* _client;
+    uint32_t _id;
+    AwsClientStatus _status;
+    unsigned long _disconnectedAt;
+    std::string _input;
+    std::string _message;           // Fragmented message so far
+    uint8_t _messageOpcode;
+
+    void sendFrame(uint8_t opcode, const uint8_t* data, size_t len);
+};
+
+typedef std::function<void(AsyncWebSocket*, AsyncWebSocketClient*, AwsEventType, void*, uint8_t*, size_t)> AwsEventHandler;
+
+class AsyncWebSocket : public AsyncWebHandler {
+public:
+    AsyncWebSocket(const String& url);
+    ~AsyncWebSocket();
+
+    const char* url() const { return _url.c_str(); }
+    void enable(bool enabled) { _enabled = enabled; }
+    bool enabled() const { return _enabled; }
+    void onEvent(AwsEventHandler handler) { _eventHandler = handler; }
+
+    size_t count() const;
+    AsyncWebSocketClient* client(uint32_t id);
+    bool hasClient(uint32_t id) { return client(id) != NULL; }
+    bool availableForWriteAll();
+
+    void close(uint32_t id, uint16_t code = 0, const char* message = NULL);
+    void closeAll(uint16_t code = 0, const char* message = NULL);
+    void cleanupClients(uint16_t maxClients = 8);
+    void ping(uint32_t id, const uint8_t* data = NULL, size_t len = 0);
+    void pingAll(const uint8_t* data = NULL, size_t len = 0);
+    void text(uint32_t id, const char* message, size_t len);
+    void text(uint32_t id, const String& message) { text(id, message.c_str(), message.length()); }
+    void textAll(const char* message, size_t len);
+    void textAll(const char* message) { textAll(message, strlen(message)); }
+    void textAll(const String& message) { textAll(message.c_str(), message.length()); }
+
+    bool canHandle(AsyncWebServerRequest* request) override;
+    void handleRequest(AsyncWebServerRequest* request) override;
+
+    // Native side
+    AsyncWebSocketClient* attachClient(AsyncClient* client);
+    void handleEvent(AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len);
+    void reapClients(unsigned long graceMs);
+
+private:
+    String _url;
+    bool _enabled;
+    uint32_t _nextId;
+    AwsEventHandler _eventHandler;
+    std::vector<AsyncWebSocketClient*> _clients;
+};
+
+// 101 Switching Protocols; the connection becomes a socket client after
+// it is written
+class AsyncWebSocketResponse : public AsyncWebServerResponse {
+public:
+    AsyncWebSocketResponse(const String& key, AsyncWebSocket* server);
+    bool upgradesToWebSocket() const override { return true; }
+    AsyncWebSocket* socketServer() { return _server; }
+
+private:
+    AsyncWebSocket* _server;
+};
+
+#endif // ASYNCWEBSOCKET_H
@@ -0,0 +1,21 @@
+#ifndef ESP32SERVO_H
+#define ESP32SERVO_H
+
+#include <Arduino.h>
+
+// Servo PWM stand-in: the commanded angle goes to NativeHal
+class Servo {
+public:
+    Servo() : pin(-1), angle(-1) {}
+    int attach(int servoPin, int minUs = 544, int maxUs = 2400);
+    void detach() { pin = -1; }
+    bool attached() const { return pin >= 0; }
+    void write(int value);
+    int read() const { return angle; }
+
+private:
+    int pin;
+    int angle;
+};
+
+#endif // ESP32SERVO_H
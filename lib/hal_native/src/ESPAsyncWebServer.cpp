@@ -0,0 +1,855 @@
+#include "ESPAsyncWebServer.h"
+#include "AsyncWebSocket.h"
+#include "native_hal.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <list>
+#include <memory>
+
+#define NATIVE_HEAD_LIMIT 8192
+#define NATIVE_IDLE_TIMEOUT_MS 30000
+#define NATIVE_CHUNK_SIZE 1460
+#define NATIVE_SOCKET_GRACE_MS 1000
+
+std::recursive_mutex& asyncTcpLock() {
+    static std::recursive_mutex lock;
+    return lock;
+}
+
+static uint64_t hostMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static String urlDecode(const String& text) {
+    std::string out;
+    const std::string& in = text.str();
+    for (size_t i = 0; i < in.length(); i++) {
+        if (in[i] == '+') {
+            out += ' ';
+        } else if (in[i] == '%' && i + 2 < in.length() && isxdigit((unsigned char)in[i + 1]) && isxdigit((unsigned char)in[i + 2])) {
+            out += (char)strtol(in.substr(i + 1, 2).c_str(), NULL, 16);
+            i += 2;
+        } else {
+            out += in[i];
+        }
+    }
+    return String(out);
+}
+
+static const char* reasonPhrase(int code) {
+    switch (code) {
+        case 101: return "Switching Protocols";
+        case 200: return "OK";
+        case 201: return "Created";
+        case 202: return "Accepted";
+        case 204: return "No Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 429: return "Too Many Requests";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return "";
+    }
+}
+
+static String contentTypeFor(const String& path) {
+    if (path.endsWith(".html") || path.endsWith(".htm")) return "text/html";
+    if (path.endsWith(".css")) return "text/css";
+    if (path.endsWith(".js")) return "application/javascript";
+    if (path.endsWith(".json")) return "application/json";
+    if (path.endsWith(".png")) return "image/png";
+    if (path.endsWith(".ico")) return "image/x-icon";
+    if (path.endsWith(".svg")) return "image/svg+xml";
+    if (path.endsWith(".txt")) return "text/plain";
+    return "application/octet-stream";
+}
+
+// ---- AsyncClient ----
+
+size_t AsyncClient::add(const char* data, size_t size) {
+    if (closeRequested || size == 0) return 0;
+    outbox.push_back(std::string(data, size));
+    queuedBytes += size;
+    return size;
+}
+
+bool AsyncClient::flush() {
+    if (socketFd < 0) return true;
+
+    while (!outbox.empty()) {
+        std::string& front = outbox.front();
+        ssize_t written = ::send(socketFd, front.data(), front.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        queuedBytes -= written;
+        if ((size_t)written < front.size()) {
+            front.erase(0, written);
+            return true;
+        }
+        outbox.pop_front();
+    }
+    return true;
+}
+
+void AsyncClient::shutdown() {
+    if (socketFd >= 0) {
+        ::close(socketFd);
+        socketFd = -1;
+    }
+    outbox.clear();
+    queuedBytes = 0;
+    closeRequested = true;
+}
+
+std::string AsyncClient::drain() {
+    std::string out;
+    while (!outbox.empty()) {
+        out += outbox.front();
+        outbox.pop_front();
+    }
+    queuedBytes = 0;
+    return out;
+}
+
+// ---- AsyncWebServerRequest ----
+
+AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* server, AsyncClient* client)
+    : _tempObject(NULL), _server(server), _client(client), _handler(NULL), _response(NULL),
+      _method(HTTP_GET), _contentLength(0) {}
+
+AsyncWebServerRequest::~AsyncWebServerRequest() {
+    if (_onDisconnect) {
+        _onDisconnect();
+    }
+    for (AsyncWebParameter* param : _params) delete param;
+    for (AsyncWebHeader* header : _headers) delete header;
+    delete _response;
+    if (_tempObject != NULL) {
+        free(_tempObject);
+    }
+}
+
+const String& AsyncWebServerRequest::methodToString() const {
+    static const String names[] = {"GET", "POST", "DELETE", "PUT", "PATCH", "HEAD", "OPTIONS", "UNKNOWN"};
+    for (int i = 0; i < 7; i++) {
+        if (_method == (1 << i)) return names[i];
+    }
+    return names[7];
+}
+
+void AsyncWebServerRequest::addParam(const String& name, const String& value, bool post) {
+    _params.push_back(new AsyncWebParameter(name, value, post));
+}
+
+void AsyncWebServerRequest::parseQuery(const String& query, bool post) {
+    int start = 0;
+    while (start < (int)query.length()) {
+        int end = query.indexOf('&', start);
+        if (end < 0) end = query.length();
+        String pair = query.substring(start, end);
+        if (pair.length() > 0) {
+            int equals = pair.indexOf('=');
+            if (equals < 0) {
+                addParam(urlDecode(pair), String(), post);
+            } else {
+                addParam(urlDecode(pair.substring(0, equals)), urlDecode(pair.substring(equals + 1)), post);
+            }
+        }
+        start = end + 1;
+    }
+}
+
+bool AsyncWebServerRequest::hasParam(const String& name, bool post, bool file) const {
+    return getParam(name, post, file) != NULL;
+}
+
+AsyncWebParameter* AsyncWebServerRequest::getParam(const String& name, bool post, bool file) const {
+    for (AsyncWebParameter* param : _params) {
+        if (param->name() == name && param->isPost() == post && param->isFile() == file) {
+            return param;
+        }
+    }
+    return NULL;
+}
+
+bool AsyncWebServerRequest::hasArg(const char* name) const {
+    for (AsyncWebParameter* param : _params) {
+        if (param->name() == name) return true;
+    }
+    return false;
+}
+
+const String& AsyncWebServerRequest::arg(const String& name) const {
+    static const String empty;
+    for (AsyncWebParameter* param : _params) {
+        if (param->name() == name) return param->value();
+    }
+    return empty;
+}
+
+bool AsyncWebServerRequest::hasHeader(const String& name) const {
+    return getHeader(name) != NULL;
+}
+
+AsyncWebHeader* AsyncWebServerRequest::getHeader(const String& name) const {
+    String wanted = name;
+    wanted.toLowerCase();
+    for (AsyncWebHeader* header : _headers) {
+        String candidate = header->name();
+        candidate.toLowerCase();
+        if (candidate == wanted) return header;
+    }
+    return NULL;
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse* response) {
+    // Like the library, only the first response counts
+    if (_response != NULL) {
+        delete response;
+        return;
+    }
+    _response = response;
+}
+
+void AsyncWebServerRequest::send(int code, const String& contentType, const String& content) {
+    send(beginResponse(code, contentType, content));
+}
+
+void AsyncWebServerRequest::send(fs::FS& fs, const String& path, const String& contentType, bool download) {
+    std::string content;
+    if (!fs.readFile(path.c_str(), content)) {
+        send(404);
+        return;
+    }
+    AsyncWebServerResponse* response = beginResponse(200, contentType.length() ? contentType : contentTypeFor(path), String(content));
+    if (download) {
+        response->addHeader("Content-Disposition", "attachment");
+    }
+    send(response);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int code, const String& contentType, const String& content) {
+    return new AsyncWebServerResponse(code, contentType, content);
+}
+
+AsyncResponseStream* AsyncWebServerRequest::beginResponseStream(const String& contentType, size_t bufferSize) {
+    (void)bufferSize;
+    return new AsyncResponseStream(contentType);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginChunkedResponse(const String& contentType, AwsResponseFiller filler) {
+    return new AsyncChunkedResponse(contentType, filler);
+}
+
+// ---- Handlers ----
+
+AsyncStaticWebHandler::AsyncStaticWebHandler(const char* uri, fs::FS& fs, const char* path, const char* cacheControl)
+    : uri(uri), fs(fs), path(path), defaultFile("index.htm"), cacheControl(cacheControl != NULL ? cacheControl : "") {
+    if (this->uri.endsWith("/") && this->uri.length() > 1) {
+        this->uri = this->uri.substring(0, this->uri.length() - 1);
+    }
+    if (this->path.endsWith("/")) {
+        this->path = this->path.substring(0, this->path.length() - 1);
+    }
+}
+
+String AsyncStaticWebHandler::resolve(const String& url) {
+    String rest = uri == "/" ? url : url.substring(uri.length());
+    String file = path + rest;
+
+    if (file.length() == 0 || file.endsWith("/")) {
+        file += defaultFile;
+    } else if (!fs.exists(file) && file.lastIndexOf('.') <= file.lastIndexOf('/')) {
+        file += "/" + defaultFile;
+    }
+    return fs.exists(file) ? file : String();
+}
+
+bool AsyncStaticWebHandler::canHandle(AsyncWebServerRequest* request) {
+    if (request->method() != HTTP_GET || !request->url().startsWith(uri)) {
+        return false;
+    }
+    return resolve(request->url()).length() > 0;
+}
+
+void AsyncStaticWebHandler::handleRequest(AsyncWebServerRequest* request) {
+    String file = resolve(request->url());
+    std::string content;
+    if (file.length() == 0 || !fs.readFile(file.c_str(), content)) {
+        request->send(404);
+        return;
+    }
+    AsyncWebServerResponse* response = request->beginResponse(200, contentTypeFor(file), String(content));
+    if (cacheControl.length()) {
+        response->addHeader("Cache-Control", cacheControl);
+    }
+    request->send(response);
+}
+
+bool AsyncCallbackWebHandler::canHandle(AsyncWebServerRequest* request) {
+    if (!requestFn || !(method & request->method())) {
+        return false;
+    }
+
+    // Same URI rules as the library: "/*.ext", "prefix*", exact or subpath
+    if (uri.length() && uri.startsWith("/*.")) {
+        return request->url().endsWith(uri.substring(uri.lastIndexOf('.')));
+    }
+    if (uri.length() && uri.endsWith("*")) {
+        return request->url().startsWith(uri.substring(0, uri.length() - 1));
+    }
+    if (uri.length() && uri != request->url() && !request->url().startsWith(uri + "/")) {
+        return false;
+    }
+    return true;
+}
+
+void AsyncCallbackWebHandler::handleRequest(AsyncWebServerRequest* request) {
+    if (requestFn) {
+        requestFn(request);
+    } else {
+        request->send(500);
+    }
+}
+
+void AsyncCallbackWebHandler::handleUpload(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final) {
+    if (uploadFn) {
+        uploadFn(request, filename, index, data, len, final);
+    }
+}
+
+void AsyncCallbackWebHandler::handleBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+    if (bodyFn) {
+        bodyFn(request, data, len, index, total);
+    }
+}
+
+DefaultHeaders& DefaultHeaders::Instance() {
+    static DefaultHeaders instance;
+    return instance;
+}
+
+// ---- AsyncWebServer ----
+
+String NativeResponse::header(const String& name) const {
+    String wanted = name;
+    wanted.toLowerCase();
+    for (const auto& header : headers) {
+        String candidate = header.first;
+        candidate.toLowerCase();
+        if (candidate == wanted) return header.second;
+    }
+    return String();
+}
+
+AsyncWebServer::AsyncWebServer(uint16_t port) : port(port), listenFd(-1), running(false) {
+    catchAll.setUri("");
+}
+
+AsyncWebServer::~AsyncWebServer() {
+    end();
+}
+
+AsyncWebHandler& AsyncWebServer::addHandler(AsyncWebHandler* handler) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    handlers.push_back(handler);
+    return *handler;
+}
+
+bool AsyncWebServer::removeHandler(AsyncWebHandler* handler) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    for (auto it = handlers.begin(); it != handlers.end(); ++it) {
+        if (*it == handler) {
+            handlers.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+AsyncStaticWebHandler& AsyncWebServer::serveStatic(const char* uri, fs::FS& fs, const char* path, const char* cacheControl) {
+    AsyncStaticWebHandler* handler = new AsyncStaticWebHandler(uri, fs, path, cacheControl);
+    addHandler(handler);
+    return *handler;
+}
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, ArRequestHandlerFunction onRequest) {
+    return on(uri, HTTP_ANY, onRequest, NULL, NULL);
+}
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest) {
+    return on(uri, method, onRequest, NULL, NULL);
+}
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                                            ArUploadHandlerFunction onUpload) {
+    return on(uri, method, onRequest, onUpload, NULL);
+}
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                                            ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody) {
+    AsyncCallbackWebHandler* handler = new AsyncCallbackWebHandler();
+    handler->setUri(uri);
+    handler->setMethod(method);
+    handler->onRequest(onRequest);
+    handler->onUpload(onUpload);
+    handler->onBody(onBody);
+    addHandler(handler);
+    return *handler;
+}
+
+AsyncWebHandler* AsyncWebServer::attachHandler(AsyncWebServerRequest* request) {
+    for (AsyncWebHandler* handler : handlers) {
+        if (handler->canHandle(request)) {
+            request->_handler = handler;
+            return handler;
+        }
+    }
+    request->_handler = &catchAll;
+    return &catchAll;
+}
+
+bool AsyncWebServer::parseHead(AsyncWebServerRequest* request, const std::string& head) {
+    size_t lineEnd = head.find("\r\n");
+    std::string requestLine = head.substr(0, lineEnd);
+
+    size_t firstSpace = requestLine.find(' ');
+    size_t secondSpace = requestLine.find(' ', firstSpace + 1);
+    if (firstSpace == std::string::npos || secondSpace == std::string::npos) {
+        return false;
+    }
+
+    std::string method = requestLine.substr(0, firstSpace);
+    static const char* names[] = {"GET", "POST", "DELETE", "PUT", "PATCH", "HEAD", "OPTIONS"};
+    request->_method = 0;
+    for (int i = 0; i < 7; i++) {
+        if (method == names[i]) request->_method = 1 << i;
+    }
+    if (request->_method == 0) {
+        return false;
+    }
+
+    String target(requestLine.substr(firstSpace + 1, secondSpace - firstSpace - 1));
+    int query = target.indexOf('?');
+    if (query >= 0) {
+        request->parseQuery(target.substring(query + 1), false);
+        target = target.substring(0, query);
+    }
+    request->_url = urlDecode(target);
+
+    size_t start = lineEnd == std::string::npos ? head.length() : lineEnd + 2;
+    while (start < head.length()) {
+        size_t end = head.find("\r\n", start);
+        if (end == std::string::npos) end = head.length();
+        std::string line = head.substr(start, end - start);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            String name(line.substr(0, colon));
+            String value(line.substr(colon + 1));
+            value.trim();
+            request->_headers.push_back(new AsyncWebHeader(name, value));
+        }
+        start = end + 2;
+    }
+
+    AsyncWebHeader* type = request->getHeader("Content-Type");
+    request->_contentType = type != NULL ? type->value() : String();
+    AsyncWebHeader* length = request->getHeader("Content-Length");
+    request->_contentLength = length != NULL ? (size_t)strtoul(length->value().c_str(), NULL, 10) : 0;
+    return true;
+}
+
+void AsyncWebServer::feedBody(AsyncWebServerRequest* request, const uint8_t* data, size_t len, size_t index, std::string& form) {
+    // Form posts become POST parameters; anything else goes to onBody
+    if (request->_contentType.startsWith("application/x-www-form-urlencoded")) {
+        form.append((const char*)data, len);
+        return;
+    }
+
+    // Handlers may write through the pointer, as they can on the ESP32. The
+    // copy is exactly len bytes with no terminator, like a TCP segment, so
+    // a handler that reads past the chunk trips ASan instead of finding a NUL
+    std::unique_ptr<uint8_t[]> piece(new uint8_t[len]);
+    memcpy(piece.get(), data, len);
+    request->_handler->handleBody(request, piece.get(), len, index, request->_contentLength);
+}
+
+void AsyncWebServer::finishRequest(AsyncWebServerRequest* request, const std::string& form) {
+    if (!form.empty()) {
+        request->parseQuery(String(form), true);
+    }
+    request->_handler->handleRequest(request);
+}
+
+NativeResponse AsyncWebServer::handle(const NativeRequest& in) {
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+
+    AsyncClient client(-1, in.remoteIP);
+    AsyncWebServerRequest* request = new AsyncWebServerRequest(this, &client);
+
+    request->_method = in.method;
+    String target = in.url;
+    int query = target.indexOf('?');
+    if (query >= 0) {
+        request->parseQuery(target.substring(query + 1), false);
+        target = target.substring(0, query);
+    }
+    request->_url = urlDecode(target);
+    for (const auto& header : in.headers) {
+        request->_headers.push_back(new AsyncWebHeader(header.first, header.second));
+    }
+    if (in.body.length() > 0) {
+        request->_contentType = in.contentType;
+        request->_contentLength = in.body.length();
+        request->_headers.push_back(new AsyncWebHeader("Content-Type", in.contentType));
+        request->_headers.push_back(new AsyncWebHeader("Content-Length", String((unsigned int)in.body.length())));
+    }
+
+    attachHandler(request);
+
+    std::string form;
+    size_t step = in.chunkSize > 0 ? in.chunkSize : NATIVE_BODY_CHUNK;
+    for (size_t index = 0; index < in.body.length(); index += step) {
+        size_t len = std::min(step, (size_t)in.body.length() - index);
+        feedBody(request, (const uint8_t*)in.body.c_str() + index, len, index, form);
+    }
+    finishRequest(request, form);
+
+    NativeResponse out;
+    AsyncWebServerResponse* response = request->response();
+    if (response != NULL) {
+        out.code = response->code();
+        out.contentType = response->contentType();
+        for (const AsyncWebHeader& header : DefaultHeaders::Instance().list()) {
+            out.headers.push_back(std::make_pair(header.name(), header.value()));
+        }
+        for (const AsyncWebHeader& header : response->headers()) {
+            out.headers.push_back(std::make_pair(header.name(), header.value()));
+        }
+
+        if (response->isChunked()) {
+            std::vector<uint8_t> buffer(NATIVE_CHUNK_SIZE);
+            size_t index = 0;
+            while (true) {
+                size_t n = response->fillChunk(buffer.data(), buffer.size(), index);
+                if (n == 0 || n == RESPONSE_TRY_AGAIN) break;
+                out.body.concat(String((const char*)buffer.data(), n));
+                index += n;
+            }
+        } else {
+            out.body = response->content();
+        }
+    }
+
+    delete request;
+    return out;
+}
+
+NativeResponse AsyncWebServer::handle(WebRequestMethod method, const String& url, const String& body) {
+    NativeRequest request;
+    request.method = method;
+    request.url = url;
+    request.body = body;
+    return handle(request);
+}
+
+// ---- Socket side ----
+
+namespace {
+
+enum ConnectionState {
+    CONNECTION_HEAD,
+    CONNECTION_BODY,
+    CONNECTION_HANDLED,     // Waiting for, or writing, the response
+    CONNECTION_WEBSOCKET,
+    CONNECTION_CLOSED
+};
+
+struct Connection {
+    AsyncClient* tcp;
+    AsyncWebServerRequest* request;
+    AsyncWebSocketClient* socket;
+    ConnectionState state;
+    std::string input;
+    std::string form;
+    size_t bodyIndex;
+    bool headSent;
+    bool responseDone;
+    size_t chunkIndex;
+    uint64_t lastActivity;
+};
+
+std::list<Connection> connections;
+
+String responseHead(AsyncWebServerResponse* response) {
+    String head = String("HTTP/1.1 ") + String(response->code()) + " " + reasonPhrase(response->code()) + "\r\n";
+    if (response->contentType().length()) {
+        head += "Content-Type: " + response->contentType() + "\r\n";
+    }
+    if (response->isChunked()) {
+        head += "Transfer-Encoding: chunked\r\n";
+    } else if (!response->upgradesToWebSocket()) {
+        head += "Content-Length: " + String((unsigned int)response->content().length()) + "\r\n";
+    }
+    for (const AsyncWebHeader& header : DefaultHeaders::Instance().list()) {
+        head += header.toString();
+    }
+    for (const AsyncWebHeader& header : response->headers()) {
+        head += header.toString();
+    }
+    if (!response->upgradesToWebSocket()) {
+        head += "Connection: close\r\n";
+    }
+    head += "\r\n";
+    return head;
+}
+
+void pumpResponse(Connection& conn) {
+    if (conn.request == NULL || conn.request->response() == NULL) return;
+    AsyncWebServerResponse* response = conn.request->response();
+
+    if (!conn.headSent) {
+        String head = responseHead(response);
+        conn.tcp->add(head.c_str(), head.length());
+        conn.headSent = true;
+
+        if (response->upgradesToWebSocket()) {
+            AsyncWebSocket* server = static_cast<AsyncWebSocketResponse*>(response)->socketServer();
+            delete conn.request;
+            conn.request = NULL;
+            conn.socket = server->attachClient(conn.tcp);
+            conn.state = CONNECTION_WEBSOCKET;
+            if (!conn.input.empty()) {
+                conn.socket->receive((const uint8_t*)conn.input.data(), conn.input.size());
+                conn.input.clear();
+            }
+            return;
+        }
+        if (!response->isChunked()) {
+            if (conn.request->method() != HTTP_HEAD) {
+                conn.tcp->add(response->content().c_str(), response->content().length());
+            }
+            conn.responseDone = true;
+        }
+    }
+
+    uint8_t buffer[NATIVE_CHUNK_SIZE];
+    while (!conn.responseDone && conn.tcp->space() > 16) {
+        size_t room = std::min(sizeof(buffer), conn.tcp->space() - 16);
+        size_t n = response->fillChunk(buffer, room, conn.chunkIndex);
+        if (n == RESPONSE_TRY_AGAIN) break;
+        if (n == 0) {
+            conn.tcp->add("0\r\n\r\n", 5);
+            conn.responseDone = true;
+            break;
+        }
+        char size[24];
+        snprintf(size, sizeof(size), "%zx\r\n", n);
+        std::string chunk(size);
+        chunk.append((const char*)buffer, n);
+        chunk.append("\r\n");
+        conn.tcp->add(chunk.data(), chunk.size());
+        conn.chunkIndex += n;
+    }
+}
+
+}  // namespace
+
+void AsyncWebServer::begin() {
+    // The firmware's port 80 maps to --port; 0 serves in-process only
+    uint16_t listenPort = hal.getPort();
+    if (listenPort == 0 || running) return;
+
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(listenPort);
+    if (bind(listenFd, (sockaddr*)&address, sizeof(address)) < 0 || listen(listenFd, 16) < 0) {
+        fprintf(stderr, "native: cannot listen on port %u: %s\n", listenPort, strerror(errno));
+        ::close(listenFd);
+        listenFd = -1;
+        return;
+    }
+
+    fprintf(stderr, "native: serving http://localhost:%u (firmware port %u)\n", listenPort, port);
+    running = true;
+    worker = std::thread(&AsyncWebServer::serve, this);
+}
+
+void AsyncWebServer::end() {
+    if (!running) return;
+    running = false;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    ::close(listenFd);
+    listenFd = -1;
+}
+
+void AsyncWebServer::serve() {
+    std::vector<pollfd> fds;
+
+    while (running) {
+        fds.clear();
+        fds.push_back({listenFd, POLLIN, 0});
+        {
+            std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+            for (Connection& conn : connections) {
+                short events = POLLIN;
+                if (conn.tcp->pendingBytes() > 0) events |= POLLOUT;
+                fds.push_back({conn.tcp->fd(), events, 0});
+            }
+        }
+
+        // Short timeout: chunked fillers that said "try again" get polled
+        poll(fds.data(), fds.size(), 10);
+
+        std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+        uint64_t now = hostMillis();
+
+        if (fds[0].revents & POLLIN) {
+            sockaddr_in peer = {};
+            socklen_t peerLen = sizeof(peer);
+            int fd;
+            while ((fd = accept4(listenFd, (sockaddr*)&peer, &peerLen, SOCK_NONBLOCK)) >= 0) {
+                Connection conn = {};
+                conn.tcp = new AsyncClient(fd, IPAddress((uint32_t)peer.sin_addr.s_addr));
+                conn.state = CONNECTION_HEAD;
+                conn.lastActivity = now;
+                connections.push_back(conn);
+                peerLen = sizeof(peer);
+            }
+        }
+
+        for (Connection& conn : connections) {
+            bool lost = false;
+            char buffer[4096];
+
+            while (conn.state != CONNECTION_CLOSED) {
+                ssize_t n = recv(conn.tcp->fd(), buffer, sizeof(buffer), MSG_DONTWAIT);
+                if (n > 0) {
+                    conn.input.append(buffer, n);
+                    conn.lastActivity = now;
+                    continue;
+                }
+                if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    lost = true;
+                }
+                break;
+            }
+
+            if (conn.state == CONNECTION_HEAD) {
+                size_t end = conn.input.find("\r\n\r\n");
+                if (end == std::string::npos && conn.input.size() > NATIVE_HEAD_LIMIT) {
+                    String reply = "HTTP/1.1 431 Request Header Fields Too Large\r\nConnection: close\r\n\r\n";
+                    conn.tcp->add(reply.c_str(), reply.length());
+                    conn.state = CONNECTION_HANDLED;
+                    conn.responseDone = true;
+                } else if (end != std::string::npos) {
+                    conn.request = new AsyncWebServerRequest(this, conn.tcp);
+                    if (!parseHead(conn.request, conn.input.substr(0, end))) {
+                        String reply = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n";
+                        conn.tcp->add(reply.c_str(), reply.length());
+                        conn.state = CONNECTION_HANDLED;
+                        conn.responseDone = true;
+                    } else {
+                        conn.input.erase(0, end + 4);
+                        attachHandler(conn.request);
+                        conn.state = CONNECTION_BODY;
+                    }
+                }
+            }
+
+            if (conn.state == CONNECTION_BODY) {
+                size_t total = conn.request->contentLength();
+                while (conn.bodyIndex < total && !conn.input.empty()) {
+                    size_t len = std::min(std::min((size_t)NATIVE_BODY_CHUNK, total - conn.bodyIndex), conn.input.size());
+                    feedBody(conn.request, (const uint8_t*)conn.input.data(), len, conn.bodyIndex, conn.form);
+                    conn.input.erase(0, len);
+                    conn.bodyIndex += len;
+                }
+                if (conn.bodyIndex >= total) {
+                    finishRequest(conn.request, conn.form);
+                    conn.state = CONNECTION_HANDLED;
+                }
+            }
+
+            if (conn.state == CONNECTION_HANDLED) {
+                pumpResponse(conn);
+            }
+
+            if (conn.state == CONNECTION_WEBSOCKET && !conn.input.empty()) {
+                conn.socket->receive((const uint8_t*)conn.input.data(), conn.input.size());
+                conn.input.clear();
+            }
+
+            if (!conn.tcp->flush()) {
+                lost = true;
+            }
+
+            bool finished = conn.state == CONNECTION_HANDLED && conn.responseDone && conn.tcp->pendingBytes() == 0;
+            bool idle = conn.state != CONNECTION_WEBSOCKET && conn.state != CONNECTION_HANDLED &&
+                        now - conn.lastActivity > NATIVE_IDLE_TIMEOUT_MS;
+            bool closed = conn.tcp->closing() && (conn.tcp->pendingBytes() == 0 || conn.tcp->aborting());
+
+            if (lost || finished || idle || closed) {
+                conn.state = CONNECTION_CLOSED;
+            }
+        }
+
+        for (auto it = connections.begin(); it != connections.end();) {
+            if (it->state != CONNECTION_CLOSED) {
+                ++it;
+                continue;
+            }
+            it->tcp->shutdown();
+            if (it->socket != NULL) {
+                it->socket->disconnected();     // Owns the AsyncClient now
+            } else {
+                delete it->request;
+                delete it->tcp;
+            }
+            it = connections.erase(it);
+        }
+
+        for (AsyncWebHandler* handler : handlers) {
+            AsyncWebSocket* socket = dynamic_cast<AsyncWebSocket*>(handler);
+            if (socket != NULL) {
+                socket->reapClients(NATIVE_SOCKET_GRACE_MS);
+            }
+        }
+    }
+
+    std::lock_guard<std::recursive_mutex> guard(asyncTcpLock());
+    for (Connection& conn : connections) {
+        conn.tcp->shutdown();
+        if (conn.socket != NULL) {
+            conn.socket->disconnected();
+        } else {
+            delete conn.request;
+            delete conn.tcp;
+        }
+    }
+    connections.clear();
+}
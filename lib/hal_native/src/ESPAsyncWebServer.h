@@ -0,0 +1,307 @@
+#ifndef ESPASYNCWEBSERVER_H
+#define ESPASYNCWEBSERVER_H
+
+#include <Arduino.h>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "AsyncTCP.h"
+#include "FS.h"
+
+// ESPAsyncWebServer stand-in: the same classes and callbacks over POSIX
+// sockets, served from one thread that plays the async_tcp task. Handler
+// selection, URI matching, body chunking and chunked responses follow the
+// ESP32 library, so routes behave the same on both targets. Requests can
+// also be dispatched in-process with AsyncWebServer::handle().
+
+typedef enum {
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+// Size of the body pieces handed to onBody, one TCP segment on the ESP32
+#define NATIVE_BODY_CHUNK 1436
+
+class AsyncWebServer;
+class AsyncWebServerRequest;
+class AsyncWebHandler;
+
+class AsyncWebParameter {
+public:
+    AsyncWebParameter(const String& name, const String& value, bool form = false, bool file = false, size_t size = 0)
+        : _name(name), _value(value), _size(size), _isForm(form), _isFile(file) {}
+    const String& name() const { return _name; }
+    const String& value() const { return _value; }
+    size_t size() const { return _size; }
+    bool isPost() const { return _isForm; }
+    bool isFile() const { return _isFile; }
+
+private:
+    String _name;
+    String _value;
+    size_t _size;
+    bool _isForm;
+    bool _isFile;
+};
+
+class AsyncWebHeader {
+public:
+    AsyncWebHeader(const String& name, const String& value) : _name(name), _value(value) {}
+    const String& name() const { return _name; }
+    const String& value() const { return _value; }
+    String toString() const { return _name + ": " + _value + "\r\n"; }
+
+private:
+    String _name;
+    String _value;
+};
+
+class AsyncWebServerResponse {
+public:
+    AsyncWebServerResponse(int code = 200, const String& contentType = String(), const String& content = String())
+        : _code(code), _contentType(contentType), _content(content) {}
+    virtual ~AsyncWebServerResponse() {}
+
+    void setCode(int code) { _code = code; }
+    void setContentType(const String& type) { _contentType = type; }
+    void addHeader(const String& name, const String& value) { _headers.push_back(AsyncWebHeader(name, value)); }
+
+    // Native side
+    int code() const { return _code; }
+    const String& contentType() const { return _contentType; }
+    const std::vector<AsyncWebHeader>& headers() const { return _headers; }
+    const String& content() const { return _content; }
+    virtual bool isChunked() const { return false; }
+    virtual size_t fillChunk(uint8_t* buffer, size_t maxLen, size_t index) { (void)buffer; (void)maxLen; (void)index; return 0; }
+    virtual bool upgradesToWebSocket() const { return false; }
+
+protected:
+    int _code;
+    String _contentType;
+    String _content;
+    std::vector<AsyncWebHeader> _headers;
+};
+
+// Response assembled with print()
+class AsyncResponseStream : public AsyncWebServerResponse, public Print {
+public:
+    AsyncResponseStream(const String& contentType) : AsyncWebServerResponse(200, contentType) {}
+    size_t write(uint8_t c) override { _content.concat((char)c); return 1; }
+    size_t write(const uint8_t* data, size_t size) override { _content.concat(String((const char*)data, size)); return size; }
+    using Print::write;
+};
+
+typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+
+// Pulled through the filler whenever the client has room; RESPONSE_TRY_AGAIN
+// means "nothing yet", 0 ends the response
+class AsyncChunkedResponse : public AsyncWebServerResponse {
+public:
+    AsyncChunkedResponse(const String& contentType, AwsResponseFiller filler)
+        : AsyncWebServerResponse(200, contentType), filler(filler) {}
+    bool isChunked() const override { return true; }
+    size_t fillChunk(uint8_t* buffer, size_t maxLen, size_t index) override { return filler(buffer, maxLen, index); }
+
+private:
+    AwsResponseFiller filler;
+};
+
+class AsyncWebServerRequest {
+    friend class AsyncWebServer;
+
+public:
+    AsyncWebServerRequest(AsyncWebServer* server, AsyncClient* client);
+    ~AsyncWebServerRequest();
+
+    void* _tempObject;
+
+    AsyncClient* client() { return _client; }
+    IPAddress remoteIP() const { return _client->remoteIP(); }
+    WebRequestMethodComposite method() const { return _method; }
+    const String& url() const { return _url; }
+    const String& methodToString() const;
+    const String& contentType() const { return _contentType; }
+    size_t contentLength() const { return _contentLength; }
+
+    bool hasParam(const String& name, bool post = false, bool file = false) const;
+    AsyncWebParameter* getParam(const String& name, bool post = false, bool file = false) const;
+    size_t params() const { return _params.size(); }
+    AsyncWebParameter* getParam(size_t index) const { return index < _params.size() ? _params[index] : NULL; }
+    bool hasArg(const char* name) const;
+    const String& arg(const String& name) const;
+
+    bool hasHeader(const String& name) const;
+    AsyncWebHeader* getHeader(const String& name) const;
+    size_t headers() const { return _headers.size(); }
+
+    void send(AsyncWebServerResponse* response);
+    void send(int code, const String& contentType = String(), const String& content = String());
+    void send(fs::FS& fs, const String& path, const String& contentType = String(), bool download = false);
+    AsyncWebServerResponse* beginResponse(int code, const String& contentType = String(), const String& content = String());
+    AsyncResponseStream* beginResponseStream(const String& contentType, size_t bufferSize = 1460);
+    AsyncWebServerResponse* beginChunkedResponse(const String& contentType, AwsResponseFiller filler);
+    void onDisconnect(std::function<void()> handler) { _onDisconnect = handler; }
+
+    // Native side
+    AsyncWebServerResponse* response() { return _response; }
+    bool sent() const { return _response != NULL; }
+
+private:
+    AsyncWebServer* _server;
+    AsyncClient* _client;
+    AsyncWebHandler* _handler;
+    AsyncWebServerResponse* _response;
+    std::function<void()> _onDisconnect;
+
+    WebRequestMethodComposite _method;
+    String _url;
+    String _contentType;
+    size_t _contentLength;
+    std::vector<AsyncWebParameter*> _params;
+    std::vector<AsyncWebHeader*> _headers;
+
+    void addParam(const String& name, const String& value, bool post);
+    void parseQuery(const String& query, bool post);
+};
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, const String&, size_t, uint8_t*, size_t, bool)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, uint8_t*, size_t, size_t, size_t)> ArBodyHandlerFunction;
+
+class AsyncWebHandler {
+public:
+    virtual ~AsyncWebHandler() {}
+    virtual bool canHandle(AsyncWebServerRequest* request) { (void)request; return false; }
+    virtual void handleRequest(AsyncWebServerRequest* request) { (void)request; }
+    virtual void handleUpload(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final) {}
+    virtual void handleBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {}
+    virtual bool isRequestHandlerTrivial() { return true; }
+};
+
+class AsyncStaticWebHandler : public AsyncWebHandler {
+public:
+    AsyncStaticWebHandler(const char* uri, fs::FS& fs, const char* path, const char* cacheControl);
+    bool canHandle(AsyncWebServerRequest* request) override;
+    void handleRequest(AsyncWebServerRequest* request) override;
+    AsyncStaticWebHandler& setDefaultFile(const char* filename) { defaultFile = filename; return *this; }
+    AsyncStaticWebHandler& setCacheControl(const char* value) { cacheControl = value; return *this; }
+
+private:
+    String uri;
+    fs::FS& fs;
+    String path;
+    String defaultFile;
+    String cacheControl;
+
+    String resolve(const String& url);
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler {
+public:
+    AsyncCallbackWebHandler() : method(HTTP_ANY) {}
+    void setUri(const String& value) { uri = value; }
+    void setMethod(WebRequestMethodComposite value) { method = value; }
+    void onRequest(ArRequestHandlerFunction fn) { requestFn = fn; }
+    void onUpload(ArUploadHandlerFunction fn) { uploadFn = fn; }
+    void onBody(ArBodyHandlerFunction fn) { bodyFn = fn; }
+
+    bool canHandle(AsyncWebServerRequest* request) override;
+    void handleRequest(AsyncWebServerRequest* request) override;
+    void handleUpload(AsyncWebServerRequest* request, const String& filename, size_t index, uint8_t* data, size_t len, bool final) override;
+    void handleBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) override;
+    bool isRequestHandlerTrivial() override { return !requestFn; }
+
+private:
+    String uri;
+    WebRequestMethodComposite method;
+    ArRequestHandlerFunction requestFn;
+    ArUploadHandlerFunction uploadFn;
+    ArBodyHandlerFunction bodyFn;
+};
+
+// A request issued in-process (simulators, fuzzers, load tests, replay)
+struct NativeRequest {
+    WebRequestMethod method = HTTP_GET;
+    String url;                               // Path plus optional ?query
+    String body;
+    String contentType = "application/json";
+    std::vector<std::pair<String, String>> headers;
+    IPAddress remoteIP = IPAddress(127, 0, 0, 1);
+    size_t chunkSize = NATIVE_BODY_CHUNK;     // onBody piece size
+};
+
+struct NativeResponse {
+    int code = 0;                             // 0: the handler never sent
+    String contentType;
+    std::vector<std::pair<String, String>> headers;
+    String body;
+
+    String header(const String& name) const;
+};
+
+class AsyncWebServer {
+public:
+    AsyncWebServer(uint16_t port);
+    ~AsyncWebServer();
+
+    void begin();
+    void end();
+
+    AsyncWebHandler& addHandler(AsyncWebHandler* handler);
+    bool removeHandler(AsyncWebHandler* handler);
+    AsyncStaticWebHandler& serveStatic(const char* uri, fs::FS& fs, const char* path, const char* cacheControl = NULL);
+    AsyncCallbackWebHandler& on(const char* uri, ArRequestHandlerFunction onRequest);
+    AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+    AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                                ArUploadHandlerFunction onUpload);
+    AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                                ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody);
+    void onNotFound(ArRequestHandlerFunction fn) { catchAll.onRequest(fn); }
+
+    // Runs a request through the same handler chain as a socket request and
+    // returns what the handler sent. Chunked responses are read until the
+    // filler ends or has nothing more right now.
+    NativeResponse handle(const NativeRequest& request);
+    NativeResponse handle(WebRequestMethod method, const String& url, const String& body = String());
+
+    // Native side: used by the connection code
+    AsyncWebHandler* attachHandler(AsyncWebServerRequest* request);
+
+private:
+    uint16_t port;
+    int listenFd;
+    volatile bool running;
+    std::thread worker;
+    std::vector<AsyncWebHandler*> handlers;
+    AsyncCallbackWebHandler catchAll;
+
+    void serve();
+    bool parseHead(AsyncWebServerRequest* request, const std::string& head);
+    void feedBody(AsyncWebServerRequest* request, const uint8_t* data, size_t len, size_t index, std::string& form);
+    void finishRequest(AsyncWebServerRequest* request, const std::string& form);
+};
+
+class DefaultHeaders {
+public:
+    void addHeader(const String& name, const String& value) { headers.push_back(AsyncWebHeader(name, value)); }
+    const std::vector<AsyncWebHeader>& list() const { return headers; }
+    static DefaultHeaders& Instance();
+
+private:
+    std::vector<AsyncWebHeader> headers;
+};
+
+#include "AsyncWebSocket.h"
+
+#endif // ESPASYNCWEBSERVER_H
@@ -0,0 +1,47 @@
+#include "FS.h"
+#include "native_hal.h"
+#include <sys/stat.h>
+
+fs::FS SPIFFS;
+
+bool fs::FS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* label) {
+    struct stat info;
+    mounted = stat(hal.getDataDir().c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+    if (!mounted && formatOnFail) {
+        // A freshly formatted partition: mounted, but empty
+        fprintf(stderr, "native: no data directory %s, filesystem is empty\n", hal.getDataDir().c_str());
+        mounted = true;
+    }
+    return mounted;
+}
+
+std::string fs::FS::hostPath(const char* path) {
+    std::string full = hal.getDataDir();
+    if (path[0] != '/') full += "/";
+    full += path;
+    return full;
+}
+
+bool fs::FS::exists(const char* path) {
+    // No ".." escapes from the data directory
+    if (path == NULL || strstr(path, "..") != NULL) return false;
+
+    struct stat info;
+    return stat(hostPath(path).c_str(), &info) == 0 && S_ISREG(info.st_mode);
+}
+
+bool fs::FS::readFile(const char* path, std::string& content) {
+    if (!exists(path)) return false;
+
+    FILE* file = fopen(hostPath(path).c_str(), "rb");
+    if (file == NULL) return false;
+
+    content.clear();
+    char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content.append(buffer, count);
+    }
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef FS_H
+#define FS_H
+
+#include <Arduino.h>
+#include <string>
+
+namespace fs {
+
+// A flash filesystem mapped onto a host directory (NativeHal's data
+// directory, i.e. the same data/ tree that is uploaded to SPIFFS)
+class FS {
+public:
+    bool begin(bool formatOnFail = false, const char* basePath = "/spiffs", uint8_t maxOpenFiles = 10, const char* label = NULL);
+    void end() {}
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool readFile(const char* path, std::string& content);
+    std::string hostPath(const char* path);
+
+private:
+    bool mounted = false;
+};
+
+}  // namespace fs
+
+using fs::FS;
+
+#endif // FS_H
@@ -0,0 +1,97 @@
+#include "HTTPClient.h"
+#include "native_hal.h"
+
+bool HTTPClient::begin(const String& url) {
+    end();
+    client = &ownClient;
+    target = url;
+    headers.clear();
+    return true;
+}
+
+bool HTTPClient::begin(WiFiClient& connection, const String& url) {
+    end();
+    client = &connection;
+    target = url;
+    headers.clear();
+    return true;
+}
+
+void HTTPClient::end() {
+    response = String();
+    bodyPending = false;
+    if (client != NULL && (!reuse || client == &ownClient)) {
+        client->stop();
+    }
+    client = NULL;
+}
+
+int HTTPClient::sendRequest(const char* method, const String& body) {
+    response = String();
+    bodyPending = false;
+    if (client == NULL) {
+        return HTTPC_ERROR_NOT_CONNECTED;
+    }
+
+    if (!client->connected()) {
+        // Host and port do not matter to the stand-in
+        int start = target.indexOf("://");
+        String host = target.substring(start < 0 ? 0 : start + 3);
+        int slash = host.indexOf('/');
+        if (slash >= 0) host = host.substring(0, slash);
+        if (!client->connect(host.c_str(), target.startsWith("https") ? 443 : 80, connectTimeout)) {
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+    }
+
+    int code = hal.httpRequest(client->nativeConnection(), method, target, body);
+    if (code < 0) {
+        client->stop();
+    } else {
+        bodyPending = true;
+    }
+    return code;
+}
+
+String HTTPClient::getString() {
+    if (bodyPending && client != NULL) {
+        String piece;
+        while (hal.httpRead(client->nativeConnection(), piece, timeout) > 0) {
+            response += piece;
+        }
+    }
+    bodyPending = false;
+    return response;
+}
+
+int HTTPClient::writeToStream(Stream* stream) {
+    if (!bodyPending || client == NULL || stream == NULL) {
+        return HTTPC_ERROR_NOT_CONNECTED;
+    }
+    bodyPending = false;
+
+    int written = 0;
+    String piece;
+    int result;
+    while ((result = hal.httpRead(client->nativeConnection(), piece, timeout)) > 0) {
+        written += stream->write((const uint8_t*)piece.c_str(), piece.length());
+    }
+    return result < 0 ? result : written;
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+        case HTTPC_ERROR_CONNECTION_REFUSED:
+            return "connection refused";
+        case HTTPC_ERROR_SEND_HEADER_FAILED:
+            return "send header failed";
+        case HTTPC_ERROR_NOT_CONNECTED:
+            return "not connected";
+        case HTTPC_ERROR_CONNECTION_LOST:
+            return "connection lost";
+        case HTTPC_ERROR_READ_TIMEOUT:
+            return "read Timeout";
+        default:
+            return String();
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef HTTPCLIENT_H
+#define HTTPCLIENT_H
+
+#include <Arduino.h>
+#include <vector>
+#include "WiFiClientSecure.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+#define HTTP_CODE_OK 200
+
+// Outbound HTTP stand-in: requests are answered by the handler set with
+// NativeHal::setHttpHandler(). Like the ESP32 client, begin(client, url)
+// reuses a connection the client already holds and, with setReuse(true),
+// leaves it open at end(); begin(url) connects for each request.
+class HTTPClient {
+public:
+    HTTPClient() : bodyPending(false), client(NULL), reuse(true), connectTimeout(5000), timeout(5000) {}
+    ~HTTPClient() { end(); }
+    bool begin(const String& url);
+    bool begin(WiFiClient& client, const String& url);
+    void end();
+    void addHeader(const String& name, const String& value) { headers.push_back(name + ": " + value); }
+    void setReuse(bool reuse) { this->reuse = reuse; }
+    // Like the ESP32 client, in ms: the timeout applies to each wait for
+    // more of the response, not to the whole of it
+    void setTimeout(uint16_t timeout) { this->timeout = timeout; }
+    void setConnectTimeout(int32_t timeout) { connectTimeout = timeout; }
+
+    int sendRequest(const char* method, const String& body);
+    int GET() { return sendRequest("GET", String()); }
+    int POST(const String& body) { return sendRequest("POST", body); }
+    int POST(uint8_t* body, size_t size) { return POST(String((const char*)body, size)); }
+    String getString();
+    int getSize() { return getString().length(); }
+    // Copies the body to stream piece by piece as it arrives; returns the
+    // bytes written or an HTTPC_ERROR_* code
+    int writeToStream(Stream* stream);
+    static String errorToString(int error);
+
+private:
+    String target;
+    std::vector<String> headers;
+    String response;
+    bool bodyPending;            // The body has not been read yet
+    WiFiClient* client;
+    WiFiClient ownClient;        // Used when begin() was given none
+    bool reuse;
+    int32_t connectTimeout;
+    uint16_t timeout;
+};
+
+#endif // HTTPCLIENT_H
@@ -0,0 +1,162 @@
+#include "Preferences.h"
+#include "native_hal.h"
+
+bool Preferences::begin(const char* name, bool readOnlyMode, const char* partition) {
+    if (started) return false;
+    readOnly = readOnlyMode;
+    if (nvs_open(name, readOnly ? NVS_READONLY : NVS_READWRITE, &handle) != ESP_OK) {
+        return false;
+    }
+    space = name;
+    started = true;
+    return true;
+}
+
+void Preferences::end() {
+    if (!started) return;
+    nvs_close(handle);
+    started = false;
+}
+
+bool Preferences::clear() {
+    return writable() && nvs_erase_all(handle) == ESP_OK && nvs_commit(handle) == ESP_OK;
+}
+
+bool Preferences::remove(const char* key) {
+    return writable() && nvs_erase_key(handle, key) == ESP_OK && nvs_commit(handle) == ESP_OK;
+}
+
+bool Preferences::isKey(const char* key) {
+    if (!started || key == NULL) return false;
+
+    // Any type will do
+    size_t length = 0;
+    uint8_t u8;
+    int8_t i8;
+    uint16_t u16;
+    int16_t i16;
+    uint32_t u32;
+    int32_t i32;
+    uint64_t u64;
+    int64_t i64;
+    return nvs_get_u8(handle, key, &u8) == ESP_OK || nvs_get_i8(handle, key, &i8) == ESP_OK ||
+           nvs_get_u16(handle, key, &u16) == ESP_OK || nvs_get_i16(handle, key, &i16) == ESP_OK ||
+           nvs_get_u32(handle, key, &u32) == ESP_OK || nvs_get_i32(handle, key, &i32) == ESP_OK ||
+           nvs_get_u64(handle, key, &u64) == ESP_OK || nvs_get_i64(handle, key, &i64) == ESP_OK ||
+           nvs_get_str(handle, key, NULL, &length) == ESP_OK || nvs_get_blob(handle, key, NULL, &length) == ESP_OK;
+}
+
+size_t Preferences::freeEntries() {
+    // A 20 KB NVS partition holds roughly 630 single-entry values
+    size_t used = started ? hal.valueCount(space.c_str()) : 0;
+    return used < 630 ? 630 - used : 0;
+}
+
+#define PUT_SCALAR(setter, value)                                           \
+    if (!writable() || key == NULL) return 0;                               \
+    if (setter(handle, key, value) != ESP_OK) return 0;                     \
+    if (nvs_commit(handle) != ESP_OK) return 0;                             \
+    return sizeof(value);
+
+size_t Preferences::putChar(const char* key, int8_t value) { PUT_SCALAR(nvs_set_i8, value) }
+size_t Preferences::putUChar(const char* key, uint8_t value) { PUT_SCALAR(nvs_set_u8, value) }
+size_t Preferences::putShort(const char* key, int16_t value) { PUT_SCALAR(nvs_set_i16, value) }
+size_t Preferences::putUShort(const char* key, uint16_t value) { PUT_SCALAR(nvs_set_u16, value) }
+size_t Preferences::putInt(const char* key, int32_t value) { PUT_SCALAR(nvs_set_i32, value) }
+size_t Preferences::putUInt(const char* key, uint32_t value) { PUT_SCALAR(nvs_set_u32, value) }
+size_t Preferences::putLong64(const char* key, int64_t value) { PUT_SCALAR(nvs_set_i64, value) }
+size_t Preferences::putULong64(const char* key, uint64_t value) { PUT_SCALAR(nvs_set_u64, value) }
+
+size_t Preferences::putBool(const char* key, bool value) {
+    return putUChar(key, (uint8_t)(value ? 1 : 0));
+}
+
+size_t Preferences::putFloat(const char* key, float value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+size_t Preferences::putDouble(const char* key, double value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+    if (!writable() || key == NULL || value == NULL) return 0;
+    if (nvs_set_str(handle, key, value) != ESP_OK) return 0;
+    if (nvs_commit(handle) != ESP_OK) return 0;
+    return strlen(value);
+}
+
+size_t Preferences::putString(const char* key, String value) {
+    return putString(key, value.c_str());
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+    if (!writable() || key == NULL || value == NULL || length == 0) return 0;
+    if (nvs_set_blob(handle, key, value, length) != ESP_OK) return 0;
+    if (nvs_commit(handle) != ESP_OK) return 0;
+    return length;
+}
+
+#define GET_SCALAR(getter, type)                                            \
+    type value = defaultValue;                                              \
+    if (started && key != NULL) getter(handle, key, &value);                \
+    return value;
+
+int8_t Preferences::getChar(const char* key, int8_t defaultValue) { GET_SCALAR(nvs_get_i8, int8_t) }
+uint8_t Preferences::getUChar(const char* key, uint8_t defaultValue) { GET_SCALAR(nvs_get_u8, uint8_t) }
+int16_t Preferences::getShort(const char* key, int16_t defaultValue) { GET_SCALAR(nvs_get_i16, int16_t) }
+uint16_t Preferences::getUShort(const char* key, uint16_t defaultValue) { GET_SCALAR(nvs_get_u16, uint16_t) }
+int32_t Preferences::getInt(const char* key, int32_t defaultValue) { GET_SCALAR(nvs_get_i32, int32_t) }
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) { GET_SCALAR(nvs_get_u32, uint32_t) }
+int64_t Preferences::getLong64(const char* key, int64_t defaultValue) { GET_SCALAR(nvs_get_i64, int64_t) }
+uint64_t Preferences::getULong64(const char* key, uint64_t defaultValue) { GET_SCALAR(nvs_get_u64, uint64_t) }
+
+bool Preferences::getBool(const char* key, bool defaultValue) {
+    return getUChar(key, defaultValue ? 1 : 0) == 1;
+}
+
+float Preferences::getFloat(const char* key, float defaultValue) {
+    float value = defaultValue;
+    getBytes(key, &value, sizeof(value));
+    return value;
+}
+
+double Preferences::getDouble(const char* key, double defaultValue) {
+    double value = defaultValue;
+    getBytes(key, &value, sizeof(value));
+    return value;
+}
+
+String Preferences::getString(const char* key, String defaultValue) {
+    if (!started || key == NULL) return defaultValue;
+
+    size_t length = 0;
+    if (nvs_get_str(handle, key, NULL, &length) != ESP_OK || length == 0) return defaultValue;
+
+    std::string buffer(length, '\0');
+    if (nvs_get_str(handle, key, &buffer[0], &length) != ESP_OK) return defaultValue;
+    return String(buffer.c_str());
+}
+
+size_t Preferences::getString(const char* key, char* value, size_t maxLength) {
+    if (!started || key == NULL || value == NULL) return 0;
+
+    size_t length = maxLength;
+    if (nvs_get_str(handle, key, value, &length) != ESP_OK) return 0;
+    return length;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (!started || key == NULL) return 0;
+
+    size_t length = 0;
+    if (nvs_get_blob(handle, key, NULL, &length) != ESP_OK) return 0;
+    return length;
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+    size_t length = getBytesLength(key);
+    if (length == 0 || buffer == NULL || length > maxLength) return 0;
+    if (nvs_get_blob(handle, key, buffer, &length) != ESP_OK) return 0;
+    return length;
+}
@@ -0,0 +1,154 @@
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static std::string formatInteger(unsigned long long value, bool negative, unsigned char base) {
+    if (base < 2 || base > 36) base = 10;
+
+    char digits[66];
+    int position = sizeof(digits) - 1;
+    digits[position] = '\0';
+
+    do {
+        int digit = value % base;
+        digits[--position] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value > 0);
+
+    if (negative) {
+        digits[--position] = '-';
+    }
+    return std::string(digits + position);
+}
+
+static std::string formatSigned(long long value, unsigned char base) {
+    // Like the ESP32 core, only base 10 prints a sign
+    if (value < 0 && base == 10) {
+        return formatInteger(0ULL - (unsigned long long)value, true, base);
+    }
+    return formatInteger((unsigned long long)value, false, base);
+}
+
+static std::string formatFloat(double value, unsigned int decimals) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+    return std::string(buffer);
+}
+
+String::String(unsigned char value, unsigned char base) : data(formatInteger(value, false, base)) {}
+String::String(int value, unsigned char base) : data(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : data(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base) : data(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : data(formatInteger(value, false, base)) {}
+String::String(long long value, unsigned char base) : data(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : data(formatInteger(value, false, base)) {}
+String::String(float value, unsigned int decimals) : data(formatFloat(value, decimals)) {}
+String::String(double value, unsigned int decimals) : data(formatFloat(value, decimals)) {}
+
+bool String::equalsIgnoreCase(const String& other) const {
+    if (data.length() != other.data.length()) return false;
+    for (size_t i = 0; i < data.length(); i++) {
+        if (tolower((unsigned char)data[i]) != tolower((unsigned char)other.data[i])) return false;
+    }
+    return true;
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const {
+    if (offset > data.length()) return false;
+    return data.compare(offset, prefix.data.length(), prefix.data) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+    if (suffix.data.length() > data.length()) return false;
+    return data.compare(data.length() - suffix.data.length(), suffix.data.length(), suffix.data) == 0;
+}
+
+int String::indexOf(char value, unsigned int from) const {
+    size_t found = data.find(value, from);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::indexOf(const String& value, unsigned int from) const {
+    size_t found = data.find(value.data, from);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::lastIndexOf(char value) const {
+    size_t found = data.rfind(value);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::lastIndexOf(const String& value) const {
+    size_t found = data.rfind(value.data);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+String String::substring(unsigned int from) const {
+    if (from >= data.length()) return String();
+    return String(data.substr(from));
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+        unsigned int swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from >= data.length()) return String();
+    if (to > data.length()) to = data.length();
+    return String(data.substr(from, to - from));
+}
+
+void String::replace(char find, char replace) {
+    for (size_t i = 0; i < data.length(); i++) {
+        if (data[i] == find) data[i] = replace;
+    }
+}
+
+void String::replace(const String& find, const String& replace) {
+    if (find.data.empty()) return;
+
+    size_t position = 0;
+    while ((position = data.find(find.data, position)) != std::string::npos) {
+        data.replace(position, find.data.length(), replace.data);
+        position += replace.data.length();
+    }
+}
+
+void String::remove(unsigned int index) {
+    if (index < data.length()) data.erase(index);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index < data.length()) data.erase(index, count);
+}
+
+void String::toLowerCase() {
+    for (size_t i = 0; i < data.length(); i++) data[i] = tolower((unsigned char)data[i]);
+}
+
+void String::toUpperCase() {
+    for (size_t i = 0; i < data.length(); i++) data[i] = toupper((unsigned char)data[i]);
+}
+
+void String::trim() {
+    size_t start = 0;
+    while (start < data.length() && isspace((unsigned char)data[start])) start++;
+    size_t end = data.length();
+    while (end > start && isspace((unsigned char)data[end - 1])) end--;
+    data = data.substr(start, end - start);
+}
+
+long String::toInt() const {
+    return atol(data.c_str());
+}
+
+float String::toFloat() const {
+    return (float)atof(data.c_str());
+}
+
+double String::toDouble() const {
+    return atof(data.c_str());
+}
@@ -0,0 +1,105 @@
+#ifndef WSTRING_H
+#define WSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Arduino String on top of std::string. Only the parts the firmware and
+// ArduinoJson use; semantics (toInt() on garbage, indexOf() returning -1)
+// follow the ESP32 core.
+class String {
+public:
+    String() {}
+    String(const char* value) : data(value != NULL ? value : "") {}
+    String(const char* value, size_t length) : data(value, length) {}
+    String(const std::string& value) : data(value) {}
+    String(char value) : data(1, value) {}
+    String(unsigned char value, unsigned char base = 10);
+    String(int value, unsigned char base = 10);
+    String(unsigned int value, unsigned char base = 10);
+    String(long value, unsigned char base = 10);
+    String(unsigned long value, unsigned char base = 10);
+    String(long long value, unsigned char base = 10);
+    String(unsigned long long value, unsigned char base = 10);
+    String(float value, unsigned int decimals = 2);
+    String(double value, unsigned int decimals = 2);
+
+    const char* c_str() const { return data.c_str(); }
+    unsigned int length() const { return data.length(); }
+    bool isEmpty() const { return data.empty(); }
+    bool reserve(unsigned int size) { data.reserve(size); return true; }
+
+    bool concat(const String& value) { data += value.data; return true; }
+    bool concat(const char* value) { if (value != NULL) data += value; return true; }
+    bool concat(const char* value, unsigned int length) { data.append(value, length); return true; }
+    bool concat(char value) { data += value; return true; }
+    template<typename T> bool concat(T value) { return concat(String(value)); }
+
+    String& operator+=(const String& value) { concat(value); return *this; }
+    String& operator+=(const char* value) { concat(value); return *this; }
+    String& operator+=(char value) { concat(value); return *this; }
+    template<typename T> String& operator+=(T value) { concat(String(value)); return *this; }
+
+    bool equals(const String& other) const { return data == other.data; }
+    bool equals(const char* other) const { return other != NULL && data == other; }
+    bool equalsIgnoreCase(const String& other) const;
+    int compareTo(const String& other) const { return data.compare(other.data); }
+    bool startsWith(const String& prefix) const { return data.compare(0, prefix.data.length(), prefix.data) == 0; }
+    bool startsWith(const String& prefix, unsigned int offset) const;
+    bool endsWith(const String& suffix) const;
+
+    char charAt(unsigned int index) const { return index < data.length() ? data[index] : 0; }
+    void setCharAt(unsigned int index, char value) { if (index < data.length()) data[index] = value; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index) { return data[index]; }
+
+    int indexOf(char value, unsigned int from = 0) const;
+    int indexOf(const String& value, unsigned int from = 0) const;
+    int lastIndexOf(char value) const;
+    int lastIndexOf(const String& value) const;
+
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+
+    void replace(char find, char replace);
+    void replace(const String& find, const String& replace);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+    // Used by ArduinoJson's String writer and reader
+    size_t write(uint8_t c) { data += (char)c; return 1; }
+    const std::string& str() const { return data; }
+
+    explicit operator bool() const { return true; }
+
+    friend bool operator==(const String& a, const String& b) { return a.data == b.data; }
+    friend bool operator==(const String& a, const char* b) { return a.equals(b); }
+    friend bool operator==(const char* a, const String& b) { return b.equals(a); }
+    friend bool operator!=(const String& a, const String& b) { return a.data != b.data; }
+    friend bool operator!=(const String& a, const char* b) { return !a.equals(b); }
+    friend bool operator!=(const char* a, const String& b) { return !b.equals(a); }
+    friend bool operator<(const String& a, const String& b) { return a.data < b.data; }
+
+private:
+    std::string data;
+};
+
+// Arduino's StringSumHelper chains collapse to plain String concatenation
+inline String operator+(const String& a, const String& b) { String result(a); result += b; return result; }
+inline String operator+(const String& a, const char* b) { String result(a); result += b; return result; }
+inline String operator+(const char* a, const String& b) { String result(a); result += b; return result; }
+inline String operator+(const String& a, char b) { String result(a); result += b; return result; }
+template<typename T> String operator+(const String& a, T b) { String result(a); result += String(b); return result; }
+
+class __FlashStringHelper;
+#define F(string_literal) (string_literal)
+
+#endif // WSTRING_H
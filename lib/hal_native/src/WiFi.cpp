@@ -0,0 +1,252 @@
+#include "WiFi.h"
+#include "native_hal.h"
+
+WiFiClass WiFi;
+
+static const unsigned long CONNECT_TIME_MS = 300;
+static const unsigned long SCAN_TIME_MS = 120;
+
+WiFiClass::WiFiClass() {
+    currentMode = WIFI_OFF;
+    autoReconnect = true;
+    connectStartMs = 0;
+    lastStatus = WL_IDLE_STATUS;
+    connectedIndex = -1;
+    memset(connectedBssid, 0, sizeof(connectedBssid));
+    apActive = false;
+    scanStartMs = 0;
+    scanRunning = false;
+    scanDone = false;
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    currentMode = mode;
+    if (mode == WIFI_OFF || mode == WIFI_AP) {
+        targetSsid.clear();
+        connectedIndex = -1;
+    }
+    if (mode == WIFI_OFF || mode == WIFI_STA) {
+        apActive = false;
+    }
+    return true;
+}
+
+int WiFiClass::findNetwork(const std::string& ssid, const uint8_t* bssid) {
+    const std::vector<HalWifiNetwork>& networks = hal.getNetworks();
+    for (size_t i = 0; i < networks.size(); i++) {
+        if (networks[i].ssid != ssid) continue;
+        if (bssid != NULL && memcmp(networks[i].bssid, bssid, 6) != 0) continue;
+        return (int)i;
+    }
+    return -1;
+}
+
+wl_status_t WiFiClass::status() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    wl_status_t current;
+
+    if (targetSsid.empty() || (currentMode != WIFI_STA && currentMode != WIFI_AP_STA)) {
+        current = lastStatus == WL_IDLE_STATUS ? WL_IDLE_STATUS : WL_DISCONNECTED;
+    } else if (millis() - connectStartMs < CONNECT_TIME_MS) {
+        current = WL_DISCONNECTED;
+    } else if (!hal.isWifiAvailable()) {
+        current = lastStatus == WL_CONNECTED ? WL_CONNECTION_LOST : WL_NO_SSID_AVAIL;
+    } else {
+        int index = findNetwork(targetSsid, NULL);
+        if (index < 0) {
+            current = WL_NO_SSID_AVAIL;
+        } else {
+            const HalWifiNetwork& network = hal.getNetworks()[index];
+            if (!network.open && !network.password.empty() && network.password != targetPassword) {
+                current = WL_CONNECT_FAILED;
+            } else {
+                current = WL_CONNECTED;
+                connectedIndex = index;
+                memcpy(connectedBssid, network.bssid, sizeof(connectedBssid));
+            }
+        }
+    }
+
+    if (current != lastStatus) {
+        lastStatus = current;
+        hal.emit(HAL_EVENT_WIFI, -1, current, targetSsid);
+    }
+    return current;
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* password, int32_t channel, const uint8_t* bssid, bool connect) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    if (currentMode == WIFI_OFF || currentMode == WIFI_AP) {
+        currentMode = currentMode == WIFI_AP ? WIFI_AP_STA : WIFI_STA;
+    }
+
+    // A stale BSSID/channel hint fails like it does on the radio
+    if (bssid != NULL && findNetwork(ssid, bssid) < 0) {
+        targetSsid = "\x01";   // Never matches
+    } else {
+        targetSsid = ssid != NULL ? ssid : "";
+    }
+    targetPassword = password != NULL ? password : "";
+    connectStartMs = millis();
+    connectedIndex = -1;
+    return WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    targetSsid.clear();
+    connectedIndex = -1;
+    if (wifiOff) currentMode = WIFI_OFF;
+    status();
+    return true;
+}
+
+bool WiFiClass::reconnect() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    connectStartMs = millis();
+    return true;
+}
+
+bool WiFiClass::softAP(const char* ssid, const char* password, int channel, int hidden, int maxConnections) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    if (password != NULL && password[0] != '\0' && strlen(password) < 8) {
+        return false;   // WPA2 needs at least 8 characters
+    }
+    if (currentMode == WIFI_OFF) currentMode = WIFI_AP;
+    if (currentMode == WIFI_STA) currentMode = WIFI_AP_STA;
+    apActive = true;
+    return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool wifiOff) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    apActive = false;
+    if (wifiOff) currentMode = WIFI_OFF;
+    return true;
+}
+
+IPAddress WiFiClass::softAPIP() {
+    return apActive ? IPAddress(192, 168, 4, 1) : IPAddress();
+}
+
+IPAddress WiFiClass::localIP() {
+    return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 50) : IPAddress();
+}
+
+IPAddress WiFiClass::gatewayIP() {
+    return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 1) : IPAddress();
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t index) {
+    return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 1) : IPAddress();
+}
+
+String WiFiClass::SSID() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    return status() == WL_CONNECTED ? String(targetSsid) : String();
+}
+
+int32_t WiFiClass::RSSI() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    if (status() != WL_CONNECTED || connectedIndex < 0) return 0;
+    return hal.getNetworks()[connectedIndex].rssi;
+}
+
+uint8_t* WiFiClass::BSSID() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    return status() == WL_CONNECTED ? connectedBssid : NULL;
+}
+
+String WiFiClass::BSSIDstr() {
+    uint8_t* bssid = BSSID();
+    if (bssid == NULL) return String();
+
+    char text[18];
+    snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+    return String(text);
+}
+
+int32_t WiFiClass::channel() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    if (status() != WL_CONNECTED || connectedIndex < 0) return 0;
+    return hal.getNetworks()[connectedIndex].channel;
+}
+
+int16_t WiFiClass::scanNetworks(bool async, bool showHidden, bool passive, uint32_t maxMsPerChannel, uint8_t channel) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    if (scanRunning) return WIFI_SCAN_RUNNING;
+
+    scanRunning = true;
+    scanDone = false;
+    scanStartMs = millis();
+    if (async) return WIFI_SCAN_RUNNING;
+
+    delay(SCAN_TIME_MS);
+    return scanComplete();
+}
+
+int16_t WiFiClass::scanComplete() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    if (scanRunning && millis() - scanStartMs >= SCAN_TIME_MS) {
+        scanRunning = false;
+        scanDone = true;
+    }
+    if (scanRunning) return WIFI_SCAN_RUNNING;
+    if (!scanDone) return WIFI_SCAN_FAILED;
+    return (int16_t)hal.getNetworks().size();
+}
+
+void WiFiClass::scanDelete() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    scanDone = false;
+}
+
+String WiFiClass::SSID(uint8_t index) {
+    const std::vector<HalWifiNetwork>& networks = hal.getNetworks();
+    return scanDone && index < networks.size() ? String(networks[index].ssid) : String();
+}
+
+int32_t WiFiClass::RSSI(uint8_t index) {
+    const std::vector<HalWifiNetwork>& networks = hal.getNetworks();
+    return scanDone && index < networks.size() ? networks[index].rssi : 0;
+}
+
+uint8_t* WiFiClass::BSSID(uint8_t index) {
+    const std::vector<HalWifiNetwork>& networks = hal.getNetworks();
+    return scanDone && index < networks.size() ? (uint8_t*)networks[index].bssid : NULL;
+}
+
+int32_t WiFiClass::channel(uint8_t index) {
+    const std::vector<HalWifiNetwork>& networks = hal.getNetworks();
+    return scanDone && index < networks.size() ? networks[index].channel : 0;
+}
+
+wifi_auth_mode_t WiFiClass::encryptionType(uint8_t index) {
+    const std::vector<HalWifiNetwork>& networks = hal.getNetworks();
+    if (!scanDone || index >= networks.size()) return WIFI_AUTH_OPEN;
+    return networks[index].open ? WIFI_AUTH_OPEN : WIFI_AUTH_WPA2_PSK;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+    stop();
+    connection = hal.httpConnect(host, port);
+    return connection != 0 ? 1 : 0;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    stop();
+    connection = hal.httpConnect(host, port, timeoutMs);
+    return connection != 0 ? 1 : 0;
+}
+
+bool WiFiClient::connected() {
+    return connection != 0 && hal.httpConnected(connection);
+}
+
+void WiFiClient::stop() {
+    if (connection != 0) {
+        hal.httpClose(connection);
+        connection = 0;
+    }
+}
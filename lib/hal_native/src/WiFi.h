@@ -0,0 +1,121 @@
+#ifndef WIFI_H
+#define WIFI_H
+
+#include <Arduino.h>
+#include <mutex>
+#include <string>
+
+#define WL_IDLE_STATUS 0
+#define WL_NO_SSID_AVAIL 1
+#define WL_SCAN_COMPLETED 2
+#define WL_CONNECTED 3
+#define WL_CONNECT_FAILED 4
+#define WL_CONNECTION_LOST 5
+#define WL_DISCONNECTED 6
+
+#define WIFI_OFF 0
+#define WIFI_STA 1
+#define WIFI_AP 2
+#define WIFI_AP_STA 3
+
+#define WIFI_AUTH_OPEN 0
+#define WIFI_AUTH_WPA2_PSK 3
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+typedef int wl_status_t;
+typedef int wifi_mode_t;
+typedef int wifi_auth_mode_t;
+
+// Radio stand-in over NativeHal's network list. A station connect or a
+// scan takes a little HAL time to finish, like the real radio, so the
+// firmware's non-blocking bring-up paths are exercised.
+class WiFiClass {
+public:
+    WiFiClass();
+
+    bool mode(wifi_mode_t mode);
+    wifi_mode_t getMode() { return currentMode; }
+    wl_status_t status();
+    bool isConnected() { return status() == WL_CONNECTED; }
+
+    wl_status_t begin(const char* ssid, const char* password = NULL, int32_t channel = 0, const uint8_t* bssid = NULL, bool connect = true);
+    bool disconnect(bool wifiOff = false, bool eraseAp = false);
+    bool reconnect();
+    bool setAutoReconnect(bool enabled) { autoReconnect = enabled; return true; }
+    void persistent(bool enabled) { (void)enabled; }
+    bool setSleep(bool enabled) { (void)enabled; return true; }
+    bool setHostname(const char* name) { (void)name; return true; }
+
+    bool softAP(const char* ssid, const char* password = NULL, int channel = 1, int hidden = 0, int maxConnections = 4);
+    bool softAPdisconnect(bool wifiOff = false);
+    IPAddress softAPIP();
+
+    IPAddress localIP();
+    IPAddress gatewayIP();
+    IPAddress dnsIP(uint8_t index = 0);
+    String macAddress() { return "AA:BB:CC:DD:EE:FF"; }
+
+    String SSID();
+    int32_t RSSI();
+    uint8_t* BSSID();
+    String BSSIDstr();
+    int32_t channel();
+
+    int16_t scanNetworks(bool async = false, bool showHidden = false, bool passive = false, uint32_t maxMsPerChannel = 300, uint8_t channel = 0);
+    int16_t scanComplete();
+    void scanDelete();
+    String SSID(uint8_t index);
+    int32_t RSSI(uint8_t index);
+    uint8_t* BSSID(uint8_t index);
+    int32_t channel(uint8_t index);
+    wifi_auth_mode_t encryptionType(uint8_t index);
+
+private:
+    std::recursive_mutex lock;
+    wifi_mode_t currentMode;
+    bool autoReconnect;
+
+    std::string targetSsid;
+    std::string targetPassword;
+    unsigned long connectStartMs;
+    wl_status_t lastStatus;
+    int connectedIndex;          // Into NativeHal's network list
+    uint8_t connectedBssid[6];
+
+    bool apActive;
+
+    unsigned long scanStartMs;
+    bool scanRunning;
+    bool scanDone;
+
+    int findNetwork(const std::string& ssid, const uint8_t* bssid);
+};
+
+extern WiFiClass WiFi;
+
+// TCP client whose connections are NativeHal's upstream stand-in: a
+// connect costs the configured handshake and the server may close or drop
+// it. No bytes flow through it; HTTPClient hands requests to NativeHal.
+class WiFiClient : public Stream {
+public:
+    WiFiClient() : connection(0) {}
+    WiFiClient(const WiFiClient&) = delete;
+    WiFiClient& operator=(const WiFiClient&) = delete;
+    virtual ~WiFiClient() { stop(); }
+    virtual int connect(const char* host, uint16_t port);
+    virtual int connect(const char* host, uint16_t port, int32_t timeoutMs);
+    virtual bool connected();
+    virtual void stop();
+    size_t write(uint8_t c) override { (void)c; return 0; }
+    size_t write(const uint8_t* buffer, size_t size) override { (void)buffer; (void)size; return 0; }
+    using Print::write;
+    operator bool() { return connected(); }
+    int nativeConnection() const { return connection; }
+
+private:
+    int connection;
+};
+
+#endif // WIFI_H
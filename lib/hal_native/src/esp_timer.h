@@ -0,0 +1,10 @@
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <stdint.h>
+
+// Microseconds since boot, from the same clock as micros() but without
+// its 32-bit wrap
+int64_t esp_timer_get_time();
+
+#endif // ESP_TIMER_H
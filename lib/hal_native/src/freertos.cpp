@@ -0,0 +1,226 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <string>
+#include <thread>
+
+// A counting semaphore covers mutexes and binary semaphores too. Timeouts
+// are in host milliseconds: they guard against deadlock, they are not part
+// of the simulated timeline.
+struct NativeSemaphore {
+    std::mutex lock;
+    std::condition_variable changed;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+    std::thread::id owner;      // Recursive mutexes only
+    UBaseType_t depth;
+};
+
+struct NativeQueue {
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<std::string> items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+};
+
+static std::atomic<UBaseType_t> runningTasks(1);    // The loop thread
+
+template<typename Ready>
+static bool waitFor(std::unique_lock<std::mutex>& guard, std::condition_variable& changed,
+                    TickType_t ticks, Ready ready) {
+    if (ticks == portMAX_DELAY) {
+        changed.wait(guard, ready);
+        return true;
+    }
+    return changed.wait_for(guard, std::chrono::milliseconds(ticks), ready);
+}
+
+static SemaphoreHandle_t createSemaphore(UBaseType_t maxCount, UBaseType_t initialCount) {
+    NativeSemaphore* semaphore = new NativeSemaphore();
+    semaphore->count = initialCount;
+    semaphore->maxCount = maxCount;
+    semaphore->depth = 0;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return createSemaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return createSemaphore(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    return createSemaphore(maxCount, initialCount);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    if (semaphore == NULL) return pdFALSE;
+
+    std::unique_lock<std::mutex> guard(semaphore->lock);
+    if (!waitFor(guard, semaphore->changed, ticks, [semaphore] { return semaphore->count > 0; })) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    if (semaphore == NULL) return pdFALSE;
+
+    {
+        std::lock_guard<std::mutex> guard(semaphore->lock);
+        if (semaphore->count >= semaphore->maxCount) {
+            return pdFALSE;
+        }
+        semaphore->count++;
+    }
+    semaphore->changed.notify_one();
+    return pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    return createSemaphore(1, 1);
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    if (semaphore == NULL) return pdFALSE;
+
+    std::unique_lock<std::mutex> guard(semaphore->lock);
+    if (semaphore->depth > 0 && semaphore->owner == std::this_thread::get_id()) {
+        semaphore->depth++;
+        return pdTRUE;
+    }
+    if (!waitFor(guard, semaphore->changed, ticks, [semaphore] { return semaphore->count > 0; })) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    semaphore->owner = std::this_thread::get_id();
+    semaphore->depth = 1;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore) {
+    if (semaphore == NULL) return pdFALSE;
+
+    {
+        std::lock_guard<std::mutex> guard(semaphore->lock);
+        if (semaphore->depth == 0 || semaphore->owner != std::this_thread::get_id()) {
+            return pdFALSE;
+        }
+        if (--semaphore->depth > 0) {
+            return pdTRUE;
+        }
+        semaphore->owner = std::thread::id();
+        semaphore->count++;
+    }
+    semaphore->changed.notify_one();
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    NativeQueue* queue = new NativeQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    if (queue == NULL) return errQUEUE_FULL;
+
+    {
+        std::unique_lock<std::mutex> guard(queue->lock);
+        if (!waitFor(guard, queue->changed, ticks, [queue] { return queue->items.size() < queue->length; })) {
+            return errQUEUE_FULL;
+        }
+        queue->items.push_back(std::string((const char*)item, queue->itemSize));
+    }
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    if (queue == NULL) return pdFALSE;
+
+    {
+        std::unique_lock<std::mutex> guard(queue->lock);
+        if (!waitFor(guard, queue->changed, ticks, [queue] { return !queue->items.empty(); })) {
+            return pdFALSE;
+        }
+        memcpy(item, queue->items.front().data(), queue->itemSize);
+        queue->items.pop_front();
+    }
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    if (queue == NULL) return 0;
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return queue->items.size();
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                       void* parameter, UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(function, name, stackDepth, parameter, priority, handle, tskNO_AFFINITY);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                   void* parameter, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    (void)name;
+    (void)stackDepth;
+    (void)priority;
+    (void)core;
+
+    runningTasks++;
+    std::thread worker([function, parameter] {
+        function(parameter);
+        runningTasks--;
+    });
+    if (handle != NULL) {
+        *handle = (TaskHandle_t)(uintptr_t)std::hash<std::thread::id>()(worker.get_id());
+    }
+    worker.detach();
+    return pdPASS;
+}
+
+// A task deleting itself ends its thread; other tasks cannot be stopped
+// from outside, and nothing in the firmware tries to
+void vTaskDelete(TaskHandle_t task) {
+    if (task == NULL) {
+        runningTasks--;
+        pthread_exit(NULL);
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    delay(ticks);
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)millis();
+}
+
+UBaseType_t uxTaskGetNumberOfTasks() {
+    return runningTasks.load();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    (void)task;
+    return 0;
+}
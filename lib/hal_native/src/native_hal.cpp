@@ -0,0 +1,628 @@
+#include "native_hal.h"
+#include "esp_timer.h"
+#include <errno.h>
+#include <random>
+#include <sys/time.h>
+#include <unistd.h>
+
+// Constructed before any firmware global, whose constructors may already
+// read the clock
+NativeHal hal __attribute__((init_priority(101)));
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static std::mt19937 randomEngine(1);   // Fixed seed: runs are repeatable
+
+NativeHal::NativeHal() {
+    stopRequested = false;
+    virtualClock = false;
+    virtualUs = 0;
+    realStartUs = hostMicros();
+    // time() itself is redirected to this object below
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    wallBase = wall.tv_sec;
+    wallSynced = false;
+    nvsWrites = 0;
+    display = NULL;
+    frames = 0;
+    wifiAvailable = true;
+    freeHeap = 200 * 1024;
+    minFreeHeap = freeHeap;
+    largestBlock = 110 * 1024;
+    upstream.handshakeMs = 0;
+    upstream.replyMs = 0;
+    upstream.keepAliveMs = 60000;
+    upstreamCounts = HalUpstreamStats();
+    upstreamDown = false;
+    nextConnection = 1;
+    serialOutput = stdout;
+    port = 8080;
+    dataDir = "data";
+
+    // The firmware never sets a zone, so the ESP32 runs on UTC
+    setenv("TZ", "UTC0", 1);
+    tzset();
+
+    HalWifiNetwork home = {"HomeNetwork", "", -52, 6, {0x02, 0x00, 0x00, 0x00, 0x00, 0x01}, false};
+    HalWifiNetwork cafe = {"Cafe Guest", "", -71, 11, {0x02, 0x00, 0x00, 0x00, 0x00, 0x02}, true};
+    networks.push_back(home);
+    networks.push_back(cafe);
+}
+
+void NativeHal::begin(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        String option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (option == "--port" && value != NULL) {
+            port = atoi(value);
+            i++;
+        } else if (option == "--data" && value != NULL) {
+            dataDir = value;
+            i++;
+        } else if (option == "--storage" && value != NULL) {
+            setStoragePath(value);
+            i++;
+        } else if (option == "--epoch" && value != NULL) {
+            setWallClock(atol(value));
+            i++;
+        } else if (option == "--virtual-time") {
+            useVirtualClock(true);
+        } else {
+            fprintf(stderr, "usage: %s [--port N] [--data DIR] [--storage FILE] [--epoch SECONDS] [--virtual-time]\n", argv[0]);
+            exit(2);
+        }
+    }
+}
+
+// ---- Clock ----
+
+uint64_t NativeHal::hostMicros() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+void NativeHal::useVirtualClock(bool enabled) {
+    std::lock_guard<std::mutex> guard(clockLock);
+    if (enabled == virtualClock) return;
+
+    // Switching keeps the clock continuous
+    if (enabled) {
+        virtualUs = hostMicros() - realStartUs;
+    } else {
+        realStartUs = hostMicros() - virtualUs;
+    }
+    virtualClock = enabled;
+}
+
+uint64_t NativeHal::nowUs() {
+    std::lock_guard<std::mutex> guard(clockLock);
+    return virtualClock ? virtualUs : hostMicros() - realStartUs;
+}
+
+void NativeHal::advance(uint64_t us) {
+    std::lock_guard<std::mutex> guard(clockLock);
+    if (virtualClock) {
+        virtualUs += us;
+    }
+}
+
+void NativeHal::sleepMs(uint32_t ms) {
+    if (virtualClock) {
+        advance((uint64_t)ms * 1000);
+    } else {
+        usleep((useconds_t)ms * 1000);
+    }
+}
+
+void NativeHal::setWallClock(time_t epoch) {
+    uint64_t elapsed = nowUs() / 1000000;
+    std::lock_guard<std::mutex> guard(clockLock);
+    wallBase = epoch - (time_t)elapsed;
+}
+
+time_t NativeHal::wallClock() {
+    time_t elapsed = (time_t)(nowUs() / 1000000);
+    return wallSynced ? wallBase + elapsed : elapsed;
+}
+
+// ---- Storage ----
+
+void NativeHal::setStoragePath(const std::string& path) {
+    std::lock_guard<std::recursive_mutex> guard(storageLock);
+    storagePath = path;
+    loadStorage();
+}
+
+bool NativeHal::readValue(const std::string& space, const std::string& key, HalStoredValue& value) {
+    std::lock_guard<std::recursive_mutex> guard(storageLock);
+    auto found = storage.find(space);
+    if (found == storage.end()) return false;
+    auto entry = found->second.find(key);
+    if (entry == found->second.end()) return false;
+    value = entry->second;
+    return true;
+}
+
+void NativeHal::writeValue(const std::string& space, const std::string& key, uint8_t type, const void* data, size_t size) {
+    {
+        std::lock_guard<std::recursive_mutex> guard(storageLock);
+        HalStoredValue& value = storage[space][key];
+        value.type = type;
+        value.bytes.assign((const char*)data, size);
+        nvsWrites++;
+        persist();
+    }
+    emit(HAL_EVENT_NVS_WRITE, type, (int32_t)size, space + "/" + key);
+}
+
+bool NativeHal::eraseValue(const std::string& space, const std::string& key) {
+    std::lock_guard<std::recursive_mutex> guard(storageLock);
+    auto found = storage.find(space);
+    if (found == storage.end() || found->second.erase(key) == 0) return false;
+    persist();
+    return true;
+}
+
+void NativeHal::eraseSpace(const std::string& space) {
+    std::lock_guard<std::recursive_mutex> guard(storageLock);
+    storage.erase(space);
+    persist();
+}
+
+size_t NativeHal::valueCount(const std::string& space) {
+    std::lock_guard<std::recursive_mutex> guard(storageLock);
+    auto found = storage.find(space);
+    return found == storage.end() ? 0 : found->second.size();
+}
+
+std::vector<std::string> NativeHal::valueKeys(const std::string& space) {
+    std::lock_guard<std::recursive_mutex> guard(storageLock);
+    std::vector<std::string> keys;
+    auto found = storage.find(space);
+    if (found != storage.end()) {
+        for (const auto& entry : found->second) keys.push_back(entry.first);
+    }
+    return keys;
+}
+
+std::vector<std::string> NativeHal::spaceNames() {
+    std::lock_guard<std::recursive_mutex> guard(storageLock);
+    std::vector<std::string> spaces;
+    for (const auto& entry : storage) spaces.push_back(entry.first);
+    return spaces;
+}
+
+void NativeHal::persist() {
+    // One line per value: namespace, key, type and hex payload
+    std::lock_guard<std::recursive_mutex> guard(storageLock);
+    if (storagePath.empty()) return;
+
+    std::string temp = storagePath + ".tmp";
+    FILE* file = fopen(temp.c_str(), "w");
+    if (file == NULL) {
+        fprintf(stderr, "native: cannot write %s: %s\n", temp.c_str(), strerror(errno));
+        return;
+    }
+
+    for (auto& space : storage) {
+        for (auto& entry : space.second) {
+            fprintf(file, "%s\t%s\t%u\t", space.first.c_str(), entry.first.c_str(), entry.second.type);
+            for (unsigned char c : entry.second.bytes) {
+                fprintf(file, "%02x", c);
+            }
+            fputc('\n', file);
+        }
+    }
+
+    fclose(file);
+    rename(temp.c_str(), storagePath.c_str());
+}
+
+void NativeHal::loadStorage() {
+    storage.clear();
+
+    FILE* file = fopen(storagePath.c_str(), "r");
+    if (file == NULL) return;   // First run starts with erased flash
+
+    char line[8192];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char* space = strtok(line, "\t");
+        char* key = strtok(NULL, "\t");
+        char* type = strtok(NULL, "\t");
+        char* hex = strtok(NULL, "\n");
+        if (space == NULL || key == NULL || type == NULL) continue;
+
+        HalStoredValue& value = storage[space][key];
+        value.type = atoi(type);
+        value.bytes.clear();
+        for (size_t i = 0; hex != NULL && hex[i] != '\0' && hex[i + 1] != '\0'; i += 2) {
+            char byte[3] = {hex[i], hex[i + 1], '\0'};
+            value.bytes += (char)strtol(byte, NULL, 16);
+        }
+    }
+
+    fclose(file);
+}
+
+// ---- GPIO and servo ----
+
+void NativeHal::setPin(uint8_t pin, int level) {
+    std::lock_guard<std::mutex> guard(pinLock);
+    pins[pin] = level;
+}
+
+int NativeHal::getPin(uint8_t pin) {
+    std::lock_guard<std::mutex> guard(pinLock);
+    auto found = pins.find(pin);
+    if (found != pins.end()) return found->second;
+
+    // Floating inputs read as their pull
+    auto mode = pinModes.find(pin);
+    return mode != pinModes.end() && mode->second == INPUT_PULLUP ? HIGH : LOW;
+}
+
+void NativeHal::setPinMode(uint8_t pin, uint8_t mode) {
+    std::lock_guard<std::mutex> guard(pinLock);
+    pinModes[pin] = mode;
+}
+
+void NativeHal::writeServo(int pin, int angle) {
+    {
+        std::lock_guard<std::mutex> guard(pinLock);
+        servos[pin] = angle;
+    }
+    emit(HAL_EVENT_SERVO, pin, angle);
+}
+
+int NativeHal::servoAngle(int pin) {
+    std::lock_guard<std::mutex> guard(pinLock);
+    auto found = servos.find(pin);
+    return found == servos.end() ? -1 : found->second;
+}
+
+void NativeHal::displayFrame() {
+    frames++;
+    emit(HAL_EVENT_DISPLAY, -1, (int32_t)frames);
+}
+
+// ---- Network and heap ----
+
+void NativeHal::setNetworks(const std::vector<HalWifiNetwork>& list) {
+    networks = list;
+}
+
+void NativeHal::setHeap(uint32_t freeBytes, uint32_t largest) {
+    freeHeap = freeBytes;
+    largestBlock = largest;
+    if (freeBytes < minFreeHeap) minFreeHeap = freeBytes;
+}
+
+void NativeHal::setUpstream(const HalUpstream& settings) {
+    std::lock_guard<std::mutex> guard(connectionLock);
+    upstream = settings;
+}
+
+HalUpstreamStats NativeHal::upstreamStats() {
+    std::lock_guard<std::mutex> guard(connectionLock);
+    return upstreamCounts;
+}
+
+void NativeHal::dropConnections() {
+    std::lock_guard<std::mutex> guard(connectionLock);
+    for (auto& entry : connections) {
+        entry.second.dropped = true;
+    }
+}
+
+void NativeHal::setUpstreamDown(bool down) {
+    std::lock_guard<std::mutex> guard(connectionLock);
+    upstreamDown = down;
+}
+
+int NativeHal::httpConnect(const String& host, uint16_t port, uint32_t timeoutMs) {
+    (void)host;
+    (void)port;
+    if (!httpHandler) {
+        return 0;
+    }
+
+    uint32_t handshakeMs;
+    {
+        std::lock_guard<std::mutex> guard(connectionLock);
+        if (upstreamDown) {
+            return 0;
+        }
+        handshakeMs = upstream.handshakeMs;
+    }
+    // Not under the lock: other tasks keep the clock moving meanwhile
+    if (handshakeMs > timeoutMs) {
+        sleepMs(timeoutMs);
+        return 0;
+    }
+    sleepMs(handshakeMs);
+
+    std::lock_guard<std::mutex> guard(connectionLock);
+    upstreamCounts.handshakes++;
+    int id = nextConnection++;
+    Connection& connection = connections[id];
+    connection.lastUsedUs = nowUs();
+    connection.dropped = false;
+    connection.nextPiece = 0;
+    connection.pieceMs = 0;
+    return id;
+}
+
+bool NativeHal::httpConnected(int id) {
+    std::lock_guard<std::mutex> guard(connectionLock);
+    auto found = connections.find(id);
+    if (found == connections.end()) {
+        return false;
+    }
+    // A dropped connection still looks open; one the server closed does not
+    if (!found->second.dropped && nowUs() - found->second.lastUsedUs > (uint64_t)upstream.keepAliveMs * 1000) {
+        connections.erase(found);
+        return false;
+    }
+    return true;
+}
+
+void NativeHal::httpClose(int id) {
+    std::lock_guard<std::mutex> guard(connectionLock);
+    connections.erase(id);
+}
+
+int NativeHal::httpRequest(int id, const String& method, const String& url, const String& body) {
+    {
+        std::lock_guard<std::mutex> guard(connectionLock);
+        auto found = connections.find(id);
+        if (found == connections.end()) {
+            return -4;  // HTTPC_ERROR_NOT_CONNECTED
+        }
+        if (found->second.dropped || upstreamDown ||
+            nowUs() - found->second.lastUsedUs > (uint64_t)upstream.keepAliveMs * 1000) {
+            upstreamCounts.lost++;
+            connections.erase(found);
+            return -5;  // HTTPC_ERROR_CONNECTION_LOST
+        }
+        upstreamCounts.requests++;
+    }
+
+    String response;
+    int code = httpHandler ? httpHandler(method, url, body, response) : -5;
+
+    // Server-sent events are delivered one at a time, anything else whole;
+    // an empty body is one empty piece, so it still takes replyMs
+    std::vector<std::string> pieces;
+    std::string text = response.c_str();
+    bool events = text.compare(0, 5, "data:") == 0 || text.compare(0, 6, "event:") == 0;
+    size_t start = 0;
+    do {
+        size_t end = events ? text.find("\n\n", start) : std::string::npos;
+        end = end == std::string::npos ? text.size() : end + 2;
+        pieces.push_back(text.substr(start, end - start));
+        start = end;
+    } while (start < text.size());
+
+    std::lock_guard<std::mutex> guard(connectionLock);
+    auto found = connections.find(id);
+    if (found != connections.end()) {
+        found->second.pieces = pieces;
+        found->second.nextPiece = 0;
+        found->second.pieceMs = upstream.replyMs / pieces.size();
+        found->second.lastUsedUs = nowUs();
+    }
+    return code;
+}
+
+int NativeHal::httpRead(int id, String& piece, uint32_t timeoutMs) {
+    uint32_t waitMs;
+    {
+        std::lock_guard<std::mutex> guard(connectionLock);
+        auto found = connections.find(id);
+        if (found == connections.end() || found->second.nextPiece >= found->second.pieces.size()) {
+            return 0;
+        }
+        waitMs = found->second.pieceMs;
+    }
+
+    // Not under the lock: other tasks keep the clock moving meanwhile
+    if (waitMs > timeoutMs) {
+        sleepMs(timeoutMs);
+        httpClose(id);
+        return -11;  // HTTPC_ERROR_READ_TIMEOUT
+    }
+    sleepMs(waitMs);
+
+    std::lock_guard<std::mutex> guard(connectionLock);
+    auto found = connections.find(id);
+    if (found == connections.end() || found->second.nextPiece >= found->second.pieces.size()) {
+        return 0;
+    }
+    piece = found->second.pieces[found->second.nextPiece++].c_str();
+    found->second.lastUsedUs = nowUs();
+    return 1;
+}
+
+// ---- Events ----
+
+void NativeHal::onEvent(HalEventHandler handler) {
+    std::lock_guard<std::mutex> guard(eventLock);
+    handlers.push_back(handler);
+}
+
+void NativeHal::emit(HalEventType type, int pin, int32_t value, const std::string& name) {
+    std::vector<HalEventHandler> current;
+    {
+        std::lock_guard<std::mutex> guard(eventLock);
+        if (handlers.empty()) return;
+        current = handlers;
+    }
+
+    HalEvent event = {type, nowUs(), pin, value, name};
+    for (auto& handler : current) {
+        handler(event);
+    }
+}
+
+// ---- Arduino core ----
+
+unsigned long millis() {
+    return (unsigned long)(hal.nowUs() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)hal.nowUs();
+}
+
+int64_t esp_timer_get_time() {
+    return (int64_t)hal.nowUs();
+}
+
+void delay(uint32_t ms) {
+    hal.sleepMs(ms);
+}
+
+void delayMicroseconds(uint32_t us) {
+    if (hal.isVirtualClock()) {
+        hal.advance(us);
+    } else {
+        usleep(us);
+    }
+}
+
+void yield() {
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    hal.setPinMode(pin, mode);
+}
+
+int digitalRead(uint8_t pin) {
+    return hal.getPin(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    hal.setPin(pin, value);
+    hal.emit(HAL_EVENT_GPIO, pin, value);
+}
+
+long random(long max) {
+    return max <= 0 ? 0 : (long)(randomEngine() % (unsigned long)max);
+}
+
+long random(long min, long max) {
+    return min >= max ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) {
+    randomEngine.seed(seed);
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1, const char* server2, const char* server3) {
+    // POSIX zones count west of Greenwich as positive
+    char zone[32];
+    long offset = -(gmtOffsetSec + daylightOffsetSec);
+    snprintf(zone, sizeof(zone), "UTC%+ld:%02ld", offset / 3600, labs(offset % 3600) / 60);
+    setenv("TZ", zone, 1);
+    tzset();
+
+    hal.syncWallClock();
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+    // Same rule as the ESP32 core: anything before 2016 is "not set yet"
+    time_t now = hal.wallClock();
+    localtime_r(&now, info);
+    return info->tm_year > (2016 - 1900);
+}
+
+// The firmware's time() calls resolve here rather than to libc, so the
+// wall clock follows the (possibly virtual) HAL clock
+extern "C" time_t time(time_t* out) noexcept {
+    time_t now = hal.wallClock();
+    if (out != NULL) *out = now;
+    return now;
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (size-- > 0) {
+        written += write(*buffer++);
+    }
+    return written;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char stackBuffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(stackBuffer, sizeof(stackBuffer), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+
+    if ((size_t)length < sizeof(stackBuffer)) {
+        return write((const uint8_t*)stackBuffer, length);
+    }
+
+    std::string heapBuffer(length + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&heapBuffer[0], heapBuffer.size(), format, args);
+    va_end(args);
+    return write((const uint8_t*)heapBuffer.data(), length);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    FILE* output = hal.getSerialOutput();
+    return output != NULL ? fwrite(buffer, 1, size, output) : size;
+}
+
+void HardwareSerial::flush() {
+    FILE* output = hal.getSerialOutput();
+    if (output != NULL) fflush(output);
+}
+
+uint32_t EspClass::getFreeHeap() { return hal.getFreeHeap(); }
+uint32_t EspClass::getMinFreeHeap() { return hal.getMinFreeHeap(); }
+uint32_t EspClass::getMaxAllocHeap() { return hal.getLargestBlock(); }
+uint32_t EspClass::getHeapSize() { return 320 * 1024; }
+uint32_t EspClass::getPsramSize() { return 0; }
+uint32_t EspClass::getFreePsram() { return 0; }
+bool psramFound() { return ESP.getPsramSize() > 0; }
+void* ps_malloc(size_t size) { return malloc(size); }
+
+void EspClass::restart() {
+    hal.persist();
+    fflush(stdout);
+    exit(0);
+}
+
+// Runs the sketch like the ESP32 loop task does. Simulators, benchmarks
+// and tests provide their own main() and drive setup()/loop() themselves.
+__attribute__((weak)) int main(int argc, char** argv) {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    hal.begin(argc, argv);
+
+    setup();
+    while (!hal.shouldStop()) {
+        loop();
+    }
+
+    hal.persist();
+
+    // Skip static destructors: the server thread and task threads are still
+    // running, as they would be on the device
+    fflush(stdout);
+    _exit(0);
+}
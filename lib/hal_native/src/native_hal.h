@@ -0,0 +1,223 @@
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+#include <Arduino.h>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The hardware side of the native build. The firmware keeps calling the
+// Arduino/ESP32 APIs; their native implementations come here for the
+// clock, key-value storage, GPIO, servo PWM, the display, Wi-Fi and the
+// upstream HTTP client. Simulators and tests drive the same object to
+// inject input and observe output.
+
+// Something the firmware did to the hardware
+enum HalEventType {
+    HAL_EVENT_GPIO,          // digitalWrite(): pin, value
+    HAL_EVENT_SERVO,         // Servo::write(): pin, value = angle
+    HAL_EVENT_NVS_WRITE,     // One key written: name = namespace/key, pin = nvs_type_t, value = bytes
+    HAL_EVENT_DISPLAY,       // display() pushed a frame: value = frame number
+    HAL_EVENT_WIFI           // Station state change: value = WL_* status
+};
+
+struct HalEvent {
+    HalEventType type;
+    uint64_t atUs;           // HAL clock when it happened
+    int pin;
+    int32_t value;
+    std::string name;
+};
+
+struct HalWifiNetwork {
+    std::string ssid;
+    std::string password;
+    int32_t rssi;
+    uint8_t channel;
+    uint8_t bssid[6];
+    bool open;
+};
+
+// Stored NVS value; type codes follow nvs_type_t
+struct HalStoredValue {
+    uint8_t type;
+    std::string bytes;
+};
+
+// The HTTPS server behind the HTTP handler: what a connection costs on the
+// HAL clock and how long the server keeps an idle one open
+struct HalUpstream {
+    uint32_t handshakeMs;    // TCP connect plus TLS handshake
+    uint32_t replyMs;        // Per request, until the whole response is in;
+                             // a server-sent event stream arrives an event
+                             // at a time, spread evenly over it
+    uint32_t keepAliveMs;    // Idle connections are closed after this
+};
+
+struct HalUpstreamStats {
+    uint32_t handshakes;
+    uint32_t requests;
+    uint32_t lost;           // Requests sent on a connection the server had dropped
+};
+
+typedef std::function<void(const HalEvent&)> HalEventHandler;
+typedef std::function<int(const String& method, const String& url, const String& body, String& response)> HalHttpHandler;
+
+class Adafruit_SSD1306;
+
+class NativeHal {
+public:
+    NativeHal();
+
+    // Parses --port, --data, --storage, --epoch and --virtual-time, then
+    // loads storage
+    void begin(int argc, char** argv);
+    void requestStop() { stopRequested = true; }
+    bool shouldStop() const { return stopRequested; }
+
+    // Clock. In virtual mode time only moves through advance() and delay(),
+    // so months of behavior run as fast as the CPU allows.
+    void useVirtualClock(bool enabled);
+    bool isVirtualClock() const { return virtualClock; }
+    uint64_t nowUs();
+    void advance(uint64_t us);
+    void sleepMs(uint32_t ms);
+    void setWallClock(time_t epoch);
+    void syncWallClock() { wallSynced = true; }
+    time_t wallClock();
+
+    // Key-value storage, shared by Preferences and the nvs_* API
+    void setStoragePath(const std::string& path);
+    bool readValue(const std::string& space, const std::string& key, HalStoredValue& value);
+    void writeValue(const std::string& space, const std::string& key, uint8_t type, const void* data, size_t size);
+    bool eraseValue(const std::string& space, const std::string& key);
+    void eraseSpace(const std::string& space);
+    size_t valueCount(const std::string& space);
+    std::vector<std::string> valueKeys(const std::string& space);
+    std::vector<std::string> spaceNames();
+    void persist();
+    uint32_t storageWrites() const { return nvsWrites; }
+
+    // GPIO: inputs are set by the test, outputs recorded
+    void setPin(uint8_t pin, int level);
+    int getPin(uint8_t pin);
+    void setPinMode(uint8_t pin, uint8_t mode);
+
+    // Servo PWM
+    void writeServo(int pin, int angle);
+    int servoAngle(int pin);
+
+    // Display framebuffer of the panel that called begin() last
+    void attachDisplay(Adafruit_SSD1306* panel) { display = panel; }
+    Adafruit_SSD1306* getDisplay() { return display; }
+    void displayFrame();
+    uint32_t displayFrames() const { return frames; }
+
+    // Wi-Fi: networks in range and whether a station connect succeeds
+    void setNetworks(const std::vector<HalWifiNetwork>& networks);
+    const std::vector<HalWifiNetwork>& getNetworks() const { return networks; }
+    void setWifiAvailable(bool available) { wifiAvailable = available; }
+    bool isWifiAvailable() const { return wifiAvailable; }
+
+    // Heap figures ESP.getFreeHeap() and friends report
+    void setHeap(uint32_t freeHeap, uint32_t largestBlock);
+    uint32_t getFreeHeap() const { return freeHeap; }
+    uint32_t getMinFreeHeap() const { return minFreeHeap; }
+    uint32_t getLargestBlock() const { return largestBlock; }
+
+    // Outbound HTTP (WiFiClient/HTTPClient); without a handler connects
+    // fail like an unreachable host. Connections are IDs; 0 is none.
+    void setHttpHandler(HalHttpHandler handler) { httpHandler = handler; }
+    void setUpstream(const HalUpstream& settings);
+    HalUpstreamStats upstreamStats();
+    // Forgets every open connection without telling the client, like a NAT
+    // timeout: the next request on one is lost
+    void dropConnections();
+    // A server that is down refuses connections and resets open ones
+    void setUpstreamDown(bool down);
+    // Gives up after timeoutMs when the handshake would take longer
+    int httpConnect(const String& host, uint16_t port, uint32_t timeoutMs = UINT32_MAX);
+    bool httpConnected(int connection);
+    void httpClose(int connection);
+    // Sends a request and returns the status once the server answers; the
+    // body then arrives through httpRead(), which waits for each piece and
+    // returns 1 with it, 0 at the end, or -11 (HTTPC_ERROR_READ_TIMEOUT)
+    // and closes the connection when a piece takes longer than timeoutMs
+    int httpRequest(int connection, const String& method, const String& url, const String& body);
+    int httpRead(int connection, String& piece, uint32_t timeoutMs = UINT32_MAX);
+
+    // Observers
+    void onEvent(HalEventHandler handler);
+    void emit(HalEventType type, int pin, int32_t value, const std::string& name = std::string());
+
+    // Where Serial writes go (stdout by default); NULL drops them
+    void setSerialOutput(FILE* stream) { serialOutput = stream; }
+    FILE* getSerialOutput() const { return serialOutput; }
+
+    uint16_t getPort() const { return port; }
+    const std::string& getDataDir() const { return dataDir; }
+
+private:
+    volatile bool stopRequested;
+
+    bool virtualClock;
+    uint64_t virtualUs;
+    uint64_t realStartUs;
+    time_t wallBase;         // Epoch at clock zero
+    bool wallSynced;         // configTime() was called; until then time()
+                             // counts from 1970 like an unsynced ESP32
+    std::mutex clockLock;
+
+    std::recursive_mutex storageLock;
+    std::map<std::string, std::map<std::string, HalStoredValue>> storage;
+    std::string storagePath;
+    uint32_t nvsWrites;
+
+    std::mutex pinLock;
+    std::map<uint8_t, int> pins;
+    std::map<uint8_t, uint8_t> pinModes;
+    std::map<int, int> servos;
+
+    Adafruit_SSD1306* display;
+    uint32_t frames;
+
+    std::vector<HalWifiNetwork> networks;
+    bool wifiAvailable;
+
+    uint32_t freeHeap;
+    uint32_t minFreeHeap;
+    uint32_t largestBlock;
+
+    struct Connection {
+        uint64_t lastUsedUs;
+        bool dropped;
+        std::vector<std::string> pieces;   // Response body still to be read
+        size_t nextPiece;
+        uint32_t pieceMs;
+    };
+
+    HalHttpHandler httpHandler;
+    HalUpstream upstream;
+    HalUpstreamStats upstreamCounts;
+    bool upstreamDown;
+    std::map<int, Connection> connections;
+    int nextConnection;
+    std::mutex connectionLock;
+
+    std::mutex eventLock;
+    std::vector<HalEventHandler> handlers;
+
+    FILE* serialOutput;
+
+    uint16_t port;
+    std::string dataDir;
+
+    void loadStorage();
+    static uint64_t hostMicros();
+};
+
+extern NativeHal hal;
+
+#endif // NATIVE_HAL_H
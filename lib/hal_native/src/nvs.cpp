@@ -0,0 +1,200 @@
+#include "nvs.h"
+#include "native_hal.h"
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Entries as they were when the iteration started
+struct nvs_opaque_iterator_t {
+    std::vector<nvs_entry_info_t> entries;
+    size_t position;
+};
+
+namespace {
+
+struct OpenHandle {
+    std::string space;
+    bool writable;
+};
+
+std::mutex handleLock;
+std::map<nvs_handle_t, OpenHandle> handles;
+nvs_handle_t nextHandle = 1;
+
+esp_err_t lookup(nvs_handle_t handle, OpenHandle& out) {
+    std::lock_guard<std::mutex> guard(handleLock);
+    auto found = handles.find(handle);
+    if (found == handles.end()) return ESP_ERR_NVS_INVALID_HANDLE;
+    out = found->second;
+    return ESP_OK;
+}
+
+esp_err_t setValue(nvs_handle_t handle, const char* key, nvs_type_t type, const void* data, size_t size) {
+    OpenHandle open;
+    esp_err_t err = lookup(handle, open);
+    if (err != ESP_OK) return err;
+    if (!open.writable) return ESP_ERR_NVS_READ_ONLY;
+    if (strlen(key) > 15) return ESP_ERR_NVS_KEY_TOO_LONG;
+
+    hal.writeValue(open.space, key, type, data, size);
+    return ESP_OK;
+}
+
+esp_err_t getValue(nvs_handle_t handle, const char* key, nvs_type_t type, void* data, size_t size) {
+    OpenHandle open;
+    esp_err_t err = lookup(handle, open);
+    if (err != ESP_OK) return err;
+
+    HalStoredValue value;
+    if (!hal.readValue(open.space, key, value)) return ESP_ERR_NVS_NOT_FOUND;
+    if (value.type != type) return ESP_ERR_NVS_TYPE_MISMATCH;
+    if (value.bytes.size() != size) return ESP_ERR_NVS_INVALID_LENGTH;
+    memcpy(data, value.bytes.data(), size);
+    return ESP_OK;
+}
+
+esp_err_t getVariable(nvs_handle_t handle, const char* key, nvs_type_t type, void* data, size_t* length) {
+    // With data == NULL only the required length is reported, like NVS
+    OpenHandle open;
+    esp_err_t err = lookup(handle, open);
+    if (err != ESP_OK) return err;
+
+    HalStoredValue value;
+    if (!hal.readValue(open.space, key, value)) return ESP_ERR_NVS_NOT_FOUND;
+    if (value.type != type) return ESP_ERR_NVS_TYPE_MISMATCH;
+
+    size_t needed = value.bytes.size();
+    if (data == NULL) {
+        *length = needed;
+        return ESP_OK;
+    }
+    if (*length < needed) return ESP_ERR_NVS_INVALID_LENGTH;
+    memcpy(data, value.bytes.data(), needed);
+    *length = needed;
+    return ESP_OK;
+}
+
+}  // namespace
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t mode, nvs_handle_t* handle) {
+    std::lock_guard<std::mutex> guard(handleLock);
+    OpenHandle open = {name, mode == NVS_READWRITE};
+    *handle = nextHandle++;
+    handles[*handle] = open;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    std::lock_guard<std::mutex> guard(handleLock);
+    handles.erase(handle);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    OpenHandle open;
+    esp_err_t err = lookup(handle, open);
+    if (err != ESP_OK) return err;
+    hal.persist();
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    OpenHandle open;
+    esp_err_t err = lookup(handle, open);
+    if (err != ESP_OK) return err;
+    if (!open.writable) return ESP_ERR_NVS_READ_ONLY;
+    return hal.eraseValue(open.space, key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle) {
+    OpenHandle open;
+    esp_err_t err = lookup(handle, open);
+    if (err != ESP_OK) return err;
+    if (!open.writable) return ESP_ERR_NVS_READ_ONLY;
+    hal.eraseSpace(open.space);
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t h, const char* key, uint8_t value) { return setValue(h, key, NVS_TYPE_U8, &value, sizeof(value)); }
+esp_err_t nvs_set_i8(nvs_handle_t h, const char* key, int8_t value) { return setValue(h, key, NVS_TYPE_I8, &value, sizeof(value)); }
+esp_err_t nvs_set_u16(nvs_handle_t h, const char* key, uint16_t value) { return setValue(h, key, NVS_TYPE_U16, &value, sizeof(value)); }
+esp_err_t nvs_set_i16(nvs_handle_t h, const char* key, int16_t value) { return setValue(h, key, NVS_TYPE_I16, &value, sizeof(value)); }
+esp_err_t nvs_set_u32(nvs_handle_t h, const char* key, uint32_t value) { return setValue(h, key, NVS_TYPE_U32, &value, sizeof(value)); }
+esp_err_t nvs_set_i32(nvs_handle_t h, const char* key, int32_t value) { return setValue(h, key, NVS_TYPE_I32, &value, sizeof(value)); }
+esp_err_t nvs_set_u64(nvs_handle_t h, const char* key, uint64_t value) { return setValue(h, key, NVS_TYPE_U64, &value, sizeof(value)); }
+esp_err_t nvs_set_i64(nvs_handle_t h, const char* key, int64_t value) { return setValue(h, key, NVS_TYPE_I64, &value, sizeof(value)); }
+
+esp_err_t nvs_set_str(nvs_handle_t h, const char* key, const char* value) {
+    // Stored with its terminator, as NVS does
+    return setValue(h, key, NVS_TYPE_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t h, const char* key, const void* value, size_t length) {
+    return setValue(h, key, NVS_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t h, const char* key, uint8_t* value) { return getValue(h, key, NVS_TYPE_U8, value, sizeof(*value)); }
+esp_err_t nvs_get_i8(nvs_handle_t h, const char* key, int8_t* value) { return getValue(h, key, NVS_TYPE_I8, value, sizeof(*value)); }
+esp_err_t nvs_get_u16(nvs_handle_t h, const char* key, uint16_t* value) { return getValue(h, key, NVS_TYPE_U16, value, sizeof(*value)); }
+esp_err_t nvs_get_i16(nvs_handle_t h, const char* key, int16_t* value) { return getValue(h, key, NVS_TYPE_I16, value, sizeof(*value)); }
+esp_err_t nvs_get_u32(nvs_handle_t h, const char* key, uint32_t* value) { return getValue(h, key, NVS_TYPE_U32, value, sizeof(*value)); }
+esp_err_t nvs_get_i32(nvs_handle_t h, const char* key, int32_t* value) { return getValue(h, key, NVS_TYPE_I32, value, sizeof(*value)); }
+esp_err_t nvs_get_u64(nvs_handle_t h, const char* key, uint64_t* value) { return getValue(h, key, NVS_TYPE_U64, value, sizeof(*value)); }
+esp_err_t nvs_get_i64(nvs_handle_t h, const char* key, int64_t* value) { return getValue(h, key, NVS_TYPE_I64, value, sizeof(*value)); }
+
+esp_err_t nvs_get_str(nvs_handle_t h, const char* key, char* value, size_t* length) {
+    return getVariable(h, key, NVS_TYPE_STR, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t h, const char* key, void* value, size_t* length) {
+    return getVariable(h, key, NVS_TYPE_BLOB, value, length);
+}
+
+nvs_iterator_t nvs_entry_find(const char* part_name, const char* namespace_name, nvs_type_t type) {
+    (void)part_name;
+    nvs_iterator_t iterator = new nvs_opaque_iterator_t();
+    iterator->position = 0;
+
+    std::vector<std::string> spaces;
+    if (namespace_name != NULL) {
+        spaces.push_back(namespace_name);
+    } else {
+        spaces = hal.spaceNames();
+    }
+    for (const std::string& space : spaces) {
+        for (const std::string& key : hal.valueKeys(space)) {
+            HalStoredValue value;
+            if (!hal.readValue(space, key, value)) continue;
+            if (type != NVS_TYPE_ANY && value.type != type) continue;
+
+            nvs_entry_info_t info = {};
+            strncpy(info.namespace_name, space.c_str(), sizeof(info.namespace_name) - 1);
+            strncpy(info.key, key.c_str(), sizeof(info.key) - 1);
+            info.type = (nvs_type_t)value.type;
+            iterator->entries.push_back(info);
+        }
+    }
+
+    if (iterator->entries.empty()) {
+        delete iterator;
+        return NULL;
+    }
+    return iterator;
+}
+
+nvs_iterator_t nvs_entry_next(nvs_iterator_t iterator) {
+    if (iterator == NULL) return NULL;
+    if (++iterator->position >= iterator->entries.size()) {
+        delete iterator;
+        return NULL;
+    }
+    return iterator;
+}
+
+void nvs_entry_info(nvs_iterator_t iterator, nvs_entry_info_t* out_info) {
+    *out_info = iterator->entries[iterator->position];
+}
+
+void nvs_release_iterator(nvs_iterator_t iterator) {
+    delete iterator;
+}
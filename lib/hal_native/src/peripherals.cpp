@@ -0,0 +1,18 @@
+#include "ESP32Servo.h"
+#include "Wire.h"
+#include "native_hal.h"
+
+TwoWire Wire;
+
+int Servo::attach(int servoPin, int minUs, int maxUs) {
+    pin = servoPin;
+    return 1;   // Channel number; 0 means failure
+}
+
+void Servo::write(int value) {
+    if (pin < 0) return;
+
+    // The library clamps angles to 0-180
+    angle = value < 0 ? 0 : (value > 180 ? 180 : value);
+    hal.writeServo(pin, angle);
+}
@@ -0,0 +1,623 @@
+#include "load_test.h"
+#include <ArduinoJson.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+// ---- Sockets ----
+
+static int msUntil(LoadClock::time_point deadline) {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - LoadClock::now()).count();
+    return left > 0 ? (int)left : 0;
+}
+
+static int connectTo(const std::string& host, uint16_t port, LoadClock::time_point deadline) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* address = NULL;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &address) != 0) {
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        freeaddrinfo(address);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    int result = connect(fd, address->ai_addr, address->ai_addrlen);
+    freeaddrinfo(address);
+    if (result < 0 && errno != EINPROGRESS) {
+        close(fd);
+        return -1;
+    }
+
+    struct pollfd waiting = {fd, POLLOUT, 0};
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (poll(&waiting, 1, msUntil(deadline)) != 1 ||
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool sendAll(int fd, const std::string& data, LoadClock::time_point deadline) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return false;
+
+        struct pollfd waiting = {fd, POLLOUT, 0};
+        if (poll(&waiting, 1, msUntil(deadline)) != 1) return false;
+    }
+    return true;
+}
+
+// Reads what is available within the deadline; false on timeout, true with
+// closed set once the connection is gone
+static bool receiveSome(int fd, std::string& into, bool& closed, LoadClock::time_point deadline) {
+    struct pollfd waiting = {fd, POLLIN, 0};
+    if (poll(&waiting, 1, msUntil(deadline)) != 1) return false;
+
+    char buffer[4096];
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n > 0) {
+        into.append(buffer, n);
+    } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        closed = true;
+    }
+    return true;
+}
+
+// ---- HTTP ----
+
+static std::string headerValue(const std::string& head, const char* name) {
+    std::string lower = head;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    std::string key = std::string("\r\n") + name + ":";
+    size_t at = lower.find(key);
+    if (at == std::string::npos) return "";
+    size_t start = head.find_first_not_of(' ', at + key.size());
+    size_t end = head.find("\r\n", start);
+    return head.substr(start, end - start);
+}
+
+static bool dechunk(const std::string& raw, std::string& body) {
+    body.clear();
+    size_t at = 0;
+    while (true) {
+        size_t lineEnd = raw.find("\r\n", at);
+        if (lineEnd == std::string::npos) return false;
+        size_t size = strtoul(raw.c_str() + at, NULL, 16);
+        at = lineEnd + 2;
+        if (size == 0) return true;
+        if (at + size > raw.size()) return false;
+        body.append(raw, at, size);
+        at += size + 2;
+    }
+}
+
+static HttpResult httpRequest(const std::string& host, uint16_t port, const std::string& method,
+                              const std::string& url, const std::string& body, const std::string& contentType) {
+    // One connection per request, as the box closes after each response
+    HttpResult result = {0, "", 0};
+    LoadClock::time_point start = LoadClock::now();
+    LoadClock::time_point deadline = start + std::chrono::milliseconds(LOAD_REQUEST_TIMEOUT_MS);
+
+    int fd = connectTo(host, port, deadline);
+    if (fd < 0) return result;
+
+    std::string message = method + " " + url + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: close\r\n";
+    if (!body.empty()) {
+        message += "Content-Type: " + contentType + "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    message += "\r\n" + body;
+
+    std::string raw;
+    bool closed = false;
+    size_t headEnd = std::string::npos;
+    size_t contentLength = std::string::npos;
+    bool chunked = false;
+    bool complete = false;
+
+    if (sendAll(fd, message, deadline)) {
+        while (!closed && receiveSome(fd, raw, closed, deadline)) {
+            if (headEnd == std::string::npos && (headEnd = raw.find("\r\n\r\n")) != std::string::npos) {
+                std::string head = raw.substr(0, headEnd + 2);
+                std::string length = headerValue(head, "content-length");
+                if (!length.empty()) contentLength = strtoul(length.c_str(), NULL, 10);
+                chunked = headerValue(head, "transfer-encoding").find("chunked") != std::string::npos;
+            }
+            if (headEnd == std::string::npos) continue;
+
+            size_t received = raw.size() - headEnd - 4;
+            if (contentLength != std::string::npos && received >= contentLength) break;
+            if (chunked && raw.compare(raw.size() - std::min(raw.size(), (size_t)5), 5, "0\r\n\r\n") == 0) break;
+        }
+
+        if (headEnd != std::string::npos) {
+            std::string content = raw.substr(headEnd + 4);
+            if (chunked) {
+                complete = dechunk(content, result.body);
+            } else {
+                complete = contentLength == std::string::npos ? closed : content.size() >= contentLength;
+                result.body = content.substr(0, contentLength);
+            }
+        }
+    }
+    close(fd);
+
+    if (complete && raw.compare(0, 5, "HTTP/") == 0) {
+        result.status = atoi(raw.c_str() + raw.find(' ') + 1);
+    }
+    result.us = std::chrono::duration_cast<std::chrono::microseconds>(LoadClock::now() - start).count();
+    return result;
+}
+
+// ---- WebSocket ----
+
+static std::string base64(const uint8_t* data, size_t length) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t chunk = data[i] << 16;
+        if (i + 1 < length) chunk |= data[i + 1] << 8;
+        if (i + 2 < length) chunk |= data[i + 2];
+        out += alphabet[(chunk >> 18) & 63];
+        out += alphabet[(chunk >> 12) & 63];
+        out += i + 1 < length ? alphabet[(chunk >> 6) & 63] : '=';
+        out += i + 2 < length ? alphabet[chunk & 63] : '=';
+    }
+    return out;
+}
+
+// Clients must mask every frame they send
+static std::string socketFrame(uint8_t opcode, const std::string& payload, std::mt19937& random) {
+    std::string frame;
+    frame += (char)(0x80 | opcode);
+    frame += (char)(0x80 | payload.size());   // Control frames only: under 126 bytes
+
+    uint8_t mask[4];
+    for (int i = 0; i < 4; i++) mask[i] = random() & 0xFF;
+    frame.append((const char*)mask, 4);
+    for (size_t i = 0; i < payload.size(); i++) {
+        frame += (char)(payload[i] ^ mask[i % 4]);
+    }
+    return frame;
+}
+
+// ---- LoadTest ----
+
+LoadTest::LoadTest()
+    : host("127.0.0.1"), port(LOAD_DEFAULT_PORT), durationMs(60000),
+      statusIntervalMs(LOAD_STATUS_INTERVAL_MS), sampleIntervalMs(LOAD_SAMPLE_INTERVAL_MS), socketCount(0),
+      socketsConnected(0), socketsRejected(0), socketsDropped(0), statusFrames(0), missedFrames(0),
+      sampled(false), heapNow(0), heapLowest(UINT32_MAX), heapDeviceLow(UINT32_MAX), skippedFirst(0), skippedLast(0) {}
+
+bool LoadTest::setTarget(const std::string& target) {
+    size_t colon = target.find(':');
+    host = target.substr(0, colon);
+    port = LOAD_DEFAULT_PORT;
+    if (colon != std::string::npos) {
+        long value = strtol(target.c_str() + colon + 1, NULL, 10);
+        if (value <= 0 || value > 65535) return false;
+        port = value;
+    }
+    return !host.empty();
+}
+
+bool LoadTest::load(const char* path) {
+    std::ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "loadgen: cannot open %s\n", path);
+        return false;
+    }
+
+    std::string line;
+    int number = 0;
+    while (std::getline(file, line)) {
+        number++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+
+        std::istringstream words(line);
+        std::string command;
+        if (!(words >> command)) continue;
+
+        std::string argument;
+        words >> argument;
+        bool ok = true;
+
+        if (command == "target") {
+            ok = setTarget(argument);
+        } else if (command == "duration") {
+            ok = parseDuration(argument, durationMs) && durationMs > 0;
+        } else if (command == "status-interval") {
+            ok = parseDuration(argument, statusIntervalMs) && statusIntervalMs > 0;
+        } else if (command == "sample") {
+            ok = parseDuration(argument, sampleIntervalMs) && sampleIntervalMs > 0;
+        } else if (command == "websocket") {
+            socketCount = atoi(argument.c_str());
+            ok = socketCount > 0 || argument == "0";
+        } else if (command == "get" || command == "post") {
+            RestClient client;
+            client.method = command == "get" ? "GET" : "POST";
+            client.url = argument;
+            client.count = 1;
+
+            std::string every;
+            words >> every;
+            ok = !client.url.empty() && client.url[0] == '/' && parseDuration(every, client.everyMs) && client.everyMs > 0;
+
+            std::string rest;
+            std::getline(words, rest);
+            rest.erase(0, rest.find_first_not_of(" \t"));
+            if (rest.size() > 1 && rest[0] == 'x' && isdigit((unsigned char)rest[1])) {
+                size_t end;
+                client.count = std::stoi(rest.substr(1), &end);
+                rest.erase(0, end + 1);
+                rest.erase(0, rest.find_first_not_of(" \t"));
+            }
+            rest.erase(rest.find_last_not_of(" \t\r") + 1);
+
+            if (client.method == "POST") {
+                client.body = rest;
+                client.contentType = !rest.empty() && rest[0] == '{' ? "application/json" : "application/x-www-form-urlencoded";
+            } else if (!rest.empty()) {
+                ok = false;
+            }
+            ok = ok && client.count > 0;
+            if (ok) restClients.push_back(client);
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "loadgen: %s:%d: cannot parse \"%s\"\n", path, number, line.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+HttpResult LoadTest::request(const std::string& method, const std::string& url,
+                             const std::string& body, const std::string& contentType) {
+    return httpRequest(host, port, method, url, body, contentType);
+}
+
+bool LoadTest::run() {
+    HttpResult probe = request("GET", "/api/status");
+    if (probe.status == 0) {
+        fprintf(stderr, "loadgen: no response from %s:%u\n", host.c_str(), port);
+        return false;
+    }
+
+    for (const RestClient& client : restClients) {
+        RouteStats* stats = new RouteStats();
+        stats->name = client.method + " " + client.url;
+        stats->success = stats->limited = stats->shed = stats->other = stats->failed = 0;
+        routes.push_back(stats);
+    }
+
+    // Profile the run only; the reset applies on the next loop() pass
+    request("POST", "/api/dev/perf/reset");
+    sample();
+
+    LoadClock::time_point start = LoadClock::now();
+    LoadClock::time_point end = start + std::chrono::milliseconds(durationMs);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < socketCount; i++) {
+        threads.emplace_back(&LoadTest::runSocket, this, i, end);
+    }
+    for (size_t i = 0; i < restClients.size(); i++) {
+        for (int c = 0; c < restClients[i].count; c++) {
+            threads.emplace_back(&LoadTest::runRest, this, i, c, start, end);
+        }
+    }
+    threads.emplace_back(&LoadTest::runSampler, this, end);
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    sample();
+    HttpResult perf = request("GET", "/api/dev/perf");
+    if (perf.status == 200) perfJson = perf.body;
+    return true;
+}
+
+void LoadTest::runRest(size_t index, int client, LoadClock::time_point start, LoadClock::time_point end) {
+    const RestClient& rest = restClients[index];
+    RouteStats& stats = *routes[index];
+
+    // Clients of one stream start spread over the first period, like tabs
+    // opened one after another, then keep a fixed cadence
+    std::mt19937 random(index * 1000 + client);
+    LoadClock::time_point next = start + std::chrono::milliseconds(random() % rest.everyMs);
+
+    while (true) {
+        std::this_thread::sleep_until(next);
+        if (LoadClock::now() >= end) break;
+
+        HttpResult result = request(rest.method, rest.url, rest.body, rest.contentType);
+        {
+            std::lock_guard<std::mutex> guard(stats.lock);
+            if (result.status == 0) {
+                stats.failed++;
+            } else {
+                stats.latencyUs.push_back(result.us);
+                if (result.status >= 200 && result.status < 300) stats.success++;
+                else if (result.status == 429) stats.limited++;
+                else if (result.status == 503) stats.shed++;
+                else stats.other++;
+            }
+        }
+
+        // A slow response delays the next request rather than piling up
+        // behind it, as setInterval() with fetch() does
+        LoadClock::time_point now = LoadClock::now();
+        do {
+            next += std::chrono::milliseconds(rest.everyMs);
+        } while (next < now);
+    }
+}
+
+void LoadTest::runSocket(int client, LoadClock::time_point end) {
+    std::mt19937 random(0x5eed + client);
+    LoadClock::time_point deadline = LoadClock::now() + std::chrono::milliseconds(LOAD_REQUEST_TIMEOUT_MS);
+
+    int fd = connectTo(host, port, deadline);
+    if (fd < 0) {
+        socketsRejected++;
+        return;
+    }
+
+    uint8_t key[16];
+    for (int i = 0; i < 16; i++) key[i] = random() & 0xFF;
+    std::string handshake = "GET /ws HTTP/1.1\r\nHost: " + host + "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                            "Sec-WebSocket-Key: " + base64(key, sizeof(key)) + "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+
+    std::string input;
+    bool closed = false;
+    size_t headEnd = std::string::npos;
+    if (sendAll(fd, handshake, deadline)) {
+        while (!closed && (headEnd = input.find("\r\n\r\n")) == std::string::npos && receiveSome(fd, input, closed, deadline)) {
+        }
+    }
+    if (headEnd == std::string::npos || input.compare(0, 12, "HTTP/1.1 101") != 0) {
+        socketsRejected++;
+        close(fd);
+        return;
+    }
+    input.erase(0, headEnd + 4);
+
+    bool connected = false;
+    bool open = true;
+    bool lostEarly = false;
+    LoadClock::time_point lastStatus;
+    bool haveStatus = false;
+    std::string message;
+
+    while (open && LoadClock::now() < end) {
+        // Parse every complete frame in the buffer
+        while (input.size() >= 2) {
+            uint8_t first = input[0];
+            uint8_t second = input[1];
+            uint64_t length = second & 0x7F;
+            size_t header = 2;
+            if (length == 126) {
+                if (input.size() < 4) break;
+                length = ((uint8_t)input[2] << 8) | (uint8_t)input[3];
+                header = 4;
+            } else if (length == 127) {
+                if (input.size() < 10) break;
+                length = 0;
+                for (int i = 0; i < 8; i++) length = (length << 8) | (uint8_t)input[2 + i];
+                header = 10;
+            }
+            if (input.size() < header + length) break;
+
+            std::string payload = input.substr(header, length);
+            input.erase(0, header + length);
+            uint8_t opcode = first & 0x0F;
+
+            if (opcode == 0x9) {
+                sendAll(fd, socketFrame(0xA, payload, random), end);
+            } else if (opcode == 0x8) {
+                // The box turns clients over its limit away with 1013
+                uint16_t code = payload.size() >= 2 ? ((uint8_t)payload[0] << 8) | (uint8_t)payload[1] : 1005;
+                if (code == 1013 && !connected) socketsRejected++;
+                else lostEarly = true;
+                open = false;
+                break;
+            } else if (opcode == 0x1 || opcode == 0x0) {
+                message += payload;
+                if (!(first & 0x80)) continue;
+
+                if (!connected) {
+                    connected = true;
+                    socketsConnected++;
+                }
+
+                // Status snapshots are bare objects; other topics are wrapped
+                if (message.compare(0, 8, "{\"type\":") != 0) {
+                    LoadClock::time_point now = LoadClock::now();
+                    statusFrames++;
+                    if (haveStatus) {
+                        uint32_t gap = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastStatus).count();
+                        if (gap > statusIntervalMs * 3 / 2) {
+                            missedFrames += (gap + statusIntervalMs / 2) / statusIntervalMs - 1;
+                        }
+                    }
+                    lastStatus = now;
+                    haveStatus = true;
+                }
+                message.clear();
+            }
+        }
+        if (!open) break;
+
+        LoadClock::time_point wait = std::min(end, LoadClock::now() + std::chrono::milliseconds(100));
+        if (!receiveSome(fd, input, closed, wait)) {
+            continue;
+        }
+        if (closed) {
+            lostEarly = true;
+            break;
+        }
+    }
+
+    if (lostEarly) {
+        if (!connected) socketsRejected++;
+        else socketsDropped++;
+    } else if (open) {
+        std::string goingAway("\x03\xe8", 2);   // 1000: normal closure
+        sendAll(fd, socketFrame(0x8, goingAway, random), LoadClock::now() + std::chrono::milliseconds(500));
+    }
+    close(fd);
+}
+
+void LoadTest::runSampler(LoadClock::time_point end) {
+    LoadClock::time_point next = LoadClock::now();
+    while (true) {
+        next += std::chrono::milliseconds(sampleIntervalMs);
+        if (next >= end) break;
+        std::this_thread::sleep_until(next);
+        sample();
+    }
+}
+
+void LoadTest::sample() {
+    HttpResult result = request("GET", "/api/dev/metrics?format=json");
+    if (result.status != 200) return;
+
+    DynamicJsonDocument doc(8192);
+    if (deserializeJson(doc, result.body.c_str())) return;
+
+    uint32_t freeHeap = doc["freeHeap"] | 0u;
+    uint32_t minFreeHeap = doc["minFreeHeap"] | freeHeap;
+    uint32_t skipped = doc["fanoutSkipped"] | 0u;
+
+    // Only the sampler thread and run() call this, never at the same time
+    if (!sampled) {
+        skippedFirst = skipped;
+        sampled = true;
+    }
+    skippedLast = skipped;
+    heapNow = freeHeap;
+    heapLowest = std::min(heapLowest, freeHeap);
+    heapDeviceLow = std::min(heapDeviceLow, minFreeHeap);
+}
+
+bool LoadTest::report(FILE* out) {
+    uint32_t restCount = 0;
+    for (const RestClient& client : restClients) restCount += client.count;
+
+    fprintf(out, "Load test: %d WebSocket and %u REST clients on %s:%u for %.1f s\n\n",
+            socketCount, restCount, host.c_str(), port, durationMs / 1000.0);
+
+    bool healthy = true;
+
+    if (!routes.empty()) {
+        fprintf(out, "%-32s %8s %8s %8s %8s %6s %6s %6s %6s %6s\n",
+                "route", "requests", "p50 ms", "p99 ms", "max ms", "2xx", "429", "503", "other", "failed");
+    }
+    for (RouteStats* stats : routes) {
+        std::vector<uint32_t>& latency = stats->latencyUs;
+        std::sort(latency.begin(), latency.end());
+        size_t n = latency.size();
+        auto percentile = [&](double q) -> double {
+            if (n == 0) return 0;
+            size_t rank = (size_t)(q * n + 0.999999);
+            return latency[std::min(n, std::max(rank, (size_t)1)) - 1] / 1000.0;
+        };
+
+        fprintf(out, "%-32s %8u %8.1f %8.1f %8.1f %6u %6u %6u %6u %6u\n",
+                stats->name.c_str(), (unsigned)(n + stats->failed), percentile(0.5), percentile(0.99),
+                n > 0 ? latency[n - 1] / 1000.0 : 0.0,
+                stats->success, stats->limited, stats->shed, stats->other, stats->failed);
+        if (stats->failed > 0) healthy = false;
+    }
+    if (!routes.empty()) fprintf(out, "\n");
+
+    if (socketCount > 0) {
+        fprintf(out, "websocket  %u of %d connected, %u refused, %u dropped\n",
+                socketsConnected.load(), socketCount, socketsRejected.load(), socketsDropped.load());
+        fprintf(out, "           %u status frames, %u missed (gaps over 1.5x the %.1f s cadence)",
+                statusFrames.load(), missedFrames.load(), statusIntervalMs / 1000.0);
+        if (sampled) fprintf(out, ", %u skipped by the box", skippedLast - skippedFirst);
+        fprintf(out, "\n");
+        if (socketsRejected > 0 || socketsDropped > 0) healthy = false;
+    }
+
+    if (sampled) {
+        fprintf(out, "heap       %u free at the end, %u lowest sampled, %u low-water on the box\n",
+                heapNow, heapLowest, heapDeviceLow);
+    } else {
+        fprintf(out, "heap       /api/dev/metrics unavailable\n");
+    }
+
+    DynamicJsonDocument perf(8192);
+    if (!perfJson.empty() && !deserializeJson(perf, perfJson.c_str())) {
+        uint32_t windowMs = perf["windowMs"] | 0u;
+        uint32_t iterations = perf["iterations"] | 0u;
+        uint32_t avgUs = perf["loop"]["avgUs"] | 0u;
+        double busy = windowMs > 0 ? (double)avgUs * iterations / (windowMs * 1000.0) : 0;
+        fprintf(out, "cpu        loop() busy %.2f%% (%u us per pass, %u passes)", busy * 100, avgUs, iterations);
+
+        // Per-task shares only when the box was built with run-time stats
+        JsonArray tasks = perf["tasks"];
+        bool first = true;
+        for (JsonObject task : tasks) {
+            if (task["cpu"].isNull()) continue;
+            fprintf(out, "%s %s %.1f%%", first ? ";" : ",", task["name"] | "?", (task["cpu"] | 0.0f) * 100);
+            first = false;
+        }
+        fprintf(out, "\n");
+    } else {
+        fprintf(out, "cpu        /api/dev/perf unavailable\n");
+    }
+
+    for (RouteStats* stats : routes) delete stats;
+    routes.clear();
+    return healthy;
+}
+
+bool LoadTest::parseDuration(const std::string& text, uint32_t& ms) {
+    char* end = NULL;
+    double value = strtod(text.c_str(), &end);
+    if (end == text.c_str() || value < 0) return false;
+
+    std::string unit(end);
+    if (unit == "ms") ms = value;
+    else if (unit == "s") ms = value * 1000;
+    else if (unit == "m") ms = value * 60000;
+    else if (unit == "h") ms = value * 3600000;
+    else return false;
+    return true;
+}
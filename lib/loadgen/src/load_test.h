@@ -0,0 +1,114 @@
+#ifndef LOAD_TEST_H
+#define LOAD_TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Load generator for the web server, run against the native build or a box
+// on the LAN. A scenario file describes the clients: /ws connections that
+// only listen, like open dashboards, and REST clients that each repeat one
+// request on a fixed cadence, like the dashboards' polling timers. The
+// report gives per-route latency percentiles and status codes, missed
+// WebSocket status frames, the heap low-water and the server's CPU use from
+// /api/dev/perf.
+//
+// Scenario commands, one per line (# starts a comment):
+//   target HOST[:PORT]          box to load, 127.0.0.1:8080 by default
+//   duration DURATION           length of the run: 500ms, 90s, 15m or 2h
+//   websocket N                 N clients on /ws
+//   status-interval DURATION    cadence the box publishes status at (5s);
+//                               longer gaps between frames count as missed
+//   sample DURATION             how often /api/dev/metrics is read for the
+//                               heap (2s)
+//   get URL EVERY [xN]          N clients, each GETting URL every EVERY
+//   post URL EVERY [xN] [BODY]  the same with a POST; a BODY starting with
+//                               { is sent as JSON, anything else as a form
+//
+// All clients come from one address, so the box's per-client rate limits
+// apply to the sum of them (and to the metrics sampling).
+
+#define LOAD_DEFAULT_PORT 8080
+#define LOAD_REQUEST_TIMEOUT_MS 5000    // Connect plus response, per request
+#define LOAD_STATUS_INTERVAL_MS 5000    // STREAM_STATUS_INTERVAL in config.h
+#define LOAD_SAMPLE_INTERVAL_MS 2000
+
+typedef std::chrono::steady_clock LoadClock;
+
+struct HttpResult {
+    int status;          // 0 when the request failed or timed out
+    std::string body;
+    uint32_t us;
+};
+
+class LoadTest {
+public:
+    LoadTest();
+
+    bool load(const char* path);
+    bool setTarget(const std::string& target);
+    // Runs the scenario; false when the box could not be reached at all
+    bool run();
+    // Prints the results; returns false when requests failed or WebSocket
+    // clients were refused or dropped
+    bool report(FILE* out);
+
+private:
+    struct RestClient {
+        std::string method;
+        std::string url;
+        std::string body;
+        std::string contentType;
+        uint32_t everyMs;
+        int count;
+    };
+
+    struct RouteStats {
+        std::string name;
+        std::mutex lock;
+        std::vector<uint32_t> latencyUs;
+        uint32_t success;
+        uint32_t limited;    // 429
+        uint32_t shed;       // 503
+        uint32_t other;
+        uint32_t failed;     // No response in time
+    };
+
+    std::string host;
+    uint16_t port;
+    uint32_t durationMs;
+    uint32_t statusIntervalMs;
+    uint32_t sampleIntervalMs;
+    int socketCount;
+    std::vector<RestClient> restClients;
+    std::vector<RouteStats*> routes;
+
+    std::atomic<uint32_t> socketsConnected;
+    std::atomic<uint32_t> socketsRejected;
+    std::atomic<uint32_t> socketsDropped;
+    std::atomic<uint32_t> statusFrames;
+    std::atomic<uint32_t> missedFrames;
+
+    bool sampled;
+    uint32_t heapNow;
+    uint32_t heapLowest;
+    uint32_t heapDeviceLow;
+    uint32_t skippedFirst;
+    uint32_t skippedLast;
+    std::string perfJson;
+
+    void runRest(size_t index, int client, LoadClock::time_point start, LoadClock::time_point end);
+    void runSocket(int client, LoadClock::time_point end);
+    void runSampler(LoadClock::time_point end);
+    void sample();
+    HttpResult request(const std::string& method, const std::string& url,
+                       const std::string& body = "", const std::string& contentType = "");
+
+    static bool parseDuration(const std::string& text, uint32_t& ms);
+};
+
+#endif // LOAD_TEST_H
@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "load_test.h"
+
+// Loads the web server with the clients a scenario describes and prints
+// latency, WebSocket, heap and CPU figures:
+//
+//   pio run -e native && .pio/build/native/program --port 8080 &
+//   pio run -e loadgen
+//   .pio/build/loadgen/program lib/loadgen/scenarios/three_dashboards.load
+//   .pio/build/loadgen/program --target 192.168.1.50:80 lib/loadgen/scenarios/three_dashboards.load
+//
+//   --target HOST[:PORT]   overrides the scenario's target
+//
+// Exits with 1 when requests went unanswered or WebSocket clients were
+// refused or dropped, and 2 when the scenario could not run.
+
+int main(int argc, char** argv) {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    LoadTest test;
+    const char* scenario = NULL;
+    const char* target = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--target" && i + 1 < argc) {
+            target = argv[++i];
+        } else if (option.compare(0, 2, "--") != 0 && scenario == NULL) {
+            scenario = argv[i];
+        } else {
+            scenario = NULL;
+            break;
+        }
+    }
+
+    if (scenario == NULL) {
+        fprintf(stderr, "usage: %s [--target HOST[:PORT]] SCENARIO\n", argv[0]);
+        return 2;
+    }
+    if (!test.load(scenario)) return 2;
+    if (target != NULL && !test.setTarget(target)) {
+        fprintf(stderr, "loadgen: bad --target %s\n", target);
+        return 2;
+    }
+
+    if (!test.run()) return 2;
+    return test.report(stdout) ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+#include "screens.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "metered_preferences.h"
+
+extern MeteredPreferences preferences;
+
+#define PBM_DIGITS_PER_LINE 64   // Plain PBM lines stay under 70 characters
+
+const std::vector<ScreenCase>& screenCases() {
+    static const std::vector<ScreenCase> cases = {
+        {"welcome", FIXED_INTERVAL, 22, 0, [](Display& d) { d.showWelcome(); }},
+
+        // Fixed interval: the progress bar assumes a one hour interval
+        {"countdown-interval", FIXED_INTERVAL, 22, 0, [](Display& d) { d.showCountdown(2700); }},
+        {"countdown-interval-zero", FIXED_INTERVAL, 22, 0, [](Display& d) { d.showCountdown(0); }},
+        {"countdown-interval-over-1h", FIXED_INTERVAL, 22, 0, [](Display& d) { d.showCountdown(5400); }},
+        {"countdown-interval-over-24h", FIXED_INTERVAL, 22, 0, [](Display& d) { d.showCountdown(93784); }},
+        {"countdown-interval-100h", FIXED_INTERVAL, 22, 0, [](Display& d) { d.showCountdown(360000); }},
+        {"countdown-interval-1000h", FIXED_INTERVAL, 22, 0, [](Display& d) { d.showCountdown(3600000); }},
+
+        // Schedules switch to days and hours past 24 h
+        {"countdown-daily", DAILY_SCHEDULE, 22, 0, [](Display& d) { d.showCountdown(45296); }},
+        {"countdown-daily-under-1h", DAILY_SCHEDULE, 7, 5, [](Display& d) { d.showCountdown(754); }},
+        {"countdown-weekly-24h", WEEKLY_SCHEDULE, 22, 30, [](Display& d) { d.showCountdown(86400); }},
+        {"countdown-weekly-days", WEEKLY_SCHEDULE, 22, 30, [](Display& d) { d.showCountdown(6 * 86400 + 23 * 3600 + 59); }},
+
+        {"unlocked", FIXED_INTERVAL, 22, 0, [](Display& d) { d.showUnlocked(); }},
+        {"setup-connecting", FIXED_INTERVAL, 22, 0, [](Display& d) { d.showSetup(false); }},
+        {"setup-connected", FIXED_INTERVAL, 22, 0, [](Display& d) { d.showSetup(true); }},
+        {"status", FIXED_INTERVAL, 22, 0, [](Display& d) { d.showStatus("Unknown State"); }},
+
+        // Messages wrap at 21 characters and stop after four lines
+        {"message", FIXED_INTERVAL, 22, 0, [](Display& d) { d.showMessage("Emergency limit reached!"); }},
+        {"message-short", FIXED_INTERVAL, 22, 0, [](Display& d) { d.showMessage("Locked"); }},
+        {"message-no-spaces", FIXED_INTERVAL, 22, 0, [](Display& d) {
+            d.showMessage("http://quitsmokingbox.local/emergency");
+        }},
+        {"message-overflow", FIXED_INTERVAL, 22, 0, [](Display& d) {
+            d.showMessage("Take a walk, drink a glass of water and breathe slowly. The craving "
+                          "passes in a few minutes, and every one you sit out makes the next "
+                          "one weaker.");
+        }},
+    };
+    return cases;
+}
+
+void prepareScreen(const ScreenCase& screen) {
+    preferences.putInt(KEY_TIMER_MODE, screen.mode);
+    preferences.putInt(KEY_DAILY_HOUR, screen.scheduleHour);
+    preferences.putInt(KEY_DAILY_MINUTE, screen.scheduleMinute);
+}
+
+ScreenFrame captureFrame(const Adafruit_SSD1306& panel) {
+    ScreenFrame frame;
+    frame.width = panel.width();
+    frame.height = panel.height();
+    frame.pixels.resize((size_t)frame.width * frame.height);
+
+    for (int y = 0; y < frame.height; y++) {
+        for (int x = 0; x < frame.width; x++) {
+            bool lit = panel.getPixel(x, y) != panel.isInverted();
+            frame.pixels[(size_t)y * frame.width + x] = lit ? 1 : 0;
+        }
+    }
+    return frame;
+}
+
+ScreenFrame diffFrames(const ScreenFrame& a, const ScreenFrame& b) {
+    ScreenFrame diff;
+    diff.width = a.width;
+    diff.height = a.height;
+    diff.pixels.resize(a.pixels.size());
+
+    for (size_t i = 0; i < a.pixels.size() && i < b.pixels.size(); i++) {
+        diff.pixels[i] = a.pixels[i] != b.pixels[i] ? 1 : 0;
+    }
+    return diff;
+}
+
+uint32_t countLit(const ScreenFrame& frame) {
+    uint32_t lit = 0;
+    for (uint8_t pixel : frame.pixels) {
+        lit += pixel;
+    }
+    return lit;
+}
+
+bool writePBM(const char* path, const ScreenFrame& frame) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    fprintf(file, "P1\n%d %d\n", frame.width, frame.height);
+    size_t count = 0;
+    for (uint8_t pixel : frame.pixels) {
+        fputc(pixel ? '1' : '0', file);
+        if (++count % PBM_DIGITS_PER_LINE == 0) {
+            fputc('\n', file);
+        }
+    }
+    if (count % PBM_DIGITS_PER_LINE != 0) {
+        fputc('\n', file);
+    }
+
+    return fclose(file) == 0;
+}
+
+// Next header token of a plain PBM, skipping whitespace and # comments
+static bool readPBMToken(FILE* file, char* token, size_t size) {
+    int c = fgetc(file);
+    while (c != EOF) {
+        if (c == '#') {
+            while (c != EOF && c != '\n') c = fgetc(file);
+        } else if (!isspace(c)) {
+            break;
+        }
+        c = fgetc(file);
+    }
+
+    size_t length = 0;
+    while (c != EOF && !isspace(c) && length + 1 < size) {
+        token[length++] = (char)c;
+        c = fgetc(file);
+    }
+    token[length] = '\0';
+    return length > 0;
+}
+
+bool readPBM(const char* path, ScreenFrame& frame) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    char magic[4], width[8], height[8];
+    bool valid = readPBMToken(file, magic, sizeof(magic)) && strcmp(magic, "P1") == 0 &&
+                 readPBMToken(file, width, sizeof(width)) &&
+                 readPBMToken(file, height, sizeof(height));
+    if (valid) {
+        frame.width = atoi(width);
+        frame.height = atoi(height);
+        valid = frame.width > 0 && frame.height > 0 && frame.width <= 1024 && frame.height <= 1024;
+    }
+
+    if (valid) {
+        frame.pixels.clear();
+        frame.pixels.reserve((size_t)frame.width * frame.height);
+        int c;
+        while (frame.pixels.size() < (size_t)frame.width * frame.height && (c = fgetc(file)) != EOF) {
+            if (c == '0' || c == '1') {
+                frame.pixels.push_back(c == '1' ? 1 : 0);
+            } else if (c == '#') {
+                while (c != EOF && c != '\n') c = fgetc(file);
+            } else if (!isspace(c)) {
+                valid = false;
+                break;
+            }
+        }
+        valid = valid && frame.pixels.size() == (size_t)frame.width * frame.height;
+    }
+
+    fclose(file);
+    return valid;
+}
@@ -0,0 +1,54 @@
+#ifndef SCREENS_H
+#define SCREENS_H
+
+#include <Arduino.h>
+#include <Adafruit_SSD1306.h>
+#include <functional>
+#include <vector>
+#include "config.h"
+#include "display.h"
+
+// Every Display screen and its edge cases, drawn into the native HAL's
+// SSD1306 framebuffer. The screens tool compares each frame with a golden
+// image in lib/screens/golden; the bench suite times the same draws, so a
+// drawing change is checked for both looks and cost.
+//
+// Golden images are plain PBM (P1): one '1' per lit pixel, 64 digits to a
+// line, so a diff of the file shows the change as ASCII art and any image
+// viewer opens it.
+
+typedef std::function<void(Display&)> ScreenDraw;
+
+struct ScreenCase {
+    const char* name;
+    TimerMode mode;       // What showCountdown reads from preferences
+    int scheduleHour;
+    int scheduleMinute;
+    ScreenDraw draw;
+};
+
+// One byte per pixel, row by row; 1 is lit
+struct ScreenFrame {
+    int width;
+    int height;
+    std::vector<uint8_t> pixels;
+
+    bool operator==(const ScreenFrame& other) const {
+        return width == other.width && height == other.height && pixels == other.pixels;
+    }
+};
+
+const std::vector<ScreenCase>& screenCases();
+
+// Stores the case's timer mode and schedule where showCountdown reads them
+void prepareScreen(const ScreenCase& screen);
+
+ScreenFrame captureFrame(const Adafruit_SSD1306& panel);
+// Pixels that differ between two frames of the same size, lit
+ScreenFrame diffFrames(const ScreenFrame& a, const ScreenFrame& b);
+uint32_t countLit(const ScreenFrame& frame);
+
+bool writePBM(const char* path, const ScreenFrame& frame);
+bool readPBM(const char* path, ScreenFrame& frame);
+
+#endif // SCREENS_H
@@ -0,0 +1,154 @@
+#ifndef SCREENS_NO_MAIN
+
+#include <Arduino.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "native_hal.h"
+#include "screens.h"
+
+// Draws every screen and compares it with its golden image:
+//
+//   pio run -e screens
+//   .pio/build/screens/program
+//
+//   --golden DIR   golden images (default lib/screens/golden)
+//   --update       rewrite the golden images from the current drawing code
+//   --out DIR      where a mismatching frame and its diff go (default
+//                  .pio/screens): NAME.pbm as drawn, NAME.diff.pbm with the
+//                  differing pixels lit
+//   --filter TEXT  only screens whose name contains TEXT
+//   --list         print the screen names and exit
+//
+// Exits with 1 when a screen differs from its golden image or has none.
+
+#define SCREENS_EPOCH 1767259800UL   // 2026-01-01 09:30 UTC
+
+static bool makeDirectories(const String& path) {
+    for (int slash = path.indexOf('/', 1); slash > 0; slash = path.indexOf('/', slash + 1)) {
+        if (mkdir(path.substring(0, slash).c_str(), 0755) != 0 && errno != EEXIST) return false;
+    }
+    return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+int main(int argc, char** argv) {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    String goldenDir = "lib/screens/golden";
+    String outDir = ".pio/screens";
+    String filter;
+    bool update = false;
+    bool list = false;
+
+    for (int i = 1; i < argc; i++) {
+        String option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (option == "--golden" && value != NULL) {
+            goldenDir = value;
+            i++;
+        } else if (option == "--out" && value != NULL) {
+            outDir = value;
+            i++;
+        } else if (option == "--filter" && value != NULL) {
+            filter = value;
+            i++;
+        } else if (option == "--update") {
+            update = true;
+        } else if (option == "--list") {
+            list = true;
+        } else {
+            fprintf(stderr, "usage: %s [--golden DIR] [--update] [--out DIR] [--filter TEXT] [--list]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (list) {
+        for (const ScreenCase& screen : screenCases()) printf("%s\n", screen.name);
+        return 0;
+    }
+
+    // In-process only, on a virtual clock synced to a fixed date
+    char* args[] = {argv[0], (char*)"--port", (char*)"0", (char*)"--virtual-time"};
+    hal.begin(4, args);
+    hal.setSerialOutput(NULL);
+    hal.setWallClock(SCREENS_EPOCH);
+    hal.syncWallClock();
+    setup();
+
+    // A panel of its own, so nothing the firmware showed at boot (a timed
+    // message, say) holds back a screen
+    Display screen;
+    if (!screen.begin() || hal.getDisplay() == NULL) {
+        fprintf(stderr, "screens: display did not start\n");
+        _exit(2);
+    }
+    if (update && !makeDirectories(goldenDir)) {
+        fprintf(stderr, "screens: cannot create %s\n", goldenDir.c_str());
+        _exit(2);
+    }
+
+    int checked = 0;
+    int failures = 0;
+
+    for (const ScreenCase& testCase : screenCases()) {
+        if (filter.length() > 0 && strstr(testCase.name, filter.c_str()) == NULL) continue;
+
+        prepareScreen(testCase);
+        testCase.draw(screen);
+        ScreenFrame frame = captureFrame(*hal.getDisplay());
+        String goldenPath = goldenDir + "/" + testCase.name + ".pbm";
+        checked++;
+
+        if (update) {
+            if (!writePBM(goldenPath.c_str(), frame)) {
+                fprintf(stderr, "screens: cannot write %s\n", goldenPath.c_str());
+                _exit(2);
+            }
+            printf("%-32s written (%u pixels lit)\n", testCase.name, countLit(frame));
+            continue;
+        }
+
+        ScreenFrame golden;
+        if (!readPBM(goldenPath.c_str(), golden)) {
+            printf("%-32s FAIL  no golden image at %s\n", testCase.name, goldenPath.c_str());
+            failures++;
+            continue;
+        }
+        if (frame == golden) {
+            printf("%-32s ok\n", testCase.name);
+            continue;
+        }
+
+        failures++;
+        String framePath = outDir + "/" + testCase.name + ".pbm";
+        String diffPath = outDir + "/" + testCase.name + ".diff.pbm";
+        bool saved = makeDirectories(outDir) && writePBM(framePath.c_str(), frame);
+        if (golden.width != frame.width || golden.height != frame.height) {
+            printf("%-32s FAIL  golden is %dx%d, the panel %dx%d\n", testCase.name,
+                   golden.width, golden.height, frame.width, frame.height);
+        } else {
+            ScreenFrame diff = diffFrames(frame, golden);
+            saved = saved && writePBM(diffPath.c_str(), diff);
+            printf("%-32s FAIL  %u pixels differ\n", testCase.name, countLit(diff));
+        }
+        if (saved) {
+            printf("%-32s       drawn: %s\n", "", framePath.c_str());
+        } else {
+            fprintf(stderr, "screens: cannot write to %s\n", outDir.c_str());
+        }
+    }
+
+    if (checked == 0) {
+        fprintf(stderr, "screens: no screen matches %s\n", filter.c_str());
+        _exit(2);
+    }
+    if (failures > 0) {
+        fprintf(stderr, "%d of %d screen(s) differ from their golden image; rerun with --update if the change is intended\n",
+                failures, checked);
+    }
+    fflush(stdout);
+    _exit(failures > 0 ? 1 : 0);
+}
+
+#endif // SCREENS_NO_MAIN
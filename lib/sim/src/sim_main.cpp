@@ -0,0 +1,85 @@
+#include <Arduino.h>
+#include <unistd.h>
+#include "native_hal.h"
+#include "simulator.h"
+#include "config.h"
+
+// Runs one scenario against the firmware on the virtual clock:
+//
+//   pio run -e sim
+//   .pio/build/sim/program lib/sim/scenarios/daily_schedule.sim
+//   .pio/build/sim/program --replay quitbox.trace
+//
+//   --replay FILE      replay an input trace from /api/dev/trace instead of
+//                      running a scenario
+//   --step MS          loop() cadence while nothing happens (default 10000)
+//   --nvs MODE         none, daily (default) or all: every write on the timeline
+//   --serial           firmware log on stderr
+//
+// Exits with 1 when an expectation failed and 2 when the scenario could not
+// run.
+
+int main(int argc, char** argv) {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    Simulator simulator;
+    const char* scenario = NULL;
+    bool serial = false;
+    bool replaying = false;
+
+    for (int i = 1; i < argc; i++) {
+        String option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (option == "--step" && value != NULL) {
+            uint32_t step = atoi(value);
+            if (step < LOOP_INTERVAL || step >= 60000) {
+                fprintf(stderr, "sim: --step must be between %d and 59999 ms\n", LOOP_INTERVAL);
+                return 2;
+            }
+            simulator.setStep(step);
+            i++;
+        } else if (option == "--nvs" && value != NULL) {
+            String mode = value;
+            if (mode == "none") simulator.setNvsDetail(SIM_NVS_NONE);
+            else if (mode == "daily") simulator.setNvsDetail(SIM_NVS_DAILY);
+            else if (mode == "all") simulator.setNvsDetail(SIM_NVS_ALL);
+            else {
+                fprintf(stderr, "sim: unknown --nvs mode %s\n", value);
+                return 2;
+            }
+            i++;
+        } else if (option == "--replay" && value != NULL && scenario == NULL) {
+            simulator.loadReplay(value);
+            scenario = value;
+            replaying = true;
+            i++;
+        } else if (option == "--serial") {
+            serial = true;
+        } else if (!option.startsWith("--") && scenario == NULL && !replaying) {
+            scenario = argv[i];
+        } else {
+            scenario = NULL;
+            break;
+        }
+    }
+
+    if (scenario == NULL) {
+        fprintf(stderr, "usage: %s [--step MS] [--nvs none|daily|all] [--serial] SCENARIO | --replay FILE\n", argv[0]);
+        return 2;
+    }
+    if (!replaying && !simulator.load(scenario)) return 2;
+
+    // In-process only; storage starts empty and stays in memory
+    char* args[] = {argv[0], (char*)"--port", (char*)"0", (char*)"--virtual-time"};
+    hal.begin(4, args);
+    hal.setSerialOutput(serial ? stderr : NULL);
+
+    int failures = simulator.run();
+    simulator.report();
+    fflush(stdout);
+
+    if (failures < 0) _exit(2);
+    if (failures > 0) fprintf(stderr, "%d expectation(s) failed\n", failures);
+    _exit(failures > 0 ? 1 : 0);
+}
@@ -0,0 +1,892 @@
+#include "simulator.h"
+#include <Preferences.h>
+#include <WiFi.h>
+#include <algorithm>
+#include <fstream>
+#include <stdarg.h>
+#include <unistd.h>
+#include "config.h"
+#include "servo_control.h"
+#include "timer.h"
+#include "input_trace.h"
+#include "ai_worker.h"
+#include "nvs.h"
+
+extern ServoControl servoControl;
+extern AsyncWebServer server;
+extern Timer timer;
+extern AIWorker aiWorker;
+extern BoxState currentState;
+void transitionToState(BoxState newState);
+
+#define SIM_DEFAULT_START 1767254400UL   // 2026-01-01 08:00 UTC
+#define SIM_PRESS_MS 200                  // Held, then released, for this long
+#define SIM_BODY_PREVIEW 120              // Response characters on the timeline
+#define SIM_TOP_KEYS 10
+#define SIM_SYNCED_EPOCH 1000000000L     // Earlier wall clocks were never synced
+#define SIM_CHAT_HOST_MS 10000            // Real time a chat reply may take before the run gives up
+#define SIM_UPSTREAM_MODEL "llama3.2:latest"
+#define SIM_UPSTREAM_REPLY "take a slow breath, count to ten and let the urge pass before you decide anything."
+
+static String nextWord(String& rest) {
+    rest.trim();
+    int space = rest.indexOf(' ');
+    String word = space < 0 ? rest : rest.substring(0, space);
+    rest = space < 0 ? String() : rest.substring(space + 1);
+    rest.trim();
+    return word;
+}
+
+static const char* methodName(WebRequestMethod method) {
+    switch (method) {
+        case HTTP_GET: return "GET";
+        case HTTP_POST: return "POST";
+        case HTTP_PUT: return "PUT";
+        case HTTP_DELETE: return "DEL";
+        case HTTP_PATCH: return "PTCH";
+        default: return "?";
+    }
+}
+
+Simulator::Simulator() {
+    startEpoch = SIM_DEFAULT_START;
+    booted = false;
+    upstreamSet = false;
+    upstreamReplies = 0;
+    upstreamHold = SIM_HOLD_OFF;
+    seeding = false;
+    stepMs = 10000;
+    nvsDetail = SIM_NVS_DAILY;
+    loopPasses = 0;
+    locks = 0;
+    unlocks = 0;
+    lastCode = 0;
+    lastChatFirstUs = -1;
+    lastChatTotalUs = 0;
+    nvsWrites = 0;
+    nvsEntries = 0;
+    dayWrites = 0;
+    dayStart = 0;
+}
+
+bool Simulator::load(const char* path) {
+    std::ifstream file(path);
+    if (!file) {
+        fprintf(stderr, "sim: cannot open %s\n", path);
+        return false;
+    }
+    scenarioPath = path;
+
+    std::string text;
+    int number = 0;
+    while (std::getline(file, text)) {
+        number++;
+        String line = text.c_str();
+        line.trim();
+        if (line.length() == 0 || line.startsWith("#")) continue;
+        lines.push_back({number, line});
+    }
+    return true;
+}
+
+void Simulator::loadReplay(const char* path) {
+    scenarioPath = "--replay";
+    lines.push_back({0, String("replay ") + path});
+}
+
+// ---- Timeline ----
+
+time_t Simulator::wallNow() {
+    return startEpoch + (time_t)(hal.nowUs() / 1000000);
+}
+
+String Simulator::formatTime(time_t when) {
+    struct tm parts;
+    gmtime_r(&when, &parts);
+    char text[24];
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &parts);
+    return String(text);
+}
+
+void Simulator::timeline(const char* format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    printf("%s  %s\n", formatTime(wallNow()).c_str(), text);
+}
+
+void Simulator::onHalEvent(const HalEvent& event) {
+    switch (event.type) {
+        case HAL_EVENT_SERVO:
+            if (event.pin != SERVO_PIN) break;
+            if (event.value == servoControl.getLockedPosition()) {
+                locks++;
+                timeline("lock          servo %d", event.value);
+            } else if (event.value == servoControl.getUnlockedPosition()) {
+                unlocks++;
+                timeline("unlock        servo %d", event.value);
+            } else {
+                timeline("servo         %d", event.value);
+            }
+            break;
+
+        case HAL_EVENT_NVS_WRITE: {
+            if (seeding) break;
+
+            // Entries of 32 bytes: one for a number, a header plus data for a
+            // string, and an extra index entry for a blob
+            uint32_t data = (event.value + SIM_NVS_ENTRY_SIZE - 1) / SIM_NVS_ENTRY_SIZE;
+            uint32_t entries = event.pin == NVS_TYPE_STR ? 1 + data : event.pin == NVS_TYPE_BLOB ? 2 + data : 1;
+
+            nvsWrites++;
+            nvsEntries += entries;
+            dayWrites++;
+            KeyWrites& key = keyWrites[event.name];
+            key.writes++;
+            key.entries += entries;
+
+            if (nvsDetail == SIM_NVS_ALL) {
+                timeline("nvs           %s (%d bytes)", event.name.c_str(), event.value);
+            }
+            break;
+        }
+
+        case HAL_EVENT_WIFI:
+            if (event.value == WL_CONNECTED) {
+                timeline("wifi          connected");
+            } else if (event.value == WL_DISCONNECTED) {
+                timeline("wifi          disconnected");
+            } else {
+                timeline("wifi          status %d", event.value);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void Simulator::closeDay(time_t now) {
+    // Summaries fall on UTC midnight
+    while (now >= dayStart + 86400) {
+        if (nvsDetail == SIM_NVS_DAILY) {
+            String day = formatTime(dayStart).substring(0, 10);
+            printf("%s  nvs           %lu writes on %s\n", formatTime(dayStart + 86400).c_str(),
+                   (unsigned long)dayWrites, day.c_str());
+        }
+        dayStart += 86400;
+        dayWrites = 0;
+    }
+}
+
+// ---- Driving the firmware ----
+
+void Simulator::boot() {
+    // A replay boots as late as its keyframe
+    time_t now = wallNow();
+    hal.setWallClock(now);
+    dayStart = now - now % 86400;
+    timeline("boot");
+    setup();
+    booted = true;
+}
+
+void Simulator::runFor(uint64_t us, uint32_t step) {
+    if (!booted) boot();
+
+    // loop() sleeps for its own cadence; quiet stretches are skipped in
+    // steps of the given size, which has to stay below the one-minute
+    // period of the schedule check
+    uint64_t end = hal.nowUs() + us;
+    while (hal.nowUs() < end) {
+        uint64_t before = hal.nowUs();
+        loop();
+        loopPasses++;
+        settleWorker();
+
+        uint64_t next = std::min<uint64_t>(before + (uint64_t)step * 1000, end);
+        uint64_t now = hal.nowUs();
+        if (now < next) hal.advance(next - now);
+        closeDay(wallNow());
+    }
+}
+
+void Simulator::pressButton() {
+    timeline("press");
+    hal.setPin(BUTTON_PIN, LOW);
+    runFor(SIM_PRESS_MS * 1000ULL, LOOP_INTERVAL);
+    hal.setPin(BUTTON_PIN, HIGH);
+    runFor(SIM_PRESS_MS * 1000ULL, LOOP_INTERVAL);
+}
+
+void Simulator::request(WebRequestMethod method, const String& url, const String& body) {
+    NativeRequest request;
+    request.method = method;
+    request.url = url;
+    request.body = body;
+    if (body.length() > 0 && !body.startsWith("{")) {
+        request.contentType = "application/x-www-form-urlencoded";
+    }
+    this->request(request);
+}
+
+void Simulator::request(const NativeRequest& request) {
+    if (!booted) boot();
+
+    NativeResponse response = server.handle(request);
+    lastCode = response.code;
+    lastBody = response.body;
+
+    // A queued chat job reaches the held stand-in on the AI worker
+    for (int waited = 0; response.code == 202 && upstreamHold == SIM_HOLD_ARMED && waited < SIM_CHAT_HOST_MS; waited++) {
+        usleep(1000);
+    }
+
+    int sessionAt = response.body.indexOf("\"sessionId\":\"");
+    if (request.url == "/api/emergency/ai" && response.code == 200 && sessionAt >= 0) {
+        sessionAt += strlen("\"sessionId\":\"");
+        sessionIds.push_back(response.body.substring(sessionAt, response.body.indexOf('"', sessionAt)));
+    }
+
+    String preview = response.body;
+    preview.replace("\n", " ");
+    if (preview.length() > SIM_BODY_PREVIEW) {
+        preview = preview.substring(0, SIM_BODY_PREVIEW) + "...";
+    }
+    timeline("%-4s %s -> %d %s", methodName(request.method), request.url.c_str(), response.code, preview.c_str());
+}
+
+void Simulator::setUpstream(const HalUpstream& settings) {
+    hal.setUpstream(settings);
+    if (upstreamSet) return;
+    upstreamSet = true;
+
+    // Answers like an OpenAI-compatible chat completions endpoint; a
+    // streamed reply comes as one server-sent event per word. The model
+    // list has SIM_UPSTREAM_MODEL, as Ollama would name it.
+    hal.setHttpHandler([this](const String& method, const String& url, const String& body, String& response) {
+        if (method == "GET") {
+            if (!url.endsWith("/v1/models")) {
+                response = "404 page not found";
+                return 404;
+            }
+            response = "{\"object\":\"list\",\"data\":[{\"id\":\"" SIM_UPSTREAM_MODEL "\",\"object\":\"model\",\"owned_by\":\"library\"}]}";
+            return 200;
+        }
+        // On the AI worker task: the simulator's own thread runs on meanwhile
+        if (upstreamHold == SIM_HOLD_ARMED) {
+            upstreamHold = SIM_HOLD_HELD;
+            while (upstreamHold == SIM_HOLD_HELD) {
+                usleep(1000);
+            }
+        }
+        upstreamReplies++;
+        upstreamBody = body;
+        String content = "Stand-in reply " + String((unsigned long)upstreamReplies) + ": " + SIM_UPSTREAM_REPLY;
+
+        if (body.indexOf("\"stream\":true") < 0) {
+            response = "{\"choices\":[{\"message\":{\"role\":\"assistant\",\"content\":\"" + content + "\"}}]}";
+            return 200;
+        }
+        response = String();
+        while (content.length() > 0) {
+            int space = content.indexOf(' ');
+            String word = space < 0 ? content : content.substring(0, space + 1);
+            content = space < 0 ? String() : content.substring(space + 1);
+            response += "data: {\"choices\":[{\"index\":0,\"delta\":{\"content\":\"" + word + "\"}}]}\n\n";
+        }
+        response += "data: [DONE]\n\n";
+        return 200;
+    });
+}
+
+bool Simulator::chat(const String& message) {
+    if (!booted) boot();
+
+    String escaped = message;
+    escaped.replace("\\", "\\\\");
+    escaped.replace("\"", "\\\"");
+    NativeRequest submit;
+    submit.method = HTTP_POST;
+    submit.url = "/api/ai/chat";
+    submit.body = "{\"message\":\"" + escaped + "\"";
+    if (sessionName().length() > 0) {
+        submit.body += ",\"sessionId\":\"" + sessionName() + "\"";
+    }
+    submit.body += "}";
+    uint64_t start = hal.nowUs();
+    HalUpstreamStats before = hal.upstreamStats();
+    NativeResponse response = server.handle(submit);
+
+    int idAt = response.body.indexOf("\"jobId\":");
+    if (response.code != 202 || idAt < 0) {
+        lastCode = response.code;
+        lastBody = response.body;
+        timeline("chat \"%s\" -> %d %s", message.c_str(), response.code, response.body.c_str());
+        return true;
+    }
+    unsigned long id = strtoul(response.body.c_str() + idAt + 8, NULL, 10);
+
+    // The worker's handshake and reply advance the virtual clock; nothing
+    // else does meanwhile, so the job cannot time out on host scheduling
+    // and its latency is exactly what the stand-in charged
+    NativeRequest poll;
+    poll.method = HTTP_GET;
+    poll.url = "/api/ai/job?id=" + String(id);
+    for (int waited = 0;; waited++) {
+        response = server.handle(poll);
+        if (response.body.indexOf("\"status\":\"queued\"") < 0 && response.body.indexOf("\"status\":\"running\"") < 0) {
+            break;
+        }
+        if (waited >= SIM_CHAT_HOST_MS) {
+            fprintf(stderr, "chat job %lu never finished\n", id);
+            return false;
+        }
+        usleep(1000);
+    }
+    uint64_t latencyUs = hal.nowUs() - start;
+    HalUpstreamStats after = hal.upstreamStats();
+
+    // Let loop() push the reply as it would on the device
+    loop();
+    loopPasses++;
+    settleWorker();
+
+    lastCode = response.code;
+    lastBody = response.body;
+    int firstAt = response.body.indexOf("\"firstTextMs\":");
+    lastChatFirstUs = firstAt < 0 ? -1 : (int64_t)strtoul(response.body.c_str() + firstAt + 14, NULL, 10) * 1000;
+    lastChatTotalUs = latencyUs;
+    String firstText = lastChatFirstUs < 0 ? String("-") : String((unsigned long)(lastChatFirstUs / 1000)) + " ms";
+    timeline("chat \"%s\" -> %llu ms (first text %s), %u handshake(s), %u lost", message.c_str(),
+             (unsigned long long)(latencyUs / 1000), firstText.c_str(),
+             after.handshakes - before.handshakes, after.lost - before.lost);
+    return true;
+}
+
+String Simulator::sessionName() {
+    if (session.length() > 0 || sessionIds.empty()) {
+        return session;
+    }
+    return sessionIds.back();
+}
+
+void Simulator::settleWorker() {
+    // Whatever loop() handed the AI worker (a health check) runs to the end
+    // before the clock moves on, so it happens at the same virtual time on
+    // every run and is never charged to a chat message that follows
+    for (int waited = 0; waited < SIM_CHAT_HOST_MS && !aiWorker.isIdle(); waited++) {
+        usleep(1000);
+    }
+}
+
+bool Simulator::seed(const String& key, const String& type, const String& value) {
+    // Seeded values are the scenario's, not the firmware's writes
+    seeding = true;
+    Preferences seed;
+    seed.begin(PREF_NAMESPACE, false);
+    bool known = true;
+    if (type == "int") seed.putInt(key.c_str(), value.toInt());
+    else if (type == "bool") seed.putBool(key.c_str(), value == "true" || value == "1");
+    else if (type == "u64") seed.putULong64(key.c_str(), strtoull(value.c_str(), NULL, 10));
+    else if (type == "float") seed.putFloat(key.c_str(), value.toFloat());
+    else if (type == "str") seed.putString(key.c_str(), value);
+    else known = false;
+    seed.end();
+    seeding = false;
+    return known;
+}
+
+String Simulator::storedValue(const String& key) {
+    HalStoredValue stored;
+    if (!hal.readValue(PREF_NAMESPACE, key.c_str(), stored)) return "(unset)";
+
+    const std::string& bytes = stored.bytes;
+    char text[32];
+    switch (stored.type) {
+        case NVS_TYPE_STR: {
+            std::string value = bytes;
+            while (!value.empty() && value.back() == '\0') value.pop_back();
+            return String(value.c_str());
+        }
+        case NVS_TYPE_BLOB:
+            // Preferences stores floats as four-byte blobs
+            if (bytes.size() == sizeof(float)) {
+                float value;
+                memcpy(&value, bytes.data(), sizeof(value));
+                snprintf(text, sizeof(text), "%g", value);
+                return String(text);
+            }
+            return String((unsigned long)bytes.size()) + " bytes";
+        default: {
+            // Little-endian integers; the high nibble of the type marks signed
+            uint64_t raw = 0;
+            memcpy(&raw, bytes.data(), std::min(bytes.size(), sizeof(raw)));
+            size_t bits = bytes.size() * 8;
+            if ((stored.type & 0x10) && bits < 64 && (raw >> (bits - 1)) & 1) {
+                raw |= ~0ULL << bits;
+            }
+            if (stored.type & 0x10) {
+                snprintf(text, sizeof(text), "%lld", (long long)raw);
+            } else {
+                snprintf(text, sizeof(text), "%llu", (unsigned long long)raw);
+            }
+            return String(text);
+        }
+    }
+}
+
+bool Simulator::expect(const String& what, const String& argument, const String& value, String& actual) {
+    if (what == "state") {
+        actual = servoControl.isLocked() ? "locked" : "unlocked";
+        return actual == argument;
+    } else if (what == "unlocks" || what == "locks") {
+        actual = String((unsigned long)(what == "unlocks" ? unlocks : locks));
+        return actual == argument;
+    } else if (what == "code") {
+        actual = String(lastCode);
+        return actual == argument;
+    } else if (what == "body") {
+        String text = value.length() > 0 ? argument + " " + value : argument;
+        actual = lastBody;
+        return lastBody.indexOf(text) >= 0;
+    } else if (what == "nvs") {
+        actual = storedValue(argument);
+        return actual == value;
+    } else if (what == "upstream") {
+        HalUpstreamStats stats = hal.upstreamStats();
+        uint32_t count;
+        if (argument == "handshakes") count = stats.handshakes;
+        else if (argument == "requests") count = stats.requests;
+        else if (argument == "lost") count = stats.lost;
+        else if (argument == "body") {
+            actual = upstreamBody;
+            return upstreamBody.indexOf(value) >= 0;
+        } else if (argument == "bytes") {
+            actual = String((unsigned long)upstreamBody.length());
+            return upstreamBody.length() <= (size_t)value.toInt();
+        } else {
+            actual = "unknown counter";
+            return false;
+        }
+        actual = String((unsigned long)count);
+        return actual == value;
+    } else if (what == "chat") {
+        uint64_t limit;
+        if ((argument != "first" && argument != "total") || !parseDuration(value, limit)) {
+            actual = "bad expectation";
+            return false;
+        }
+        int64_t took = argument == "first" ? lastChatFirstUs : (int64_t)lastChatTotalUs;
+        actual = took < 0 ? String("nothing streamed") : String((unsigned long)(took / 1000)) + "ms";
+        return took >= 0 && (uint64_t)took <= limit;
+    }
+    actual = "unknown expectation";
+    return false;
+}
+
+bool Simulator::execute(const Line& line, int& failures) {
+    String rest = line.text;
+    String command = nextWord(rest);
+
+    if (command == "start") {
+        if (booted || !parseDate(rest, startEpoch)) return false;
+        hal.setWallClock(startEpoch);
+    } else if (command == "replay") {
+        if (rest.length() == 0 || !replay(rest, failures)) return false;
+    } else if (command == "nvs") {
+        String key = nextWord(rest);
+        String type = nextWord(rest);
+        if (key.length() == 0 || !seed(key, type, rest)) return false;
+    } else if (command == "wifi") {
+        if (rest != "on" && rest != "off") return false;
+        hal.setWifiAvailable(rest == "on");
+    } else if (command == "boot") {
+        if (booted) return false;
+        boot();
+    } else if (command == "wait") {
+        uint64_t us;
+        if (!parseDuration(rest, us)) return false;
+        runFor(us, stepMs);
+    } else if (command == "until") {
+        time_t target;
+        if (!parseDate(rest, target)) return false;
+        if (!booted) boot();
+        if (target > wallNow()) runFor((uint64_t)(target - wallNow()) * 1000000, stepMs);
+    } else if (command == "press") {
+        pressButton();
+    } else if (command == "get" || command == "post") {
+        rest.replace("$session", sessionName());
+        String url = nextWord(rest);
+        if (!url.startsWith("/")) return false;
+        request(command == "get" ? HTTP_GET : HTTP_POST, url, rest);
+    } else if (command == "session") {
+        if (rest == "newest") {
+            session = String();
+            return true;
+        }
+        int n = rest.toInt();
+        if (n < 1 || n > (int)sessionIds.size()) return false;
+        session = sessionIds[n - 1];
+    } else if (command == "upstream") {
+        if (rest == "drop") {
+            timeline("upstream drops its connections");
+            hal.dropConnections();
+            return true;
+        } else if (rest == "hold") {
+            timeline("upstream holds the next chat request");
+            upstreamHold = SIM_HOLD_ARMED;
+            return true;
+        } else if (rest == "release") {
+            timeline("upstream answers the held request");
+            upstreamHold = SIM_HOLD_OFF;
+            settleWorker();
+            return true;
+        } else if (rest == "down" || rest == "up") {
+            timeline("upstream server %s", rest == "down" ? "goes down" : "is back up");
+            hal.setUpstreamDown(rest == "down");
+            return true;
+        }
+        uint64_t handshake, reply, keepAlive;
+        if (!parseDuration(nextWord(rest), handshake) || !parseDuration(nextWord(rest), reply) ||
+            !parseDuration(rest, keepAlive)) {
+            return false;
+        }
+        HalUpstream settings = {(uint32_t)(handshake / 1000), (uint32_t)(reply / 1000), (uint32_t)(keepAlive / 1000)};
+        setUpstream(settings);
+    } else if (command == "chat") {
+        if (rest.length() == 0 || !chat(rest)) return false;
+    } else if (command == "expect") {
+        String what = nextWord(rest);
+        String argument = nextWord(rest);
+        String actual;
+        if (!expect(what, argument, rest, actual)) {
+            timeline("FAIL          %s (got %s)", line.text.c_str(), actual.c_str());
+            fprintf(stderr, "%s:%d: %s: got %s\n", scenarioPath.c_str(), line.number, line.text.c_str(), actual.c_str());
+            failures++;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int Simulator::run() {
+    hal.onEvent([this](const HalEvent& event) { onHalEvent(event); });
+
+    int failures = 0;
+    for (const Line& line : lines) {
+        if (!execute(line, failures)) {
+            fprintf(stderr, "%s:%d: cannot run \"%s\"\n", scenarioPath.c_str(), line.number, line.text.c_str());
+            return -1;
+        }
+    }
+    return failures;
+}
+
+// ---- Replay ----
+
+struct ReplayRecord {
+    TraceRecordHeader header;
+    const uint8_t* payload;
+    size_t size;
+};
+
+template <typename T>
+static T readField(const uint8_t*& cursor) {
+    T value;
+    memcpy(&value, cursor, sizeof(value));
+    cursor += sizeof(value);
+    return value;
+}
+
+void Simulator::runUntil(uint64_t us) {
+    if (us > hal.nowUs()) runFor(us - hal.nowUs(), LOOP_INTERVAL);
+}
+
+void Simulator::addNetwork(const String& ssid) {
+    std::vector<HalWifiNetwork> networks = hal.getNetworks();
+    for (const HalWifiNetwork& network : networks) {
+        if (ssid == network.ssid.c_str()) return;
+    }
+
+    // Passwords are redacted from the trace; an empty one takes any, and
+    // the BSSID the box remembered keeps its fast reconnect working
+    HalWifiNetwork network = {ssid.c_str(), "", -55, 6, {0x02, 0x00, 0x00, 0x00, 0x00, 0x03}, false};
+    HalStoredValue bssid;
+    if (hal.readValue(PREF_NAMESPACE, KEY_WIFI_BSSID, bssid) && bssid.bytes.size() == sizeof(network.bssid)) {
+        memcpy(network.bssid, bssid.bytes.data(), sizeof(network.bssid));
+    }
+    networks.push_back(network);
+    hal.setNetworks(networks);
+}
+
+bool Simulator::replay(const String& path, int& failures) {
+    if (booted) return false;
+
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file) {
+        fprintf(stderr, "sim: cannot open %s\n", path.c_str());
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    TraceFileHeader header;
+    if (data.size() < sizeof(header)) {
+        fprintf(stderr, "sim: %s is not an input trace\n", path.c_str());
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 || header.version != TRACE_VERSION) {
+        fprintf(stderr, "sim: %s is not a version %d input trace\n", path.c_str(), TRACE_VERSION);
+        return false;
+    }
+
+    // A download cut short leaves a torn last record, which is dropped
+    std::vector<ReplayRecord> records;
+    size_t offset = sizeof(header);
+    while (offset + sizeof(TraceRecordHeader) <= data.size()) {
+        ReplayRecord record;
+        memcpy(&record.header, data.data() + offset, sizeof(record.header));
+        if (record.header.size < sizeof(TraceRecordHeader) || offset + record.header.size > data.size()) break;
+        record.payload = (const uint8_t*)data.data() + offset + sizeof(TraceRecordHeader);
+        record.size = record.header.size - sizeof(TraceRecordHeader);
+        records.push_back(record);
+        offset += record.header.size;
+    }
+
+    // The ring may have overwritten part of the oldest keyframe; start from
+    // the first one with all of its preferences
+    const size_t keyframeSize = 4 + 1 + 1 + 4 + 1 + 2;
+    size_t first = records.size();
+    uint16_t count = 0;
+    for (size_t i = 0; i < records.size() && first == records.size(); i++) {
+        if (records[i].header.type != TRACE_KEYFRAME || records[i].size < keyframeSize) continue;
+        memcpy(&count, records[i].payload + keyframeSize - sizeof(count), sizeof(count));
+        if (count > i) continue;
+        bool complete = true;
+        for (size_t j = i - count; j < i; j++) {
+            complete = complete && records[j].header.type == TRACE_PREFERENCE;
+        }
+        if (complete) first = i;
+    }
+    if (first == records.size()) {
+        fprintf(stderr, "sim: %s has no complete keyframe\n", path.c_str());
+        return false;
+    }
+
+    // Preferences as they were stored
+    seeding = true;
+    for (size_t i = first - count; i < first; i++) {
+        const ReplayRecord& record = records[i];
+        if (record.size < 2 || (size_t)2 + record.payload[1] > record.size) continue;
+        uint8_t type = record.payload[0];
+        std::string key((const char*)record.payload + 2, record.payload[1]);
+        std::string value((const char*)record.payload + 2 + key.size(), record.size - 2 - key.size());
+        if (type == NVS_TYPE_STR) value.push_back('\0');
+        hal.writeValue(PREF_NAMESPACE, key, type, value.data(), value.size());
+    }
+    seeding = false;
+
+    const ReplayRecord& keyframe = records[first];
+    const uint8_t* cursor = keyframe.payload;
+    uint32_t epoch = readField<uint32_t>(cursor);
+    BoxState state = (BoxState)readField<uint8_t>(cursor);
+    bool running = readField<uint8_t>(cursor) != 0;
+    uint32_t remaining = readField<uint32_t>(cursor);
+    bool station = readField<uint8_t>(cursor) != 0;
+
+    hal.advance((uint64_t)keyframe.header.ms * 1000 - std::min<uint64_t>(hal.nowUs(), (uint64_t)keyframe.header.ms * 1000));
+    if (epoch >= SIM_SYNCED_EPOCH) {
+        startEpoch = epoch - keyframe.header.ms / 1000;
+        hal.setWallClock(epoch);
+        hal.syncWallClock();
+    }
+    // A station that was down may just not have connected yet; only a
+    // NETWORK record takes the network away
+    HalStoredValue ssid;
+    if (station && hal.readValue(PREF_NAMESPACE, KEY_WIFI_SSID, ssid)) {
+        addNetwork(String(ssid.bytes.c_str()));
+        hal.setWifiAvailable(true);
+    }
+
+    timeline("replay        %s: %lu records from %.1f s, %lu dropped, %lu overwritten", path.c_str(),
+             (unsigned long)(records.size() - first), keyframe.header.ms / 1000.0,
+             (unsigned long)header.dropped, (unsigned long)header.evicted);
+    boot();
+
+    // Past the boot keyframe, setup() restored the lock from preferences
+    // but not the countdown in progress
+    if (!(keyframe.header.flags & TRACE_FLAG_BOOT)) {
+        if (running && !timer.isRunning()) timer.start(remaining);
+        if (state != currentState) {
+            transitionToState(state);
+            if (state == LOCKED) servoControl.lock();
+            else if (state == UNLOCKED) servoControl.unlock();
+        }
+    }
+
+    for (size_t i = first + 1; i < records.size(); i++) {
+        const ReplayRecord& record = records[i];
+        uint64_t at = (uint64_t)record.header.ms * 1000;
+        cursor = record.payload;
+
+        switch (record.header.type) {
+            case TRACE_STALL: {
+                // The previous pass ran on time, then nothing until this one
+                if (record.size < sizeof(uint32_t)) break;
+                uint64_t gap = (uint64_t)readField<uint32_t>(cursor) * 1000;
+                runUntil(at > gap ? at - gap : 0);
+                if (at > hal.nowUs()) hal.advance(at - hal.nowUs());
+                timeline("stall         %lu ms", (unsigned long)(gap / 1000));
+                break;
+            }
+
+            case TRACE_BUTTON:
+                if (record.size < 1) break;
+                runUntil(at);
+                hal.setPin(BUTTON_PIN, record.payload[0] ? HIGH : LOW);
+                timeline("button        %s", record.payload[0] ? "released" : "pressed");
+                break;
+
+            case TRACE_CLOCK: {
+                if (record.size < sizeof(uint32_t)) break;
+                runUntil(at);
+                time_t clock = readField<uint32_t>(cursor);
+                startEpoch = clock - (time_t)(hal.nowUs() / 1000000);
+                hal.setWallClock(clock);
+                hal.syncWallClock();
+                dayStart = clock - clock % 86400;
+                timeline("clock         set");
+                break;
+            }
+
+            case TRACE_NETWORK: {
+                if (record.size < 1) break;
+                runUntil(at);
+                bool online = record.payload[0] != 0;
+                String name = String(std::string((const char*)record.payload + 1, record.size - 1).c_str());
+                if (online && name.length() > 0) addNetwork(name);
+                hal.setWifiAvailable(online);
+                timeline("network       %s %s", online ? "up" : "down", name.c_str());
+                break;
+            }
+
+            case TRACE_REQUEST: {
+                if (record.size < 4) break;
+                NativeRequest request;
+                request.method = (WebRequestMethod)readField<uint8_t>(cursor);
+                uint16_t urlLength = readField<uint16_t>(cursor);
+                if ((size_t)3 + urlLength + 1 > record.size) break;
+                request.url = String(std::string((const char*)cursor, urlLength).c_str());
+                cursor += urlLength;
+                uint8_t typeLength = readField<uint8_t>(cursor);
+                size_t used = 4 + urlLength + typeLength;
+                if (used > record.size) break;
+                request.contentType = String(std::string((const char*)cursor, typeLength).c_str());
+                cursor += typeLength;
+                request.body = String(std::string((const char*)cursor, record.size - used).c_str());
+                runUntil(at);
+                this->request(request);
+                break;
+            }
+
+            case TRACE_KEYFRAME: {
+                // Later keyframes check that the replay kept up with the box
+                if (record.size < keyframeSize) break;
+                runUntil(at);
+                cursor += sizeof(uint32_t);
+                BoxState recorded = (BoxState)readField<uint8_t>(cursor);
+                if (recorded != currentState) {
+                    timeline("FAIL          box state %d where the trace has %d", currentState, recorded);
+                    fprintf(stderr, "%s: state diverges at %.1f s\n", path.c_str(), record.header.ms / 1000.0);
+                    failures++;
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+// ---- Report ----
+
+void Simulator::report() {
+    double days = (double)hal.nowUs() / 86400e6;
+    if (days <= 0) return;
+
+    printf("\nSimulated %.2f days in %lu loop passes\n", days, (unsigned long)loopPasses);
+    printf("Servo: %lu lock and %lu unlock moves\n", (unsigned long)locks, (unsigned long)unlocks);
+    printf("NVS: %llu writes (%.0f/day), %llu entries of %d bytes (%.0f/day)\n",
+           (unsigned long long)nvsWrites, nvsWrites / days,
+           (unsigned long long)nvsEntries, SIM_NVS_ENTRY_SIZE, nvsEntries / days);
+
+    std::vector<std::pair<std::string, KeyWrites>> keys(keyWrites.begin(), keyWrites.end());
+    std::sort(keys.begin(), keys.end(), [](const std::pair<std::string, KeyWrites>& a, const std::pair<std::string, KeyWrites>& b) {
+        return a.second.entries > b.second.entries;
+    });
+    for (size_t i = 0; i < keys.size() && i < SIM_TOP_KEYS; i++) {
+        printf("  %-32s %8lu writes %8.0f/day\n", keys[i].first.c_str(),
+               (unsigned long)keys[i].second.writes, keys[i].second.writes / days);
+    }
+
+    // NVS appends entries and erases a page once it is full and compacted,
+    // rotating through the partition, so wear spreads across every page
+    double pageErasesPerDay = nvsEntries / days / SIM_NVS_ENTRIES_PER_PAGE;
+    double erasesPerPagePerDay = pageErasesPerDay / SIM_NVS_PAGES;
+    printf("Flash wear: %.1f page erases/day over %d pages", pageErasesPerDay, SIM_NVS_PAGES);
+    if (erasesPerPagePerDay > 0) {
+        printf(", %d-cycle endurance reached in %.1f years\n", SIM_FLASH_ENDURANCE,
+               SIM_FLASH_ENDURANCE / erasesPerPagePerDay / 365.0);
+    } else {
+        printf("\n");
+    }
+}
+
+// ---- Parsing ----
+
+bool Simulator::parseDuration(const String& text, uint64_t& us) {
+    // 250ms, 90s, 15m, 6h, 3d, or a sum such as 1d12h
+    us = 0;
+    const char* cursor = text.c_str();
+    if (*cursor == '\0') return false;
+    while (*cursor != '\0') {
+        char* unit;
+        unsigned long long amount = strtoull(cursor, &unit, 10);
+        if (unit == cursor) return false;
+        switch (*unit) {
+            case 's': us += amount * 1000000ULL; break;
+            case 'm':
+                if (unit[1] == 's') {
+                    us += amount * 1000ULL;
+                    unit++;
+                } else {
+                    us += amount * 60000000ULL;
+                }
+                break;
+            case 'h': us += amount * 3600000000ULL; break;
+            case 'd': us += amount * 86400000000ULL; break;
+            default: return false;
+        }
+        cursor = unit + 1;
+    }
+    return true;
+}
+
+bool Simulator::parseDate(const String& text, time_t& epoch) {
+    struct tm parts = {};
+    int second = 0;
+    int fields = sscanf(text.c_str(), "%d-%d-%d %d:%d:%d", &parts.tm_year, &parts.tm_mon, &parts.tm_mday,
+                        &parts.tm_hour, &parts.tm_min, &second);
+    if (fields < 5) return false;
+    parts.tm_year -= 1900;
+    parts.tm_mon -= 1;
+    parts.tm_sec = second;
+    epoch = timegm(&parts);
+    return true;
+}
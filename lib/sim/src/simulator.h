@@ -0,0 +1,171 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+#include "native_hal.h"
+
+// Discrete-event simulator over the native build. A scenario file drives
+// the firmware on the virtual clock: seeded preferences, button presses,
+// web API calls and long stretches of plain loop() time. Lock/unlock
+// moves, inputs, responses and NVS writes go to a timeline on stdout;
+// "expect" lines turn a scenario into a regression test, and the closing
+// report estimates NVS flash wear from the write rate.
+//
+// Scenario commands, one per line (# starts a comment):
+//   start YYYY-MM-DD HH:MM      wall clock at power-on (UTC), before boot
+//   replay FILE                 boot from the first keyframe of an input
+//                               trace (/api/dev/trace) and feed it the
+//                               recorded inputs at their recorded times;
+//                               a later keyframe whose box state differs
+//                               counts as a failed expectation
+//   nvs KEY TYPE VALUE          seed a preference before boot; TYPE is
+//                               int, bool, u64, float or str
+//   wifi on|off                 whether station connects succeed
+//   boot                        run setup()
+//   wait DURATION               run loop() for 90s, 15m, 6h or 3d
+//   until YYYY-MM-DD HH:MM      run loop() up to that wall time
+//   press                       press and release the button
+//   get URL / post URL [BODY]   call the web API; a BODY starting with {
+//                               is sent as JSON, anything else as a form
+//   upstream HANDSHAKE REPLY KEEPALIVE
+//                               stand in for the AI provider's HTTPS server:
+//                               what a connection and a reply take, and how
+//                               long it keeps an idle connection (900ms,
+//                               1500ms, 60s)
+//   upstream drop               the network forgets every open connection
+//                               without closing it, like a NAT timeout
+//   upstream down|up            the server refuses connections and resets
+//                               open ones, or answers again; it serves
+//                               chat completions and, on GET, a model list
+//   upstream hold|release       keep the next chat request waiting at the
+//                               server until release, which lets its reply
+//                               through; the post that queued it returns
+//                               once the request is held, and the lines in
+//                               between run while the reply is in flight
+//   chat MESSAGE                post MESSAGE to /api/ai/chat and wait for
+//                               the reply; the clock moves only by what the
+//                               stand-in charges, so the latency is exact
+//   session N|newest            the Nth AI session /api/emergency/ai
+//                               started is the one chat lines name, and
+//                               $session in get/post lines; newest, the
+//                               default, is whichever was started last
+//   expect state locked|unlocked
+//   expect unlocks N / expect locks N
+//   expect code N               status of the last API call
+//   expect body TEXT            the last response body contains TEXT
+//   expect nvs KEY VALUE        stored preference, as the timeline prints it
+//   expect upstream handshakes|requests|lost N
+//   expect upstream body TEXT   the last chat request the stand-in
+//                               answered contains TEXT
+//   expect upstream bytes N     and was no longer than N bytes
+//   expect chat first|total DURATION
+//                               the last chat reply showed its first words
+//                               or finished within DURATION
+
+// Flash figures for the wear estimate: the nvs partition of huge_app.csv
+// (0x5000) and the endurance Espressif quotes for the SPI flash
+#define SIM_NVS_PAGES 5
+#define SIM_NVS_ENTRIES_PER_PAGE 126
+#define SIM_NVS_ENTRY_SIZE 32
+#define SIM_FLASH_ENDURANCE 100000
+
+enum SimHold {
+    SIM_HOLD_OFF,
+    SIM_HOLD_ARMED,  // The next chat request is held
+    SIM_HOLD_HELD    // A chat request waits for release
+};
+
+enum SimNvsDetail {
+    SIM_NVS_NONE,    // Only the closing report
+    SIM_NVS_DAILY,   // One summary line per simulated day
+    SIM_NVS_ALL      // Every write on the timeline
+};
+
+class Simulator {
+public:
+    Simulator();
+
+    bool load(const char* path);
+    // A scenario of a single replay line, for --replay
+    void loadReplay(const char* path);
+    // Runs the scenario; returns the number of failed expectations, or -1
+    // when a line could not be executed
+    int run();
+    void report();
+
+    void setStep(uint32_t ms) { stepMs = ms; }
+    void setNvsDetail(SimNvsDetail detail) { nvsDetail = detail; }
+
+private:
+    struct Line {
+        int number;
+        String text;
+    };
+
+    struct KeyWrites {
+        uint32_t writes;
+        uint64_t entries;
+    };
+
+    std::string scenarioPath;
+    std::vector<Line> lines;
+
+    time_t startEpoch;
+    bool booted;
+    bool upstreamSet;
+    uint32_t upstreamReplies;
+    String upstreamBody;         // Last chat request the stand-in answered
+    std::atomic<int> upstreamHold;   // SimHold
+    std::vector<String> sessionIds;  // From /api/emergency/ai, in order
+    String session;              // Named by chat lines; empty for the newest
+    bool seeding;
+    uint32_t stepMs;
+    SimNvsDetail nvsDetail;
+
+    uint32_t loopPasses;
+    uint32_t locks;
+    uint32_t unlocks;
+    int lastCode;
+    String lastBody;
+    int64_t lastChatFirstUs;     // -1 when nothing was streamed
+    uint64_t lastChatTotalUs;
+
+    uint64_t nvsWrites;
+    uint64_t nvsEntries;
+    uint32_t dayWrites;
+    time_t dayStart;
+    std::map<std::string, KeyWrites> keyWrites;
+
+    time_t wallNow();
+    String formatTime(time_t when);
+    void timeline(const char* format, ...);
+    void onHalEvent(const HalEvent& event);
+    void closeDay(time_t now);
+
+    bool execute(const Line& line, int& failures);
+    void boot();
+    void runFor(uint64_t us, uint32_t step);
+    void pressButton();
+    void request(WebRequestMethod method, const String& url, const String& body);
+    void request(const NativeRequest& request);
+    void setUpstream(const HalUpstream& settings);
+    bool chat(const String& message);
+    String sessionName();
+    void settleWorker();
+    bool replay(const String& path, int& failures);
+    void runUntil(uint64_t us);
+    void addNetwork(const String& ssid);
+    bool seed(const String& key, const String& type, const String& value);
+    bool expect(const String& what, const String& argument, const String& value, String& actual);
+    String storedValue(const String& key);
+
+    static bool parseDuration(const String& text, uint64_t& us);
+    static bool parseDate(const String& text, time_t& epoch);
+};
+
+#endif // SIMULATOR_H
@@ -0,0 +1,136 @@
+#include "admission_control.h"
+#include <limits.h>
+
+// Burst size and sustained rate per endpoint class (REQUEST_STATIC unused)
+static const float CLASS_BURST[REQUEST_CLASS_COUNT] = {
+    0, RATE_LIMIT_READ_BURST, RATE_LIMIT_WRITE_BURST, RATE_LIMIT_AI_BURST
+};
+static const float CLASS_PER_MINUTE[REQUEST_CLASS_COUNT] = {
+    0, RATE_LIMIT_READ_PER_MINUTE, RATE_LIMIT_WRITE_PER_MINUTE, RATE_LIMIT_AI_PER_MINUTE
+};
+
+AdmissionControl::AdmissionControl() {
+    admitted = 0;
+    rateLimited = 0;
+    shed = 0;
+
+    for (int i = 0; i < RATE_LIMIT_MAX_BUCKETS; i++) {
+        buckets[i].used = false;
+    }
+}
+
+bool AdmissionControl::canHandle(AsyncWebServerRequest *request) {
+    // Called once per request, before any other handler sees it
+    RequestClass requestClass = classify(request);
+
+    if (!heapAvailable(requestClass)) {
+        shed++;
+        return reject(request, 503, ADMISSION_RETRY_AFTER);
+    }
+
+    if (requestClass != REQUEST_STATIC) {
+        unsigned long now = millis();
+        Bucket* bucket = findBucket((uint32_t)request->client()->remoteIP(), requestClass, now);
+        unsigned long retryAfter = takeToken(bucket, requestClass, now);
+        if (retryAfter > 0) {
+            rateLimited++;
+            return reject(request, 429, retryAfter);
+        }
+    }
+
+    admitted++;
+    return false;
+}
+
+void AdmissionControl::handleRequest(AsyncWebServerRequest *request) {
+    Verdict* verdict = (Verdict*)request->_tempObject;
+    int status = verdict != NULL ? verdict->status : 503;
+    unsigned long retryAfter = verdict != NULL ? verdict->retryAfter : ADMISSION_RETRY_AFTER;
+
+    const char* body = status == 429
+        ? "{\"success\":false,\"error\":\"Too many requests\"}"
+        : "{\"success\":false,\"error\":\"Device busy, try again shortly\"}";
+
+    AsyncWebServerResponse *response = request->beginResponse(status, "application/json", body);
+    response->addHeader("Retry-After", String(retryAfter));
+    request->send(response);
+}
+
+void AdmissionControl::writeJSON(JsonObject stats) {
+    stats["admitted"] = admitted;
+    stats["rateLimited"] = rateLimited;
+    stats["shed"] = shed;
+    stats["freeHeap"] = ESP.getFreeHeap();
+    stats["largestBlock"] = ESP.getMaxAllocHeap();
+}
+
+RequestClass AdmissionControl::classify(AsyncWebServerRequest *request) {
+    const String& url = request->url();
+
+    if (!url.startsWith("/api/")) {
+        return REQUEST_STATIC;
+    }
+    if (url.startsWith("/api/emergency") || url.startsWith("/api/ai/chat")) {
+        return REQUEST_AI;
+    }
+    return request->method() == HTTP_GET ? REQUEST_READ : REQUEST_WRITE;
+}
+
+bool AdmissionControl::heapAvailable(RequestClass requestClass) {
+    uint32_t minimum = requestClass == REQUEST_AI ? ADMISSION_MIN_AI_HEAP : ADMISSION_MIN_FREE_HEAP;
+    return ESP.getFreeHeap() >= minimum && ESP.getMaxAllocHeap() >= ADMISSION_MIN_FREE_BLOCK;
+}
+
+AdmissionControl::Bucket* AdmissionControl::findBucket(uint32_t ip, RequestClass requestClass, unsigned long now) {
+    Bucket* oldest = NULL;
+
+    for (int i = 0; i < RATE_LIMIT_MAX_BUCKETS; i++) {
+        Bucket& bucket = buckets[i];
+        if (bucket.used && bucket.ip == ip && bucket.requestClass == requestClass) {
+            return &bucket;
+        }
+
+        // Free slots sort before any used one
+        unsigned long age = bucket.used ? now - bucket.lastRefill : ULONG_MAX;
+        if (oldest == NULL || age > (oldest->used ? now - oldest->lastRefill : ULONG_MAX)) {
+            oldest = &bucket;
+        }
+    }
+
+    // New client: take a free slot, or recycle the least recently used one
+    oldest->used = true;
+    oldest->ip = ip;
+    oldest->requestClass = requestClass;
+    oldest->tokens = CLASS_BURST[requestClass];
+    oldest->lastRefill = now;
+    return oldest;
+}
+
+unsigned long AdmissionControl::takeToken(Bucket* bucket, RequestClass requestClass, unsigned long now) {
+    float perMs = CLASS_PER_MINUTE[requestClass] / 60000.0f;
+
+    bucket->tokens += (now - bucket->lastRefill) * perMs;
+    if (bucket->tokens > CLASS_BURST[requestClass]) {
+        bucket->tokens = CLASS_BURST[requestClass];
+    }
+    bucket->lastRefill = now;
+
+    if (bucket->tokens >= 1.0f) {
+        bucket->tokens -= 1.0f;
+        return 0;
+    }
+
+    // Whole seconds until the next token is due
+    return (unsigned long)((1.0f - bucket->tokens) / perMs / 1000.0f) + 1;
+}
+
+bool AdmissionControl::reject(AsyncWebServerRequest *request, int status, unsigned long retryAfter) {
+    // The verdict travels with the request; the server frees _tempObject
+    Verdict* verdict = (Verdict*)calloc(1, sizeof(Verdict));
+    if (verdict != NULL) {
+        verdict->status = status;
+        verdict->retryAfter = retryAfter;
+    }
+    request->_tempObject = verdict;
+    return true;
+}
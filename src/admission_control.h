@@ -0,0 +1,56 @@
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+enum RequestClass {
+    REQUEST_STATIC = 0,  // Pages, assets and /ws: heap check only
+    REQUEST_READ,
+    REQUEST_WRITE,
+    REQUEST_AI,          // Emergency and chat endpoints (outbound HTTPS)
+    REQUEST_CLASS_COUNT
+};
+
+// Registered as the first web handler. It claims only the requests it is
+// going to reject, answering 429 when the client's token bucket for that
+// endpoint class is empty and 503 when the heap is too low to serve it;
+// everything else falls through to the regular handlers.
+// All calls happen in the async_tcp task.
+class AdmissionControl : public AsyncWebHandler {
+public:
+    AdmissionControl();
+    virtual bool canHandle(AsyncWebServerRequest *request) override;
+    virtual void handleRequest(AsyncWebServerRequest *request) override;
+    virtual bool isRequestHandlerTrivial() override { return true; }
+    void writeJSON(JsonObject stats);
+
+private:
+    struct Bucket {
+        bool used;
+        uint32_t ip;
+        RequestClass requestClass;
+        float tokens;
+        unsigned long lastRefill;
+    };
+
+    struct Verdict {
+        int status;
+        unsigned long retryAfter;
+    };
+
+    Bucket buckets[RATE_LIMIT_MAX_BUCKETS];
+    uint32_t admitted;
+    uint32_t rateLimited;
+    uint32_t shed;
+
+    static RequestClass classify(AsyncWebServerRequest *request);
+    bool heapAvailable(RequestClass requestClass);
+    Bucket* findBucket(uint32_t ip, RequestClass requestClass, unsigned long now);
+    unsigned long takeToken(Bucket* bucket, RequestClass requestClass, unsigned long now);
+    bool reject(AsyncWebServerRequest *request, int status, unsigned long retryAfter);
+};
+
+#endif // ADMISSION_CONTROL_H
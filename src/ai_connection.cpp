@@ -0,0 +1,159 @@
+#include "ai_connection.h"
+#include "metrics.h"
+#include "logger.h"
+
+extern Metrics metrics;
+
+AIConnection::AIConnection() {
+    lock = NULL;
+    client = &secureClient;
+    lastUsed = 0;
+    connectTimeout = AI_JOB_TIMEOUT;
+    replyTimeout = AI_JOB_TIMEOUT;
+}
+
+void AIConnection::begin() {
+    lock = xSemaphoreCreateMutex();
+    // As before: the provider's certificate is not pinned
+    secureClient.setInsecure();
+    secureClient.setHandshakeTimeout(AI_HANDSHAKE_TIMEOUT);
+    http.setReuse(true);
+}
+
+void AIConnection::setTimeouts(uint32_t connectTimeout, uint16_t replyTimeout) {
+    // Called from request handlers on the async_tcp task, which must not
+    // wait out a request the worker holds the lock for
+    this->connectTimeout = connectTimeout;
+    this->replyTimeout = replyTimeout;
+}
+
+void AIConnection::update() {
+    // The worker holds the lock for a whole request; try again next pass
+    if (lock == NULL || xSemaphoreTake(lock, 0) != pdTRUE) {
+        return;
+    }
+    if (origin.length() > 0 && millis() - lastUsed > AI_CONNECTION_IDLE) {
+        LOG_DEBUG("🔌 Closing idle AI connection to %s", origin.c_str());
+        close();
+    }
+    xSemaphoreGive(lock);
+}
+
+int AIConnection::post(const String& url, const String& authorization, const String& body, String& response) {
+    return send("POST", url, authorization, body, &response, NULL);
+}
+
+int AIConnection::post(const String& url, const String& authorization, const String& body, Stream& sink) {
+    return send("POST", url, authorization, body, NULL, &sink);
+}
+
+int AIConnection::get(const String& url, const String& authorization, String& response) {
+    return send("GET", url, authorization, String(), &response, NULL);
+}
+
+int AIConnection::send(const char* method, const String& url, const String& authorization, const String& body,
+                       String* response, Stream* sink) {
+    bool secure;
+    String host;
+    uint16_t port;
+    if (!parseOrigin(url, secure, host, port)) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    String target = String(secure ? "https://" : "http://") + host + ":" + String(port);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    uint32_t connectWait = connectTimeout;
+    uint16_t replyWait = replyTimeout;
+
+    if (origin.length() > 0 && (origin != target || millis() - lastUsed > AI_CONNECTION_IDLE || !client->connected())) {
+        close();
+    }
+
+    int code = HTTPC_ERROR_CONNECTION_REFUSED;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool reused = origin.length() > 0;
+        if (!reused) {
+            if (!open(secure, host, port, connectWait)) {
+                break;
+            }
+            origin = target;
+        }
+
+        unsigned long start = micros();
+        http.begin(*client, url);
+        http.setTimeout(replyWait);
+        if (body.length() > 0) {
+            http.addHeader("Content-Type", "application/json");
+        }
+        if (authorization.length() > 0) {
+            http.addHeader("Authorization", authorization);
+        }
+        code = http.sendRequest(method, body);
+        bool answered = code > 0;
+        if (code == HTTP_CODE_OK && sink != NULL) {
+            int written = http.writeToStream(sink);
+            if (written < 0) code = written;
+        } else if (code > 0 && response != NULL) {
+            *response = http.getString();
+        }
+        http.end();
+        metrics.recordAIRequest(micros() - start, reused);
+
+        // Once answered a request is not repeated: the sink has part of it
+        if (answered || !reused) {
+            break;
+        }
+        LOG_WARN("🔌 AI connection to %s lost (%s), reconnecting", origin.c_str(), HTTPClient::errorToString(code).c_str());
+        metrics.countAIRetry();
+        close();
+    }
+
+    if (code > 0) {
+        lastUsed = millis();
+    } else {
+        close();
+    }
+    xSemaphoreGive(lock);
+    return code;
+}
+
+bool AIConnection::open(bool secure, const String& host, uint16_t port, uint32_t timeout) {
+    client = secure ? (WiFiClient*)&secureClient : &plainClient;
+    unsigned long start = micros();
+    if (!client->connect(host.c_str(), port, timeout)) {
+        LOG_WARN("🔌 AI connection to %s:%u failed", host.c_str(), port);
+        return false;
+    }
+    metrics.recordAIHandshake(micros() - start);
+    return true;
+}
+
+void AIConnection::close() {
+    client->stop();
+    origin = String();
+}
+
+bool AIConnection::parseOrigin(const String& url, bool& secure, String& host, uint16_t& port) {
+    int start;
+    if (url.startsWith("https://")) {
+        secure = true;
+        start = 8;
+    } else if (url.startsWith("http://")) {
+        secure = false;
+        start = 7;
+    } else {
+        return false;
+    }
+
+    int end = url.indexOf('/', start);
+    String authority = end < 0 ? url.substring(start) : url.substring(start, end);
+    int colon = authority.indexOf(':');
+    if (colon >= 0) {
+        host = authority.substring(0, colon);
+        port = authority.substring(colon + 1).toInt();
+    } else {
+        host = authority;
+        port = secure ? 443 : 80;
+    }
+    return host.length() > 0 && port != 0;
+}
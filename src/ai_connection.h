@@ -0,0 +1,52 @@
+#ifndef AI_CONNECTION_H
+#define AI_CONNECTION_H
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <atomic>
+#include "config.h"
+
+// One keep-alive connection to an AI provider, so only the first message of
+// a conversation pays for the handshake. post() opens it on demand and
+// reopens it when the URL's origin changes; a request that fails on a
+// reused connection (the server or a NAT dropped it) is retried once on a
+// fresh one. update() closes it after AI_CONNECTION_IDLE unused, which
+// gives the TLS buffers back to the heap. https:// URLs go over TLS,
+// http:// ones (a model server on the LAN) over plain TCP. Handshake and
+// request times go to the metrics.
+class AIConnection {
+public:
+    AIConnection();
+    void begin();
+    void update();
+    // In ms; the reply timeout applies to each wait for more of the
+    // response. Both default to AI_JOB_TIMEOUT. Never waits: a request
+    // under way keeps the ones it started with.
+    void setTimeouts(uint32_t connectTimeout, uint16_t replyTimeout);
+    // Return the HTTP status, or an HTTPC_ERROR_* code. The streaming form
+    // writes a 200 body to sink as it arrives. An empty authorization sends
+    // no Authorization header.
+    int post(const String& url, const String& authorization, const String& body, String& response);
+    int post(const String& url, const String& authorization, const String& body, Stream& sink);
+    int get(const String& url, const String& authorization, String& response);
+
+private:
+    SemaphoreHandle_t lock;
+    WiFiClientSecure secureClient;
+    WiFiClient plainClient;
+    WiFiClient* client;              // The one origin uses
+    HTTPClient http;
+    String origin;                   // Scheme, host and port the client is connected to
+    unsigned long lastUsed;
+    std::atomic<uint32_t> connectTimeout;   // Read by send() as each request starts
+    std::atomic<uint16_t> replyTimeout;
+
+    int send(const char* method, const String& url, const String& authorization, const String& body,
+             String* response, Stream* sink);
+    bool open(bool secure, const String& host, uint16_t port, uint32_t timeout);
+    void close();
+    static bool parseOrigin(const String& url, bool& secure, String& host, uint16_t& port);
+};
+
+#endif // AI_CONNECTION_H
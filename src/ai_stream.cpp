@@ -0,0 +1,78 @@
+#include "ai_stream.h"
+#include "logger.h"
+
+AIStreamParser::AIStreamParser(AIStreamCallback callback) : event(AI_STREAM_LINE_MAX * 2) {
+    this->callback = callback;
+    lineLength = 0;
+    overflow = false;
+    done = false;
+}
+
+size_t AIStreamParser::write(uint8_t c) {
+    if (addChar((char)c) && callback != NULL) {
+        callback(reply);
+    }
+    return 1;
+}
+
+size_t AIStreamParser::write(const uint8_t* buffer, size_t size) {
+    // One callback per piece however many events it held
+    bool added = false;
+    for (size_t i = 0; i < size; i++) {
+        added |= addChar((char)buffer[i]);
+    }
+    if (added && callback != NULL) {
+        callback(reply);
+    }
+    return size;
+}
+
+bool AIStreamParser::addChar(char c) {
+    if (c == '\r') {
+        return false;
+    }
+    if (c != '\n') {
+        if (lineLength < sizeof(line) - 1) {
+            line[lineLength++] = c;
+        } else {
+            overflow = true;
+        }
+        return false;
+    }
+
+    bool added = false;
+    if (overflow) {
+        LOG_WARN("🤖 Skipped a streamed event over %d bytes", AI_STREAM_LINE_MAX);
+    } else {
+        line[lineLength] = '\0';
+        added = parseLine();
+    }
+    lineLength = 0;
+    overflow = false;
+    return added;
+}
+
+bool AIStreamParser::parseLine() {
+    // Blank lines separate events; "event:", "id:" and comments carry
+    // nothing a completion needs
+    if (done || strncmp(line, "data:", 5) != 0) {
+        return false;
+    }
+    const char* data = line + 5;
+    while (*data == ' ') data++;
+
+    if (strcmp(data, "[DONE]") == 0) {
+        done = true;
+        return false;
+    }
+
+    if (deserializeJson(event, data)) {
+        return false;
+    }
+    const char* content = event["choices"][0]["delta"]["content"];
+    if (content == NULL || *content == '\0') {
+        return false;
+    }
+    reply += content;
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef AI_STREAM_H
+#define AI_STREAM_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+typedef void (*AIStreamCallback)(const String& text);
+
+// Reads a streamed chat completion ("stream": true) as HTTPClient's
+// writeToStream() hands over the body, which it has already de-chunked.
+// Each server-sent event line "data: {...}" adds its
+// choices[0].delta.content to text(), and the callback sees the text so far
+// after every piece that added some; "data: [DONE]" ends the stream. Only
+// the line being parsed is buffered, never the whole body.
+class AIStreamParser : public Stream {
+public:
+    explicit AIStreamParser(AIStreamCallback callback);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    // Nothing to read back: the parser is only ever written to
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+    const String& text() const { return reply; }
+    bool isDone() const { return done; }
+
+private:
+    AIStreamCallback callback;
+    DynamicJsonDocument event;       // Reused for every line
+    String reply;
+    char line[AI_STREAM_LINE_MAX];
+    size_t lineLength;
+    bool overflow;           // Skipping the rest of a line that did not fit
+    bool done;
+
+    bool addChar(char c);
+    bool parseLine();
+};
+
+#endif // AI_STREAM_H
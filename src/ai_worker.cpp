@@ -0,0 +1,273 @@
+#include "ai_worker.h"
+#include "logger.h"
+#include "metrics.h"
+
+extern Metrics metrics;
+
+AIWorker::AIWorker() {
+    lock = NULL;
+    queue = NULL;
+    responder = NULL;
+    outcome = NULL;
+    idleTask = NULL;
+    nextId = 1;
+    runningSlot = -1;
+    outstanding = 0;
+
+    for (int i = 0; i < AI_JOB_SLOTS; i++) {
+        jobs[i].id = 0;
+        jobs[i].status = AI_JOB_FREE;
+        jobs[i].collected = false;
+        jobs[i].progressed = false;
+        jobs[i].submittedAt = 0;
+        jobs[i].firstTextAt = 0;
+        jobs[i].finishedAt = 0;
+    }
+}
+
+void AIWorker::begin(AIResponder responder, AIOutcome outcome, AIIdleTask idleTask) {
+    this->responder = responder;
+    this->outcome = outcome;
+    this->idleTask = idleTask;
+    lock = xSemaphoreCreateMutex();
+    // Room for every slot twice, and a poke: a slot that timed out while
+    // queued is still in the queue when it is handed to the next job
+    queue = xQueueCreate(AI_JOB_SLOTS * 2 + 1, sizeof(int));
+
+    xTaskCreatePinnedToCore(taskMain, "ai_worker", AI_WORKER_STACK, this,
+                            AI_WORKER_PRIORITY, NULL, AI_WORKER_CORE);
+    LOG_INFO("🤖 AI worker ready (%d job slots)", AI_JOB_SLOTS);
+}
+
+uint32_t AIWorker::submit(const AIJobInput& input) {
+    // Called from the web server task: never waits on the worker
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    // A free slot, else the finished job that has been collected longest
+    int slot = -1;
+    for (int i = 0; i < AI_JOB_SLOTS; i++) {
+        Job& job = jobs[i];
+        if (job.status == AI_JOB_FREE) {
+            slot = i;
+            break;
+        }
+        bool finished = job.status == AI_JOB_DONE || job.status == AI_JOB_TIMED_OUT;
+        if (finished && job.collected && (slot < 0 || job.finishedAt < jobs[slot].finishedAt)) {
+            slot = i;
+        }
+    }
+
+    if (slot < 0 || xQueueSend(queue, &slot, 0) != pdPASS) {
+        xSemaphoreGive(lock);
+        return 0;
+    }
+
+    outstanding++;
+    Job& job = jobs[slot];
+    job.id = nextId++;
+    if (nextId == 0) nextId = 1;
+    job.status = AI_JOB_QUEUED;
+    job.collected = false;
+    job.progressed = false;
+    job.submittedAt = millis();
+    job.firstTextAt = 0;
+    job.finishedAt = 0;
+    job.input = input;
+    job.partial = String();
+    job.reply = String();
+    uint32_t id = job.id;
+
+    xSemaphoreGive(lock);
+    return id;
+}
+
+bool AIWorker::poke() {
+    int poke = -1;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool queued = idleTask != NULL && xQueueSend(queue, &poke, 0) == pdPASS;
+    if (queued) outstanding++;
+    xSemaphoreGive(lock);
+    return queued;
+}
+
+bool AIWorker::isIdle() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool idle = outstanding == 0;
+    xSemaphoreGive(lock);
+    return idle;
+}
+
+void AIWorker::update() {
+    unsigned long now = millis();
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (int i = 0; i < AI_JOB_SLOTS; i++) {
+        Job& job = jobs[i];
+
+        if ((job.status == AI_JOB_QUEUED || job.status == AI_JOB_RUNNING) &&
+            now - job.submittedAt > AI_JOB_TIMEOUT) {
+            // A late reply from the worker is dropped; it checks the status
+            LOG_WARN("⏱️ AI job %u timed out while %s", job.id, statusName(job.status));
+            job.status = AI_JOB_TIMED_OUT;
+            job.finishedAt = now;
+            if (outcome != NULL) {
+                outcome(job.input, NULL);
+            }
+        } else if ((job.status == AI_JOB_DONE || job.status == AI_JOB_TIMED_OUT) &&
+                   job.collected && now - job.finishedAt > AI_JOB_KEEP) {
+            job.status = AI_JOB_FREE;
+            job.input = AIJobInput();
+            job.partial = String();
+            job.reply = String();
+        }
+    }
+    xSemaphoreGive(lock);
+}
+
+bool AIWorker::takeFinished(uint32_t& id) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (int i = 0; i < AI_JOB_SLOTS; i++) {
+        Job& job = jobs[i];
+        if ((job.status == AI_JOB_DONE || job.status == AI_JOB_TIMED_OUT) && !job.collected) {
+            job.collected = true;
+            id = job.id;
+            xSemaphoreGive(lock);
+            return true;
+        }
+    }
+    xSemaphoreGive(lock);
+    return false;
+}
+
+void AIWorker::reportProgress(const String& partial) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (runningSlot >= 0 && jobs[runningSlot].status == AI_JOB_RUNNING) {
+        Job& job = jobs[runningSlot];
+        if (job.firstTextAt == 0) {
+            job.firstTextAt = millis();
+            metrics.recordAIFirstText((job.firstTextAt - job.submittedAt) * 1000UL);
+        }
+        job.partial = partial;
+        job.progressed = true;
+    }
+    xSemaphoreGive(lock);
+}
+
+bool AIWorker::takeProgress(uint32_t& id, String& partial) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (int i = 0; i < AI_JOB_SLOTS; i++) {
+        Job& job = jobs[i];
+        if (job.status == AI_JOB_RUNNING && job.progressed) {
+            job.progressed = false;
+            id = job.id;
+            partial = job.partial;
+            xSemaphoreGive(lock);
+            return true;
+        }
+    }
+    xSemaphoreGive(lock);
+    return false;
+}
+
+bool AIWorker::writeJSON(uint32_t id, JsonDocument& doc) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    Job* job = findJob(id);
+    if (job == NULL) {
+        xSemaphoreGive(lock);
+        return false;
+    }
+
+    doc["jobId"] = job->id;
+    doc["status"] = statusName(job->status);
+    doc["sessionId"] = String(job->input.session, HEX);
+    doc["messageCount"] = job->input.messageCount;
+    doc["trigger"] = job->input.trigger;
+    doc["intent"] = IntentClassifier::intentName(job->input.intent);
+    if (job->status == AI_JOB_DONE) {
+        doc["message"] = job->reply;
+    } else if (job->status == AI_JOB_RUNNING && job->partial.length() > 0) {
+        doc["partial"] = job->partial;
+    }
+    if (job->firstTextAt != 0) {
+        doc["firstTextMs"] = job->firstTextAt - job->submittedAt;
+    }
+    xSemaphoreGive(lock);
+    return true;
+}
+
+void AIWorker::taskMain(void* parameter) {
+    static_cast<AIWorker*>(parameter)->run();
+}
+
+void AIWorker::run() {
+    for (;;) {
+        int slot;
+        if (xQueueReceive(queue, &slot, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (slot < 0) {
+            idleTask();
+            xSemaphoreTake(lock, portMAX_DELAY);
+            outstanding--;
+            xSemaphoreGive(lock);
+            continue;
+        }
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        Job& job = jobs[slot];
+        if (job.status != AI_JOB_QUEUED) {
+            // Timed out before its turn
+            outstanding--;
+            xSemaphoreGive(lock);
+            continue;
+        }
+        job.status = AI_JOB_RUNNING;
+        runningSlot = slot;
+        uint32_t id = job.id;
+        AIJobInput input = job.input;
+        xSemaphoreGive(lock);
+
+        unsigned long start = millis();
+        String reply = responder(input);
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        if (job.id == id && job.status == AI_JOB_RUNNING) {
+            job.status = AI_JOB_DONE;
+            job.finishedAt = millis();
+            job.partial = String();
+            job.reply = reply;
+            if (outcome != NULL) {
+                outcome(job.input, &job.reply);
+            }
+        }
+        runningSlot = -1;
+        outstanding--;
+        xSemaphoreGive(lock);
+
+        LOG_DEBUG("🤖 AI job %u answered in %lu ms", id, millis() - start);
+    }
+}
+
+AIWorker::Job* AIWorker::findJob(uint32_t id) {
+    for (int i = 0; i < AI_JOB_SLOTS; i++) {
+        if (jobs[i].status != AI_JOB_FREE && jobs[i].id == id) {
+            return &jobs[i];
+        }
+    }
+    return NULL;
+}
+
+const char* AIWorker::statusName(AIJobStatus status) {
+    switch (status) {
+        case AI_JOB_QUEUED:
+            return "queued";
+        case AI_JOB_RUNNING:
+            return "running";
+        case AI_JOB_DONE:
+            return "done";
+        case AI_JOB_TIMED_OUT:
+            return "timeout";
+        default:
+            return "free";
+    }
+}
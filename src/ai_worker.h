@@ -0,0 +1,95 @@
+#ifndef AI_WORKER_H
+#define AI_WORKER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "intent_classifier.h"
+
+enum AIJobStatus {
+    AI_JOB_FREE = 0,
+    AI_JOB_QUEUED,
+    AI_JOB_RUNNING,
+    AI_JOB_DONE,
+    AI_JOB_TIMED_OUT
+};
+
+// Everything a reply depends on, copied when the job is submitted so the
+// worker never reads the session or settings that handlers change
+struct AIJobInput {
+    String message;
+    String trigger;
+    MessageIntent intent;        // What the message asks for
+    String personality;
+    String provider;
+    int messageCount;
+    uint32_t session;            // The emergency session's ID
+    uint32_t turn;               // The message's place in its conversation
+};
+
+typedef String (*AIResponder)(const AIJobInput& input);
+// Called under the worker's lock once a job's fate is settled: with the
+// reply when the job is done, NULL when it timed out and nobody sees one
+typedef void (*AIOutcome)(const AIJobInput& input, const String* reply);
+typedef void (*AIIdleTask)();
+
+// Produces AI replies on a task of its own, so a TLS round trip to the
+// provider holds up neither the web server nor loop(). submit() hands back a
+// job ID at once; finished jobs are collected from loop() with
+// takeFinished() and can be polled with writeJSON() until AI_JOB_KEEP runs
+// out. Jobs live in AI_JOB_SLOTS fixed slots, so a full table turns new ones
+// away, and one not answered within AI_JOB_TIMEOUT is failed. A responder
+// that streams calls reportProgress() with the reply so far; loop() picks
+// it up with takeProgress(), at most once per pass however fast it grows.
+// poke() has the worker run the idle task after the jobs already queued,
+// for upkeep that must not hold up loop() either, like provider health
+// checks.
+class AIWorker {
+public:
+    AIWorker();
+    void begin(AIResponder responder, AIOutcome outcome, AIIdleTask idleTask = NULL);
+    void update();
+    // Returns 0 when every slot is taken
+    uint32_t submit(const AIJobInput& input);
+    // Returns false when it could not be queued; callers keep at most one
+    // outstanding
+    bool poke();
+    // Nothing queued or in hand
+    bool isIdle();
+    bool takeFinished(uint32_t& id);
+    // From the responder, on the worker task
+    void reportProgress(const String& partial);
+    bool takeProgress(uint32_t& id, String& partial);
+    bool writeJSON(uint32_t id, JsonDocument& doc);
+
+private:
+    struct Job {
+        uint32_t id;
+        AIJobStatus status;
+        bool collected;          // takeFinished() has handed it out
+        bool progressed;         // partial changed since takeProgress()
+        unsigned long submittedAt;
+        unsigned long firstTextAt;
+        unsigned long finishedAt;
+        AIJobInput input;
+        String partial;
+        String reply;
+    };
+
+    SemaphoreHandle_t lock;
+    QueueHandle_t queue;         // Slot indices, oldest first; -1 for a poke
+    AIResponder responder;
+    AIOutcome outcome;
+    AIIdleTask idleTask;
+    Job jobs[AI_JOB_SLOTS];
+    int runningSlot;             // -1 while the worker is idle
+    int outstanding;             // Jobs and pokes queued or in hand
+    uint32_t nextId;
+
+    static void taskMain(void* parameter);
+    void run();
+    Job* findJob(uint32_t id);
+    static const char* statusName(AIJobStatus status);
+};
+
+#endif // AI_WORKER_H
@@ -0,0 +1,55 @@
+#include "boot_timeline.h"
+#include "logger.h"
+
+BootTimeline::BootTimeline() {
+    entryCount = 0;
+}
+
+void BootTimeline::mark(const char* phase) {
+    // Ends the phase that started at the previous mark (or at reset)
+    if (entryCount >= BOOT_MAX_PHASES) return;
+
+    entries[entryCount].name = phase;
+    entries[entryCount].at = esp_timer_get_time();
+    entries[entryCount].milestone = false;
+    entryCount++;
+}
+
+void BootTimeline::milestone(const char* name) {
+    // Only the first occurrence counts; later reconnects are not boot
+    for (int i = 0; i < entryCount; i++) {
+        if (entries[i].milestone && strcmp(entries[i].name, name) == 0) return;
+    }
+
+    if (entryCount >= BOOT_MAX_PHASES) return;
+
+    entries[entryCount].name = name;
+    entries[entryCount].at = esp_timer_get_time();
+    entries[entryCount].milestone = true;
+    entryCount++;
+
+    LOG_INFO("⏱️ Boot milestone '%s' reached at %lu ms", name, (unsigned long)(entries[entryCount - 1].at / 1000));
+}
+
+void BootTimeline::writeJSON(JsonDocument& doc) {
+    JsonArray phases = doc.createNestedArray("phases");
+    JsonArray milestones = doc.createNestedArray("milestones");
+
+    int64_t previous = 0;
+    for (int i = 0; i < entryCount; i++) {
+        if (entries[i].milestone) {
+            JsonObject entry = milestones.createNestedObject();
+            entry["name"] = entries[i].name;
+            entry["atUs"] = entries[i].at;
+        } else {
+            JsonObject entry = phases.createNestedObject();
+            entry["name"] = entries[i].name;
+            entry["startUs"] = previous;
+            entry["durationUs"] = entries[i].at - previous;
+            previous = entries[i].at;
+        }
+    }
+
+    // The last setup() phase ends when the box is ready
+    doc["readyUs"] = previous;
+}
@@ -0,0 +1,29 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include "config.h"
+
+// Records how long each step of setup() took, plus milestones reached in
+// the background afterwards (Wi-Fi, NTP). Served by /api/dev/boot.
+class BootTimeline {
+public:
+    BootTimeline();
+    void mark(const char* phase);
+    void milestone(const char* name);
+    void writeJSON(JsonDocument& doc);
+
+private:
+    struct Entry {
+        const char* name;
+        int64_t at;          // Microseconds since boot; micros() wraps after ~71 minutes
+        bool milestone;
+    };
+
+    Entry entries[BOOT_MAX_PHASES];
+    int entryCount;
+};
+
+#endif // BOOT_TIMELINE_H
@@ -1,4 +1,6 @@
 #include "button.h"
+#include "logger.h"
+#include "input_trace.h"
 #include "config.h"
 
 Button::Button() {
@@ -11,7 +13,7 @@ Button::Button() {
 
 void Button::begin() {
     pinMode(buttonPin, INPUT_PULLUP);
-    Serial.printf("🔘 Button initialized on pin %d\n", buttonPin);
+    LOG_INFO("🔘 Button initialized on pin %d", buttonPin);
 }
 
 void Button::update() {
@@ -19,6 +21,7 @@ void Button::update() {
     
     if (reading != lastReading) {
         lastDebounceTime = millis();
+        inputTrace.recordButton(reading);
     }
     
     if ((millis() - lastDebounceTime) > BUTTON_DEBOUNCE_DELAY) {
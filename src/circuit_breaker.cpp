@@ -0,0 +1,115 @@
+#include "circuit_breaker.h"
+#include "logger.h"
+
+CircuitBreaker::CircuitBreaker(const char* name) {
+    lock = NULL;
+    this->name = name;
+    state = BREAKER_CLOSED;
+    outcomes = 0;
+    calls = 0;
+    openedAt = 0;
+    coolDownMs = AI_BREAKER_OPEN_MS;
+    lastLatencyMs = 0;
+    trips = 0;
+    refused = 0;
+}
+
+void CircuitBreaker::begin() {
+    lock = xSemaphoreCreateMutex();
+}
+
+bool CircuitBreaker::allow() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool allowed = state == BREAKER_CLOSED;
+    if (state == BREAKER_OPEN && millis() - openedAt >= coolDownMs) {
+        // The probe; the rest wait for its outcome
+        state = BREAKER_HALF_OPEN;
+        allowed = true;
+        LOG_INFO("🔌 %s breaker half-open, probing", name);
+    }
+    if (!allowed) refused++;
+    xSemaphoreGive(lock);
+    return allowed;
+}
+
+void CircuitBreaker::record(bool succeeded, uint32_t latencyMs) {
+    bool failed = !succeeded || latencyMs > AI_BREAKER_SLOW_MS;
+    unsigned long now = millis();
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    lastLatencyMs = latencyMs;
+    if (state == BREAKER_HALF_OPEN) {
+        if (failed) {
+            coolDownMs = min((uint32_t)AI_BREAKER_OPEN_MAX_MS, coolDownMs * 2);
+            open(now);
+            LOG_WARN("🔌 %s probe failed; breaker open for %lu s", name, (unsigned long)(coolDownMs / 1000));
+        } else {
+            LOG_INFO("🔌 %s breaker closed", name);
+            state = BREAKER_CLOSED;
+            outcomes = 0;
+            calls = 0;
+            coolDownMs = AI_BREAKER_OPEN_MS;
+        }
+    } else if (state == BREAKER_CLOSED) {
+        outcomes = (outcomes << 1) | (failed ? 1 : 0);
+        if (calls < AI_BREAKER_WINDOW) calls++;
+        uint16_t streak = (1 << AI_BREAKER_CONSECUTIVE) - 1;
+        if ((outcomes & streak) == streak ||
+            (calls >= AI_BREAKER_MIN_CALLS && failures() * 100 >= AI_BREAKER_FAILURE_PERCENT * calls)) {
+            open(now);
+            LOG_WARN("🔌 %s breaker open for %lu s (%d of the last %d calls failed)",
+                     name, (unsigned long)(coolDownMs / 1000), failures(), calls);
+        }
+    }
+    // A call that was let through before the breaker opened changes nothing
+    xSemaphoreGive(lock);
+}
+
+void CircuitBreaker::reset() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    state = BREAKER_CLOSED;
+    outcomes = 0;
+    calls = 0;
+    coolDownMs = AI_BREAKER_OPEN_MS;
+    xSemaphoreGive(lock);
+}
+
+void CircuitBreaker::writeJSON(JsonObject target) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    target["state"] = stateName(state);
+    target["calls"] = calls;
+    target["failures"] = failures();
+    target["latencyMs"] = lastLatencyMs;
+    if (state == BREAKER_OPEN) {
+        unsigned long openFor = millis() - openedAt;
+        target["retryIn"] = openFor >= coolDownMs ? 0 : (coolDownMs - openFor + 999) / 1000;
+    }
+    target["trips"] = trips;
+    target["refused"] = refused;
+    xSemaphoreGive(lock);
+}
+
+int CircuitBreaker::failures() const {
+    int count = 0;
+    for (int i = 0; i < calls; i++) {
+        if (outcomes & (1 << i)) count++;
+    }
+    return count;
+}
+
+void CircuitBreaker::open(unsigned long now) {
+    state = BREAKER_OPEN;
+    openedAt = now;
+    trips++;
+}
+
+const char* CircuitBreaker::stateName(BreakerState state) {
+    switch (state) {
+        case BREAKER_OPEN:
+            return "open";
+        case BREAKER_HALF_OPEN:
+            return "half-open";
+        default:
+            return "closed";
+    }
+}
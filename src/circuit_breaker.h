@@ -0,0 +1,52 @@
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+enum BreakerState : uint8_t {
+    BREAKER_CLOSED = 0,          // Calls go through
+    BREAKER_OPEN,                // Calls are refused until the cool-down ends
+    BREAKER_HALF_OPEN            // One probe call is out; its outcome decides
+};
+
+// Keeps the AI worker from waiting on a provider that is failing. The
+// outcomes of the last AI_BREAKER_WINDOW calls are kept, a call that took
+// longer than AI_BREAKER_SLOW_MS counting as failed. When the last
+// AI_BREAKER_CONSECUTIVE calls failed, or at least AI_BREAKER_MIN_CALLS are
+// in and AI_BREAKER_FAILURE_PERCENT of them failed, the breaker opens and
+// allow() turns calls away at once. After the cool-down, AI_BREAKER_OPEN_MS
+// at first and doubling up to AI_BREAKER_OPEN_MAX_MS while probes keep
+// failing, one call is let through as a probe: it closes the breaker if it
+// succeeds. Any task may call in.
+class CircuitBreaker {
+public:
+    explicit CircuitBreaker(const char* name);
+    void begin();
+    // Whether to make the call; every call allowed must be recorded
+    bool allow();
+    void record(bool succeeded, uint32_t latencyMs);
+    // Closes the breaker, for when the provider's settings change
+    void reset();
+
+    void writeJSON(JsonObject target);
+
+private:
+    SemaphoreHandle_t lock;
+    const char* name;
+    BreakerState state;
+    uint16_t outcomes;           // Bit per call, newest lowest, set when it failed
+    uint8_t calls;               // In outcomes, at most AI_BREAKER_WINDOW
+    unsigned long openedAt;
+    uint32_t coolDownMs;
+    uint32_t lastLatencyMs;
+    uint32_t trips;
+    uint32_t refused;
+
+    int failures() const;
+    void open(unsigned long now);
+    static const char* stateName(BreakerState state);
+};
+
+#endif // CIRCUIT_BREAKER_H
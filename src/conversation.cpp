@@ -0,0 +1,178 @@
+#include "conversation.h"
+#include "logger.h"
+
+// Starts the summary message; lines follow oldest first
+static const char SUMMARY_HEADER[] = "Summary of the earlier conversation:\n";
+static const size_t SUMMARY_START = sizeof(SUMMARY_HEADER) - 1;
+
+Conversation::Conversation() {
+    lock = NULL;
+    nextSequence = 1;
+    used = 0;
+    count = 0;
+    memcpy(summary, SUMMARY_HEADER, SUMMARY_START + 1);
+    summaryLength = SUMMARY_START;
+}
+
+void Conversation::begin() {
+    lock = xSemaphoreCreateMutex();
+}
+
+void Conversation::clear() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    used = 0;
+    count = 0;
+    summary[SUMMARY_START] = '\0';
+    summaryLength = SUMMARY_START;
+    xSemaphoreGive(lock);
+}
+
+uint32_t Conversation::add(ConversationRole role, const String& message) {
+    // One message may fill at most half the history
+    size_t length = clip(message.c_str(), message.length(), AI_HISTORY_BYTES / 2 - 1);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    while (count > 0 && (count == AI_HISTORY_TURNS || used + length + 1 > AI_HISTORY_BYTES)) {
+        evictOldest();
+    }
+
+    Turn& turn = turns[count++];
+    turn.offset = used;
+    turn.length = length;
+    turn.sequence = nextSequence++;
+    turn.role = role;
+    memcpy(text + used, message.c_str(), length);
+    text[used + length] = '\0';
+    used += length + 1;
+
+    uint32_t sequence = turn.sequence;
+    xSemaphoreGive(lock);
+    return sequence;
+}
+
+void Conversation::remove(uint32_t sequence) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (int i = 0; i < count; i++) {
+        if (turns[i].sequence != sequence) continue;
+
+        // Later messages may have been added since
+        size_t size = turns[i].length + 1;
+        size_t end = turns[i].offset + size;
+        memmove(text + turns[i].offset, text + end, used - end);
+        used -= size;
+        for (int j = i + 1; j < count; j++) {
+            turns[j - 1] = turns[j];
+            turns[j - 1].offset -= size;
+        }
+        count--;
+        break;
+    }
+    xSemaphoreGive(lock);
+}
+
+void Conversation::serialize(JsonDocument& doc, JsonArray messages, uint32_t sequence, String& body) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    if (summaryLength > SUMMARY_START) {
+        JsonObject earlier = messages.createNestedObject();
+        earlier["role"] = "system";
+        earlier["content"] = (const char*)summary;
+    }
+    for (int i = 0; i < count && turns[i].sequence <= sequence; i++) {
+        JsonObject message = messages.createNestedObject();
+        message["role"] = turns[i].role == CONVERSATION_USER ? "user" : "assistant";
+        message["content"] = (const char*)(text + turns[i].offset);
+    }
+    if (doc.overflowed()) {
+        LOG_WARN("🤖 AI request document full; conversation cut short");
+    }
+
+    // Sized once, so the body is never copied while it grows
+    body = String();
+    body.reserve(measureJson(doc) + 1);
+    serializeJson(doc, body);
+    doc.clear();
+
+    xSemaphoreGive(lock);
+}
+
+uint64_t Conversation::contextHash(uint32_t sequence) {
+    // FNV-1a; each message ends with its NUL and is preceded by its role
+    uint64_t hash = 14695981039346656037ULL;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (size_t i = SUMMARY_START; i < summaryLength; i++) {
+        hash = (hash ^ (uint8_t)summary[i]) * 1099511628211ULL;
+    }
+    for (int i = 0; i < count && turns[i].sequence < sequence; i++) {
+        hash = (hash ^ turns[i].role) * 1099511628211ULL;
+        const char* message = text + turns[i].offset;
+        for (size_t j = 0; j <= turns[i].length; j++) {
+            hash = (hash ^ (uint8_t)message[j]) * 1099511628211ULL;
+        }
+    }
+    xSemaphoreGive(lock);
+    return hash;
+}
+
+void Conversation::evictOldest() {
+    const Turn& oldest = turns[0];
+    summarize(oldest);
+
+    size_t size = oldest.length + 1;
+    memmove(text, text + size, used - size);
+    used -= size;
+    for (int i = 1; i < count; i++) {
+        turns[i - 1] = turns[i];
+        turns[i - 1].offset -= size;
+    }
+    count--;
+}
+
+void Conversation::summarize(const Turn& turn) {
+    const char* source = text + turn.offset;
+    size_t length = turn.length;
+    while (length > 0 && isspace((unsigned char)*source)) {
+        source++;
+        length--;
+    }
+
+    // The first sentence, punctuation included
+    size_t sentence = 0;
+    while (sentence < length && strchr(".!?\n", source[sentence]) == NULL) {
+        sentence++;
+    }
+    if (sentence < length && source[sentence] != '\n') {
+        sentence++;
+    }
+
+    const char* prefix = turn.role == CONVERSATION_USER ? "User: " : "Counselor: ";
+    size_t prefixLength = strlen(prefix);
+    sentence = clip(source, sentence, AI_SUMMARY_LINE - prefixLength - 1);
+    size_t line = prefixLength + sentence + 1;
+
+    // Oldest lines go first
+    while (summaryLength + line > AI_SUMMARY_BYTES - 1 && summaryLength > SUMMARY_START) {
+        char* start = summary + SUMMARY_START;
+        char* newline = (char*)memchr(start, '\n', summaryLength - SUMMARY_START);
+        size_t drop = newline != NULL ? newline - start + 1 : summaryLength - SUMMARY_START;
+        memmove(start, start + drop, summaryLength - SUMMARY_START - drop);
+        summaryLength -= drop;
+    }
+
+    memcpy(summary + summaryLength, prefix, prefixLength);
+    memcpy(summary + summaryLength + prefixLength, source, sentence);
+    summaryLength += line;
+    summary[summaryLength - 1] = '\n';
+    summary[summaryLength] = '\0';
+}
+
+size_t Conversation::clip(const char* text, size_t length, size_t limit) {
+    if (length <= limit) {
+        return length;
+    }
+    // Never split a UTF-8 sequence
+    while (limit > 0 && ((uint8_t)text[limit] & 0xC0) == 0x80) {
+        limit--;
+    }
+    return limit;
+}
@@ -0,0 +1,62 @@
+#ifndef CONVERSATION_H
+#define CONVERSATION_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+enum ConversationRole : uint8_t {
+    CONVERSATION_USER = 0,
+    CONVERSATION_COUNSELOR
+};
+
+// Transcript of the emergency session, in fixed memory: the newest
+// messages are kept verbatim in AI_HISTORY_BYTES (at most AI_HISTORY_TURNS
+// of them), and each one pushed out is compacted into a line of a running
+// summary, its first sentence, which in turn drops its oldest lines to
+// stay within AI_SUMMARY_BYTES. Messages carry increasing sequence numbers
+// so a reply is built from the transcript as it stood when its message
+// was sent, even if more arrived since. Any task may call in.
+class Conversation {
+public:
+    Conversation();
+    void begin();
+    void clear();
+    // Returns the message's sequence number
+    uint32_t add(ConversationRole role, const String& text);
+    // Takes back a message that was never answered, unless it has already
+    // been compacted into the summary
+    void remove(uint32_t sequence);
+
+    // Appends the summary (as a system message) and the messages up to and
+    // including sequence to messages, then serializes doc into body. The
+    // messages are referenced, not copied, so this happens under the lock
+    // and doc is cleared before returning.
+    void serialize(JsonDocument& doc, JsonArray messages, uint32_t sequence, String& body);
+    // Hash of the summary and the messages before sequence: equal for two
+    // conversations that went the same way up to that message
+    uint64_t contextHash(uint32_t sequence);
+
+private:
+    struct Turn {
+        uint16_t offset;         // Into text; turns are NUL-terminated
+        uint16_t length;
+        uint32_t sequence;
+        ConversationRole role;
+    };
+
+    SemaphoreHandle_t lock;
+    char text[AI_HISTORY_BYTES];
+    uint16_t used;
+    Turn turns[AI_HISTORY_TURNS];
+    int count;
+    char summary[AI_SUMMARY_BYTES];  // A fixed header, then one line per compacted message
+    uint16_t summaryLength;
+    uint32_t nextSequence;
+
+    void evictOldest();
+    void summarize(const Turn& turn);
+    static size_t clip(const char* text, size_t length, size_t limit);
+};
+
+#endif // CONVERSATION_H
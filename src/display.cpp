@@ -1,6 +1,6 @@
 #include "display.h"
 #include "config.h"
-#include <Preferences.h>
+#include "metered_preferences.h"
 
 Display::Display() : display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET), 
                      messageEndTime(0), showingMessage(false) {
@@ -14,7 +14,7 @@ bool Display::begin() {
     display.clearDisplay();
     display.setTextSize(1);
     display.setTextColor(SSD1306_WHITE);
-    display.display();
+    flush();
     
     return true;
 }
@@ -31,7 +31,7 @@ void Display::showWelcome() {
     drawCenteredText("TIMER BOX", 45);
     drawCenteredText("Starting...", 55);
     
-    display.display();
+    flush();
 }
 
 void Display::showCountdown(unsigned long secondsRemaining) {
@@ -43,7 +43,7 @@ void Display::showCountdown(unsigned long secondsRemaining) {
     display.clearDisplay();
     
     // Check if we're in a scheduled mode (we need to include this from main)
-    extern Preferences preferences;
+    extern MeteredPreferences preferences;
     
     TimerMode currentMode = (TimerMode)preferences.getInt(KEY_TIMER_MODE, FIXED_INTERVAL);
     
@@ -99,7 +99,7 @@ void Display::showCountdown(unsigned long secondsRemaining) {
         drawCenteredText("Time until unlock", 55);
     }
     
-    display.display();
+    flush();
 }
 
 void Display::showUnlocked() {
@@ -120,7 +120,7 @@ void Display::showUnlocked() {
     display.setTextSize(1);
     drawCenteredText("Box is ready", 55);
     
-    display.display();
+    flush();
 }
 
 void Display::showSetup(bool wifiConnected) {
@@ -139,7 +139,7 @@ void Display::showSetup(bool wifiConnected) {
         drawCenteredText("Please wait...", 35);
     }
     
-    display.display();
+    flush();
 }
 
 void Display::showStatus(const char* message) {
@@ -151,7 +151,7 @@ void Display::showStatus(const char* message) {
     display.setTextSize(1);
     drawCenteredText(message, 30);
     
-    display.display();
+    flush();
 }
 
 void Display::showMessage(const char* message, unsigned long duration) {
@@ -188,7 +188,7 @@ void Display::showMessage(const char* message, unsigned long duration) {
         if (y > 55) break; // Don't overflow display
     }
     
-    display.display();
+    flush();
     
     if (duration > 0) {
         showingMessage = true;
@@ -198,7 +198,7 @@ void Display::showMessage(const char* message, unsigned long duration) {
 
 void Display::clear() {
     display.clearDisplay();
-    display.display();
+    flush();
 }
 
 void Display::update() {
@@ -207,7 +207,7 @@ void Display::update() {
         showingMessage = false;
         // Force a redraw by clearing
         display.clearDisplay();
-        display.display();
+        flush();
     }
 }
 
@@ -242,12 +242,18 @@ String Display::formatTime(unsigned long seconds) {
     unsigned long minutes = (seconds % 3600) / 60;
     unsigned long secs = seconds % 60;
     
-    char buffer[10];
+    char buffer[16]; // Up to 1193046:59:59 with a 32-bit unsigned long
     if (hours > 0) {
-        sprintf(buffer, "%02lu:%02lu:%02lu", hours, minutes, secs);
+        snprintf(buffer, sizeof(buffer), "%02lu:%02lu:%02lu", hours, minutes, secs);
     } else {
-        sprintf(buffer, "%02lu:%02lu", minutes, secs);
+        snprintf(buffer, sizeof(buffer), "%02lu:%02lu", minutes, secs);
     }
     
     return String(buffer);
-}
\ No newline at end of file
+}
+void Display::flush() {
+    // Pushes the frame buffer over I2C; the slowest part of every redraw
+    unsigned long start = micros();
+    display.display();
+    metrics.recordI2CFlush(micros() - start);
+}
@@ -24,6 +24,7 @@ private:
     unsigned long messageEndTime;
     bool showingMessage;
     
+    void flush();
     void drawCenteredText(const char* text, int y, int textSize = 1);
     void drawProgressBar(int percentage, int y);
     String formatTime(unsigned long seconds);
@@ -0,0 +1,244 @@
+#include "emergency_sessions.h"
+#include "logger.h"
+
+EmergencySessions::EmergencySessions() {
+    lock = NULL;
+    nextDeadline = 0;
+    active = 0;
+
+    for (int i = 0; i < AI_SESSION_SLOTS; i++) {
+        memset(&sessions[i], 0, sizeof(sessions[i]));
+    }
+}
+
+void EmergencySessions::begin() {
+    lock = xSemaphoreCreateMutex();
+    for (int i = 0; i < AI_SESSION_SLOTS; i++) {
+        transcripts[i].begin();
+    }
+}
+
+void EmergencySessions::update() {
+    uint32_t now = millis();
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (active > 0 && (int32_t)(now - nextDeadline) >= 0) {
+        sweep(now);
+    }
+    xSemaphoreGive(lock);
+}
+
+uint32_t EmergencySessions::start(const String& trigger) {
+    uint32_t now = millis();
+    xSemaphoreTake(lock, portMAX_DELAY);
+    sweep(now);
+
+    // A free slot, else the session that has been quiet the longest
+    int slot = -1;
+    for (int i = 0; i < AI_SESSION_SLOTS; i++) {
+        if (sessions[i].id == 0) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 || now - sessions[i].usedAt > now - sessions[slot].usedAt) {
+            slot = i;
+        }
+    }
+    if (sessions[slot].id != 0) {
+        LOG_WARN("🚨 Every session slot is taken; ending session %lx", (unsigned long)sessions[slot].id);
+        release(slot);
+    }
+
+    // Random, so another phone cannot guess its way into a session
+    uint32_t id;
+    do {
+        id = (uint32_t)random(1, 0x7FFFFFFF);
+    } while (find(id) >= 0);
+
+    EmergencySession& session = sessions[slot];
+    memset(&session, 0, sizeof(session));
+    session.id = id;
+    session.startedAt = now;
+    session.deadline = now + AI_MAX_SESSION_TIME * 1000UL;
+    session.usedAt = now;
+    snprintf(session.trigger, sizeof(session.trigger), "%s", trigger.c_str());
+    // Every session lasts as long, so the first deadline only changes
+    // when the table was empty
+    if (active == 0) {
+        nextDeadline = session.deadline;
+    }
+    active++;
+    xSemaphoreGive(lock);
+    return id;
+}
+
+void EmergencySessions::end(uint32_t id) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = find(id);
+    if (slot >= 0) {
+        release(slot);
+    }
+    xSemaphoreGive(lock);
+}
+
+bool EmergencySessions::get(uint32_t id, EmergencySession& session) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = find(id);
+    if (slot >= 0) {
+        session = sessions[slot];
+    }
+    xSemaphoreGive(lock);
+    return slot >= 0;
+}
+
+bool EmergencySessions::newest(EmergencySession& session) {
+    uint32_t now = millis();
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int found = -1;
+    for (int i = 0; i < AI_SESSION_SLOTS; i++) {
+        if (sessions[i].id == 0 || (int32_t)(now - sessions[i].deadline) >= 0) continue;
+        if (found < 0 || now - sessions[i].startedAt < now - sessions[found].startedAt) {
+            found = i;
+        }
+    }
+    if (found >= 0) {
+        session = sessions[found];
+    }
+    xSemaphoreGive(lock);
+    return found >= 0;
+}
+
+int EmergencySessions::count() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int live = 0;
+    for (int i = 0; i < AI_SESSION_SLOTS; i++) {
+        if (sessions[i].id != 0 && (int32_t)(millis() - sessions[i].deadline) < 0) {
+            live++;
+        }
+    }
+    xSemaphoreGive(lock);
+    return live;
+}
+
+uint32_t EmergencySessions::addMessage(uint32_t id, ConversationRole role, const String& text) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = find(id);
+    uint32_t sequence = slot >= 0 ? transcripts[slot].add(role, text) : 0;
+    xSemaphoreGive(lock);
+    return sequence;
+}
+
+void EmergencySessions::removeMessage(uint32_t id, uint32_t sequence) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = find(id);
+    if (slot >= 0) {
+        transcripts[slot].remove(sequence);
+    }
+    xSemaphoreGive(lock);
+}
+
+bool EmergencySessions::serialize(uint32_t id, JsonDocument& doc, JsonArray messages, uint32_t sequence, String& body) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = find(id);
+    if (slot >= 0) {
+        transcripts[slot].serialize(doc, messages, sequence, body);
+    }
+    xSemaphoreGive(lock);
+    return slot >= 0;
+}
+
+bool EmergencySessions::contextHash(uint32_t id, uint32_t sequence, uint64_t& hash) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = find(id);
+    if (slot >= 0) {
+        hash = transcripts[slot].contextHash(sequence);
+    }
+    xSemaphoreGive(lock);
+    return slot >= 0;
+}
+
+bool EmergencySessions::setTrigger(uint32_t id, const char* trigger) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = find(id);
+    if (slot >= 0) {
+        snprintf(sessions[slot].trigger, sizeof(sessions[slot].trigger), "%s", trigger);
+    }
+    xSemaphoreGive(lock);
+    return slot >= 0;
+}
+
+bool EmergencySessions::countMessage(uint32_t id) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = find(id);
+    if (slot >= 0) {
+        sessions[slot].messageCount++;
+        sessions[slot].usedAt = millis();
+    }
+    xSemaphoreGive(lock);
+    return slot >= 0;
+}
+
+bool EmergencySessions::startReflection(uint32_t id) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = find(id);
+    if (slot >= 0) {
+        sessions[slot].reflection = REFLECTION_ASKING;
+        sessions[slot].reflectionQuestion = 0;
+        sessions[slot].reflectionStartedAt = millis();
+    }
+    xSemaphoreGive(lock);
+    return slot >= 0;
+}
+
+bool EmergencySessions::answerReflection(uint32_t id) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = find(id);
+    if (slot >= 0 && sessions[slot].reflectionQuestion < CATALOG_QUESTIONS) {
+        sessions[slot].reflectionQuestion++;
+    }
+    xSemaphoreGive(lock);
+    return slot >= 0;
+}
+
+bool EmergencySessions::finishReflection(uint32_t id) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = find(id);
+    if (slot >= 0) {
+        sessions[slot].reflection = REFLECTION_DONE;
+    }
+    xSemaphoreGive(lock);
+    return slot >= 0;
+}
+
+int EmergencySessions::find(uint32_t id) {
+    // A session past its deadline is over, swept or not; 0 names none
+    uint32_t now = millis();
+    for (int i = 0; i < AI_SESSION_SLOTS; i++) {
+        const EmergencySession& session = sessions[i];
+        if (session.id == 0 || (int32_t)(now - session.deadline) >= 0) continue;
+        if (session.id == id) return i;
+    }
+    return -1;
+}
+
+void EmergencySessions::release(int slot) {
+    sessions[slot].id = 0;
+    active--;
+    // What was said in it goes with it
+    transcripts[slot].clear();
+}
+
+void EmergencySessions::sweep(uint32_t now) {
+    bool first = true;
+    for (int i = 0; i < AI_SESSION_SLOTS; i++) {
+        EmergencySession& session = sessions[i];
+        if (session.id == 0) continue;
+        if ((int32_t)(now - session.deadline) >= 0) {
+            LOG_INFO("⏰ Emergency session %lx expired after %d messages",
+                     (unsigned long)session.id, session.messageCount);
+            release(i);
+        } else if (first || (int32_t)(session.deadline - nextDeadline) < 0) {
+            nextDeadline = session.deadline;
+            first = false;
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef EMERGENCY_SESSIONS_H
+#define EMERGENCY_SESSIONS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "conversation.h"
+#include "response_catalog.h"
+
+enum ReflectionState : uint8_t {
+    REFLECTION_OFF = 0,
+    REFLECTION_ASKING,           // Working through the reflection questions
+    REFLECTION_DONE              // The summary was given
+};
+
+// One AI emergency session, as handed out by EmergencySessions::get()
+struct EmergencySession {
+    uint32_t id;                 // 0 for a free slot
+    uint32_t startedAt;          // millis()
+    uint32_t deadline;           // millis() at which it expires
+    uint32_t usedAt;             // millis() of the last message
+    uint32_t reflectionStartedAt;
+    uint16_t messageCount;
+    uint8_t reflectionQuestion;  // Next one to ask, up to CATALOG_QUESTIONS
+    ReflectionState reflection;
+    char trigger[AI_SESSION_TRIGGER_MAX];
+};
+
+// The AI emergency sessions in progress, one per phone, in AI_SESSION_SLOTS
+// fixed slots keyed by session ID, each with a transcript of its own. A
+// session ends when it is completed or AI_MAX_SESSION_TIME after it began:
+// update() only looks at the table once the earliest deadline has passed.
+// Starting one while every slot is taken ends the session that has been
+// quiet the longest. Any task may call in; sessions are copied out. Every
+// call names its session: only the status summary asks for the newest.
+class EmergencySessions {
+public:
+    EmergencySessions();
+    void begin();
+    // From loop(): ends the sessions whose deadline has passed
+    void update();
+
+    // Returns the new session's ID
+    uint32_t start(const String& trigger);
+    void end(uint32_t id);
+    bool get(uint32_t id, EmergencySession& session);
+    // The session started last; false when none is in progress
+    bool newest(EmergencySession& session);
+    int count();
+    // The session's transcript, looked up under the lock on every call so
+    // nothing said after a session ended lands in the one that took its
+    // slot. addMessage() returns the sequence number, 0 once it has ended;
+    // serialize() and contextHash() return false then.
+    uint32_t addMessage(uint32_t id, ConversationRole role, const String& text);
+    void removeMessage(uint32_t id, uint32_t sequence);
+    bool serialize(uint32_t id, JsonDocument& doc, JsonArray messages, uint32_t sequence, String& body);
+    bool contextHash(uint32_t id, uint32_t sequence, uint64_t& hash);
+
+    // Each false when the session has ended
+    bool setTrigger(uint32_t id, const char* trigger);
+    bool countMessage(uint32_t id);
+    bool startReflection(uint32_t id);
+    // The current reflection question was answered
+    bool answerReflection(uint32_t id);
+    bool finishReflection(uint32_t id);
+
+private:
+    SemaphoreHandle_t lock;
+    EmergencySession sessions[AI_SESSION_SLOTS];
+    Conversation transcripts[AI_SESSION_SLOTS];
+    uint32_t nextDeadline;       // Earliest deadline in the table
+    int active;
+
+    int find(uint32_t id);
+    void release(int slot);
+    void sweep(uint32_t now);
+};
+
+extern EmergencySessions emergencySessions;
+
+#endif // EMERGENCY_SESSIONS_H
@@ -0,0 +1,367 @@
+#include "input_trace.h"
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <nvs.h>
+#include "logger.h"
+#include "metered_preferences.h"
+#include "timer.h"
+
+extern MeteredPreferences preferences;
+extern Timer timer;
+extern BoxState currentState;
+
+static bool isSecretName(const char* name) {
+    return strcmp(name, "password") == 0 || strcmp(name, "apiKey") == 0;
+}
+
+// Replaces every non-empty "password" and "apiKey" string, at any depth
+static bool redactSecrets(JsonVariant value) {
+    bool redacted = false;
+    if (value.is<JsonObject>()) {
+        for (JsonPair member : value.as<JsonObject>()) {
+            if (isSecretName(member.key().c_str()) && member.value().is<const char*>() &&
+                strlen(member.value().as<const char*>()) > 0) {
+                member.value().set(TRACE_REDACTED);
+                redacted = true;
+            } else {
+                redacted |= redactSecrets(member.value());
+            }
+        }
+    } else if (value.is<JsonArray>()) {
+        for (JsonVariant element : value.as<JsonArray>()) {
+            redacted |= redactSecrets(element);
+        }
+    }
+    return redacted;
+}
+
+static void appendEncoded(String& out, const String& text) {
+    static const char hex[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < text.length(); i++) {
+        char c = text.charAt(i);
+        if (isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            out += c;
+        } else {
+            out += '%';
+            out += hex[(uint8_t)c >> 4];
+            out += hex[(uint8_t)c & 0x0f];
+        }
+    }
+}
+
+static void appendParam(String& out, const String& name, const String& value) {
+    if (out.length() > 0) out += '&';
+    appendEncoded(out, name);
+    out += '=';
+    appendEncoded(out, isSecretName(name.c_str()) && value.length() > 0 ? String(TRACE_REDACTED) : value);
+}
+
+InputTrace::InputTrace() {
+    ring = NULL;
+    head = 0;
+    tail = 0;
+    keyframeAt = 0;
+    dropped = 0;
+    evicted = 0;
+    lock = NULL;
+    lastPass = 0;
+    clockEpoch = 0;
+    clockMs = 0;
+    stationUp = false;
+}
+
+void InputTrace::begin() {
+    if (!preferences.getBool(KEY_TRACE_ENABLED, false)) {
+        return;
+    }
+
+    ring = (uint8_t*)malloc(TRACE_RING_SIZE);
+    if (ring == NULL) {
+        LOG_ERROR("❌ No memory for the input trace");
+        return;
+    }
+    lock = xSemaphoreCreateMutex();
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    writeKeyframe(TRACE_FLAG_BOOT);
+    xSemaphoreGive(lock);
+    LOG_INFO("⏺️ Recording inputs (%d byte ring)", TRACE_RING_SIZE);
+}
+
+void InputTrace::update() {
+    if (ring == NULL) {
+        return;
+    }
+
+    unsigned long now = millis();
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    if (lastPass != 0 && now - lastPass > LOOP_INTERVAL + TRACE_STALL_MS) {
+        uint32_t gap = now - lastPass;
+        Part part = {&gap, sizeof(gap)};
+        append(TRACE_STALL, 0, &part, 1);
+    }
+    lastPass = now;
+
+    // NTP sync, or anything else that moves the clock by more than the
+    // rounding of whole seconds
+    time_t epoch = time(NULL);
+    time_t expected = clockEpoch + (time_t)((now - clockMs) / 1000);
+    if (epoch > expected + 1 || epoch < expected - 1) {
+        uint32_t value = (uint32_t)epoch;
+        Part part = {&value, sizeof(value)};
+        append(TRACE_CLOCK, 0, &part, 1);
+        clockEpoch = epoch;
+        clockMs = now;
+    }
+
+    bool connected = WiFi.status() == WL_CONNECTED;
+    if (connected != stationUp) {
+        uint8_t online = connected ? 1 : 0;
+        String ssid = connected ? WiFi.SSID() : String();
+        Part parts[] = {{&online, sizeof(online)}, {ssid.c_str(), ssid.length()}};
+        append(TRACE_NETWORK, 0, parts, 2);
+        stationUp = connected;
+    }
+
+    if (head - keyframeAt >= TRACE_RING_SIZE / 2) {
+        writeKeyframe(0);
+    }
+
+    xSemaphoreGive(lock);
+}
+
+void InputTrace::recordButton(int level) {
+    if (ring == NULL) {
+        return;
+    }
+
+    uint8_t value = level == LOW ? 0 : 1;
+    Part part = {&value, sizeof(value)};
+    xSemaphoreTake(lock, portMAX_DELAY);
+    append(TRACE_BUTTON, 0, &part, 1);
+    xSemaphoreGive(lock);
+}
+
+void InputTrace::recordRequest(AsyncWebServerRequest* request) {
+    if (ring == NULL || request->method() == HTTP_GET) {
+        return;
+    }
+
+    String query;
+    String form;
+    for (size_t i = 0; i < request->params(); i++) {
+        AsyncWebParameter* param = request->getParam(i);
+        if (param->isFile()) continue;
+        appendParam(param->isPost() ? form : query, param->name(), param->value());
+    }
+    String url = request->url();
+    if (query.length() > 0) {
+        url += "?" + query;
+    }
+
+    // A JSON body gathered by collectRequestBody, else the form fields
+    String body = form;
+    if (request->_tempObject != NULL) {
+        body = (const char*)request->_tempObject;
+        DynamicJsonDocument doc(body.length() * 2 + 256);
+        if (deserializeJson(doc, body) == DeserializationError::Ok) {
+            if (redactSecrets(doc.as<JsonVariant>())) {
+                body = "";
+                serializeJson(doc, body);
+            }
+        } else if (body.indexOf("password") >= 0 || body.indexOf("apiKey") >= 0) {
+            body = ""; // Unparsed, so it cannot be redacted; it was rejected anyway
+        }
+    }
+
+    uint8_t method = (uint8_t)request->method();
+    uint16_t urlLength = url.length();
+    const String& contentType = request->contentType();
+    uint8_t typeLength = contentType.length() > 255 ? 255 : contentType.length();
+    Part parts[] = {
+        {&method, sizeof(method)},
+        {&urlLength, sizeof(urlLength)},
+        {url.c_str(), urlLength},
+        {&typeLength, sizeof(typeLength)},
+        {contentType.c_str(), typeLength},
+        {body.c_str(), body.length()}
+    };
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    append(TRACE_REQUEST, 0, parts, sizeof(parts) / sizeof(parts[0]));
+    xSemaphoreGive(lock);
+}
+
+void InputTrace::writeKeyframe(uint8_t flags) {
+    // One PREFERENCE record per stored key, then the keyframe that counts
+    // them; the lock keeps other records from landing in between
+    uint16_t count = 0;
+    nvs_handle_t handle;
+    if (nvs_open(PREF_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, PREF_NAMESPACE, NVS_TYPE_ANY);
+        while (it != NULL) {
+            nvs_entry_info_t info;
+            nvs_entry_info(it, &info);
+            it = nvs_entry_next(it);
+
+            // Integers at their stored width (little-endian, so the low
+            // bytes of number); strings and blobs on the heap
+            uint64_t number = 0;
+            uint8_t* value = (uint8_t*)&number;
+            size_t size = 0;
+            esp_err_t err;
+            switch (info.type) {
+                case NVS_TYPE_U8: size = 1; err = nvs_get_u8(handle, info.key, (uint8_t*)value); break;
+                case NVS_TYPE_I8: size = 1; err = nvs_get_i8(handle, info.key, (int8_t*)value); break;
+                case NVS_TYPE_U16: size = 2; err = nvs_get_u16(handle, info.key, (uint16_t*)value); break;
+                case NVS_TYPE_I16: size = 2; err = nvs_get_i16(handle, info.key, (int16_t*)value); break;
+                case NVS_TYPE_U32: size = 4; err = nvs_get_u32(handle, info.key, (uint32_t*)value); break;
+                case NVS_TYPE_I32: size = 4; err = nvs_get_i32(handle, info.key, (int32_t*)value); break;
+                case NVS_TYPE_U64: size = 8; err = nvs_get_u64(handle, info.key, &number); break;
+                case NVS_TYPE_I64: size = 8; err = nvs_get_i64(handle, info.key, (int64_t*)value); break;
+                case NVS_TYPE_STR:
+                    err = nvs_get_str(handle, info.key, NULL, &size);
+                    if (err == ESP_OK && (value = (uint8_t*)malloc(size)) != NULL) {
+                        err = nvs_get_str(handle, info.key, (char*)value, &size);
+                        size = size > 0 ? size - 1 : 0; // Without the terminator
+                    }
+                    break;
+                case NVS_TYPE_BLOB:
+                    err = nvs_get_blob(handle, info.key, NULL, &size);
+                    if (err == ESP_OK && (value = (uint8_t*)malloc(size > 0 ? size : 1)) != NULL) {
+                        err = nvs_get_blob(handle, info.key, value, &size);
+                    }
+                    break;
+                default:
+                    err = ESP_FAIL;
+                    break;
+            }
+
+            if (err == ESP_OK && value != NULL) {
+                bool secret = strcmp(info.key, KEY_WIFI_PASSWORD) == 0 || strcmp(info.key, KEY_AI_API_KEY) == 0;
+                const void* data = value;
+                if (secret && size > 0) {
+                    data = TRACE_REDACTED;
+                    size = strlen(TRACE_REDACTED);
+                }
+                uint8_t type = info.type;
+                uint8_t keyLength = strlen(info.key);
+                Part parts[] = {{&type, 1}, {&keyLength, 1}, {info.key, keyLength}, {data, size}};
+                if (append(TRACE_PREFERENCE, 0, parts, 4)) count++;
+            }
+            if (value != (uint8_t*)&number) free(value);
+        }
+        nvs_close(handle);
+    }
+
+    unsigned long now = millis();
+    uint32_t epoch = (uint32_t)time(NULL);
+    uint8_t state = (uint8_t)currentState;
+    uint8_t running = timer.isRunning() ? 1 : 0;
+    uint32_t remaining = timer.getTimeRemaining();
+    uint8_t station = stationUp ? 1 : 0;
+    Part parts[] = {
+        {&epoch, sizeof(epoch)},
+        {&state, sizeof(state)},
+        {&running, sizeof(running)},
+        {&remaining, sizeof(remaining)},
+        {&station, sizeof(station)},
+        {&count, sizeof(count)}
+    };
+    append(TRACE_KEYFRAME, flags, parts, 6);
+
+    keyframeAt = head;
+    clockEpoch = epoch;
+    clockMs = now;
+}
+
+bool InputTrace::append(uint8_t type, uint8_t flags, const Part* parts, size_t count) {
+    // Called with the lock held
+    size_t size = sizeof(TraceRecordHeader);
+    for (size_t i = 0; i < count; i++) {
+        size += parts[i].size;
+    }
+    if (size > TRACE_MAX_RECORD) {
+        dropped++;
+        return false;
+    }
+
+    // Overwrite the oldest records until this one fits
+    while (head + size - tail > TRACE_RING_SIZE) {
+        TraceRecordHeader oldest;
+        copyOut(tail, &oldest, sizeof(oldest));
+        tail += oldest.size;
+        evicted++;
+    }
+
+    TraceRecordHeader header;
+    header.size = (uint16_t)size;
+    header.type = type;
+    header.flags = flags;
+    header.ms = millis();
+    copyIn(head, &header, sizeof(header));
+    head += sizeof(header);
+
+    for (size_t i = 0; i < count; i++) {
+        copyIn(head, parts[i].data, parts[i].size);
+        head += parts[i].size;
+    }
+    return true;
+}
+
+void InputTrace::beginRead(TraceCursor& cursor) {
+    memcpy(cursor.header.magic, TRACE_MAGIC, sizeof(cursor.header.magic));
+    cursor.header.version = TRACE_VERSION;
+    cursor.header.loopInterval = LOOP_INTERVAL;
+    cursor.position = 0;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    cursor.header.dropped = dropped;
+    cursor.header.evicted = evicted;
+    cursor.start = tail;
+    cursor.end = head;
+    xSemaphoreGive(lock);
+}
+
+size_t InputTrace::read(TraceCursor& cursor, uint8_t* buffer, size_t maxLen) {
+    size_t written = 0;
+
+    while (cursor.position < sizeof(cursor.header) && written < maxLen) {
+        buffer[written++] = ((const uint8_t*)&cursor.header)[cursor.position++];
+    }
+
+    uint32_t length = cursor.end - cursor.start;
+    uint32_t offset = cursor.position - sizeof(cursor.header);
+    if (written < maxLen && offset < length) {
+        size_t size = min((size_t)(length - offset), maxLen - written);
+
+        xSemaphoreTake(lock, portMAX_DELAY);
+        if (cursor.start + offset < tail) {
+            // Overwritten while downloading: end the file here; the replay
+            // drops a torn last record
+            size = 0;
+            cursor.position = sizeof(cursor.header) + length;
+        } else {
+            copyOut(cursor.start + offset, buffer + written, size);
+            cursor.position += size;
+        }
+        xSemaphoreGive(lock);
+        written += size;
+    }
+    return written;
+}
+
+void InputTrace::copyIn(uint32_t offset, const void* source, size_t size) {
+    size_t start = offset % TRACE_RING_SIZE;
+    size_t first = min(size, (size_t)TRACE_RING_SIZE - start);
+    memcpy(ring + start, source, first);
+    memcpy(ring, (const uint8_t*)source + first, size - first);
+}
+
+void InputTrace::copyOut(uint32_t offset, void* target, size_t size) {
+    size_t start = offset % TRACE_RING_SIZE;
+    size_t first = min(size, (size_t)TRACE_RING_SIZE - start);
+    memcpy(target, ring + start, first);
+    memcpy((uint8_t*)target + first, ring, size - first);
+}
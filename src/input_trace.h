@@ -0,0 +1,120 @@
+#ifndef INPUT_TRACE_H
+#define INPUT_TRACE_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "config.h"
+
+// Records what drives the control logic, so a problem seen in the field can
+// be replayed on the native build (lib/sim: replay FILE). Off unless
+// KEY_TRACE_ENABLED is set; recording then starts at boot into a RAM ring
+// that keeps the newest inputs, and /api/dev/trace downloads it.
+//
+// Recorded: raw button level changes, loop passes that came more than
+// TRACE_STALL_MS late (on-time passes follow from LOOP_INTERVAL), wall
+// clock steps, the station going up or down, and every routed request
+// other than a GET, with its query, form fields or JSON body. GETs only
+// read state. Passwords and API keys are replaced by TRACE_REDACTED. /ws
+// and /ws/log take no commands, and upstream AI replies are not inputs to
+// the lock, so neither is recorded.
+//
+// A keyframe (box state and every preference) opens the trace and is
+// repeated whenever half the ring has been written since the last one, so
+// the ring always holds at least one to start a replay from.
+//
+// Download layout, little-endian: TraceFileHeader, then the records oldest
+// first, each a TraceRecordHeader and its payload:
+//   PREFERENCE  u8 nvs_type_t, u8 key length, key, value (integers at
+//               their width, strings without the terminator)
+//   KEYFRAME    u32 epoch, u8 box state, u8 timer running, u32 timer ms
+//               left, u8 station connected, u16 count: closes the count
+//               PREFERENCE records before it
+//   BUTTON      u8 level read from the pin
+//   STALL       u32 ms since the previous loop pass
+//   CLOCK       u32 epoch the wall clock stepped to
+//   NETWORK     u8 station connected, SSID
+//   REQUEST     u8 method, u16 URL length, URL with query, u8 content type
+//               length, content type, body
+
+#define TRACE_MAGIC "QBTR"
+#define TRACE_VERSION 1
+#define TRACE_FLAG_BOOT 0x01        // Keyframe taken in setup(), before the lock state was restored
+
+enum TraceRecordType : uint8_t {
+    TRACE_PREFERENCE = 1,
+    TRACE_KEYFRAME,
+    TRACE_BUTTON,
+    TRACE_STALL,
+    TRACE_CLOCK,
+    TRACE_NETWORK,
+    TRACE_REQUEST
+};
+
+struct TraceFileHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t loopInterval;
+    uint32_t dropped;               // Requests too large to record
+    uint32_t evicted;               // Records the ring has overwritten
+};
+
+struct TraceRecordHeader {
+    uint16_t size;                  // Header included
+    uint8_t type;
+    uint8_t flags;
+    uint32_t ms;                    // millis() when it was recorded
+};
+
+// Download position: the file header, then the ring as it was at
+// beginRead(); records written since are left for the next download
+struct TraceCursor {
+    TraceFileHeader header;
+    uint32_t start;
+    uint32_t end;
+    uint32_t position;
+};
+
+class InputTrace {
+public:
+    InputTrace();
+    // In setup(), once preferences are open; takes the boot keyframe
+    void begin();
+    // At the top of every loop() pass: stalls, clock steps, the station and
+    // periodic keyframes
+    void update();
+    bool isRecording() const { return ring != NULL; }
+
+    void recordButton(int level);
+    void recordRequest(AsyncWebServerRequest* request);
+
+    void beginRead(TraceCursor& cursor);
+    size_t read(TraceCursor& cursor, uint8_t* buffer, size_t maxLen);
+
+private:
+    struct Part {
+        const void* data;
+        size_t size;
+    };
+
+    uint8_t* ring;
+    uint32_t head;           // Monotonic byte offsets into the ring
+    uint32_t tail;
+    uint32_t keyframeAt;     // head after the last keyframe
+    uint32_t dropped;
+    uint32_t evicted;
+    SemaphoreHandle_t lock;
+
+    unsigned long lastPass;
+    time_t clockEpoch;       // Wall clock at clockMs, as last recorded
+    unsigned long clockMs;
+    bool stationUp;
+
+    bool append(uint8_t type, uint8_t flags, const Part* parts, size_t count);
+    void writeKeyframe(uint8_t flags);
+    void copyIn(uint32_t offset, const void* source, size_t size);
+    void copyOut(uint32_t offset, void* target, size_t size);
+};
+
+extern InputTrace inputTrace;
+
+#endif // INPUT_TRACE_H
@@ -0,0 +1,254 @@
+#include "intent_classifier.h"
+#include "logger.h"
+
+// Categories are bits of a node's hits: the triggers first, by their
+// CatalogTrigger value, then the intents
+#define CATEGORY_INTENT(intent) ((int)CATALOG_OTHER_TRIGGER + (int)(intent) - 1)
+#define CATEGORIES CATEGORY_INTENT(INTENT_CRAVING + 1)
+
+// Keywords in lower case, as classify() folds the text: anything that is
+// not a letter or digit becomes a space ("i'm" is "i m"). Each one starts a
+// word; a trailing space makes it end one too. English, Portuguese,
+// Spanish, French and German, like translations.json.
+static const char* const kStressWords[] = {
+    "stress", "anxi", "overwhelm", "pressure", "deadline", "worr", "nervous", "panic", "tense",
+    "estres", "ansi", "pressão", "preocupad", "nervos", "prazo",
+    "estrés", "agobiad", "presión", "nervios",
+    "angoiss", "pression", "inquiet", "nerveu", "débordé", "deborde",
+    "gestresst", "angst", "druck", "nervös", "sorgen", "überfordert", "panik"
+};
+
+static const char* const kBoredomWords[] = {
+    "bored", "boring", "nothing to do", "dull", "idle",
+    "entediad", "tédio", "tedio", "nada para fazer", "nada pra fazer",
+    "aburrid", "aburrimiento", "nada que hacer",
+    "ennui", "ennuy", "rien à faire", "rien a faire",
+    "langweil", "langeweile", "nichts zu tun"
+};
+
+static const char* const kAngerWords[] = {
+    "angry", "anger", "mad ", "furious", "pissed", "annoyed", "frustr", "rage", "fight", "argu", "yell", "shout",
+    "raiva", "irritad", "brav", "furios", "chatead", "brig", "discuti", "grit",
+    "enojad", "enfadad", "rabia", "ira ", "pelea", "discut",
+    "colère", "colere", "énervé", "enerve", "furieu", "fâché", "fache", "dispute", "engueul",
+    "wütend", "wut", "ärger", "sauer", "streit", "geschrien"
+};
+
+static const char* const kHabitWords[] = {
+    "habit", "routine", "usually", "coffee", "after dinner", "after lunch", "after eating", "after a meal",
+    "automati", "every morning", "every day",
+    "hábito", "costum", "rotina", "café", "cafe", "depois do almoço", "depois do jantar", "depois de comer",
+    "automáti", "todo dia", "todos os dias",
+    "rutina", "después de comer", "despues de comer", "todos los días", "siempre",
+    "habitude", "après le repas", "apres le repas", "tous les jours", "toujours",
+    "gewohnheit", "kaffee", "nach dem essen", "jeden tag", "jeden morgen", "immer"
+};
+
+static const char* const kHelpWords[] = {
+    "help ", "what can i do", "what should i do", "what do i do", "how do i", "how can i", "advice", "tip",
+    "ajud", "o que eu faço", "o que faço", "o que fazer", "o que posso fazer", "dica", "como posso", "conselho",
+    "ayud", "qué hago", "que hago", "qué puedo hacer", "que puedo hacer", "qué hacer", "consejo", "cómo puedo",
+    "aid", "que faire", "que dois je faire", "comment faire", "conseil", "astuce",
+    "hilf", "was soll ich", "was kann ich", "tipp", "ratschl"
+};
+
+static const char* const kBetterWords[] = {
+    "better", "calmer", "i m ok", "i am ok", "i can wait", "it passed", "feel good", "feel fine",
+    "feeling fine", "relieved", "under control", "made it",
+    "melhor", "mais calm", "passou", "aliviad", "sob controle", "consegui",
+    "mejor", "más tranquil", "mas tranquil", "se pasó", "ya pasó", "ya paso", "bajo control", "lo logré",
+    "mieux", "plus calme", "ça va", "ca va", "c est passé", "soulag", "sous contrôle",
+    "besser", "ruhiger", "geht schon", "vorbei", "erleichtert", "unter kontrolle", "geschafft"
+};
+
+static const char* const kCravingWords[] = {
+    "smok", "cigar", "crav", "urge", "nicotin", "need one", "light up", "pack",
+    "fum", "vontade", "maço",
+    "ganas", "antojo", "pitillo", "cajetilla",
+    "clope", "envie", "paquet",
+    "rauch", "zigarett", "kippe", "verlangen", "lust", "nikotin", "schachtel"
+};
+
+struct Vocabulary {
+    uint8_t category;
+    const char* const* words;
+    uint8_t count;
+};
+
+#define VOCABULARY(category, words) {category, words, sizeof(words) / sizeof(words[0])}
+
+static const Vocabulary kVocabularies[] = {
+    VOCABULARY(CATALOG_STRESS, kStressWords),
+    VOCABULARY(CATALOG_BOREDOM, kBoredomWords),
+    VOCABULARY(CATALOG_ANGER, kAngerWords),
+    VOCABULARY(CATALOG_HABIT, kHabitWords),
+    VOCABULARY(CATEGORY_INTENT(INTENT_HELP), kHelpWords),
+    VOCABULARY(CATEGORY_INTENT(INTENT_BETTER), kBetterWords),
+    VOCABULARY(CATEGORY_INTENT(INTENT_CRAVING), kCravingWords)
+};
+
+// Lower case, keeping letters, digits and UTF-8 sequences, with the
+// upper-case Latin-1 letters (U+00C0 to U+00DE, but for ×) folded; anything
+// else is a space
+static uint8_t fold(uint8_t previous, uint8_t c) {
+    if (c >= 'A' && c <= 'Z') return c + ('a' - 'A');
+    if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) return c;
+    if (c >= 0x80) {
+        if (previous == 0xC3 && c >= 0x80 && c <= 0x9E && c != 0x97) return c + 0x20;
+        return c;
+    }
+    return ' ';
+}
+
+// The category matched most, else the one matched first; -1 for none
+static int strongest(const uint8_t* counts, const uint8_t* order, int from, int to) {
+    int best = -1;
+    for (int category = from; category < to; category++) {
+        if (counts[category] > 0 && (best < 0 || counts[category] > counts[best] ||
+            (counts[category] == counts[best] && order[category] < order[best]))) {
+            best = category;
+        }
+    }
+    return best;
+}
+
+IntentClassifier::IntentClassifier() {
+    used = 0;
+}
+
+void IntentClassifier::begin() {
+    // Node 0 is the root
+    used = 1;
+    label[0] = 0;
+    child[0] = 0;
+    sibling[0] = 0;
+    fail[0] = 0;
+    hits[0] = 0;
+
+    int keywords = 0;
+    size_t longest = 0;
+    for (size_t v = 0; v < sizeof(kVocabularies) / sizeof(kVocabularies[0]); v++) {
+        for (uint8_t w = 0; w < kVocabularies[v].count; w++) {
+            const char* keyword = kVocabularies[v].words[w];
+            if (!insert(keyword, kVocabularies[v].category)) {
+                LOG_ERROR("❌ Intent keyword \"%s\" does not fit in INTENT_MAX_NODES", keyword);
+                continue;
+            }
+            keywords++;
+            longest = max(longest, strlen(keyword) + 1);
+        }
+    }
+
+    for (int c = 0; c < 256; c++) {
+        rootNext[c] = findChild(0, c);
+    }
+    // Failure links a level at a time, so the shorter suffixes they lead
+    // to are always linked first
+    for (size_t depth = 1; depth <= longest; depth++) {
+        link(0, 0, depth);
+    }
+
+    LOG_INFO("🧭 Intent classifier ready (%d keywords, %u nodes)", keywords, used);
+}
+
+void IntentClassifier::classify(const char* text, MessageClass& result) const {
+    uint8_t counts[CATEGORIES] = {0};
+    uint8_t order[CATEGORIES] = {0};     // When each was first matched, from 1
+    uint8_t matched = 0;
+
+    // The text starts and ends with a space, and runs of them count as one
+    uint16_t node = step(0, ' ');
+    uint8_t previous = ' ';
+    uint8_t last = ' ';
+    for (const char* p = text; ; p++) {
+        uint8_t c = *p == '\0' ? ' ' : fold(previous, *p);
+        if (c != ' ' || last != ' ') {
+            node = step(node, c);
+            uint8_t category = 0;
+            for (uint8_t found = hits[node]; found != 0; found >>= 1, category++) {
+                if (!(found & 1)) continue;
+                if (counts[category] < 255) counts[category]++;
+                if (order[category] == 0) order[category] = ++matched;
+            }
+        }
+        if (*p == '\0') break;
+        previous = *p;
+        last = c;
+    }
+
+    int trigger = strongest(counts, order, 0, CATALOG_OTHER_TRIGGER);
+    result.trigger = trigger < 0 ? CATALOG_OTHER_TRIGGER : (CatalogTrigger)trigger;
+    int intent = strongest(counts, order, CATALOG_OTHER_TRIGGER, CATEGORIES);
+    result.intent = intent < 0 ? INTENT_NONE : (MessageIntent)(intent - CATEGORY_INTENT(INTENT_NONE));
+}
+
+const char* IntentClassifier::intentName(MessageIntent intent) {
+    switch (intent) {
+        case INTENT_HELP:
+            return "help";
+        case INTENT_BETTER:
+            return "better";
+        case INTENT_CRAVING:
+            return "craving";
+        default:
+            return "none";
+    }
+}
+
+bool IntentClassifier::insert(const char* keyword, uint8_t category) {
+    // Every keyword starts a word
+    uint16_t node = 0;
+    if (!extend(node, ' ')) return false;
+
+    uint8_t previous = ' ';
+    for (const char* p = keyword; *p != '\0'; p++) {
+        if (!extend(node, fold(previous, *p))) return false;
+        previous = *p;
+    }
+    hits[node] |= 1 << category;
+    return true;
+}
+
+bool IntentClassifier::extend(uint16_t& node, uint8_t c) {
+    uint16_t next = findChild(node, c);
+    if (next == 0) {
+        if (used >= INTENT_MAX_NODES) return false;
+        next = used++;
+        label[next] = c;
+        child[next] = 0;
+        sibling[next] = child[node];
+        fail[next] = 0;
+        hits[next] = 0;
+        child[node] = next;
+    }
+    node = next;
+    return true;
+}
+
+uint16_t IntentClassifier::findChild(uint16_t node, uint8_t c) const {
+    for (uint16_t next = child[node]; next != 0; next = sibling[next]) {
+        if (label[next] == c) return next;
+    }
+    return 0;
+}
+
+uint16_t IntentClassifier::step(uint16_t node, uint8_t c) const {
+    while (node != 0) {
+        uint16_t next = findChild(node, c);
+        if (next != 0) return next;
+        node = fail[node];
+    }
+    return rootNext[c];
+}
+
+void IntentClassifier::link(uint16_t node, size_t depth, size_t target) {
+    for (uint16_t next = child[node]; next != 0; next = sibling[next]) {
+        if (depth + 1 < target) {
+            link(next, depth + 1, target);
+        } else {
+            // The root's children fall back to the root
+            fail[next] = node == 0 ? 0 : step(fail[node], label[next]);
+            hits[next] |= hits[fail[next]];
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef INTENT_CLASSIFIER_H
+#define INTENT_CLASSIFIER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "response_catalog.h"
+
+enum MessageIntent : uint8_t {
+    INTENT_NONE = 0,
+    INTENT_HELP,                 // Asks what to do
+    INTENT_BETTER,               // The craving is easing
+    INTENT_CRAVING               // Wants to smoke
+};
+
+struct MessageClass {
+    CatalogTrigger trigger;      // CATALOG_OTHER_TRIGGER when none was named
+    MessageIntent intent;
+};
+
+// Reads what a chat message is about: the trigger it names and what the
+// user wants, from keywords in the languages of the web UI. The keywords
+// are compiled once, in begin(), into an Aho-Corasick automaton in
+// INTENT_MAX_NODES fixed nodes, so a message is classified in one pass over
+// its bytes, matching every keyword at once, without allocating. Keywords
+// match at the start of a word, so stems catch their inflections; the
+// category matched most often wins, the one matched first on a tie.
+// Nothing changes after begin(), so any task may classify.
+class IntentClassifier {
+public:
+    IntentClassifier();
+    void begin();
+    void classify(const char* text, MessageClass& result) const;
+    static const char* intentName(MessageIntent intent);
+
+private:
+    uint8_t label[INTENT_MAX_NODES];
+    uint16_t child[INTENT_MAX_NODES];    // First child, 0 for none
+    uint16_t sibling[INTENT_MAX_NODES];  // Next child of the same parent
+    uint16_t fail[INTENT_MAX_NODES];     // Longest proper suffix in the trie
+    uint8_t hits[INTENT_MAX_NODES];      // Categories matched on reaching the node
+    uint16_t rootNext[256];              // The root's transitions, looked up directly
+    uint16_t used;
+
+    bool insert(const char* keyword, uint8_t category);
+    bool extend(uint16_t& node, uint8_t c);
+    uint16_t findChild(uint16_t node, uint8_t c) const;
+    uint16_t step(uint16_t node, uint8_t c) const;
+    void link(uint16_t node, size_t depth, size_t target);
+};
+
+extern IntentClassifier intentClassifier;
+
+#endif // INTENT_CLASSIFIER_H
@@ -0,0 +1,181 @@
+#include "local_ai.h"
+#include "ai_worker.h"
+#include "metered_preferences.h"
+#include "logger.h"
+#include <WiFi.h>
+
+extern MeteredPreferences preferences;
+extern AIWorker aiWorker;
+
+LocalAI::LocalAI() {
+    lock = NULL;
+    selected = false;
+    health = LOCAL_AI_UNCHECKED;
+    lastError = 0;
+    latencyMs = 0;
+    checkedAt = 0;
+    checkQueued = false;
+}
+
+void LocalAI::begin() {
+    lock = xSemaphoreCreateMutex();
+    connection.begin();
+    reload();
+}
+
+void LocalAI::reload() {
+    bool enabled = preferences.getBool(KEY_AI_ENABLED, false) &&
+                   preferences.getString(KEY_AI_PROVIDER, "simple") == "local";
+    String url = preferences.getString(KEY_AI_LOCAL_URL, "");
+    while (url.endsWith("/")) {
+        url.remove(url.length() - 1);
+    }
+    String model = preferences.getString(KEY_AI_LOCAL_MODEL, AI_LOCAL_MODEL);
+    int32_t connectTimeout = preferences.getInt(KEY_AI_LOCAL_CONNECT, AI_LOCAL_CONNECT_TIMEOUT);
+    int32_t replyTimeout = preferences.getInt(KEY_AI_LOCAL_TIMEOUT, AI_LOCAL_REPLY_TIMEOUT);
+
+    connection.setTimeouts(connectTimeout, replyTimeout * 1000);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (url != baseUrl || model != modelName) {
+        // A different server or model: what was known no longer holds
+        health = LOCAL_AI_UNCHECKED;
+        lastError = 0;
+        checkedAt = 0;
+    }
+    selected = enabled;
+    baseUrl = url;
+    modelName = model;
+    xSemaphoreGive(lock);
+}
+
+void LocalAI::update() {
+    connection.update();
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool due = selected && baseUrl.length() > 0 && !checkQueued &&
+               (checkedAt == 0 || millis() - checkedAt >= AI_LOCAL_HEALTH_INTERVAL);
+    if (due && WiFi.status() == WL_CONNECTED) {
+        checkQueued = aiWorker.poke();
+    }
+    xSemaphoreGive(lock);
+}
+
+String LocalAI::model() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    String model = modelName;
+    xSemaphoreGive(lock);
+    return model;
+}
+
+bool LocalAI::isConfigured() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool configured = baseUrl.length() > 0;
+    xSemaphoreGive(lock);
+    return configured;
+}
+
+int LocalAI::chat(const String& body, Stream& sink) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    String url = baseUrl;
+    xSemaphoreGive(lock);
+    if (url.length() == 0) {
+        return HTTPC_ERROR_NOT_CONNECTED;
+    }
+
+    // Local servers take no key
+    int code = connection.post(url + "/v1/chat/completions", "", body, sink);
+    if (code == HTTP_CODE_OK) {
+        record(LOCAL_AI_UP, code);
+    } else {
+        // Ollama answers 404 for a model it does not have
+        record(code == 404 ? LOCAL_AI_NO_MODEL : LOCAL_AI_DOWN, code);
+    }
+    return code;
+}
+
+void LocalAI::checkHealth() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    String url = baseUrl;
+    String model = modelName;
+    if (url.length() == 0) {
+        checkQueued = false;
+        xSemaphoreGive(lock);
+        return;
+    }
+    xSemaphoreGive(lock);
+
+    unsigned long start = millis();
+    String response;
+    int code = connection.get(url + "/v1/models", "", response);
+    uint32_t took = millis() - start;
+
+    LocalAIHealth result = LOCAL_AI_DOWN;
+    if (code == HTTP_CODE_OK) {
+        // Only the model IDs; Ollama lists "llama3.2:latest" for "llama3.2"
+        StaticJsonDocument<64> filter;
+        filter["data"][0]["id"] = true;
+        DynamicJsonDocument models(1024);
+        result = LOCAL_AI_NO_MODEL;
+        if (!deserializeJson(models, response, DeserializationOption::Filter(filter))) {
+            String tagged = model + ":";
+            for (JsonVariant entry : models["data"].as<JsonArray>()) {
+                String id = entry["id"].as<String>();
+                if (id == model || id.startsWith(tagged)) {
+                    result = LOCAL_AI_UP;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (result != LOCAL_AI_UP) {
+        LOG_WARN("🤖 Local AI at %s is %s (%d)", url.c_str(), healthName(result), code);
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    latencyMs = took;
+    checkQueued = false;
+    xSemaphoreGive(lock);
+    record(result, code);
+}
+
+void LocalAI::record(LocalAIHealth result, int code) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    health = result;
+    lastError = result == LOCAL_AI_UP ? 0 : code;
+    checkedAt = millis();
+    if (checkedAt == 0) checkedAt = 1;
+    xSemaphoreGive(lock);
+}
+
+void LocalAI::writeJSON(JsonDocument& doc) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    doc["selected"] = selected;
+    doc["url"] = baseUrl;
+    doc["model"] = modelName;
+    doc["health"] = healthName(health);
+    if (checkedAt != 0) {
+        doc["checkedAgo"] = (millis() - checkedAt) / 1000;
+        doc["latencyMs"] = latencyMs;
+    }
+    if (lastError > 0) {
+        doc["error"] = "HTTP " + String(lastError);
+    } else if (lastError < 0) {
+        doc["error"] = HTTPClient::errorToString(lastError);
+    }
+    xSemaphoreGive(lock);
+}
+
+const char* LocalAI::healthName(LocalAIHealth health) {
+    switch (health) {
+        case LOCAL_AI_UP:
+            return "up";
+        case LOCAL_AI_NO_MODEL:
+            return "no-model";
+        case LOCAL_AI_DOWN:
+            return "down";
+        default:
+            return "unchecked";
+    }
+}
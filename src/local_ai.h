@@ -0,0 +1,61 @@
+#ifndef LOCAL_AI_H
+#define LOCAL_AI_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "ai_connection.h"
+
+enum LocalAIHealth : uint8_t {
+    LOCAL_AI_UNCHECKED = 0,
+    LOCAL_AI_UP,
+    LOCAL_AI_NO_MODEL,       // The server answers but does not have the model
+    LOCAL_AI_DOWN
+};
+
+// The "local" provider: a model server on the LAN with the OpenAI-compatible
+// chat completions API (Ollama, llama.cpp's server, LM Studio), so the
+// conversation never leaves the network. It keeps a connection of its own,
+// plain HTTP unless the URL is https, with the timeouts from the settings.
+//
+// While it is the selected provider, update() has the AI worker check the
+// server every AI_LOCAL_HEALTH_INTERVAL between jobs: GET /v1/models, which
+// also tells whether the model is installed. How a chat request went counts
+// as a check too.
+class LocalAI {
+public:
+    LocalAI();
+    void begin();
+    // Picks up the URL, model and timeouts after the settings change
+    void reload();
+    // From loop(): closes the idle connection and schedules checks
+    void update();
+
+    // On the AI worker task
+    String model();
+    // Whether a server URL is set, selected or not
+    bool isConfigured();
+    int chat(const String& body, Stream& sink);
+    void checkHealth();
+
+    void writeJSON(JsonDocument& doc);
+
+private:
+    SemaphoreHandle_t lock;
+    AIConnection connection;
+    bool selected;               // AI on and set to the local provider
+    String baseUrl;              // Without a trailing slash
+    String modelName;
+    LocalAIHealth health;
+    int lastError;               // HTTP status or HTTPC_ERROR_* of the last failure
+    uint32_t latencyMs;          // Of the last check
+    unsigned long checkedAt;     // 0 until the first check
+    bool checkQueued;
+
+    void record(LocalAIHealth health, int code);
+    static const char* healthName(LocalAIHealth health);
+};
+
+extern LocalAI localAI;
+
+#endif // LOCAL_AI_H
@@ -0,0 +1,413 @@
+#include "logger.h"
+
+LogRecord::LogRecord(uint8_t level, const char* format) {
+    Header header;
+    header.size = 0;      // Filled in by Logger::commit()
+    header.level = level;
+    header.argCount = 0;
+    header.seq = 0;
+    header.timestamp = millis();
+    header.format = format;
+    memcpy(buffer, &header, sizeof(header));
+    length = sizeof(header);
+}
+
+bool LogRecord::reserve(size_t bytes) {
+    if (length + bytes > sizeof(buffer)) {
+        return false; // Too many arguments; the rest print as the raw spec
+    }
+    buffer[offsetof(Header, argCount)]++;
+    return true;
+}
+
+void LogRecord::put32(uint8_t tag, uint32_t value) {
+    if (!reserve(1 + sizeof(value))) return;
+    buffer[length++] = tag;
+    memcpy(buffer + length, &value, sizeof(value));
+    length += sizeof(value);
+}
+
+void LogRecord::put64(uint8_t tag, uint64_t value) {
+    if (!reserve(1 + sizeof(value))) return;
+    buffer[length++] = tag;
+    memcpy(buffer + length, &value, sizeof(value));
+    length += sizeof(value);
+}
+
+void LogRecord::add(const char* value) {
+    if (value == NULL) value = "(null)";
+
+    size_t size = strnlen(value, LOG_MAX_STRING);
+    if (!reserve(2 + size)) return;
+    buffer[length++] = TAG_STR;
+    buffer[length++] = (uint8_t)size;
+    memcpy(buffer + length, value, size);
+    length += size;
+}
+
+Logger::Logger() : ws("/ws/log") {
+    head = 0;
+    tail = 0;
+    firstSeq = 0;
+    nextSeq = 0;
+    dropped = 0;
+    portMUX_INITIALIZE(&ringLock);
+    clientLock = NULL;
+    serialCursor.seq = 0;
+    serialCursor.offset = 0;
+
+    for (int i = 0; i < LOG_MAX_CLIENTS; i++) {
+        clients[i].used = false;
+    }
+}
+
+void Logger::begin(AsyncWebServer& server) {
+    clientLock = xSemaphoreCreateMutex();
+
+    ws.onEvent([this](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+        onSocketEvent(client, type);
+    });
+    server.addHandler(&ws);
+}
+
+void Logger::update() {
+#if LOG_SERIAL
+    // A bounded batch per pass keeps a burst of records from stalling loop()
+    char line[LOG_LINE_SIZE];
+    for (int i = 0; i < LOG_SEND_BATCH; i++) {
+        if (readLine(serialCursor, line, sizeof(line)) == 0) break;
+        Serial.println(line);
+    }
+#endif
+
+    if (clientLock != NULL) {
+        flushSockets();
+    }
+}
+
+void Logger::flushSerial() {
+    // For fatal paths that never reach loop() again
+    char line[LOG_LINE_SIZE];
+    while (readLine(serialCursor, line, sizeof(line)) > 0) {
+        Serial.println(line);
+    }
+    Serial.flush();
+}
+
+void Logger::commit(const LogRecord& record) {
+    uint16_t size = record.size();
+
+    portENTER_CRITICAL(&ringLock);
+
+    // Make room by dropping the oldest records
+    while (head - tail + size > LOG_RING_SIZE) {
+        uint16_t oldest;
+        copyOut(tail, &oldest, sizeof(oldest));
+        tail += oldest;
+        firstSeq++;
+        dropped++;
+    }
+
+    uint32_t seq = nextSeq++;
+    copyIn(head, record.data(), size);
+    copyIn(head + offsetof(LogRecord::Header, size), &size, sizeof(size));
+    copyIn(head + offsetof(LogRecord::Header, seq), &seq, sizeof(seq));
+    head += size;
+
+    portEXIT_CRITICAL(&ringLock);
+}
+
+void Logger::beginRead(LogCursor& cursor) {
+    portENTER_CRITICAL(&ringLock);
+    cursor.seq = firstSeq;
+    cursor.offset = tail;
+    portEXIT_CRITICAL(&ringLock);
+}
+
+bool Logger::copyRecord(LogCursor& cursor, uint8_t* record) {
+    // Copies the record at the cursor out of the ring and advances it. A
+    // cursor that fell behind the tail skips to the oldest record kept.
+    portENTER_CRITICAL(&ringLock);
+
+    if ((int32_t)(cursor.seq - firstSeq) < 0) {
+        cursor.seq = firstSeq;
+        cursor.offset = tail;
+    }
+
+    if (cursor.seq == nextSeq) {
+        portEXIT_CRITICAL(&ringLock);
+        return false;
+    }
+
+    uint16_t size;
+    copyOut(cursor.offset, &size, sizeof(size));
+    copyOut(cursor.offset, record, size);
+    cursor.offset += size;
+    cursor.seq++;
+
+    portEXIT_CRITICAL(&ringLock);
+    return true;
+}
+
+size_t Logger::readLine(LogCursor& cursor, char* line, size_t size, uint8_t* level, uint32_t* timestamp) {
+    uint8_t record[LOG_MAX_RECORD];
+    if (!copyRecord(cursor, record)) {
+        return 0;
+    }
+
+    LogRecord::Header header;
+    memcpy(&header, record, sizeof(header));
+    if (level != NULL) *level = header.level;
+    if (timestamp != NULL) *timestamp = header.timestamp;
+
+    if (level != NULL) {
+        // Caller renders level and time itself
+        return formatRecord(record, line, size);
+    }
+
+    int prefix = snprintf(line, size, "[%6lu.%03lu] %c ",
+                          (unsigned long)header.timestamp / 1000, (unsigned long)header.timestamp % 1000,
+                          toupper(levelName(header.level)[0]));
+    return prefix + formatRecord(record, line + prefix, size - prefix);
+}
+
+size_t Logger::readText(LogCursor& cursor, uint8_t* buffer, size_t maxLen, String& pending) {
+    if (pending.length() == 0) {
+        char line[LOG_LINE_SIZE];
+        if (readLine(cursor, line, sizeof(line)) == 0) {
+            return 0; // Done
+        }
+        pending = line;
+        pending += "\n";
+    }
+
+    size_t length = pending.length();
+    if (length > maxLen) {
+        length = maxLen;
+    }
+    memcpy(buffer, pending.c_str(), length);
+    pending.remove(0, length);
+    return length;
+}
+
+const char* Logger::levelName(uint8_t level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR:
+            return "error";
+        case LOG_LEVEL_WARN:
+            return "warning";
+        case LOG_LEVEL_INFO:
+            return "info";
+        default:
+            return "debug";
+    }
+}
+
+void Logger::copyOut(uint32_t offset, void* target, size_t size) {
+    size_t start = offset % LOG_RING_SIZE;
+    size_t first = size < LOG_RING_SIZE - start ? size : LOG_RING_SIZE - start;
+    memcpy(target, ring + start, first);
+    memcpy((uint8_t*)target + first, ring, size - first);
+}
+
+void Logger::copyIn(uint32_t offset, const void* source, size_t size) {
+    size_t start = offset % LOG_RING_SIZE;
+    size_t first = size < LOG_RING_SIZE - start ? size : LOG_RING_SIZE - start;
+    memcpy(ring + start, source, first);
+    memcpy(ring, (const uint8_t*)source + first, size - first);
+}
+
+void Logger::onSocketEvent(AsyncWebSocketClient* client, AwsEventType type) {
+    // Runs in the async_tcp task
+    xSemaphoreTake(clientLock, portMAX_DELAY);
+
+    if (type == WS_EVT_CONNECT) {
+        SocketClient* slot = NULL;
+        for (int i = 0; i < LOG_MAX_CLIENTS; i++) {
+            if (!clients[i].used) {
+                slot = &clients[i];
+                break;
+            }
+        }
+
+        if (slot == NULL) {
+            xSemaphoreGive(clientLock);
+            client->close(1013, "Too many clients");
+            return;
+        }
+
+        // New viewers get the backlog still in the ring first
+        slot->used = true;
+        slot->id = client->id();
+        beginRead(slot->cursor);
+    } else if (type == WS_EVT_DISCONNECT) {
+        for (int i = 0; i < LOG_MAX_CLIENTS; i++) {
+            if (clients[i].used && clients[i].id == client->id()) {
+                clients[i].used = false;
+            }
+        }
+    }
+
+    xSemaphoreGive(clientLock);
+}
+
+void Logger::flushSockets() {
+    char line[LOG_LINE_SIZE];
+
+    xSemaphoreTake(clientLock, portMAX_DELAY);
+
+    for (int i = 0; i < LOG_MAX_CLIENTS; i++) {
+        SocketClient& slot = clients[i];
+        if (!slot.used) continue;
+
+        AsyncWebSocketClient* client = ws.client(slot.id);
+        if (client == NULL) {
+            slot.used = false;
+            continue;
+        }
+
+        for (int sent = 0; sent < LOG_SEND_BATCH; sent++) {
+            // Leave the record in the ring until the socket can take it
+            if (!client->canSend() || client->client()->space() < LOG_LINE_SIZE * 2) break;
+
+            uint8_t level;
+            uint32_t timestamp;
+            if (readLine(slot.cursor, line, sizeof(line), &level, &timestamp) == 0) break;
+
+            String message = "{\"timestamp\":";
+            message += timestamp;
+            message += ",\"level\":\"";
+            message += levelName(level);
+            message += "\",\"message\":\"";
+            for (const char* c = line; *c != '\0'; c++) {
+                if (*c == '"' || *c == '\\') {
+                    message += '\\';
+                    message += *c;
+                } else if ((uint8_t)*c < 0x20) {
+                    message += ' ';
+                } else {
+                    message += *c;
+                }
+            }
+            message += "\"}";
+            client->text(message);
+        }
+    }
+
+    xSemaphoreGive(clientLock);
+}
+
+size_t Logger::formatRecord(const uint8_t* record, char* line, size_t size) {
+    // printf-style formatting of a stored record, one conversion at a time
+    // against the argument types captured when it was written
+    LogRecord::Header header;
+    memcpy(&header, record, sizeof(header));
+
+    const uint8_t* arg = record + sizeof(header);
+    const uint8_t* end = record + header.size;
+    size_t used = 0;
+    const char* p = header.format;
+
+    while (*p != '\0' && used + 1 < size) {
+        if (*p != '%') {
+            line[used++] = *p++;
+            continue;
+        }
+
+        const char* specStart = p++;
+        if (*p == '%') {
+            line[used++] = '%';
+            p++;
+            continue;
+        }
+
+        // Flags, width and precision are kept; length modifiers are
+        // replaced to match the stored argument type
+        char spec[16];
+        size_t specLength = 0;
+        spec[specLength++] = '%';
+        while (*p != '\0' && strchr("-+ #0123456789.", *p) != NULL) {
+            if (specLength < sizeof(spec) - 4) spec[specLength++] = *p;
+            p++;
+        }
+        while (*p != '\0' && strchr("hlLqjzt", *p) != NULL) {
+            p++;
+        }
+        char conversion = *p;
+        if (conversion == '\0') break;
+        p++;
+
+        if (arg >= end) {
+            // More conversions than arguments: print the spec itself
+            int written = snprintf(line + used, size - used, "%.*s", (int)(p - specStart), specStart);
+            used += written < (int)(size - used) ? written : size - used - 1;
+            continue;
+        }
+
+        uint8_t tag = *arg++;
+        uint64_t integer = 0;
+        float real = 0;
+        char text[LOG_MAX_STRING + 1] = "";
+
+        if (tag == LogRecord::TAG_STR) {
+            uint8_t length = *arg++;
+            memcpy(text, arg, length);
+            text[length] = '\0';
+            arg += length;
+        } else if (tag == LogRecord::TAG_I64 || tag == LogRecord::TAG_U64) {
+            memcpy(&integer, arg, sizeof(uint64_t));
+            arg += sizeof(uint64_t);
+        } else {
+            uint32_t value;
+            memcpy(&value, arg, sizeof(value));
+            arg += sizeof(value);
+            if (tag == LogRecord::TAG_F32) {
+                memcpy(&real, &value, sizeof(real));
+            } else if (tag == LogRecord::TAG_I32) {
+                integer = (uint64_t)(int64_t)(int32_t)value;
+            } else {
+                integer = value;
+            }
+        }
+
+        int written;
+        if (conversion == 's') {
+            spec[specLength++] = 's';
+            spec[specLength] = '\0';
+            written = snprintf(line + used, size - used, spec, tag == LogRecord::TAG_STR ? text : "?");
+        } else if (strchr("fFeEgGaA", conversion) != NULL) {
+            spec[specLength++] = conversion;
+            spec[specLength] = '\0';
+            double value = tag == LogRecord::TAG_F32 ? real
+                         : (tag == LogRecord::TAG_I32 || tag == LogRecord::TAG_I64) ? (double)(int64_t)integer
+                         : (double)integer;
+            written = snprintf(line + used, size - used, spec, value);
+        } else if (conversion == 'c') {
+            spec[specLength++] = 'c';
+            spec[specLength] = '\0';
+            written = snprintf(line + used, size - used, spec, (int)integer);
+        } else if (conversion == 'p') {
+            written = snprintf(line + used, size - used, "0x%08lx", (unsigned long)integer);
+        } else {
+            spec[specLength++] = 'l';
+            spec[specLength++] = 'l';
+            spec[specLength++] = strchr("diouxX", conversion) != NULL ? conversion : 'd';
+            spec[specLength] = '\0';
+            if (tag == LogRecord::TAG_F32) {
+                integer = (uint64_t)(int64_t)real;
+            }
+            if (spec[specLength - 1] == 'd' || spec[specLength - 1] == 'i') {
+                written = snprintf(line + used, size - used, spec, (long long)integer);
+            } else {
+                written = snprintf(line + used, size - used, spec, (unsigned long long)integer);
+            }
+        }
+
+        if (written > 0) {
+            used += written < (int)(size - used) ? written : size - used - 1;
+        }
+    }
+
+    line[used] = '\0';
+    return used;
+}
@@ -0,0 +1,167 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <type_traits>
+#include "config.h"
+
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Levels above LOG_LEVEL compile away, but their arguments are still
+// type-checked and count as used, so values computed only for a log line
+// do not turn into unused-variable warnings
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(format, ...) logger.write(LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...) do { if (0) logger.write(LOG_LEVEL_ERROR, format, ##__VA_ARGS__); } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(format, ...) logger.write(LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#else
+#define LOG_WARN(format, ...) do { if (0) logger.write(LOG_LEVEL_WARN, format, ##__VA_ARGS__); } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(format, ...) logger.write(LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...) do { if (0) logger.write(LOG_LEVEL_INFO, format, ##__VA_ARGS__); } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(format, ...) logger.write(LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...) do { if (0) logger.write(LOG_LEVEL_DEBUG, format, ##__VA_ARGS__); } while (0)
+#endif
+
+// One log call, encoded as the format string's address (it lives in flash
+// for the life of the firmware) plus typed arguments. Strings are copied
+// since the caller's buffer will not outlive the call.
+class LogRecord {
+public:
+    LogRecord(uint8_t level, const char* format);
+
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value>::type add(T value) {
+        if (sizeof(T) > 4) {
+            put64(std::is_signed<T>::value ? TAG_I64 : TAG_U64, (uint64_t)value);
+        } else {
+            put32(std::is_signed<T>::value ? TAG_I32 : TAG_U32, (uint32_t)value);
+        }
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type add(T value) {
+        put32(TAG_I32, (uint32_t)(int32_t)value);
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type add(T value) {
+        float narrowed = value;
+        uint32_t bits;
+        memcpy(&bits, &narrowed, sizeof(bits));
+        put32(TAG_F32, bits);
+    }
+
+    void add(const char* value);
+    void add(char* value) { add((const char*)value); }
+    void add(const String& value) { add(value.c_str()); }
+    void add(const void* value) { put32(TAG_PTR, (uint32_t)(uintptr_t)value); }
+
+    const uint8_t* data() const { return buffer; }
+    size_t size() const { return length; }
+
+    enum Tag : uint8_t {
+        TAG_I32 = 1,
+        TAG_U32,
+        TAG_I64,
+        TAG_U64,
+        TAG_F32,
+        TAG_PTR,
+        TAG_STR
+    };
+
+    // Record layout: header, then per argument a tag and its payload
+    struct Header {
+        uint16_t size;
+        uint8_t level;
+        uint8_t argCount;
+        uint32_t seq;
+        uint32_t timestamp;
+        const char* format;
+    };
+
+private:
+    uint8_t buffer[LOG_MAX_RECORD];
+    size_t length;
+
+    bool reserve(size_t bytes);
+    void put32(uint8_t tag, uint32_t value);
+    void put64(uint8_t tag, uint64_t value);
+};
+
+// Read position in the log ring
+struct LogCursor {
+    uint32_t seq;
+    uint32_t offset;
+};
+
+// Structured logger: records go into a RAM ring in binary form and are only
+// formatted when something reads them (Serial echo and /ws/log from
+// loop(), /api/dev/logs on demand). write() may be called from any task.
+class Logger {
+public:
+    Logger();
+    void begin(AsyncWebServer& server);
+    void update();
+    void flushSerial();
+
+    template<typename... Args>
+    void write(uint8_t level, const char* format, Args... args) {
+        LogRecord record(level, format);
+        int expand[] = { 0, (record.add(args), 0)... };
+        (void)expand;
+        commit(record);
+    }
+
+    void beginRead(LogCursor& cursor);
+    size_t readLine(LogCursor& cursor, char* line, size_t size, uint8_t* level = NULL, uint32_t* timestamp = NULL);
+    size_t readText(LogCursor& cursor, uint8_t* buffer, size_t maxLen, String& pending);
+    static const char* levelName(uint8_t level);
+
+private:
+    struct SocketClient {
+        bool used;
+        uint32_t id;
+        LogCursor cursor;
+    };
+
+    uint8_t ring[LOG_RING_SIZE];
+    uint32_t head;           // Monotonic byte offsets into the ring
+    uint32_t tail;
+    uint32_t firstSeq;       // Sequence number of the record at tail
+    uint32_t nextSeq;
+    uint32_t dropped;
+    portMUX_TYPE ringLock;
+
+    AsyncWebSocket ws;
+    SemaphoreHandle_t clientLock;
+    SocketClient clients[LOG_MAX_CLIENTS];
+    LogCursor serialCursor;
+
+    void commit(const LogRecord& record);
+    bool copyRecord(LogCursor& cursor, uint8_t* record);
+    void copyOut(uint32_t offset, void* target, size_t size);
+    void copyIn(uint32_t offset, const void* source, size_t size);
+    void onSocketEvent(AsyncWebSocketClient* client, AwsEventType type);
+    void flushSockets();
+    static size_t formatRecord(const uint8_t* record, char* line, size_t size);
+};
+
+extern Logger logger;
+
+#endif // LOGGER_H
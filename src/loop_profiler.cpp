@@ -0,0 +1,214 @@
+#include "loop_profiler.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+LoopProfiler::LoopProfiler() {
+    windowStart = 0;
+    iterationStart = 0;
+    lastMark = 0;
+    previousStart = 0;
+    iterations = 0;
+    maxWorkUs = 0;
+    maxPeriodUs = 0;
+    periodSamples = 0;
+    periodMean = 0;
+    periodM2 = 0;
+    loopStackFree = 0;
+    taskBaselineCount = 0;
+    totalRunTimeBaseline = 0;
+
+    for (int i = 0; i < PERF_SUBSYSTEM_COUNT; i++) {
+        subsystemUs[i] = 0;
+        subsystemMaxUs[i] = 0;
+    }
+
+    // The window (and task baseline) starts with the first loop() iteration
+    resetRequested = true;
+}
+
+void LoopProfiler::beginIteration() {
+    if (resetRequested) {
+        resetRequested = false;
+        reset();
+    }
+
+    unsigned long now = micros();
+
+    // Start-to-start period includes the delay at the end of loop(), so
+    // its spread is the jitter anything scheduled from loop() sees
+    if (previousStart != 0) {
+        uint32_t period = now - previousStart;
+        if (period > maxPeriodUs) maxPeriodUs = period;
+
+        periodSamples++;
+        float delta = period - periodMean;
+        periodMean += delta / periodSamples;
+        periodM2 += delta * (period - periodMean);
+    }
+
+    previousStart = now;
+    iterationStart = now;
+    lastMark = now;
+}
+
+void LoopProfiler::mark(PerfSubsystem subsystem) {
+    // Charges the time since the previous mark to this subsystem
+    unsigned long now = micros();
+    uint32_t elapsed = now - lastMark;
+    lastMark = now;
+
+    subsystemUs[subsystem] += elapsed;
+    if (elapsed > subsystemMaxUs[subsystem]) {
+        subsystemMaxUs[subsystem] = elapsed;
+    }
+}
+
+unsigned long LoopProfiler::endIteration() {
+    uint32_t elapsed = micros() - iterationStart;
+
+    work.record(elapsed);
+    if (elapsed > maxWorkUs) maxWorkUs = elapsed;
+    iterations++;
+
+    // Cheap enough to sample every iteration (reads a watermark word)
+    loopStackFree = uxTaskGetStackHighWaterMark(NULL);
+
+    return elapsed;
+}
+
+void LoopProfiler::requestReset() {
+    resetRequested = true;
+}
+
+void LoopProfiler::reset() {
+    windowStart = millis();
+    previousStart = 0;
+    work.reset();
+    iterations = 0;
+    maxWorkUs = 0;
+    maxPeriodUs = 0;
+    periodSamples = 0;
+    periodMean = 0;
+    periodM2 = 0;
+    loopStackFree = 0;
+
+    for (int i = 0; i < PERF_SUBSYSTEM_COUNT; i++) {
+        subsystemUs[i] = 0;
+        subsystemMaxUs[i] = 0;
+    }
+
+    captureTaskBaseline();
+}
+
+void LoopProfiler::writeJSON(JsonDocument& doc) {
+    // Read from the async_tcp task while loop() keeps recording; values
+    // can be an iteration apart, which is fine for a profile
+    uint64_t workSum = work.sumUs();
+    uint32_t count = iterations;
+
+    doc["windowMs"] = millis() - windowStart;
+    doc["iterations"] = count;
+
+    JsonObject loopStats = doc.createNestedObject("loop");
+    loopStats["avgUs"] = count > 0 ? (uint32_t)(workSum / count) : 0;
+    loopStats["maxUs"] = maxWorkUs;
+    loopStats["periodAvgUs"] = (uint32_t)periodMean;
+    loopStats["periodMaxUs"] = maxPeriodUs;
+    uint32_t samples = periodSamples;
+    loopStats["jitterUs"] = samples > 1 ? (uint32_t)sqrtf(periodM2 / (samples - 1)) : 0;
+    loopStats["targetPeriodUs"] = LOOP_INTERVAL * 1000UL;
+    loopStats["stackFree"] = loopStackFree;
+    work.writeJSON(loopStats.createNestedObject("histogram"));
+
+    JsonArray subsystems = doc.createNestedArray("subsystems");
+    for (int i = 0; i < PERF_SUBSYSTEM_COUNT; i++) {
+        JsonObject entry = subsystems.createNestedObject();
+        entry["name"] = subsystemName((PerfSubsystem)i);
+        entry["totalUs"] = subsystemUs[i];
+        entry["avgUs"] = count > 0 ? subsystemUs[i] / count : 0;
+        entry["maxUs"] = subsystemMaxUs[i];
+        entry["share"] = workSum > 0 ? (float)subsystemUs[i] / workSum : 0;
+    }
+
+    writeTasks(doc);
+}
+
+void LoopProfiler::captureTaskBaseline() {
+    taskBaselineCount = 0;
+    totalRunTimeBaseline = 0;
+
+#if configUSE_TRACE_FACILITY == 1 && configGENERATE_RUN_TIME_STATS == 1
+    UBaseType_t taskCount = uxTaskGetNumberOfTasks();
+    TaskStatus_t* tasks = (TaskStatus_t*)malloc(taskCount * sizeof(TaskStatus_t));
+    if (tasks == NULL) return;
+
+    uint32_t totalRunTime = 0;
+    taskCount = uxTaskGetSystemState(tasks, taskCount, &totalRunTime);
+    for (UBaseType_t i = 0; i < taskCount && taskBaselineCount < PERF_MAX_TASKS; i++) {
+        taskBaseline[taskBaselineCount].number = tasks[i].xTaskNumber;
+        taskBaseline[taskBaselineCount].runTime = tasks[i].ulRunTimeCounter;
+        taskBaselineCount++;
+    }
+    totalRunTimeBaseline = totalRunTime;
+
+    free(tasks);
+#endif
+}
+
+void LoopProfiler::writeTasks(JsonDocument& doc) {
+    // The calling (async_tcp) task's own headroom is always available
+    doc["handlerStackFree"] = uxTaskGetStackHighWaterMark(NULL);
+
+#if configUSE_TRACE_FACILITY == 1
+    UBaseType_t taskCount = uxTaskGetNumberOfTasks();
+    TaskStatus_t* tasks = (TaskStatus_t*)malloc(taskCount * sizeof(TaskStatus_t));
+    if (tasks == NULL) return;
+
+    uint32_t totalRunTime = 0;
+    taskCount = uxTaskGetSystemState(tasks, taskCount, &totalRunTime);
+
+    JsonArray list = doc.createNestedArray("tasks");
+    for (UBaseType_t i = 0; i < taskCount; i++) {
+        JsonObject task = list.createNestedObject();
+        task["name"] = tasks[i].pcTaskName;
+        task["priority"] = tasks[i].uxCurrentPriority;
+        task["stackFree"] = tasks[i].usStackHighWaterMark;
+
+#if configGENERATE_RUN_TIME_STATS == 1
+        // Share of one core over the window (both cores together sum to
+        // 2.0); tasks started since the reset count from zero. The
+        // run-time counter wraps after ~71 minutes.
+        uint32_t base = 0;
+        for (int j = 0; j < taskBaselineCount; j++) {
+            if (taskBaseline[j].number == tasks[i].xTaskNumber) {
+                base = taskBaseline[j].runTime;
+                break;
+            }
+        }
+        uint32_t elapsed = totalRunTime - totalRunTimeBaseline;
+        task["cpu"] = elapsed > 0 ? (float)(tasks[i].ulRunTimeCounter - base) / elapsed : 0;
+#endif
+    }
+
+    free(tasks);
+#endif
+}
+
+const char* LoopProfiler::subsystemName(PerfSubsystem subsystem) {
+    switch (subsystem) {
+        case PERF_BUTTON:
+            return "button";
+        case PERF_TIMER:
+            return "timer";
+        case PERF_DISPLAY:
+            return "display";
+        case PERF_NETWORK:
+            return "network";
+        case PERF_STREAM:
+            return "stream";
+        case PERF_SAVE:
+            return "save";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "metrics.h"
+
+// Parts of loop() that are timed separately
+enum PerfSubsystem {
+    PERF_BUTTON = 0,
+    PERF_TIMER,
+    PERF_DISPLAY,
+    PERF_NETWORK,
+    PERF_STREAM,
+    PERF_SAVE,
+    PERF_SUBSYSTEM_COUNT
+};
+
+// Times loop() iterations and the subsystems inside them, and samples
+// FreeRTOS task CPU share and stack high-water marks. Everything covers
+// the window since the last reset. loop() records; /api/dev/perf reads
+// and may request a reset, which loop() applies on its next iteration.
+class LoopProfiler {
+public:
+    LoopProfiler();
+    void beginIteration();
+    void mark(PerfSubsystem subsystem);
+    unsigned long endIteration();
+    void requestReset();
+    void writeJSON(JsonDocument& doc);
+
+private:
+    struct TaskBaseline {
+        UBaseType_t number;
+        uint32_t runTime;
+    };
+
+    volatile bool resetRequested;
+    unsigned long windowStart;
+    unsigned long iterationStart;
+    unsigned long lastMark;
+    unsigned long previousStart;
+
+    Histogram work;                  // Time spent in loop() itself
+    uint32_t iterations;
+    uint32_t maxWorkUs;
+    uint32_t maxPeriodUs;
+    uint32_t periodSamples;          // Periods measured; one fewer than the iterations
+    float periodMean;                // Running mean and variance of the
+    float periodM2;                  // start-to-start period (jitter)
+
+    uint32_t subsystemUs[PERF_SUBSYSTEM_COUNT];
+    uint32_t subsystemMaxUs[PERF_SUBSYSTEM_COUNT];
+    uint32_t loopStackFree;
+
+    TaskBaseline taskBaseline[PERF_MAX_TASKS];
+    int taskBaselineCount;
+    uint32_t totalRunTimeBaseline;
+
+    void reset();
+    void captureTaskBaseline();
+    void writeTasks(JsonDocument& doc);
+    static const char* subsystemName(PerfSubsystem subsystem);
+};
+
+#endif // LOOP_PROFILER_H
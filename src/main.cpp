@@ -10,49 +10,60 @@
 #include <Adafruit_SSD1306.h>
 #include <ESP32Servo.h>
 #include <time.h>
+#include <memory>
 #include "config.h"
 #include "display.h"
 #include "servo_control.h"
 #include "timer.h"
 #include "button.h"
+#include "settings_store.h"
+#include "status_stream.h"
+#include "wifi_scanner.h"
+#include "network_manager.h"
+#include "boot_timeline.h"
+#include "admission_control.h"
+#include "metrics.h"
+#include "loop_profiler.h"
+#include "metered_preferences.h"
+#include "logger.h"
+#include "input_trace.h"
+#include "ai_worker.h"
+#include "ai_connection.h"
+#include "ai_stream.h"
+#include "conversation.h"
+#include "local_ai.h"
+#include "response_catalog.h"
+#include "intent_classifier.h"
+#include "response_cache.h"
+#include "circuit_breaker.h"
+#include "emergency_sessions.h"
 #include <AsyncWebSocket.h>
-#include <HTTPClient.h>
 
 // Global objects
+Metrics metrics;
+Logger logger;
+InputTrace inputTrace;
 AsyncWebServer server(80);
-AsyncWebSocket ws("/ws");
-Preferences preferences;
+StatusStream statusStream;
+WifiScanner wifiScanner;
+AIWorker aiWorker;
+AIConnection aiConnection;
+LocalAI localAI;
+IntentClassifier intentClassifier;
+ResponseCache responseCache;
+CircuitBreaker openAIBreaker("OpenAI");
+CircuitBreaker localAIBreaker("Local AI");
+EmergencySessions emergencySessions;
+NetworkManager networkManager;
+BootTimeline bootTimeline;
+AdmissionControl admissionControl;
+LoopProfiler profiler;
+MeteredPreferences preferences;
 Display display;
 ServoControl servoControl;
 Timer timer;
 Button button;
 
-// AI Emergency Gatekeeper
-struct EmergencySession {
-    bool active = false;
-    unsigned long startTime = 0;
-    String sessionId = "";
-    int messageCount = 0;
-    String trigger = "";
-    String personality = "supportive";
-    bool reflectionMode = false;
-    int currentReflectionQuestion = 0;
-    String reflectionResponses[5] = {"", "", "", "", ""};
-    bool reflectionCompleted = false;
-};
-
-struct ReflectionSession {
-    String trigger;
-    String personality;
-    int currentQuestion;
-    unsigned long startTime;
-    String responses[5];
-    bool completed;
-};
-
-EmergencySession currentEmergencySession;
-ReflectionSession currentReflection;
-
 // Global variables
 BoxState currentState = SETUP;
 TimerMode currentMode = FIXED_INTERVAL;
@@ -79,8 +90,6 @@ LanguageConfig languageConfig;
 CostConfig costConfig;
 
 // Function declarations
-void setupWiFi();
-void setupTimeSync();
 void setupWebServer();
 void setupHardware();
 void handleWebRequests();
@@ -89,27 +98,34 @@ void saveStatus();
 void loadConfiguration();
 String getStatusJSON();
 void transitionToState(BoxState newState);
+void collectRequestBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total, size_t maxSize);
+bool readJSONBody(AsyncWebServerRequest *request, JsonDocument& doc, size_t maxSize);
+void saveSettingsSection(AsyncWebServerRequest *request, const char* section, const char* message);
+AsyncCallbackWebHandler& onRoute(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload = NULL, ArBodyHandlerFunction onBody = NULL);
+void sendJSON(AsyncWebServerRequest *request, int code, const String& body);
+void applyStoredSettings();
 // AI Emergency Gatekeeper functions
 bool isEmergencyAllowedOnCurrentNetwork();
-void startEmergencySession(String trigger);
-String getAIResponse(String userMessage, String trigger, String personality);
-String getSimpleAIResponse(String userMessage, String trigger, String personality);
-String getEnhancedAIResponse(String userMessage, String trigger, String personality, int messageCount);
-String getWelcomeMessage(String personality);
-String getTriggerAnalysis(String userMessage, String trigger, String personality);
-String getReflectionQuestion(String trigger, int questionNumber);
-String analyzeReflectionResponse(String userMessage, String trigger, String personality);
-String getCopingStrategy(String trigger, String personality);
-String getEncouragementAndAlternatives(String userMessage, String trigger, String personality);
-String getOpenAIResponse(String userMessage, String trigger, String personality);
-String getLocalAIResponse(String userMessage, String trigger, String personality);
+uint32_t startEmergencySession(const String& trigger);
+String getAIResponse(const AIJobInput& job);
+void settleAIJob(const AIJobInput& job, const String* reply);
+bool writeAIJobJSON(uint32_t jobId, JsonDocument& doc);
+void publishAIReply(uint32_t jobId);
+void publishAIPartial(uint32_t jobId, const String& partial);
+String getEnhancedAIResponse(const String& trigger, const String& personality, int messageCount, MessageIntent intent);
+String getReflectionQuestion(const String& trigger, int questionNumber);
+String getOpenAIResponse(uint32_t sessionId, String trigger, String personality, uint32_t turn, uint64_t cacheKey);
+String getLocalAIResponse(uint32_t sessionId, String trigger, String personality, uint32_t turn, uint64_t cacheKey);
+String buildChatRequest(uint32_t sessionId, const String& model, String trigger, String personality, uint32_t turn);
+uint32_t requestedSessionId(AsyncWebServerRequest *request);
 // Reflection system functions
-void startReflectionSession(String trigger, String personality);
-String getNextReflectionQuestion();
-void recordReflectionResponse(String response);
-String generateReflectionSummary();
-bool isReflectionSessionActive();
+void startReflectionSession(uint32_t sessionId);
+String getNextReflectionQuestion(uint32_t sessionId);
+void recordReflectionResponse(uint32_t sessionId);
+String generateReflectionSummary(const EmergencySession& session);
+bool isReflectionSessionActive(uint32_t sessionId);
 void broadcastStatus();
+void publishWifiScan();
 void updateStatistics();
 // Timer mode implementations
 void updateGradualReduction();
@@ -117,34 +133,33 @@ void updateCompleteQuitMode();
 
 void setup() {
     Serial.begin(115200);
-    Serial.println("🚭 Quit Smoking Timer Box - Starting...");
+    LOG_INFO("🚭 Quit Smoking Timer Box - Starting...");
+    bootTimeline.mark("serial");
     
     // Initialize SPIFFS
     if (!SPIFFS.begin(true)) {
-        Serial.println("❌ SPIFFS initialization failed!");
+        LOG_ERROR("❌ SPIFFS initialization failed!");
         return;
     }
+    bootTimeline.mark("spiffs");
     
     // Initialize preferences
     preferences.begin(PREF_NAMESPACE, false);
+    bootTimeline.mark("preferences");
+    
+    // Input recording for replay on the native build, when enabled
+    inputTrace.begin();
     
     // Setup hardware
     setupHardware();
+    bootTimeline.mark("hardware");
     
     // Load saved configuration
     loadConfiguration();
+    bootTimeline.mark("config");
     
-    // Setup WiFi
-    setupWiFi();
-    
-    // Setup web server
-    setupWebServer();
-    
-    // Initialize display with welcome message
-    display.showWelcome();
-    delay(2000);
-    
-    // Start in locked state if timer is active, otherwise unlocked
+    // Restore the lock state before anything slow: start in locked state
+    // if timer is active, otherwise unlocked
     if (timer.isActive()) {
         transitionToState(LOCKED);
         servoControl.lock();
@@ -152,19 +167,47 @@ void setup() {
         transitionToState(UNLOCKED);
         servoControl.unlock();
     }
+    bootTimeline.mark("lock");
+    
+    // Show the welcome message until the first regular display update
+    display.showWelcome();
+    lastDisplayUpdate = millis();
+    bootTimeline.mark("display");
     
-    Serial.println("✅ Quit Smoking Timer Box - Ready!");
-    Serial.print("📱 Web interface: http://");
-    Serial.println(WiFi.softAPIP());
+    // Start WiFi; connecting and NTP continue in the background from loop()
+    networkManager.begin();
+    bootTimeline.mark("network");
+    
+    // Setup web server
+    wifiScanner.begin();
+    aiConnection.begin();
+    aiConnection.setTimeouts(AI_OPENAI_CONNECT_TIMEOUT, AI_OPENAI_REPLY_TIMEOUT);
+    localAI.begin();
+    emergencySessions.begin();
+    intentClassifier.begin();
+    responseCache.begin();
+    openAIBreaker.begin();
+    localAIBreaker.begin();
+    // Health checks of the local model server run between replies
+    aiWorker.begin(getAIResponse, settleAIJob, []() {
+        localAI.checkHealth();
+    });
+    setupWebServer();
+    bootTimeline.mark("webserver");
+    
+    LOG_INFO("✅ Quit Smoking Timer Box - Ready in %lu ms!", millis());
 }
 
 void loop() {
+    profiler.beginIteration();
+    inputTrace.update();
+    
     // Update button state
     button.update();
     
     // Handle button press (emergency unlock from inside)
     if (button.wasPressed() && currentState == LOCKED) {
-        Serial.println("🚨 Emergency button pressed!");
+        LOG_INFO("🚨 Emergency button pressed!");
         
         // Check emergency unlock limits
         int emergencyCount = preferences.getInt(KEY_EMERGENCY_COUNT, 0);
@@ -182,19 +225,20 @@ void loop() {
             transitionToState(UNLOCKED);
             servoControl.unlock();
             
-            Serial.printf("Emergency unlock granted. Penalty: %d minutes added to next timer.\n", EMERGENCY_UNLOCK_PENALTY);
+            LOG_INFO("Emergency unlock granted. Penalty: %d minutes added to next timer.", EMERGENCY_UNLOCK_PENALTY);
         } else {
-            Serial.println("❌ Maximum emergency unlocks per day reached!");
+            LOG_ERROR("❌ Maximum emergency unlocks per day reached!");
             display.showMessage("Emergency limit reached!", 2000);
         }
     }
+    profiler.mark(PERF_BUTTON);
     
     // Update timer
     timer.update();
     
     // Check if timer finished
     if (timer.wasTriggered()) {
-        Serial.println("⏰ Timer finished - Unlocking box");
+        LOG_INFO("⏰ Timer finished - Unlocking box");
         transitionToState(UNLOCKED);
         servoControl.unlock();
         
@@ -219,19 +263,61 @@ void loop() {
         // Broadcast status update to WebSocket clients
         broadcastStatus();
     }
+    profiler.mark(PERF_TIMER);
     
     // Update display periodically
     if (millis() - lastDisplayUpdate >= DISPLAY_UPDATE_INTERVAL) {
         updateDisplay();
         lastDisplayUpdate = millis();
         
-        // Broadcast status every 5 seconds when clients are connected
+        // Publish a fresh snapshot periodically while clients are connected
         static unsigned long lastBroadcast = 0;
-        if (ws.count() > 0 && millis() - lastBroadcast >= 5000) {
+        if (millis() - lastBroadcast >= STREAM_STATUS_INTERVAL) {
             broadcastStatus();
             lastBroadcast = millis();
         }
     }
+    profiler.mark(PERF_DISPLAY);
+    
+    // Bring WiFi and NTP up in the background
+    networkManager.update();
+    wifiConnected = networkManager.isOnline();
+    if (networkManager.wasOnline()) {
+        bootTimeline.milestone(networkManager.isConnected() ? "wifi" : "accessPoint");
+    }
+    if (networkManager.wasTimeSynced()) {
+        bootTimeline.milestone("ntp");
+    }
+    
+    // Collect background WiFi scans and push fresh results to clients;
+    // a scan would abort a connect attempt, so it waits for that to finish
+    if (!networkManager.isConnecting()) {
+        wifiScanner.update();
+    }
+    if (wifiScanner.wasUpdated()) {
+        publishWifiScan();
+    }
+    profiler.mark(PERF_NETWORK);
+    
+    // Push AI replies the worker has finished and the newest text of one
+    // still streaming in; the rest time out here
+    aiWorker.update();
+    aiConnection.update();
+    localAI.update();
+    emergencySessions.update();
+    uint32_t aiJob;
+    while (aiWorker.takeFinished(aiJob)) {
+        publishAIReply(aiJob);
+    }
+    String aiPartial;
+    if (aiWorker.takeProgress(aiJob, aiPartial)) {
+        publishAIPartial(aiJob, aiPartial);
+    }
+    
+    // Feed stream clients that have room, ping and reap the rest
+    statusStream.update();
+    logger.update();
+    profiler.mark(PERF_STREAM);
     
     // Save status and update statistics periodically
     if (millis() - lastStatusSave >= 60000) { // Every minute
@@ -245,21 +331,26 @@ void loop() {
     if (millis() - lastReset >= 86400000) { // 24 hours
         preferences.putInt(KEY_EMERGENCY_COUNT, 0);
         lastReset = millis();
-        Serial.println("🔄 Daily emergency count reset");
+        LOG_INFO("🔄 Daily emergency count reset");
     }
+    profiler.mark(PERF_SAVE);
     
-    delay(50); // Small delay to prevent watchdog issues
+    // Sleep for the rest of the period rather than a fixed 50 ms, so the
+    // loop keeps its cadence; delay() also lets lower-priority tasks run
+    unsigned long busyMs = profiler.endIteration() / 1000;
+    delay(busyMs < LOOP_INTERVAL ? LOOP_INTERVAL - busyMs : 1);
 }
 
 void setupHardware() {
-    Serial.println("🔧 Initializing hardware...");
+    LOG_INFO("🔧 Initializing hardware...");
     
     // Initialize I2C for OLED
     Wire.begin(OLED_SDA, OLED_SCL);
     
     // Initialize display
     if (!display.begin()) {
-        Serial.println("❌ OLED display initialization failed!");
+        LOG_ERROR("❌ OLED display initialization failed!");
+        logger.flushSerial();
         while (1) delay(100);
     }
     
@@ -272,102 +363,32 @@ void setupHardware() {
     // Initialize button
     button.begin();
     
-    Serial.println("✅ Hardware initialized");
+    LOG_INFO("✅ Hardware initialized");
 }
 
-void setupWiFi() {
-    Serial.println("📶 Setting up WiFi...");
-    
-    // Try to connect to stored WiFi credentials first
-    String storedSSID = preferences.getString("wifi_ssid", "");
-    String storedPassword = preferences.getString("wifi_password", "");
-    
-    if (storedSSID.length() > 0) {
-        Serial.printf("🔄 Attempting to connect to stored WiFi: %s\n", storedSSID.c_str());
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(storedSSID.c_str(), storedPassword.c_str());
-        
-        // Wait up to 15 seconds for connection
-        int attempts = 0;
-        while (WiFi.status() != WL_CONNECTED && attempts < 30) {
-            delay(500);
-            Serial.print(".");
-            attempts++;
-        }
-        
-        if (WiFi.status() == WL_CONNECTED) {
-            Serial.println("\n✅ Connected to WiFi!");
-            Serial.printf("📱 IP Address: %s\n", WiFi.localIP().toString().c_str());
-            wifiConnected = true;
-            setupTimeSync();
-            return;
-        } else {
-            Serial.println("\n❌ Failed to connect to stored WiFi");
-        }
-    }
+void setupWebServer() {
+    LOG_INFO("🌐 Setting up web server...");
     
-    // Fall back to Access Point mode
-    Serial.println("📶 Starting WiFi Access Point...");
-    WiFi.mode(WIFI_AP);
+    // Rate limiting and low-memory shedding; must be the first handler so
+    // it sees every request before the real handlers allocate anything
+    server.addHandler(&admissionControl);
     
-    bool apStarted = WiFi.softAP(AP_SSID, AP_PASSWORD);
+    // Live status over WebSocket (/ws) and Server-Sent Events (/api/events)
+    statusStream.begin(server);
     
-    if (apStarted) {
-        IPAddress ip = WiFi.softAPIP();
-        Serial.printf("✅ WiFi AP started: %s\n", AP_SSID);
-        Serial.printf("📱 IP Address: %s\n", ip.toString().c_str());
-        Serial.printf("🔐 Password: %s\n", AP_PASSWORD);
-        wifiConnected = true;
-        
-        // Setup time synchronization (NTP)
-        setupTimeSync();
-    } else {
-        Serial.println("❌ Failed to start WiFi AP!");
-        wifiConnected = false;
-    }
-}
-
-void setupTimeSync() {
-    Serial.println("🕒 Setting up time synchronization...");
-    
-    // Configure NTP
-    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-    
-    // Wait for time to be set
-    int attempts = 0;
-    while (time(nullptr) < 1000000000L && attempts < 20) {
-        delay(500);
-        Serial.print(".");
-        attempts++;
-    }
-    
-    if (time(nullptr) > 1000000000L) {
-        Serial.println("\n✅ Time synchronized with NTP");
-        
-        struct tm timeinfo;
-        if (getLocalTime(&timeinfo)) {
-            Serial.printf("📅 Current time: %04d-%02d-%02d %02d:%02d:%02d\n",
-                         timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
-                         timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
-        }
-    } else {
-        Serial.println("\n⚠️ Failed to synchronize time with NTP");
-    }
-}
-
-void setupWebServer() {
-    Serial.println("🌐 Setting up web server...");
+    // Live log records over WebSocket (/ws/log)
+    logger.begin(server);
     
     // Serve static files from SPIFFS
     server.serveStatic("/", SPIFFS, "/").setDefaultFile("index.html");
     
     // API endpoint: Get current status
-    server.on("/api/status", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(200, "application/json", getStatusJSON());
+    onRoute("/api/status", HTTP_GET, [](AsyncWebServerRequest *request) {
+        sendJSON(request, 200, getStatusJSON());
     });
     
     // API endpoint: Get configuration
-    server.on("/api/config", HTTP_GET, [](AsyncWebServerRequest *request) {
+    onRoute("/api/config", HTTP_GET, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument doc(1024);
         
         TimerMode currentMode = (TimerMode)preferences.getInt(KEY_TIMER_MODE, FIXED_INTERVAL);
@@ -390,55 +411,20 @@ void setupWebServer() {
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
     
     // API endpoint: Save configuration
-    server.on("/api/config", HTTP_POST, [](AsyncWebServerRequest *request) {
-        // Handle POST data
+    onRoute("/api/config", HTTP_POST, [](AsyncWebServerRequest *request) {
+        // Same checks as the timer section of /api/settings; the schedule is
+        // re-applied from the stored values
+        saveSettingsSection(request, "timer", "Configuration saved");
     }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
-        DynamicJsonDocument doc(1024);
-        deserializeJson(doc, (char*)data);
-        
-        // Save basic configuration
-        TimerMode newMode = (TimerMode)doc["timerMode"].as<int>();
-        preferences.putInt(KEY_TIMER_MODE, newMode);
-        preferences.putInt(KEY_INTERVAL_MINUTES, doc["intervalMinutes"]);
-        preferences.putInt(KEY_DAILY_LIMIT, doc["dailyLimit"]);
-        
-        // Handle schedule configuration for new modes
-        if (newMode == DAILY_SCHEDULE || newMode == WEEKLY_SCHEDULE || newMode == CUSTOM_SCHEDULE) {
-            if (doc.containsKey("scheduleHour") && doc.containsKey("scheduleMinute")) {
-                int hour = doc["scheduleHour"];
-                int minute = doc["scheduleMinute"];
-                int unlockDuration = doc["unlockDuration"] | 30; // Default 30 minutes
-                
-                if (newMode == DAILY_SCHEDULE) {
-                    timer.setDailySchedule(hour, minute, unlockDuration);
-                } else if (newMode == WEEKLY_SCHEDULE && doc.containsKey("weekDay")) {
-                    int weekDay = doc["weekDay"];
-                    timer.setWeeklySchedule(weekDay, hour, minute, unlockDuration);
-                }
-                
-                Serial.printf("📅 Schedule configured: %02d:%02d for %d minutes\n", hour, minute, unlockDuration);
-            }
-        }
-        
-        currentMode = newMode;
-        
-        DynamicJsonDocument response(256);
-        response["success"] = true;
-        response["message"] = "Configuration saved";
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        request->send(200, "application/json", responseStr);
-        
-        Serial.println("💾 Configuration updated via web interface");
+        collectRequestBody(request, data, len, index, total, API_MAX_BODY_SIZE);
     });
     
     // API endpoint: Manual unlock
-    server.on("/api/unlock", HTTP_POST, [](AsyncWebServerRequest *request) {
+    onRoute("/api/unlock", HTTP_POST, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument response(256);
         
         if (currentState != UNLOCKED) {
@@ -449,7 +435,7 @@ void setupWebServer() {
             response["success"] = true;
             response["message"] = "Box unlocked";
             
-            Serial.println("🔓 Manual unlock via web interface");
+            LOG_INFO("🔓 Manual unlock via web interface");
         } else {
             response["success"] = false;
             response["message"] = "Box already unlocked";
@@ -457,44 +443,11 @@ void setupWebServer() {
         
         String responseStr;
         serializeJson(response, responseStr);
-        request->send(200, "application/json", responseStr);
-    });
-    
-    // API endpoint: Emergency unlock
-    server.on("/api/emergency", HTTP_POST, [](AsyncWebServerRequest *request) {
-        DynamicJsonDocument response(256);
-        
-        int emergencyCount = preferences.getInt(KEY_EMERGENCY_COUNT, 0);
-        
-        if (emergencyCount < MAX_EMERGENCY_UNLOCKS_PER_DAY) {
-            preferences.putInt(KEY_EMERGENCY_COUNT, emergencyCount + 1);
-            
-            // Add penalty
-            int currentInterval = preferences.getInt(KEY_INTERVAL_MINUTES, DEFAULT_TIMER_MINUTES);
-            int newInterval = currentInterval + EMERGENCY_UNLOCK_PENALTY;
-            preferences.putInt(KEY_INTERVAL_MINUTES, newInterval);
-            
-            timer.stop();
-            transitionToState(UNLOCKED);
-            servoControl.unlock();
-            
-            response["success"] = true;
-            response["penalty"] = EMERGENCY_UNLOCK_PENALTY;
-            response["message"] = "Emergency unlock granted";
-            
-            Serial.println("🚨 Emergency unlock via web interface");
-        } else {
-            response["success"] = false;
-            response["message"] = "Emergency unlock limit reached";
-        }
-        
-        String responseStr;
-        serializeJson(response, responseStr);
-        request->send(200, "application/json", responseStr);
+        sendJSON(request, 200, responseStr);
     });
     
     // API endpoint: Reset progress
-    server.on("/api/reset", HTTP_POST, [](AsyncWebServerRequest *request) {
+    onRoute("/api/reset", HTTP_POST, [](AsyncWebServerRequest *request) {
         // Reset all stored data
         preferences.clear();
         
@@ -509,14 +462,14 @@ void setupWebServer() {
         
         String responseStr;
         serializeJson(response, responseStr);
-        request->send(200, "application/json", responseStr);
+        sendJSON(request, 200, responseStr);
         
-        Serial.println("🔄 Progress reset via web interface");
+        LOG_INFO("🔄 Progress reset via web interface");
     });
     
     // API endpoint: Test servo
-    server.on("/api/test", HTTP_POST, [](AsyncWebServerRequest *request) {
-        Serial.println("🧪 Testing servo...");
+    onRoute("/api/test", HTTP_POST, [](AsyncWebServerRequest *request) {
+        LOG_INFO("🧪 Testing servo...");
         
         // Test servo movement
         servoControl.unlock();
@@ -537,11 +490,11 @@ void setupWebServer() {
         
         String responseStr;
         serializeJson(response, responseStr);
-        request->send(200, "application/json", responseStr);
+        sendJSON(request, 200, responseStr);
     });
     
     // API endpoint: Schedule information
-    server.on("/api/schedule-info", HTTP_GET, [](AsyncWebServerRequest *request) {
+    onRoute("/api/schedule-info", HTTP_GET, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument doc(512);
         
         TimerMode currentMode = (TimerMode)preferences.getInt(KEY_TIMER_MODE, FIXED_INTERVAL);
@@ -556,47 +509,96 @@ void setupWebServer() {
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
 
     // AI Configuration endpoints
-    server.on("/api/ai/config", HTTP_GET, [](AsyncWebServerRequest *request) {
+    onRoute("/api/ai/config", HTTP_GET, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument doc(1024);
         
         doc["enabled"] = preferences.getBool("ai_enabled", false);
         doc["provider"] = preferences.getString("ai_provider", "simple");
         doc["apiKey"] = preferences.getString("ai_api_key", "");
-        doc["delayMinutes"] = preferences.getInt("ai_delay_min", 10);
+        doc["delayMinutes"] = preferences.getInt(KEY_AI_DELAY_MINUTES, 10);
         doc["personality"] = preferences.getString("ai_personality", "supportive");
+        doc["localUrl"] = preferences.getString(KEY_AI_LOCAL_URL, "");
+        doc["localModel"] = preferences.getString(KEY_AI_LOCAL_MODEL, AI_LOCAL_MODEL);
+        doc["localConnectTimeout"] = preferences.getInt(KEY_AI_LOCAL_CONNECT, AI_LOCAL_CONNECT_TIMEOUT);
+        doc["localTimeout"] = preferences.getInt(KEY_AI_LOCAL_TIMEOUT, AI_LOCAL_REPLY_TIMEOUT);
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
 
-    server.on("/api/ai/config", HTTP_POST, [](AsyncWebServerRequest *request) {
-        // Handle AI configuration updates
+    onRoute("/api/ai/config", HTTP_POST, [](AsyncWebServerRequest *request) {
+        saveSettingsSection(request, "ai", "AI configuration saved");
     }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
-        DynamicJsonDocument doc(1024);
-        deserializeJson(doc, (char*)data);
+        collectRequestBody(request, data, len, index, total, API_MAX_BODY_SIZE);
+    });
+
+    // Complete AI emergency unlock. Registered ahead of /api/emergency/ai
+    // and /api/emergency: a handler also takes every URL below its own
+    onRoute("/api/emergency/ai/complete", HTTP_POST, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument response(256);
         
-        preferences.putBool("ai_enabled", doc["enabled"]);
-        preferences.putString("ai_provider", doc["provider"].as<String>());
-        preferences.putString("ai_api_key", doc["apiKey"].as<String>());
-        preferences.putInt("ai_delay_min", doc["delayMinutes"]);
-        preferences.putString("ai_personality", doc["personality"].as<String>());
+        uint32_t sessionId = requestedSessionId(request);
+        if (sessionId == 0) {
+            response["success"] = false;
+            response["message"] = "sessionId is required";
+            String responseStr;
+            serializeJson(response, responseStr);
+            sendJSON(request, 400, responseStr);
+            return;
+        }
         
-        DynamicJsonDocument response(256);
-        response["success"] = true;
-        response["message"] = "AI configuration saved";
+        EmergencySession session;
+        if (!emergencySessions.get(sessionId, session)) {
+            response["success"] = false;
+            response["message"] = "No active emergency session";
+            String responseStr;
+            serializeJson(response, responseStr);
+            sendJSON(request, 400, responseStr);
+            return;
+        }
+
+        unsigned long elapsed = (millis() - session.startedAt) / 1000;
+        unsigned long required = AI_EMERGENCY_DELAY_MINUTES * 60;
+        
+        if (elapsed >= required && session.messageCount >= AI_MIN_MESSAGES) {
+            // Grant emergency unlock
+            int emergencyCount = preferences.getInt(KEY_EMERGENCY_COUNT, 0);
+            preferences.putInt(KEY_EMERGENCY_COUNT, emergencyCount + 1);
+            
+            // Add penalty
+            int currentInterval = preferences.getInt(KEY_INTERVAL_MINUTES, DEFAULT_TIMER_MINUTES);
+            int newInterval = currentInterval + (EMERGENCY_UNLOCK_PENALTY * 2); // Double penalty for AI bypass
+            preferences.putInt(KEY_INTERVAL_MINUTES, newInterval);
+            
+            timer.stop();
+            transitionToState(UNLOCKED);
+            servoControl.unlock();
+            
+            // End session
+            emergencySessions.end(session.id);
+            
+            response["success"] = true;
+            response["penalty"] = EMERGENCY_UNLOCK_PENALTY * 2;
+            response["message"] = "Emergency unlock granted after AI session";
+            
+            LOG_INFO("🤖 AI Emergency unlock granted");
+        } else {
+            response["success"] = false;
+            response["message"] = "Session requirements not met";
+        }
         
         String responseStr;
         serializeJson(response, responseStr);
-        request->send(200, "application/json", responseStr);
+        sendJSON(request, 200, responseStr);
     });
 
     // AI Emergency unlock endpoint
-    server.on("/api/emergency/ai", HTTP_POST, [](AsyncWebServerRequest *request) {
+    onRoute("/api/emergency/ai", HTTP_POST, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument response(512);
         
         bool aiEnabled = preferences.getBool("ai_enabled", false);
@@ -605,7 +607,7 @@ void setupWebServer() {
             response["message"] = "AI Emergency Gatekeeper not enabled";
             String responseStr;
             serializeJson(response, responseStr);
-            request->send(400, "application/json", responseStr);
+            sendJSON(request, 400, responseStr);
             return;
         }
 
@@ -615,164 +617,316 @@ void setupWebServer() {
             response["message"] = "Emergency unlock blocked on this network";
             String responseStr;
             serializeJson(response, responseStr);
-            request->send(403, "application/json", responseStr);
+            sendJSON(request, 403, responseStr);
             return;
         }
 
         // Start AI session
         String trigger = request->getParam("trigger", true) ? request->getParam("trigger", true)->value() : "general";
-        startEmergencySession(trigger);
+        uint32_t sessionId = startEmergencySession(trigger);
         
         response["success"] = true;
         response["aiSession"] = true;
-        response["sessionId"] = currentEmergencySession.sessionId;
+        response["sessionId"] = String(sessionId, HEX);
         response["minDuration"] = AI_EMERGENCY_DELAY_MINUTES * 60; // seconds
         response["message"] = "AI Emergency session started";
         
         String responseStr;
         serializeJson(response, responseStr);
-        request->send(200, "application/json", responseStr);
+        sendJSON(request, 200, responseStr);
     });
 
     // AI Chat endpoint
-    server.on("/api/ai/chat", HTTP_POST, [](AsyncWebServerRequest *request) {
-        // Handle AI chat messages
-    }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
-        DynamicJsonDocument doc(512);
-        deserializeJson(doc, (char*)data);
+    onRoute("/api/ai/chat", HTTP_POST, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument doc(API_MAX_BODY_SIZE);
+        if (!readJSONBody(request, doc, API_MAX_BODY_SIZE)) {
+            return;
+        }
         
         DynamicJsonDocument response(1024);
         
-        if (!currentEmergencySession.active) {
+        // The session the client started; with several phones in sessions
+        // at once, none can be assumed
+        JsonVariantConst sessionField = doc["sessionId"];
+        uint32_t sessionId = sessionField.is<const char*>() ? strtoul(sessionField.as<const char*>(), NULL, 16) : 0;
+        if (sessionId == 0) {
+            response["success"] = false;
+            response["message"] = "sessionId is required";
+            String responseStr;
+            serializeJson(response, responseStr);
+            sendJSON(request, 400, responseStr);
+            return;
+        }
+        
+        EmergencySession session;
+        if (!emergencySessions.get(sessionId, session)) {
             response["success"] = false;
             response["message"] = "No active emergency session";
             String responseStr;
             serializeJson(response, responseStr);
-            request->send(400, "application/json", responseStr);
+            sendJSON(request, 400, responseStr);
             return;
         }
 
-        String userMessage = doc["message"];
-        String personality = preferences.getString("ai_personality", "supportive");
+        JsonVariantConst message = doc["message"];
+        if (!message.is<const char*>() || strlen(message.as<const char*>()) > AI_MAX_MESSAGE_LENGTH) {
+            response["success"] = false;
+            response["message"] = "Message must be a string of at most " + String(AI_MAX_MESSAGE_LENGTH) + " characters";
+            String responseStr;
+            serializeJson(response, responseStr);
+            sendJSON(request, 400, responseStr);
+            return;
+        }
+
+        // A trigger the message names answers it, and becomes the
+        // session's if the client did not give one the counselor knows
+        MessageClass heard;
+        unsigned long classifyStart = micros();
+        intentClassifier.classify(message.as<const char*>(), heard);
+        LOG_DEBUG("🧭 Message read as %s/%s in %lu us", catalogTriggerName(heard.trigger),
+                  IntentClassifier::intentName(heard.intent), micros() - classifyStart);
+        if (heard.trigger != CATALOG_OTHER_TRIGGER && catalogTrigger(session.trigger) == CATALOG_OTHER_TRIGGER) {
+            emergencySessions.setTrigger(session.id, catalogTriggerName(heard.trigger));
+        }
         
-        String aiResponse = getAIResponse(userMessage, currentEmergencySession.trigger, personality);
-        currentEmergencySession.messageCount++;
+        // The reply is produced by the AI worker; it arrives over /ws as an
+        // aiReply message or from /api/ai/job?id=
+        AIJobInput job;
+        job.message = message.as<const char*>();
+        job.trigger = heard.trigger != CATALOG_OTHER_TRIGGER ? String(catalogTriggerName(heard.trigger)) : String(session.trigger);
+        job.intent = heard.intent;
+        job.personality = preferences.getString("ai_personality", "supportive");
+        job.provider = preferences.getString("ai_provider", "simple");
+        job.messageCount = session.messageCount + 1;
+        job.session = session.id;
+        job.turn = emergencySessions.addMessage(session.id, CONVERSATION_USER, job.message);
+        if (job.turn == 0) {
+            // Ended since it was looked up
+            response["success"] = false;
+            response["message"] = "No active emergency session";
+            String responseStr;
+            serializeJson(response, responseStr);
+            sendJSON(request, 400, responseStr);
+            return;
+        }
         
-        unsigned long elapsed = (millis() - currentEmergencySession.startTime) / 1000;
-        unsigned long required = AI_EMERGENCY_DELAY_MINUTES * 60;
-        bool canUnlock = elapsed >= required && currentEmergencySession.messageCount >= 5;
+        uint32_t jobId = aiWorker.submit(job);
+        if (jobId == 0) {
+            emergencySessions.removeMessage(session.id, job.turn);
+            AsyncWebServerResponse *busy = request->beginResponse(503, "application/json",
+                "{\"success\":false,\"message\":\"AI counselor is busy, try again shortly\"}");
+            busy->addHeader("Retry-After", String(ADMISSION_RETRY_AFTER));
+            request->send(busy);
+            return;
+        }
+        emergencySessions.countMessage(session.id);
         
-        response["success"] = true;
-        response["message"] = aiResponse;
-        response["elapsed"] = elapsed;
-        response["required"] = required;
-        response["canUnlock"] = canUnlock;
-        response["messageCount"] = currentEmergencySession.messageCount;
+        writeAIJobJSON(jobId, response);
         
         String responseStr;
         serializeJson(response, responseStr);
-        request->send(200, "application/json", responseStr);
+        sendJSON(request, 202, responseStr);
+    }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        collectRequestBody(request, data, len, index, total, API_MAX_BODY_SIZE);
     });
 
-    // Complete AI emergency unlock
-    server.on("/api/emergency/ai/complete", HTTP_POST, [](AsyncWebServerRequest *request) {
-        DynamicJsonDocument response(256);
+    // Local model server: settings and the last health check
+    onRoute("/api/ai/local", HTTP_GET, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument doc(512);
+        localAI.writeJSON(doc);
         
-        if (!currentEmergencySession.active) {
-            response["success"] = false;
-            response["message"] = "No active emergency session";
-            String responseStr;
-            serializeJson(response, responseStr);
-            request->send(400, "application/json", responseStr);
+        String response;
+        serializeJson(doc, response);
+        sendJSON(request, 200, response);
+    });
+    
+    // Cached provider replies and how often they were reused
+    onRoute("/api/ai/cache", HTTP_GET, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument doc(384);
+        responseCache.writeJSON(doc);
+        
+        String response;
+        serializeJson(doc, response);
+        sendJSON(request, 200, response);
+    });
+    
+    // AI reply, for clients that missed the /ws push
+    onRoute("/api/ai/job", HTTP_GET, [](AsyncWebServerRequest *request) {
+        uint32_t jobId = request->hasParam("id") ? strtoul(request->getParam("id")->value().c_str(), NULL, 10) : 0;
+        
+        DynamicJsonDocument doc(2048);
+        if (!writeAIJobJSON(jobId, doc)) {
+            sendJSON(request, 404, "{\"success\":false,\"message\":\"Unknown or expired job\"}");
             return;
         }
-
-        unsigned long elapsed = (millis() - currentEmergencySession.startTime) / 1000;
-        unsigned long required = AI_EMERGENCY_DELAY_MINUTES * 60;
         
-        if (elapsed >= required && currentEmergencySession.messageCount >= 5) {
-            // Grant emergency unlock
-            int emergencyCount = preferences.getInt(KEY_EMERGENCY_COUNT, 0);
+        String response;
+        serializeJson(doc, response);
+        sendJSON(request, 200, response);
+    });
+    
+    // API endpoint: Emergency unlock
+    onRoute("/api/emergency", HTTP_POST, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument response(256);
+        
+        int emergencyCount = preferences.getInt(KEY_EMERGENCY_COUNT, 0);
+        
+        if (emergencyCount < MAX_EMERGENCY_UNLOCKS_PER_DAY) {
             preferences.putInt(KEY_EMERGENCY_COUNT, emergencyCount + 1);
             
             // Add penalty
             int currentInterval = preferences.getInt(KEY_INTERVAL_MINUTES, DEFAULT_TIMER_MINUTES);
-            int newInterval = currentInterval + (EMERGENCY_UNLOCK_PENALTY * 2); // Double penalty for AI bypass
+            int newInterval = currentInterval + EMERGENCY_UNLOCK_PENALTY;
             preferences.putInt(KEY_INTERVAL_MINUTES, newInterval);
             
             timer.stop();
             transitionToState(UNLOCKED);
             servoControl.unlock();
             
-            // End session
-            currentEmergencySession.active = false;
-            
             response["success"] = true;
-            response["penalty"] = EMERGENCY_UNLOCK_PENALTY * 2;
-            response["message"] = "Emergency unlock granted after AI session";
+            response["penalty"] = EMERGENCY_UNLOCK_PENALTY;
+            response["message"] = "Emergency unlock granted";
             
-            Serial.println("🤖 AI Emergency unlock granted");
+            LOG_INFO("🚨 Emergency unlock via web interface");
         } else {
             response["success"] = false;
-            response["message"] = "Session requirements not met";
+            response["message"] = "Emergency unlock limit reached";
         }
         
         String responseStr;
         serializeJson(response, responseStr);
-        request->send(200, "application/json", responseStr);
+        sendJSON(request, 200, responseStr);
     });
-
+    
     // Security configuration (alias for network config to match frontend expectations)
-    server.on("/api/security/config", HTTP_GET, [](AsyncWebServerRequest *request) {
+    onRoute("/api/security/config", HTTP_GET, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument doc(1024);
         
-        doc["allowedNetworks"] = preferences.getString("allowed_networks", "[]");
-        doc["blockedNetworks"] = preferences.getString("blocked_networks", "[]");
+        doc["allowedNetworks"] = preferences.getString(KEY_ALLOWED_NETWORKS, "[]");
+        doc["blockedNetworks"] = preferences.getString(KEY_BLOCKED_NETWORKS, "[]");
         doc["blockOnPublic"] = preferences.getBool("block_on_public", false);
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
 
-    server.on("/api/security/config", HTTP_POST, [](AsyncWebServerRequest *request) {
-        // Handle security configuration
+    onRoute("/api/security/config", HTTP_POST, [](AsyncWebServerRequest *request) {
+        saveSettingsSection(request, "security", "Security configuration saved");
     }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
-        DynamicJsonDocument doc(1024);
-        deserializeJson(doc, (char*)data);
+        collectRequestBody(request, data, len, index, total, API_MAX_BODY_SIZE);
+    });
+    
+    // Bulk settings: the full tree on GET, the full tree or a partial patch on POST
+    onRoute("/api/settings", HTTP_GET, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument doc(3072);
+        writeSettingsJSON(doc);
         
-        preferences.putString("allowed_networks", doc["allowedNetworks"].as<String>());
-        preferences.putString("blocked_networks", doc["blockedNetworks"].as<String>());
-        preferences.putBool("block_on_public", doc["blockOnPublic"]);
+        String response;
+        serializeJson(doc, response);
+        sendJSON(request, 200, response);
+    });
+    
+    onRoute("/api/settings", HTTP_POST, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument response(512);
+        
+        if (request->contentLength() > SETTINGS_MAX_BODY_SIZE) {
+            response["success"] = false;
+            response["error"] = "Settings body too large";
+            String responseStr;
+            serializeJson(response, responseStr);
+            sendJSON(request, 413, responseStr);
+            return;
+        }
+        
+        char* body = (char*)request->_tempObject;
+        if (body == NULL) {
+            response["success"] = false;
+            response["error"] = "Settings body required";
+            String responseStr;
+            serializeJson(response, responseStr);
+            sendJSON(request, 400, responseStr);
+            return;
+        }
+        
+        DynamicJsonDocument doc(SETTINGS_MAX_BODY_SIZE);
+        DeserializationError error = deserializeJson(doc, body);
+        if (error) {
+            response["success"] = false;
+            response["error"] = String("Invalid JSON: ") + error.c_str();
+            String responseStr;
+            serializeJson(response, responseStr);
+            sendJSON(request, 400, responseStr);
+            return;
+        }
+        
+        // Optional optimistic concurrency check against a second open settings page
+        if (doc.containsKey("baseVersion") && doc["baseVersion"].as<uint32_t>() != getSettingsVersion()) {
+            response["success"] = false;
+            response["error"] = "Settings were changed elsewhere";
+            response["version"] = getSettingsVersion();
+            String responseStr;
+            serializeJson(response, responseStr);
+            sendJSON(request, 409, responseStr);
+            return;
+        }
+        
+        // Everything is validated before anything is written
+        SettingsTransaction transaction;
+        String validationError;
+        if (!stageSettingsPatch(doc.as<JsonVariantConst>(), transaction, validationError)) {
+            response["success"] = false;
+            response["error"] = validationError;
+            String responseStr;
+            serializeJson(response, responseStr);
+            sendJSON(request, 400, responseStr);
+            return;
+        }
+        
+        size_t changed = transaction.pendingCount();
+        if (!transaction.commit()) {
+            response["success"] = false;
+            response["error"] = "Failed to store settings";
+            String responseStr;
+            serializeJson(response, responseStr);
+            sendJSON(request, 500, responseStr);
+            return;
+        }
+        
+        if (changed > 0) {
+            applyStoredSettings();
+        }
         
-        DynamicJsonDocument response(256);
         response["success"] = true;
-        response["message"] = "Security configuration saved";
+        response["version"] = transaction.getVersion();
+        response["changed"] = changed;
         
         String responseStr;
         serializeJson(response, responseStr);
-        request->send(200, "application/json", responseStr);
+        sendJSON(request, 200, responseStr);
+    }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        collectRequestBody(request, data, len, index, total, SETTINGS_MAX_BODY_SIZE);
     });
     
     // Language and cost configuration endpoints
-    server.on("/api/language", HTTP_GET, [](AsyncWebServerRequest *request) {
+    onRoute("/api/language", HTTP_GET, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument doc(512);
         doc["currentLanguage"] = languageConfig.currentLanguage;
         doc["supportedLanguages"] = languageConfig.supportedLanguages;
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
     
-    server.on("/api/language", HTTP_POST, [](AsyncWebServerRequest *request) {
+    onRoute("/api/language", HTTP_POST, [](AsyncWebServerRequest *request) {
         if (request->hasParam("language", true)) {
             String language = request->getParam("language", true)->value();
             
             // Validate language is supported
             if (languageConfig.supportedLanguages.indexOf(language) >= 0) {
                 languageConfig.currentLanguage = language;
-                preferences.putString("current_language", language);
+                preferences.putString(KEY_CURRENT_LANGUAGE, language);
                 
                 DynamicJsonDocument doc(256);
                 doc["success"] = true;
@@ -780,16 +934,16 @@ void setupWebServer() {
                 
                 String response;
                 serializeJson(doc, response);
-                request->send(200, "application/json", response);
+                sendJSON(request, 200, response);
             } else {
-                request->send(400, "application/json", "{\"error\":\"Unsupported language\"}");
+                sendJSON(request, 400, "{\"error\":\"Unsupported language\"}");
             }
         } else {
-            request->send(400, "application/json", "{\"error\":\"Language parameter required\"}");
+            sendJSON(request, 400, "{\"error\":\"Language parameter required\"}");
         }
     });
     
-    server.on("/api/cost-config", HTTP_GET, [](AsyncWebServerRequest *request) {
+    onRoute("/api/cost-config", HTTP_GET, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument doc(512);
         doc["productName"] = costConfig.productName;
         doc["currency"] = costConfig.currency;
@@ -800,10 +954,10 @@ void setupWebServer() {
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
     
-    server.on("/api/cost-config", HTTP_POST, [](AsyncWebServerRequest *request) {
+    onRoute("/api/cost-config", HTTP_POST, [](AsyncWebServerRequest *request) {
         bool updated = false;
         
         if (request->hasParam("productName", true)) {
@@ -838,7 +992,7 @@ void setupWebServer() {
         
         if (request->hasParam("cigarettesPerPack", true)) {
             costConfig.cigarettesPerPack = request->getParam("cigarettesPerPack", true)->value().toInt();
-            preferences.putInt("cigarettes_per_pack", costConfig.cigarettesPerPack);
+            preferences.putInt(KEY_CIGARETTES_PER_PACK, costConfig.cigarettesPerPack);
             updated = true;
         }
         
@@ -850,11 +1004,11 @@ void setupWebServer() {
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
     
     // Developer tools endpoints
-    server.on("/api/servo/calibration", HTTP_GET, [](AsyncWebServerRequest *request) {
+    onRoute("/api/servo/calibration", HTTP_GET, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument doc(256);
         doc["locked"] = SERVO_LOCKED_POSITION;
         doc["unlocked"] = SERVO_UNLOCKED_POSITION;
@@ -862,10 +1016,10 @@ void setupWebServer() {
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
     
-    server.on("/api/servo/calibration", HTTP_POST, [](AsyncWebServerRequest *request) {
+    onRoute("/api/servo/calibration", HTTP_POST, [](AsyncWebServerRequest *request) {
         bool updated = false;
         int lockedPos = SERVO_LOCKED_POSITION;
         int unlockedPos = SERVO_UNLOCKED_POSITION;
@@ -873,7 +1027,7 @@ void setupWebServer() {
         if (request->hasParam("locked", true)) {
             lockedPos = request->getParam("locked", true)->value().toInt();
             if (lockedPos >= 0 && lockedPos <= 180) {
-                preferences.putInt("servo_locked_pos", lockedPos);
+                preferences.putInt(KEY_SERVO_LOCKED_POS, lockedPos);
                 updated = true;
             }
         }
@@ -881,7 +1035,7 @@ void setupWebServer() {
         if (request->hasParam("unlocked", true)) {
             unlockedPos = request->getParam("unlocked", true)->value().toInt();
             if (unlockedPos >= 0 && unlockedPos <= 180) {
-                preferences.putInt("servo_unlocked_pos", unlockedPos);
+                preferences.putInt(KEY_SERVO_UNLOCKED_POS, unlockedPos);
                 updated = true;
             }
         }
@@ -895,10 +1049,10 @@ void setupWebServer() {
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
     
-    server.on("/api/servo/command", HTTP_POST, [](AsyncWebServerRequest *request) {
+    onRoute("/api/servo/command", HTTP_POST, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument doc(256);
         
         if (request->hasParam("command", true)) {
@@ -938,7 +1092,7 @@ void setupWebServer() {
             } else if (command == "setLocked" && request->hasParam("value", true)) {
                 int position = request->getParam("value", true)->value().toInt();
                 if (position >= 0 && position <= 180) {
-                    preferences.putInt("servo_locked_pos", position);
+                    preferences.putInt(KEY_SERVO_LOCKED_POS, position);
                     doc["success"] = true;
                     doc["command"] = "setLocked";
                     doc["position"] = position;
@@ -949,7 +1103,7 @@ void setupWebServer() {
             } else if (command == "setUnlocked" && request->hasParam("value", true)) {
                 int position = request->getParam("value", true)->value().toInt();
                 if (position >= 0 && position <= 180) {
-                    preferences.putInt("servo_unlocked_pos", position);
+                    preferences.putInt(KEY_SERVO_UNLOCKED_POS, position);
                     doc["success"] = true;
                     doc["command"] = "setUnlocked";
                     doc["position"] = position;
@@ -968,11 +1122,11 @@ void setupWebServer() {
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
     
-    server.on("/api/dev/system-info", HTTP_GET, [](AsyncWebServerRequest *request) {
-        DynamicJsonDocument doc(512);
+    onRoute("/api/dev/system-info", HTTP_GET, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument doc(768);
         doc["firmware"] = "v1.0.0";
         doc["hardware"] = "ESP32-S3";
         doc["flashSize"] = ESP.getFlashChipSize();
@@ -991,20 +1145,128 @@ void setupWebServer() {
             network["dns"] = WiFi.dnsIP().toString();
         }
         
+        admissionControl.writeJSON(doc.createNestedObject("admission"));
+        
+        String response;
+        serializeJson(doc, response);
+        sendJSON(request, 200, response);
+    });
+    
+    // Request, fan-out, NVS and I2C metrics; Prometheus text by default,
+    // JSON with ?format=json
+    onRoute("/api/dev/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+        bool json = request->hasParam("format") && request->getParam("format")->value() == "json";
+        
+        std::shared_ptr<MetricsCursor> cursor = std::make_shared<MetricsCursor>();
+        metrics.beginReport(*cursor, json);
+        
+        AsyncWebServerResponse *response = request->beginChunkedResponse(
+            json ? "application/json" : "text/plain; version=0.0.4",
+            [cursor](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return metrics.readReport(*cursor, buffer, maxLen);
+            });
+        response->addHeader("Cache-Control", "no-cache");
+        request->send(response);
+    });
+    
+    // Everything still in the log ring as plain text, oldest first
+    onRoute("/api/dev/logs", HTTP_GET, [](AsyncWebServerRequest *request) {
+        std::shared_ptr<LogCursor> cursor = std::make_shared<LogCursor>();
+        std::shared_ptr<String> pending = std::make_shared<String>();
+        logger.beginRead(*cursor);
+        
+        AsyncWebServerResponse *response = request->beginChunkedResponse("text/plain",
+            [cursor, pending](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return logger.readText(*cursor, buffer, maxLen, *pending);
+            });
+        response->addHeader("Cache-Control", "no-cache");
+        response->addHeader("Content-Disposition", "attachment; filename=\"quitbox.log\"");
+        request->send(response);
+    });
+    
+    // Loop and task profile since the last reset
+    onRoute("/api/dev/perf", HTTP_GET, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument doc(4096);
+        profiler.writeJSON(doc);
+        
+        String response;
+        serializeJson(doc, response);
+        sendJSON(request, 200, response);
+    });
+    
+    onRoute("/api/dev/perf/reset", HTTP_POST, [](AsyncWebServerRequest *request) {
+        profiler.requestReset();
+        sendJSON(request, 200, "{\"success\":true}");
+    });
+    
+    // Recorded inputs, oldest first, for replay in the simulator (lib/sim)
+    onRoute("/api/dev/trace", HTTP_GET, [](AsyncWebServerRequest *request) {
+        if (!inputTrace.isRecording()) {
+            sendJSON(request, 404, "{\"success\":false,\"error\":\"Input trace is off\"}");
+            return;
+        }
+        
+        std::shared_ptr<TraceCursor> cursor = std::make_shared<TraceCursor>();
+        inputTrace.beginRead(*cursor);
+        
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/octet-stream",
+            [cursor](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return inputTrace.read(*cursor, buffer, maxLen);
+            });
+        response->addHeader("Cache-Control", "no-cache");
+        response->addHeader("Content-Disposition", "attachment; filename=\"quitbox.trace\"");
+        request->send(response);
+    });
+    
+    // Turns recording on or off; it starts and stops with the next boot
+    onRoute("/api/dev/trace", HTTP_POST, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument doc(256);
+        if (!readJSONBody(request, doc, API_MAX_BODY_SIZE)) {
+            return;
+        }
+        if (!doc["enabled"].is<bool>()) {
+            sendJSON(request, 400, "{\"success\":false,\"error\":\"enabled must be true or false\"}");
+            return;
+        }
+        
+        bool enabled = doc["enabled"];
+        preferences.putBool(KEY_TRACE_ENABLED, enabled);
+        
+        DynamicJsonDocument response(192);
+        response["success"] = true;
+        response["enabled"] = enabled;
+        response["recording"] = inputTrace.isRecording();
+        response["message"] = "Takes effect after a restart";
+        String responseStr;
+        serializeJson(response, responseStr);
+        sendJSON(request, 200, responseStr);
+    }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        collectRequestBody(request, data, len, index, total, API_MAX_BODY_SIZE);
+    });
+    
+    // Boot phase timing breakdown
+    onRoute("/api/dev/boot", HTTP_GET, [](AsyncWebServerRequest *request) {
+        DynamicJsonDocument doc(1536);
+        bootTimeline.writeJSON(doc);
+        doc["network"] = networkManager.getStateName();
+        doc["timeSynced"] = networkManager.isTimeSynced();
+        
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
     
     // Serve dev.html only if specifically requested
-    server.on("/dev", HTTP_GET, [](AsyncWebServerRequest *request) {
+    onRoute("/dev", HTTP_GET, [](AsyncWebServerRequest *request) {
         request->send(SPIFFS, "/dev.html", "text/html");
     });
     
     // WiFi Management API endpoints
-    server.on("/api/wifi/status", HTTP_GET, [](AsyncWebServerRequest *request) {
+    onRoute("/api/wifi/status", HTTP_GET, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument doc(512);
         doc["connected"] = wifiConnected;
+        doc["state"] = networkManager.getStateName();
+        doc["timeSynced"] = networkManager.isTimeSynced();
         doc["ip"] = wifiConnected ? WiFi.localIP().toString() : "";
         doc["ssid"] = wifiConnected ? WiFi.SSID() : "";
         doc["rssi"] = wifiConnected ? WiFi.RSSI() : 0;
@@ -1014,90 +1276,68 @@ void setupWebServer() {
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
     
-    server.on("/api/wifi/connect", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
-        // Handle JSON body data
-        String body = String((char*)data);
-        DynamicJsonDocument doc(1024);
-        DeserializationError error = deserializeJson(doc, body);
+    onRoute("/api/wifi/connect", HTTP_POST, [](AsyncWebServerRequest *request) {
+        String ssid;
+        String password;
         
-        if (error) {
-            // Fallback to form parameters for compatibility
-            if (!request->hasParam("ssid", true)) {
-                request->send(400, "application/json", "{\"success\":false,\"error\":\"SSID required\"}");
+        if (request->_tempObject != NULL || request->contentLength() > API_MAX_BODY_SIZE) {
+            // JSON body
+            DynamicJsonDocument doc(API_MAX_BODY_SIZE);
+            if (!readJSONBody(request, doc, API_MAX_BODY_SIZE)) {
                 return;
             }
-            
-            String ssid = request->getParam("ssid", true)->value();
-            String password = request->hasParam("password", true) ? request->getParam("password", true)->value() : "";
-            
-            if (ssid.length() > 0) {
-                // Store credentials
-                preferences.putString("wifi_ssid", ssid);
-                preferences.putString("wifi_password", password);
-                
-                // Attempt connection
-                WiFi.mode(WIFI_STA);
-                WiFi.begin(ssid.c_str(), password.c_str());
-                
-                Serial.printf("🔄 Attempting WiFi connection to: %s\n", ssid.c_str());
-                
-                request->send(200, "application/json", "{\"success\":true,\"message\":\"Connection initiated\"}");
-            } else {
-                request->send(400, "application/json", "{\"success\":false,\"error\":\"Invalid SSID\"}");
+            if ((!doc["ssid"].isNull() && !doc["ssid"].is<const char*>()) ||
+                (!doc["password"].isNull() && !doc["password"].is<const char*>())) {
+                sendJSON(request, 400, "{\"success\":false,\"error\":\"SSID and password must be strings\"}");
+                return;
             }
+            ssid = doc["ssid"] | "";
+            password = doc["password"] | "";
+        } else if (request->hasParam("ssid", true)) {
+            // Form parameters for compatibility
+            ssid = request->getParam("ssid", true)->value();
+            password = request->hasParam("password", true) ? request->getParam("password", true)->value() : "";
+        }
+        
+        // 802.11 limits: 32-byte SSID, 63-character passphrase
+        if (ssid.length() == 0 || ssid.length() > 32 || password.length() > 63) {
+            sendJSON(request, 400, "{\"success\":false,\"error\":\"SSID required\"}");
             return;
         }
         
-        // Parse JSON data
-        String ssid = doc["ssid"] | "";
-        String password = doc["password"] | "";
+        // Store credentials and reconnect in the background
+        networkManager.connect(ssid, password);
         
-        if (ssid.length() > 0) {
-            // Store credentials
-            preferences.putString("wifi_ssid", ssid);
-            preferences.putString("wifi_password", password);
-            
-            // Attempt connection
-            WiFi.mode(WIFI_STA);
-            WiFi.begin(ssid.c_str(), password.c_str());
-            
-            Serial.printf("🔄 Attempting WiFi connection to: %s\n", ssid.c_str());
-            
-            request->send(200, "application/json", "{\"success\":true,\"message\":\"Connection initiated\"}");
-        } else {
-            request->send(400, "application/json", "{\"success\":false,\"error\":\"SSID required\"}");
-        }
+        sendJSON(request, 200, "{\"success\":true,\"message\":\"Connection initiated\"}");
+    }, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        collectRequestBody(request, data, len, index, total, API_MAX_BODY_SIZE);
     });
     
-    server.on("/api/wifi/scan", HTTP_GET, [](AsyncWebServerRequest *request) {
-        int n = WiFi.scanNetworks();
-        DynamicJsonDocument doc(2048);
-        JsonArray networks = doc.createNestedArray("networks");
+    onRoute("/api/wifi/scan", HTTP_GET, [](AsyncWebServerRequest *request) {
+        // Answer from the cache right away; a stale cache (or ?refresh)
+        // starts a background scan whose results are pushed over /ws
+        wifiScanner.requestScan(request->hasParam("refresh"));
         
-        for (int i = 0; i < n; i++) {
-            JsonObject network = networks.createNestedObject();
-            network["ssid"] = WiFi.SSID(i);
-            network["rssi"] = WiFi.RSSI(i);
-            network["secure"] = (WiFi.encryptionType(i) != WIFI_AUTH_OPEN);
-        }
+        DynamicJsonDocument doc(2048);
+        wifiScanner.writeJSON(doc);
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
     
     // Setup check endpoint - determines if box needs initial configuration
-    server.on("/api/setup-status", HTTP_GET, [](AsyncWebServerRequest *request) {
+    onRoute("/api/setup-status", HTTP_GET, [](AsyncWebServerRequest *request) {
         DynamicJsonDocument doc(512);
         
         // Check if basic configuration is complete
-        bool hasWifiConfig = preferences.getString("wifi_ssid", "").length() > 0;
+        bool hasWifiConfig = preferences.getString(KEY_WIFI_SSID, "").length() > 0;
         bool hasTimerConfig = preferences.getInt("timer_mode", -1) >= 0;
-        bool hasServoCalibration = preferences.getInt("servo_locked_pos", -1) >= 0 && 
-                                 preferences.getInt("servo_unlocked_pos", -1) >= 0;
+        bool hasServoCalibration = preferences.getInt(KEY_SERVO_LOCKED_POS, -1) >= 0 && 
+                                 preferences.getInt(KEY_SERVO_UNLOCKED_POS, -1) >= 0;
         bool hasCostConfig = preferences.getString("product_name", "").length() > 0;
         
         bool isConfigured = hasTimerConfig && hasServoCalibration;
@@ -1111,7 +1351,7 @@ void setupWebServer() {
         
         String response;
         serializeJson(doc, response);
-        request->send(200, "application/json", response);
+        sendJSON(request, 200, response);
     });
     
     // Handle 404
@@ -1120,7 +1360,7 @@ void setupWebServer() {
     });
     
     server.begin();
-    Serial.println("✅ Web server started");
+    LOG_INFO("✅ Web server started");
 }
 
 void updateDisplay() {
@@ -1154,7 +1394,7 @@ void updateDisplay() {
 
 void transitionToState(BoxState newState) {
     if (currentState != newState) {
-        Serial.printf("🔄 State transition: %d -> %d\n", currentState, newState);
+        LOG_INFO("🔄 State transition: %d -> %d", currentState, newState);
         currentState = newState;
         
         // Trigger immediate display update
@@ -1162,6 +1402,136 @@ void transitionToState(BoxState newState) {
     }
 }
 
+AsyncCallbackWebHandler& onRoute(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest, ArUploadHandlerFunction onUpload, ArBodyHandlerFunction onBody) {
+    // server.on() with the handler (and body callback) timed per route
+    int route = metrics.addRoute(uri, method);
+    
+    ArBodyHandlerFunction meteredBody = NULL;
+    if (onBody) {
+        meteredBody = [route, onBody](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+            unsigned long start = micros();
+            metrics.enterRoute(route);
+            onBody(request, data, len, index, total);
+            metrics.recordBody(route, micros() - start);
+        };
+    }
+    
+    return server.on(uri, method, [route, onRequest](AsyncWebServerRequest *request) {
+        unsigned long start = micros();
+        metrics.enterRoute(route);
+        inputTrace.recordRequest(request);
+        onRequest(request);
+        metrics.exitRoute(route, micros() - start);
+    }, onUpload, meteredBody);
+}
+
+void sendJSON(AsyncWebServerRequest *request, int code, const String& body) {
+    metrics.recordResponse(code, body.length());
+    request->send(code, "application/json", body);
+}
+
+void collectRequestBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total, size_t maxSize) {
+    // Bodies can arrive in several chunks; gather them into one NUL-terminated
+    // buffer that the request handler reads once the body is complete. The
+    // server frees _tempObject together with the request.
+    if (total == 0 || total > maxSize) {
+        return;
+    }
+    
+    if (index == 0 && request->_tempObject == NULL) {
+        request->_tempObject = calloc(total + 1, 1);
+    }
+    
+    if (request->_tempObject != NULL && index + len <= total) {
+        memcpy((uint8_t*)request->_tempObject + index, data, len);
+    }
+}
+
+bool readJSONBody(AsyncWebServerRequest *request, JsonDocument& doc, size_t maxSize) {
+    // Parses the body gathered by collectRequestBody into a JSON object. On
+    // failure the error response has already been sent.
+    if (request->contentLength() > maxSize) {
+        sendJSON(request, 413, "{\"success\":false,\"error\":\"Body too large\"}");
+        return false;
+    }
+    
+    char* body = (char*)request->_tempObject;
+    if (body == NULL) {
+        sendJSON(request, 400, "{\"success\":false,\"error\":\"JSON body required\"}");
+        return false;
+    }
+    
+    DeserializationError error = deserializeJson(doc, body);
+    if (error) {
+        DynamicJsonDocument response(128);
+        response["success"] = false;
+        response["error"] = String("Invalid JSON: ") + error.c_str();
+        String responseStr;
+        serializeJson(response, responseStr);
+        sendJSON(request, 400, responseStr);
+        return false;
+    }
+    
+    if (!doc.is<JsonObject>()) {
+        sendJSON(request, 400, "{\"success\":false,\"error\":\"Body must be a JSON object\"}");
+        return false;
+    }
+    return true;
+}
+
+void saveSettingsSection(AsyncWebServerRequest *request, const char* section, const char* message) {
+    // The per-area POST routes: validate one settings section, then store it
+    // in a single transaction like /api/settings does
+    DynamicJsonDocument doc(API_MAX_BODY_SIZE);
+    if (!readJSONBody(request, doc, API_MAX_BODY_SIZE)) {
+        return;
+    }
+    
+    DynamicJsonDocument response(256);
+    SettingsTransaction transaction;
+    String validationError;
+    if (!stageSettingsSection(section, doc.as<JsonVariantConst>(), transaction, validationError)) {
+        response["success"] = false;
+        response["error"] = validationError;
+        String responseStr;
+        serializeJson(response, responseStr);
+        sendJSON(request, 400, responseStr);
+        return;
+    }
+    
+    size_t changed = transaction.pendingCount();
+    if (!transaction.commit()) {
+        sendJSON(request, 500, "{\"success\":false,\"error\":\"Failed to store settings\"}");
+        return;
+    }
+    
+    if (changed > 0) {
+        applyStoredSettings();
+    }
+    
+    response["success"] = true;
+    response["message"] = message;
+    
+    String responseStr;
+    serializeJson(response, responseStr);
+    sendJSON(request, 200, responseStr);
+    
+    LOG_INFO("💾 %s settings updated via web interface", section);
+}
+
+void applyStoredSettings() {
+    // Pick up values committed by a settings transaction
+    loadConfiguration();
+    servoControl.reloadCalibration();
+    localAI.reload();
+    // The settings shape the prompt; replies to the old one no longer fit
+    responseCache.clear();
+    // A new key or server deserves a fresh chance
+    openAIBreaker.reset();
+    localAIBreaker.reset();
+    broadcastStatus();
+}
+
 void saveStatus() {
     preferences.putInt("current_state", currentState);
     preferences.putULong64("last_save", millis());
@@ -1171,8 +1541,8 @@ void loadConfiguration() {
     currentMode = (TimerMode)preferences.getInt(KEY_TIMER_MODE, FIXED_INTERVAL);
     
     // Load language configuration
-    languageConfig.currentLanguage = preferences.getString("current_language", "en");
-    languageConfig.supportedLanguages = preferences.getString("supported_languages", "en,pt,es,fr,de");
+    languageConfig.currentLanguage = preferences.getString(KEY_CURRENT_LANGUAGE, "en");
+    languageConfig.supportedLanguages = preferences.getString(KEY_SUPPORTED_LANGUAGES, "en,pt,es,fr,de");
     
     // Load cost configuration
     costConfig.productName = preferences.getString("product_name", "Cigarettes");
@@ -1180,30 +1550,25 @@ void loadConfiguration() {
     costConfig.usePackPrice = preferences.getBool("use_pack_price", false);
     costConfig.cigaretteCost = preferences.getFloat("cigarette_cost", 0.50);
     costConfig.packCost = preferences.getFloat("pack_cost", 10.00);
-    costConfig.cigarettesPerPack = preferences.getInt("cigarettes_per_pack", 20);
+    costConfig.cigarettesPerPack = preferences.getInt(KEY_CIGARETTES_PER_PACK, 20);
     
     // Load schedule configuration for scheduled modes
+    int hour = preferences.getInt(KEY_DAILY_HOUR, 22);
+    int minute = preferences.getInt(KEY_DAILY_MINUTE, 0);
+    int unlockDuration = preferences.getInt(KEY_UNLOCK_DURATION, 30);
+    int weekDay = preferences.getInt(KEY_WEEKLY_DAY, 0);
+    timer.applySchedule(currentMode, weekDay, hour, minute, unlockDuration);
+    
     if (currentMode == DAILY_SCHEDULE || currentMode == WEEKLY_SCHEDULE) {
-        int hour = preferences.getInt(KEY_DAILY_HOUR, 22);
-        int minute = preferences.getInt(KEY_DAILY_MINUTE, 0);
-        int unlockDuration = preferences.getInt(KEY_UNLOCK_DURATION, 30);
-        
-        if (currentMode == DAILY_SCHEDULE) {
-            timer.setDailySchedule(hour, minute, unlockDuration);
-        } else if (currentMode == WEEKLY_SCHEDULE) {
-            int weekDay = preferences.getInt(KEY_WEEKLY_DAY, 0);
-            timer.setWeeklySchedule(weekDay, hour, minute, unlockDuration);
-        }
-        
-        Serial.printf("📅 Loaded schedule: %02d:%02d for %d minutes\n", hour, minute, unlockDuration);
+        LOG_INFO("📅 Loaded schedule: %02d:%02d for %d minutes", hour, minute, unlockDuration);
     }
     
-    Serial.printf("📖 Loaded configuration - Mode: %d, Language: %s, Currency: %s\n", 
+    LOG_INFO("📖 Loaded configuration - Mode: %d, Language: %s, Currency: %s", 
                   currentMode, languageConfig.currentLanguage.c_str(), costConfig.currency.c_str());
 }
 
 String getStatusJSON() {
-    DynamicJsonDocument doc(1024);
+    DynamicJsonDocument doc(1536);
     
     TimerMode currentMode = (TimerMode)preferences.getInt(KEY_TIMER_MODE, FIXED_INTERVAL);
     
@@ -1225,13 +1590,21 @@ String getStatusJSON() {
     // AI Emergency Gatekeeper status
     doc["aiEnabled"] = preferences.getBool("ai_enabled", false);
     doc["emergencyAllowed"] = isEmergencyAllowedOnCurrentNetwork();
-    doc["activeSession"] = currentEmergencySession.active;
-    
-    if (currentEmergencySession.active) {
-        unsigned long elapsed = (millis() - currentEmergencySession.startTime) / 1000;
+    EmergencySession session;
+    bool activeSession = emergencySessions.newest(session);
+    doc["activeSession"] = activeSession;
+    doc["sessions"] = emergencySessions.count();
+    JsonObject providers = doc.createNestedObject("aiProviders");
+    openAIBreaker.writeJSON(providers.createNestedObject("openai"));
+    localAIBreaker.writeJSON(providers.createNestedObject("local"));
+    
+    // The newest session's progress
+    if (activeSession) {
+        unsigned long elapsed = (millis() - session.startedAt) / 1000;
         doc["sessionElapsed"] = elapsed;
         doc["sessionRequired"] = AI_EMERGENCY_DELAY_MINUTES * 60;
-        doc["messageCount"] = currentEmergencySession.messageCount;
+        doc["sessionExpiresIn"] = (session.deadline - millis()) / 1000;
+        doc["messageCount"] = session.messageCount;
     }
     
     // Add time information based on mode
@@ -1263,12 +1636,12 @@ bool isEmergencyAllowedOnCurrentNetwork() {
                          currentSSID.indexOf("Public") >= 0 || 
                          currentSSID.indexOf("Guest") >= 0 ||
                          currentSSID.indexOf("WiFi") >= 0)) {
-        Serial.printf("🚫 Emergency blocked on public network: %s\n", currentSSID.c_str());
+        LOG_WARN("🚫 Emergency blocked on public network: %s", currentSSID.c_str());
         return false;
     }
     
     // Parse allowed networks JSON
-    String allowedNetworksJson = preferences.getString("allowed_networks", "[]");
+    String allowedNetworksJson = preferences.getString(KEY_ALLOWED_NETWORKS, "[]");
     DynamicJsonDocument allowedDoc(512);
     deserializeJson(allowedDoc, allowedNetworksJson);
     
@@ -1281,19 +1654,19 @@ bool isEmergencyAllowedOnCurrentNetwork() {
             }
         }
         if (!found) {
-            Serial.printf("🚫 Emergency blocked - network not in allowed list: %s\n", currentSSID.c_str());
+            LOG_WARN("🚫 Emergency blocked - network not in allowed list: %s", currentSSID.c_str());
             return false;
         }
     }
     
     // Parse blocked networks JSON
-    String blockedNetworksJson = preferences.getString("blocked_networks", "[]");
+    String blockedNetworksJson = preferences.getString(KEY_BLOCKED_NETWORKS, "[]");
     DynamicJsonDocument blockedDoc(512);
     deserializeJson(blockedDoc, blockedNetworksJson);
     
     for (size_t i = 0; i < blockedDoc.size(); i++) {
         if (blockedDoc[i].as<String>() == currentSSID) {
-            Serial.printf("🚫 Emergency blocked on blocked network: %s\n", currentSSID.c_str());
+            LOG_WARN("🚫 Emergency blocked on blocked network: %s", currentSSID.c_str());
             return false;
         }
     }
@@ -1301,369 +1674,303 @@ bool isEmergencyAllowedOnCurrentNetwork() {
     return true; // Allow by default
 }
 
-void startEmergencySession(String trigger) {
-    currentEmergencySession.active = true;
-    currentEmergencySession.startTime = millis();
-    currentEmergencySession.sessionId = String(millis(), HEX);
-    currentEmergencySession.messageCount = 0;
-    currentEmergencySession.trigger = trigger;
+uint32_t startEmergencySession(const String& trigger) {
+    uint32_t sessionId = emergencySessions.start(trigger);
+    String sessionName = String(sessionId, HEX);
     
     // Save session ID to preferences (for tracking)
-    preferences.putString("current_session_id", currentEmergencySession.sessionId);
+    preferences.putString("current_session_id", sessionName);
     
-    Serial.printf("🚀 Emergency session started: %s (Trigger: %s)\n", currentEmergencySession.sessionId.c_str(), trigger.c_str());
+    LOG_INFO("🚀 Emergency session started: %s (Trigger: %s)", sessionName.c_str(), trigger.c_str());
+    return sessionId;
 }
 
-String getAIResponse(String userMessage, String trigger, String personality) {
-    String provider = preferences.getString("ai_provider", "simple");
-    
-    if (provider == "openai") {
-        return getOpenAIResponse(userMessage, trigger, personality);
-    } else if (provider == "local") {
-        return getLocalAIResponse(userMessage, trigger, personality);
-    } else {
-        // Simple rule-based responses
-        return getSimpleAIResponse(userMessage, trigger, personality);
+// The session a request names with ?sessionId= (or a form field of that
+// name); 0 when it names none
+uint32_t requestedSessionId(AsyncWebServerRequest *request) {
+    if (request->hasParam("sessionId")) {
+        return strtoul(request->getParam("sessionId")->value().c_str(), NULL, 16);
     }
-}
-
-String getSimpleAIResponse(String userMessage, String trigger, String personality) {
-    return getEnhancedAIResponse(userMessage, trigger, personality, currentEmergencySession.messageCount);
-}
-
-String getEnhancedAIResponse(String userMessage, String trigger, String personality, int messageCount) {
-    String response = "";
-    
-    // Progressive conversation flow
-    if (messageCount == 1) {
-        response = getWelcomeMessage(personality);
-    } else if (messageCount == 2) {
-        response = getTriggerAnalysis(userMessage, trigger, personality);
-    } else if (messageCount == 3) {
-        response = getReflectionQuestion(trigger, 0);
-    } else if (messageCount == 4) {
-        response = analyzeReflectionResponse(userMessage, trigger, personality);
-    } else if (messageCount == 5) {
-        response = getCopingStrategy(trigger, personality);
-    } else if (messageCount >= 6) {
-        response = getEncouragementAndAlternatives(userMessage, trigger, personality);
+    if (request->hasParam("sessionId", true)) {
+        return strtoul(request->getParam("sessionId", true)->value().c_str(), NULL, 16);
     }
-    
-    return response;
+    return 0;
 }
 
-String getWelcomeMessage(String personality) {
-    if (personality == "supportive") {
-        return "Hi there. I can sense you're having a tough moment right now, and I want you to know that reaching out shows incredible strength. Let's work through this together. What's going on that's making you want to smoke right now?";
-    } else if (personality == "strict") {
-        return "Hold on. Before we go any further, I need you to remember why you started this journey. You made a commitment to yourself for a reason. What was that reason, and why are you willing to throw it away right now?";
-    } else if (personality == "understanding") {
-        return "Hey, I'm here with you. No judgment, no lectures - just someone who gets that this is really hard. Take a deep breath and tell me what's happening in your world right now that's making this craving feel so intense.";
-    } else if (personality == "professional") {
-        return "Good evening. What you're experiencing right now is a completely normal part of the neuroplasticity process during smoking cessation. Let's examine the triggers and develop a cognitive strategy. Can you describe the specific circumstances that led to this craving?";
+// Runs on the AI worker task, from a copy of what the chat handler saw.
+// The session can end at any point while a provider is answering; its
+// transcript is only ever reached through its ID, so a late reply is
+// dropped rather than added to the session that took its slot.
+String getAIResponse(const AIJobInput& job) {
+    String reply;
+    uint64_t context;
+    if (!emergencySessions.contextHash(job.session, job.turn, context)) {
+        // The session ended while the message waited; nobody reads this
+        return getEnhancedAIResponse(job.trigger, job.personality, job.messageCount, job.intent);
     }
-    return "I'm here to help you through this moment. What's triggering this craving?";
-}
-
-String getTriggerAnalysis(String userMessage, String trigger, String personality) {
-    String response = "";
-    
-    if (personality == "supportive") {
-        response = "Thank you for sharing that with me. I can hear in your words that this is genuinely difficult. ";
-        if (trigger == "stress") {
-            response += "Stress can make everything feel overwhelming, but smoking won't actually solve what's stressing you - it just adds another layer of complexity. ";
-        } else if (trigger == "boredom") {
-            response += "Boredom can be surprisingly challenging because our minds start seeking familiar patterns, and smoking has been one of those patterns. ";
-        } else if (trigger == "anger") {
-            response += "Anger is such a powerful emotion, and it makes sense that you'd want to do something with that energy. ";
-        } else if (trigger == "habit") {
-            response += "Habits are deeply ingrained patterns, and it takes real awareness to even notice when they're activated. ";
-        }
-    } else if (personality == "strict") {
-        response = "I hear what you're saying, but let me challenge you on something. ";
-        if (trigger == "stress") {
-            response += "Stress is a part of life - successful people learn to handle it without crutches. When you smoke during stress, you're teaching your brain that you can't handle life's challenges. ";
-        } else if (trigger == "boredom") {
-            response += "Boredom is a choice. There are literally thousands of things you could do right now instead of smoking. The fact that you're choosing the destructive option tells me something about your priorities. ";
-        } else if (trigger == "anger") {
-            response += "Anger is energy. You can use that energy to destroy your progress, or you can channel it into something that actually solves the problem. ";
-        } else if (trigger == "habit") {
-            response += "Habits are just repeated choices. Every time you choose to smoke, you're choosing to stay trapped in the same pattern. ";
+    
+    uint64_t cacheKey = 0;
+    if (job.provider == "openai" || job.provider == "local") {
+        // A model's reply to the same message, at the same point of a
+        // conversation that went the same way, is given again
+        String model = job.provider == "local" ? localAI.model() : String(AI_OPENAI_MODEL);
+        cacheKey = ResponseCache::key(job.provider + ":" + model, job.personality, job.trigger,
+                                      job.message, context);
+        if (responseCache.lookup(cacheKey, reply)) {
+            return reply;
         }
-    } else if (personality == "understanding") {
-        response = "I really appreciate you being honest with me about what's going on. ";
-        if (trigger == "stress") {
-            response += "Stress is one of the hardest triggers because it feels so immediate and overwhelming. Your brain is looking for the fastest relief it knows. ";
-        } else if (trigger == "boredom") {
-            response += "Boredom hits different when you're trying to quit because suddenly you have all this time and mental space that used to be filled with smoking. ";
-        } else if (trigger == "anger") {
-            response += "Anger can feel like it needs an immediate outlet, and smoking has probably been that outlet for a while. ";
-        } else if (trigger == "habit") {
-            response += "Habitual cravings are tricky because they can hit you even when you don't really want to smoke - it's just what your brain expects to do. ";
+    }
+    
+    // A provider that did not answer returns nothing. A failing one is
+    // skipped while its breaker is open, so the next in line (openai,
+    // local, simple) answers at once instead of the user waiting through
+    // another timeout.
+    if (job.provider == "openai") {
+        if (preferences.getString("ai_api_key", "").length() == 0) {
+            return "OpenAI API key not configured. Please set it in Settings.";
         }
-    } else if (personality == "professional") {
-        response = "Based on your description, we can identify specific neural pathways being activated. ";
-        if (trigger == "stress") {
-            response += "Stress activates the hypothalamic-pituitary-adrenal axis, which has been conditioned to expect nicotine as a coping mechanism. ";
-        } else if (trigger == "boredom") {
-            response += "Dopamine-seeking behavior often manifests during understimulation, when the brain seeks familiar reward patterns. ";
-        } else if (trigger == "anger") {
-            response += "Emotional dysregulation often triggers conditioned responses that were developed as self-soothing mechanisms. ";
-        } else if (trigger == "habit") {
-            response += "Automatic behavioral patterns stored in the basal ganglia are being activated by environmental or temporal cues. ";
+        if (openAIBreaker.allow()) {
+            unsigned long started = millis();
+            reply = getOpenAIResponse(job.session, job.trigger, job.personality, job.turn, cacheKey);
+            openAIBreaker.record(reply.length() > 0, millis() - started);
+            if (reply.length() > 0) {
+                return reply;
+            }
         }
+        // The key is OpenAI's; a stand-in reply is not cached under it
+        cacheKey = 0;
     }
     
-    return response + "Let me ask you something that might help us understand this better...";
+    if (job.provider == "local" || (job.provider == "openai" && localAI.isConfigured())) {
+        if (localAIBreaker.allow()) {
+            unsigned long started = millis();
+            reply = getLocalAIResponse(job.session, job.trigger, job.personality, job.turn, cacheKey);
+            localAIBreaker.record(reply.length() > 0, millis() - started);
+            if (reply.length() > 0) {
+                return reply;
+            }
+        }
+    }
+    // Simple rule-based responses
+    reply = getEnhancedAIResponse(job.trigger, job.personality, job.messageCount, job.intent);
+    return reply;
 }
 
-String getReflectionQuestion(String trigger, int questionNumber) {
-    String questions[5];
-    
-    if (trigger == "stress") {
-        questions[0] = "If you could solve the stress you're feeling right now without smoking, what would that solution look like?";
-        questions[1] = "Think back to a time when you handled stress really well without smoking. What was different about that situation?";
-        questions[2] = "What's the worst thing that would happen if you just sat with this stress for 10 more minutes without doing anything?";
-        questions[3] = "If your best friend was feeling this exact stress, what advice would you give them?";
-        questions[4] = "How will you feel about smoking in exactly one hour from now?";
-    } else if (trigger == "boredom") {
-        questions[0] = "What's something you've been putting off that you could tackle right now instead?";
-        questions[1] = "If you had to choose between being bored for 10 minutes or disappointed in yourself for hours, which would you pick?";
-        questions[2] = "What activities used to excite you before smoking became your go-to boredom fix?";
-        questions[3] = "If someone gave you $50 to stay busy for the next hour without smoking, what would you do?";
-        questions[4] = "What would happen if you just let yourself be bored for a few minutes without trying to fix it?";
-    } else if (trigger == "anger") {
-        questions[0] = "What are you really angry about - the situation, or feeling like you need a cigarette to handle it?";
-        questions[1] = "If you smoke right now, will you be less angry, or just angry AND disappointed in yourself?";
-        questions[2] = "What would handling this anger like a complete badass look like?";
-        questions[3] = "What's the angriest you've ever been when you handled it perfectly without smoking?";
-        questions[4] = "Will the thing you're angry about matter in a week? Will breaking your quit attempt matter in a week?";
-    } else if (trigger == "habit") {
-        questions[0] = "What usually happens right before this habitual moment that we could change?";
-        questions[1] = "If you had to replace this smoking habit with a different 5-minute habit, what would it be?";
-        questions[2] = "What's the real reward your brain is seeking right now - the nicotine, or the break/pause/ritual?";
-        questions[3] = "How could you give yourself the same mental break without the cigarette?";
-        questions[4] = "What would your future self, who successfully quit, tell you about this moment?";
+// On the AI worker's lock: only a reply the client gets joins the
+// conversation, and a message that was never answered leaves it
+void settleAIJob(const AIJobInput& job, const String* reply) {
+    if (reply != NULL) {
+        emergencySessions.addMessage(job.session, CONVERSATION_COUNSELOR, *reply);
     } else {
-        questions[0] = "What specific situation or feeling triggered this craving right now?";
-        questions[1] = "How has smoking helped you in similar situations before, and did it actually solve the underlying issue?";
-        questions[2] = "What would you do right now if smoking wasn't an option at all?";
-        questions[3] = "What's one thing you could do in the next 5 minutes that would make you feel proud of yourself?";
-        questions[4] = "If you successfully resist this craving, how will you feel about yourself tomorrow?";
+        emergencySessions.removeMessage(job.session, job.turn);
     }
-    
-    return questions[questionNumber % 5];
 }
 
-String analyzeReflectionResponse(String userMessage, String trigger, String personality) {
-    String response = "";
-    
-    if (personality == "supportive") {
-        response = "That's a really thoughtful answer. I can see you're genuinely thinking about this, which shows you care about your success. ";
-        response += "What you just shared actually gives us a path forward. Instead of smoking, what if we tried to address what you identified? ";
-    } else if (personality == "strict") {
-        response = "Good. Now you're thinking instead of just reacting. That's exactly the mental discipline you need to succeed. ";
-        response += "You have the answer right there - you just need to act on it instead of taking the easy way out. ";
-    } else if (personality == "understanding") {
-        response = "Thank you for really considering that question. Your answer tells me you have more insight into this than you might realize. ";
-        response += "It sounds like there might be a way to handle this situation that honors both your feelings and your commitment to quitting. ";
-    } else if (personality == "professional") {
-        response = "Your response indicates good self-awareness and cognitive flexibility. This suggests your prefrontal cortex is engaging effectively. ";
-        response += "Let's build on this insight with a specific behavioral intervention strategy. ";
+bool writeAIJobJSON(uint32_t jobId, JsonDocument& doc) {
+    if (!aiWorker.writeJSON(jobId, doc)) {
+        return false;
     }
     
-    return response + "Here's what I'd like you to try instead...";
+    // The job's session, as it stands now
+    EmergencySession session;
+    bool active = emergencySessions.get(strtoul(doc["sessionId"] | "", NULL, 16), session);
+    unsigned long elapsed = active ? (millis() - session.startedAt) / 1000 : 0;
+    unsigned long required = AI_EMERGENCY_DELAY_MINUTES * 60;
+    
+    doc["success"] = doc["status"].as<String>() != "timeout";
+    doc["elapsed"] = elapsed;
+    doc["required"] = required;
+    doc["canUnlock"] = active && elapsed >= required && session.messageCount >= AI_MIN_MESSAGES;
+    return true;
 }
 
-String getCopingStrategy(String trigger, String personality) {
-    String strategy = "";
-    
-    if (trigger == "stress") {
-        if (personality == "supportive") {
-            strategy = "Let's do a quick stress-release technique together. First, take 3 deep breaths - in for 4 counts, hold for 4, out for 6. Then, write down or mentally list 3 things that are within your control right now, even if they're small. Focus on just one of those things for the next 10 minutes.";
-        } else if (personality == "strict") {
-            strategy = "Stop making excuses and start making solutions. Right now: 1) Stand up and do 20 jumping jacks, 2) Write down exactly what's stressing you, 3) Write down one action you can take today to improve it, 4) Take that action. Stress doesn't give you permission to quit your quit.";
-        } else if (personality == "understanding") {
-            strategy = "It's okay to feel stressed - that's part of being human. Try this: place your hand on your chest and feel your heartbeat. Remind yourself that this stress will pass, just like all the other stresses you've survived. Maybe do something that usually comforts you - listen to music, take a warm shower, or call someone who cares about you.";
-        } else if (personality == "professional") {
-            strategy = "Implement a structured stress response protocol: 1) Progressive muscle relaxation (tense and release each muscle group for 5 seconds), 2) Cognitive reframing (identify the specific stressor and three potential solutions), 3) Grounding technique (name 5 things you can see, 4 you can touch, 3 you can hear).";
-        }
-    } else if (trigger == "boredom") {
-        if (personality == "supportive") {
-            strategy = "Boredom is actually a gift - it means your mind is ready for something new. How about: text someone you haven't talked to in a while, organize one small area of your space, or spend 10 minutes learning something random online. The goal isn't to be productive, just to redirect your brain's energy.";
-        } else if (personality == "strict") {
-            strategy = "Boredom is a luxury problem. Do 50 push-ups right now, then clean something, then learn something. If you have time to be bored, you have time to improve yourself. Make this craving cost you something positive instead of something destructive.";
-        } else if (personality == "understanding") {
-            strategy = "Being bored when you're trying to quit can feel really uncomfortable because you're used to filling that space with smoking. It's okay to just sit with the boredom for a minute. Maybe try a gentle activity like stretching, making tea, or just looking out the window and noticing what you see.";
-        } else if (personality == "professional") {
-            strategy = "Engage your dopamine system through novel, low-commitment activities: 1) Learn three new facts about a topic that interests you, 2) Rearrange your immediate environment, 3) Practice a brief mindfulness exercise focusing on sensory input rather than thought suppression.";
-        }
-    } else if (trigger == "anger") {
-        if (personality == "supportive") {
-            strategy = "That anger is real and valid. Let's channel it constructively: try doing vigorous exercise for 2-3 minutes, punch a pillow, or write an angry letter you'll never send. Your anger doesn't need a cigarette to be heard - it needs movement and expression.";
-        } else if (personality == "strict") {
-            strategy = "Use that anger as fuel. Angry at the situation? Fix it. Angry at yourself? Prove you're stronger. Angry at others? Show them what you're made of by succeeding. Channel that fire into determination, not destruction.";
-        } else if (personality == "understanding") {
-            strategy = "Anger can feel so intense and urgent. It's completely understandable that you'd want to do something with that energy. Try this: set a timer for 5 minutes and let yourself feel angry without judging it. Sometimes anger just needs to be acknowledged before it can pass.";
-        } else if (personality == "professional") {
-            strategy = "Implement emotional regulation through physiological intervention: 1) Cold water on wrists and face to activate the dive response, 2) Bilateral stimulation (alternate tapping left and right sides of your body), 3) Expressive writing for 90 seconds to process the emotional content.";
-        }
-    } else if (trigger == "habit") {
-        if (personality == "supportive") {
-            strategy = "Habits are so automatic, which is why they're extra tricky. Let's interrupt the pattern: do the first part of your smoking routine, but replace the cigarette with something else - hold a pen like a cigarette, step outside but do jumping jacks instead, or take the break but drink water.";
-        } else if (personality == "strict") {
-            strategy = "Habits are just weak excuses. You control your actions, not the other way around. Right now: do the opposite of what the habit wants. If you normally smoke sitting down, stand up and pace. If you smoke outside, stay inside. Break the pattern by choosing differently.";
-        } else if (personality == "understanding") {
-            strategy = "Habitual cravings can sneak up on you because they're not really about wanting to smoke - they're about the familiar routine. Try keeping most of the routine but swapping out the cigarette: take the same break, go to the same place, but chew gum or do breathing exercises instead.";
-        } else if (personality == "professional") {
-            strategy = "Disrupt the automated behavior chain through pattern interruption: 1) Change your physical position/location, 2) Perform a competing behavior (if you normally use your hands, keep them busy), 3) Introduce a 2-minute delay before any smoking-related action to reactivate conscious decision-making.";
-        }
-    } else {
-        strategy = "Try this immediate action plan: 1) Change your environment (move to a different room or go outside), 2) Do something physical for 2 minutes (walk, stretch, clean), 3) Engage your senses (smell something pleasant, listen to music, taste mint gum), 4) Connect with your motivation (look at a photo that reminds you why you're quitting).";
+String getEnhancedAIResponse(const String& trigger, const String& personality, int messageCount, MessageIntent intent) {
+    // Progressive conversation flow, from the catalog in flash
+    CatalogRequest request;
+    request.stage = catalogStage(messageCount);
+    // After the welcome, asking what to do gets a coping strategy at once,
+    // and a craving that is easing gets encouragement
+    if (request.stage > CATALOG_WELCOME && intent == INTENT_HELP) {
+        request.stage = CATALOG_COPING;
+    } else if (request.stage > CATALOG_WELCOME && intent == INTENT_BETTER) {
+        request.stage = CATALOG_ENCOURAGEMENT;
     }
-    
-    return strategy;
+    request.trigger = catalogTrigger(trigger);
+    request.personality = catalogPersonality(personality);
+    request.question = 0;
+    request.minutes = 0;
+    
+    char reply[AI_CANNED_REPLY_MAX];
+    writeCatalogReply(request, reply, sizeof(reply));
+    return String(reply);
 }
 
-String getEncouragementAndAlternatives(String userMessage, String trigger, String personality) {
-    String response = "";
-    
-    if (personality == "supportive") {
-        response = "You've been talking with me for several minutes now, which means you're already winning. Every second you delay is your brain building new, healthier pathways. I'm proud of how you're handling this. ";
-        response += "Here are three things you could do right now instead: 1) Take a hot shower, 2) Call someone who makes you laugh, 3) Go for a walk around the block. Which one feels most appealing?";
-    } else if (personality == "strict") {
-        response = "You've proven you can resist for this long, which means you're stronger than your addiction. Don't waste that strength now. ";
-        response += "Your options: 1) Go exercise until you're tired, 2) Do something productive you've been avoiding, 3) Face this craving head-on and prove you're in control. What's it going to be?";
-    } else if (personality == "understanding") {
-        response = "Look how far you've come in this conversation. That's not accident - that's your real self choosing your long-term happiness over short-term relief. ";
-        response += "Some gentle alternatives: 1) Make yourself a special drink (tea, coffee, smoothie), 2) Put on music that makes you feel good, 3) Do something nice for someone else. What sounds good to you?";
-    } else if (personality == "professional") {
-        response = "You've successfully extended the decision-making window and engaged higher-order cognitive processes. This indicates strong executive function and impulse control capacity. ";
-        response += "Evidence-based alternatives include: 1) 4-7-8 breathing technique (proven to reduce cortisol), 2) Progressive muscle relaxation (activates parasympathetic nervous system), 3) Brief high-intensity exercise (releases endorphins naturally). Which intervention appeals to your current psychological state?";
+String getReflectionQuestion(const String& trigger, int questionNumber) {
+    CatalogRequest request;
+    request.stage = CATALOG_QUESTION;
+    request.trigger = catalogTrigger(trigger);
+    request.personality = CATALOG_OTHER_PERSONALITY;
+    request.question = questionNumber % CATALOG_QUESTIONS;
+    request.minutes = 0;
+    
+    char question[AI_CANNED_REPLY_MAX];
+    writeCatalogReply(request, question, sizeof(question));
+    return String(question);
+}
+
+String getOpenAIResponse(uint32_t sessionId, String trigger, String personality, uint32_t turn, uint64_t cacheKey) {
+    // Empty when OpenAI did not answer
+    String apiKey = preferences.getString("ai_api_key", "");
+    
+    String requestBody = buildChatRequest(sessionId, AI_OPENAI_MODEL, trigger, personality, turn);
+    if (requestBody.length() == 0) {
+        return String();
     }
     
-    return response;
+    AIStreamParser reply([](const String& partial) {
+        aiWorker.reportProgress(partial);
+    });
+    int httpResponseCode = aiConnection.post("https://api.openai.com/v1/chat/completions",
+                                             "Bearer " + apiKey, requestBody, reply);
+    
+    // Only a 200 is streamed into reply; one cut short keeps what arrived,
+    // but only a whole one is cached
+    if (reply.text().length() > 0) {
+        if (reply.isDone()) {
+            responseCache.store(cacheKey, reply.text());
+        }
+        return reply.text();
+    } else {
+        LOG_WARN("🤖 OpenAI request failed (%d), falling back", httpResponseCode);
+        return String();
+    }
 }
 
-String getOpenAIResponse(String userMessage, String trigger, String personality) {
-    String apiKey = preferences.getString("ai_api_key", "");
-    if (apiKey.length() == 0) {
-        return "OpenAI API key not configured. Please set it in Settings.";
+String getLocalAIResponse(uint32_t sessionId, String trigger, String personality, uint32_t turn, uint64_t cacheKey) {
+    // A model server on the LAN (Ollama and the like), through its
+    // OpenAI-compatible API; empty when it did not answer
+    String requestBody = buildChatRequest(sessionId, localAI.model(), trigger, personality, turn);
+    if (requestBody.length() == 0) {
+        return String();
     }
     
-    HTTPClient http;
-    http.begin("https://api.openai.com/v1/chat/completions");
-    http.addHeader("Content-Type", "application/json");
-    http.addHeader("Authorization", "Bearer " + apiKey);
+    AIStreamParser reply([](const String& partial) {
+        aiWorker.reportProgress(partial);
+    });
+    int httpResponseCode = localAI.chat(requestBody, reply);
     
+    if (reply.text().length() > 0) {
+        if (reply.isDone()) {
+            responseCache.store(cacheKey, reply.text());
+        }
+        return reply.text();
+    }
+    LOG_WARN("🤖 Local AI request failed (%d), falling back", httpResponseCode);
+    return String();
+}
+
+// Empty once the session has ended
+String buildChatRequest(uint32_t sessionId, const String& model, String trigger, String personality, uint32_t turn) {
     // Construct prompt based on personality and trigger
     String systemPrompt = "You are a " + personality + " smoking cessation counselor. ";
     systemPrompt += "The user is experiencing a '" + trigger + "' trigger and wants to access cigarettes. ";
     systemPrompt += "Your goal is to help them resist this urge through conversation, coping strategies, and encouragement. ";
     systemPrompt += "Be empathetic but firm. Provide practical alternatives. Keep responses under 200 words.";
     
-    DynamicJsonDocument requestDoc(1024);
-    requestDoc["model"] = "gpt-3.5-turbo";
-    requestDoc["messages"][0]["role"] = "system";
-    requestDoc["messages"][0]["content"] = systemPrompt;
-    requestDoc["messages"][1]["role"] = "user";
-    requestDoc["messages"][1]["content"] = userMessage;
+    // The system prompt, then the conversation so far, which ends with the
+    // user's message; the conversation's messages are referenced, not copied
+    DynamicJsonDocument requestDoc(3072);
+    requestDoc["model"] = model;
+    JsonArray messages = requestDoc.createNestedArray("messages");
+    JsonObject system = messages.createNestedObject();
+    system["role"] = "system";
+    system["content"] = systemPrompt;
     requestDoc["max_tokens"] = 200;
     requestDoc["temperature"] = 0.7;
+    // Streamed, so the first words reach the browser while the rest is
+    // still being generated
+    requestDoc["stream"] = true;
     
     String requestBody;
-    serializeJson(requestDoc, requestBody);
-    
-    int httpResponseCode = http.POST(requestBody);
-    
-    if (httpResponseCode == 200) {
-        String response = http.getString();
-        DynamicJsonDocument responseDoc(2048);
-        deserializeJson(responseDoc, response);
-        
-        String aiResponse = responseDoc["choices"][0]["message"]["content"];
-        http.end();
-        return aiResponse;
-    } else {
-        http.end();
-        return "AI service temporarily unavailable. Try the simple mode instead.";
+    if (!emergencySessions.serialize(sessionId, requestDoc, messages, turn, requestBody)) {
+        return String();
     }
-}
-
-String getLocalAIResponse(String userMessage, String trigger, String personality) {
-    // Placeholder for local AI integration (Ollama, etc.)
-    return "Local AI not yet implemented. Using simple responses instead.\n\n" + 
-           getSimpleAIResponse(userMessage, trigger, personality);
+    return requestBody;
 }
 
 // Reflection Question System
-void startReflectionSession(String trigger, String personality) {
-    currentReflection.trigger = trigger;
-    currentReflection.personality = personality;
-    currentReflection.currentQuestion = 0;
-    currentReflection.startTime = millis();
-    currentReflection.completed = false;
-    
-    for (int i = 0; i < 5; i++) {
-        currentReflection.responses[i] = "";
-    }
-    
-    // Also update the emergency session
-    currentEmergencySession.reflectionMode = true;
-    currentEmergencySession.currentReflectionQuestion = 0;
-    currentEmergencySession.reflectionCompleted = false;
+void startReflectionSession(uint32_t sessionId) {
+    emergencySessions.startReflection(sessionId);
 }
 
-String getNextReflectionQuestion() {
-    if (currentReflection.currentQuestion >= 5) {
-        currentReflection.completed = true;
-        currentEmergencySession.reflectionCompleted = true;
-        return generateReflectionSummary();
+String getNextReflectionQuestion(uint32_t sessionId) {
+    EmergencySession session;
+    if (!emergencySessions.get(sessionId, session)) {
+        return String();
+    }
+    if (session.reflectionQuestion >= CATALOG_QUESTIONS) {
+        emergencySessions.finishReflection(session.id);
+        return generateReflectionSummary(session);
     }
     
-    String question = getReflectionQuestion(currentReflection.trigger, currentReflection.currentQuestion);
+    String question = getReflectionQuestion(session.trigger, session.reflectionQuestion);
     return question;
 }
 
-void recordReflectionResponse(String response) {
-    if (currentReflection.currentQuestion < 5) {
-        currentReflection.responses[currentReflection.currentQuestion] = response;
-        currentEmergencySession.reflectionResponses[currentReflection.currentQuestion] = response;
-        currentReflection.currentQuestion++;
-        currentEmergencySession.currentReflectionQuestion++;
-    }
+void recordReflectionResponse(uint32_t sessionId) {
+    // The answer itself is in the session's transcript
+    emergencySessions.answerReflection(sessionId);
 }
 
-String generateReflectionSummary() {
-    String summary = "You've spent " + String((millis() - currentReflection.startTime) / 60000) + " minutes reflecting on this craving. ";
-    summary += "Based on your responses, it seems like the core issue is about ";
-    
-    if (currentReflection.trigger == "stress") {
-        summary += "finding better ways to manage pressure without smoking. ";
-    } else if (currentReflection.trigger == "boredom") {
-        summary += "creating more engaging activities in your daily routine. ";
-    } else if (currentReflection.trigger == "anger") {
-        summary += "channeling your anger into constructive actions rather than destructive habits. ";
-    } else if (currentReflection.trigger == "habit") {
-        summary += "building new, healthier automatic responses to replace old patterns. ";
-    } else {
-        summary += "understanding your triggers and developing personalized coping strategies. ";
+String generateReflectionSummary(const EmergencySession& session) {
+    CatalogRequest request;
+    request.stage = CATALOG_SUMMARY;
+    request.trigger = catalogTrigger(session.trigger);
+    request.personality = CATALOG_OTHER_PERSONALITY;
+    request.question = 0;
+    request.minutes = (millis() - session.reflectionStartedAt) / 60000;
+    
+    char summary[AI_CANNED_REPLY_MAX];
+    writeCatalogReply(request, summary, sizeof(summary));
+    return String(summary);
+}
+
+bool isReflectionSessionActive(uint32_t sessionId) {
+    EmergencySession session;
+    return emergencySessions.get(sessionId, session) && session.reflection == REFLECTION_ASKING;
+}
+
+void broadcastStatus() {
+    // Clients that are still sending an older snapshot just get this one next
+    if (statusStream.clientCount() > 0) {
+        statusStream.publish(TOPIC_STATUS, getStatusJSON());
     }
+}
+
+void publishWifiScan() {
+    DynamicJsonDocument doc(2048);
+    wifiScanner.writeJSON(doc);
     
-    summary += "\n\nYou have the insights you need - now it's about choosing to act on them instead of smoking. ";
-    summary += "What specific action will you take right now to honor the reflection work you've just done?";
-    
-    return summary;
+    String json;
+    serializeJson(doc, json);
+    statusStream.publish(TOPIC_WIFI_SCAN, json);
 }
 
-bool isReflectionSessionActive() {
-    return currentEmergencySession.reflectionMode && !currentEmergencySession.reflectionCompleted;
+void publishAIPartial(uint32_t jobId, const String& partial) {
+    DynamicJsonDocument doc(2048);
+    doc["jobId"] = jobId;
+    doc["text"] = partial;
+    String json;
+    serializeJson(doc, json);
+    statusStream.publish(TOPIC_AI_PARTIAL, json);
 }
 
-void broadcastStatus() {
-    if (ws.count() > 0) {
-        String statusJSON = getStatusJSON();
-        ws.textAll(statusJSON);
+void publishAIReply(uint32_t jobId) {
+    DynamicJsonDocument doc(2048);
+    if (writeAIJobJSON(jobId, doc)) {
+        String json;
+        serializeJson(doc, json);
+        statusStream.publish(TOPIC_AI_REPLY, json);
     }
 }
 
@@ -1701,7 +2008,7 @@ void updateGradualReduction() {
     
     if (newInterval > currentInterval) {
         preferences.putInt(KEY_INTERVAL_MINUTES, newInterval);
-        Serial.printf("📈 Gradual reduction: interval increased to %d minutes\n", newInterval);
+        LOG_INFO("📈 Gradual reduction: interval increased to %d minutes", newInterval);
     }
 }
 
@@ -1715,6 +2022,6 @@ void updateCompleteQuitMode() {
     
     if (newInterval > currentInterval) {
         preferences.putInt(KEY_INTERVAL_MINUTES, newInterval);
-        Serial.printf("🎯 Complete quit mode: interval increased to %d minutes\n", newInterval);
+        LOG_INFO("🎯 Complete quit mode: interval increased to %d minutes", newInterval);
     }
 }
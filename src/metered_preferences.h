@@ -0,0 +1,38 @@
+#ifndef METERED_PREFERENCES_H
+#define METERED_PREFERENCES_H
+
+#include <Preferences.h>
+#include "metrics.h"
+
+extern Metrics metrics;
+
+// Preferences that counts NVS reads and writes for /api/dev/metrics.
+// Declare the shared instance with this type; Preferences' accessors are
+// not virtual, so calls through a plain Preferences reference bypass it.
+class MeteredPreferences : public Preferences {
+public:
+    bool isKey(const char* key) { metrics.countNvsRead(); return Preferences::isKey(key); }
+
+    int32_t getInt(const char* key, int32_t defaultValue = 0) { metrics.countNvsRead(); return Preferences::getInt(key, defaultValue); }
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) { metrics.countNvsRead(); return Preferences::getUInt(key, defaultValue); }
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0) { metrics.countNvsRead(); return Preferences::getUChar(key, defaultValue); }
+    uint64_t getULong64(const char* key, uint64_t defaultValue = 0) { metrics.countNvsRead(); return Preferences::getULong64(key, defaultValue); }
+    bool getBool(const char* key, bool defaultValue = false) { metrics.countNvsRead(); return Preferences::getBool(key, defaultValue); }
+    float getFloat(const char* key, float defaultValue = NAN) { metrics.countNvsRead(); return Preferences::getFloat(key, defaultValue); }
+    String getString(const char* key, String defaultValue = String()) { metrics.countNvsRead(); return Preferences::getString(key, defaultValue); }
+    size_t getBytes(const char* key, void* buf, size_t maxLen) { metrics.countNvsRead(); return Preferences::getBytes(key, buf, maxLen); }
+
+    size_t putInt(const char* key, int32_t value) { metrics.countNvsWrite(); return Preferences::putInt(key, value); }
+    size_t putUInt(const char* key, uint32_t value) { metrics.countNvsWrite(); return Preferences::putUInt(key, value); }
+    size_t putUChar(const char* key, uint8_t value) { metrics.countNvsWrite(); return Preferences::putUChar(key, value); }
+    size_t putULong64(const char* key, uint64_t value) { metrics.countNvsWrite(); return Preferences::putULong64(key, value); }
+    size_t putBool(const char* key, bool value) { metrics.countNvsWrite(); return Preferences::putBool(key, value); }
+    size_t putFloat(const char* key, float value) { metrics.countNvsWrite(); return Preferences::putFloat(key, value); }
+    size_t putString(const char* key, const char* value) { metrics.countNvsWrite(); return Preferences::putString(key, value); }
+    size_t putString(const char* key, String value) { metrics.countNvsWrite(); return Preferences::putString(key, value); }
+    size_t putBytes(const char* key, const void* value, size_t len) { metrics.countNvsWrite(); return Preferences::putBytes(key, value, len); }
+    bool remove(const char* key) { metrics.countNvsWrite(); return Preferences::remove(key); }
+    bool clear() { metrics.countNvsWrite(); return Preferences::clear(); }
+};
+
+#endif // METERED_PREFERENCES_H
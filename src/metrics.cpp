@@ -0,0 +1,451 @@
+#include "metrics.h"
+#include "logger.h"
+
+Histogram::Histogram() {
+    for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        buckets[i].store(0);
+    }
+    total.store(0);
+    sumLow.store(0);
+    sumHalves.store(0);
+}
+
+void Histogram::record(uint32_t us) {
+    uint32_t scaled = us >> METRICS_HISTOGRAM_BASE_SHIFT;
+    int index = scaled == 0 ? 0 : 32 - __builtin_clz(scaled);
+    if (index >= METRICS_HISTOGRAM_BUCKETS) {
+        index = METRICS_HISTOGRAM_BUCKETS - 1;
+    }
+
+    buckets[index].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+
+    // One sample flips bit 31 at most once; longer ones are not durations
+    if (us > 0x7FFFFFFFUL) {
+        us = 0x7FFFFFFFUL;
+    }
+    uint32_t before = sumLow.fetch_add(us, std::memory_order_relaxed);
+    if (((before + us) ^ before) & 0x80000000UL) {
+        sumHalves.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void Histogram::reset() {
+    for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    sumLow.store(0, std::memory_order_relaxed);
+    sumHalves.store(0, std::memory_order_relaxed);
+}
+
+void Histogram::writeJSON(JsonObject target) const {
+    target["count"] = count();
+    target["sumUs"] = sumUs();
+
+    JsonArray list = target.createNestedArray("buckets");
+    for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        list.add(bucket(i));
+    }
+}
+
+uint32_t Histogram::bucket(int index) const {
+    return buckets[index].load(std::memory_order_relaxed);
+}
+
+uint32_t Histogram::count() const {
+    return total.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::sumUs() const {
+    uint32_t halves = sumHalves.load(std::memory_order_acquire);
+    uint32_t low = sumLow.load(std::memory_order_relaxed);
+    // A recorder that just carried bit 31 has not counted the flip yet
+    if ((low >> 31) != (halves & 1)) {
+        halves++;
+    }
+    return ((uint64_t)(halves >> 1) << 32) | low;
+}
+
+uint32_t Histogram::upperBoundUs(int index) {
+    // The last bucket has no upper bound (+Inf)
+    return (1UL << METRICS_HISTOGRAM_BASE_SHIFT) << index;
+}
+
+Metrics::Metrics() {
+    routeCount = 0;
+    currentRoute = -1;
+    fanoutMessages.store(0);
+    fanoutBytes.store(0);
+    fanoutSkipped.store(0);
+    nvsReads.store(0);
+    nvsWrites.store(0);
+    aiReused.store(0);
+    aiRetries.store(0);
+    aiCacheHits.store(0);
+    aiCacheMisses.store(0);
+
+    for (int i = 0; i < METRICS_MAX_ROUTES; i++) {
+        routes[i].uri = NULL;
+        routes[i].method = HTTP_ANY;
+        routes[i].bodyUs.store(0);
+        routes[i].errors.store(0);
+        routes[i].bytes.store(0);
+        routes[i].maxBytes.store(0);
+    }
+}
+
+int Metrics::addRoute(const char* uri, WebRequestMethodComposite method) {
+    if (routeCount >= METRICS_MAX_ROUTES) {
+        LOG_WARN("⚠️ Metrics: route table full, %s is not measured", uri);
+        return -1;
+    }
+
+    routes[routeCount].uri = uri;
+    routes[routeCount].method = method;
+    return routeCount++;
+}
+
+void Metrics::enterRoute(int route) {
+    currentRoute = route;
+}
+
+void Metrics::exitRoute(int route, uint32_t us) {
+    currentRoute = -1;
+    if (route < 0) return;
+    routes[route].latency.record(us);
+}
+
+void Metrics::recordBody(int route, uint32_t us) {
+    currentRoute = -1;
+    if (route < 0) return;
+    routes[route].bodyUs.fetch_add(us, std::memory_order_relaxed);
+}
+
+void Metrics::recordResponse(int status, size_t bytes) {
+    // Attributed to the route whose handler is sending
+    int route = currentRoute;
+    if (route < 0) return;
+
+    Route& entry = routes[route];
+    entry.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (status >= 400) {
+        entry.errors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint32_t seen = entry.maxBytes.load(std::memory_order_relaxed);
+    while (bytes > seen && !entry.maxBytes.compare_exchange_weak(seen, bytes, std::memory_order_relaxed)) {
+    }
+}
+
+void Metrics::recordFanout(uint32_t us, uint32_t messages, uint32_t bytes, uint32_t skipped) {
+    fanout.record(us);
+    fanoutMessages.fetch_add(messages, std::memory_order_relaxed);
+    fanoutBytes.fetch_add(bytes, std::memory_order_relaxed);
+    fanoutSkipped.fetch_add(skipped, std::memory_order_relaxed);
+}
+
+void Metrics::recordI2CFlush(uint32_t us) {
+    i2cFlush.record(us);
+}
+
+void Metrics::recordAIHandshake(uint32_t us) {
+    aiHandshake.record(us);
+}
+
+void Metrics::recordAIRequest(uint32_t us, bool reused) {
+    aiRequest.record(us);
+    if (reused) {
+        aiReused.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::recordAIFirstText(uint32_t us) {
+    aiFirstText.record(us);
+}
+
+void Metrics::countAIRetry() {
+    aiRetries.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::countAICacheLookup(bool hit) {
+    (hit ? aiCacheHits : aiCacheMisses).fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::countNvsRead() {
+    nvsReads.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::countNvsWrite(uint32_t writes) {
+    nvsWrites.fetch_add(writes, std::memory_order_relaxed);
+}
+
+void Metrics::beginReport(MetricsCursor& cursor, bool json) {
+    cursor.json = json;
+    cursor.section = 0;
+    cursor.first = true;
+    cursor.frame = String();
+    cursor.offset = 0;
+}
+
+size_t Metrics::readReport(MetricsCursor& cursor, uint8_t* buffer, size_t maxLen) {
+    // Rendered one section at a time so the report never sits in RAM whole
+    while (cursor.offset >= cursor.frame.length()) {
+        cursor.frame = String();
+        cursor.offset = 0;
+        if (!writeSection(cursor, cursor.frame)) {
+            return 0; // Done
+        }
+    }
+
+    size_t length = cursor.frame.length() - cursor.offset;
+    if (length > maxLen) {
+        length = maxLen;
+    }
+    memcpy(buffer, cursor.frame.c_str() + cursor.offset, length);
+    cursor.offset += length;
+    return length;
+}
+
+bool Metrics::writeSection(MetricsCursor& cursor, String& out) {
+    // Prometheus: header, one histogram per route, four per-route counter
+    // families, then the device-wide metrics. JSON: header, routes, tail.
+    int sections = cursor.json ? routeCount + 2 : routeCount + 6;
+    if (cursor.section >= sections) {
+        return false;
+    }
+
+    if (cursor.json) {
+        writeJSONSection(cursor, out);
+    } else {
+        writePrometheusSection(cursor.section, out);
+    }
+    cursor.section++;
+    return true;
+}
+
+void Metrics::writePrometheusSection(int section, String& out) {
+    char line[192];
+    char labels[96];
+
+    if (section == 0) {
+        out += "# TYPE quitbox_http_request_duration_seconds histogram\n";
+        return;
+    }
+
+    if (section <= routeCount) {
+        const Route& route = routes[section - 1];
+        if (isIdle(route)) return;
+        formatLabels(labels, sizeof(labels), route);
+        writeHistogram(out, "quitbox_http_request_duration_seconds", labels, route.latency);
+        return;
+    }
+
+    switch (section - routeCount) {
+        case 1:
+            writeRouteCounter(out, "quitbox_http_response_bytes_total", "counter", 0);
+            return;
+        case 2:
+            writeRouteCounter(out, "quitbox_http_response_bytes_max", "gauge", 1);
+            return;
+        case 3:
+            writeRouteCounter(out, "quitbox_http_errors_total", "counter", 2);
+            return;
+        case 4:
+            writeRouteCounter(out, "quitbox_http_body_seconds_total", "counter", 3);
+            return;
+        default:
+            break;
+    }
+
+    out += "# TYPE quitbox_ws_fanout_duration_seconds histogram\n";
+    writeHistogram(out, "quitbox_ws_fanout_duration_seconds", "", fanout);
+    snprintf(line, sizeof(line),
+             "# TYPE quitbox_ws_fanout_messages_total counter\nquitbox_ws_fanout_messages_total %u\n"
+             "# TYPE quitbox_ws_fanout_bytes_total counter\nquitbox_ws_fanout_bytes_total %u\n",
+             fanoutMessages.load(), fanoutBytes.load());
+    out += line;
+    snprintf(line, sizeof(line),
+             "# TYPE quitbox_ws_skipped_snapshots_total counter\nquitbox_ws_skipped_snapshots_total %u\n",
+             fanoutSkipped.load());
+    out += line;
+
+    out += "# TYPE quitbox_i2c_flush_duration_seconds histogram\n";
+    writeHistogram(out, "quitbox_i2c_flush_duration_seconds", "", i2cFlush);
+
+    out += "# TYPE quitbox_ai_handshake_duration_seconds histogram\n";
+    writeHistogram(out, "quitbox_ai_handshake_duration_seconds", "", aiHandshake);
+    out += "# TYPE quitbox_ai_request_duration_seconds histogram\n";
+    writeHistogram(out, "quitbox_ai_request_duration_seconds", "", aiRequest);
+    out += "# TYPE quitbox_ai_first_text_seconds histogram\n";
+    writeHistogram(out, "quitbox_ai_first_text_seconds", "", aiFirstText);
+    snprintf(line, sizeof(line),
+             "# TYPE quitbox_ai_reused_connections_total counter\nquitbox_ai_reused_connections_total %u\n"
+             "# TYPE quitbox_ai_retries_total counter\nquitbox_ai_retries_total %u\n",
+             aiReused.load(), aiRetries.load());
+    out += line;
+    snprintf(line, sizeof(line),
+             "# TYPE quitbox_ai_cache_hits_total counter\nquitbox_ai_cache_hits_total %u\n"
+             "# TYPE quitbox_ai_cache_misses_total counter\nquitbox_ai_cache_misses_total %u\n",
+             aiCacheHits.load(), aiCacheMisses.load());
+    out += line;
+
+    snprintf(line, sizeof(line),
+             "# TYPE quitbox_nvs_reads_total counter\nquitbox_nvs_reads_total %u\n"
+             "# TYPE quitbox_nvs_writes_total counter\nquitbox_nvs_writes_total %u\n",
+             nvsReads.load(), nvsWrites.load());
+    out += line;
+
+    snprintf(line, sizeof(line),
+             "# TYPE quitbox_heap_free_bytes gauge\nquitbox_heap_free_bytes %u\n"
+             "# TYPE quitbox_heap_min_free_bytes gauge\nquitbox_heap_min_free_bytes %u\n",
+             ESP.getFreeHeap(), ESP.getMinFreeHeap());
+    out += line;
+    snprintf(line, sizeof(line),
+             "# TYPE quitbox_uptime_seconds gauge\nquitbox_uptime_seconds %lu\n",
+             millis() / 1000);
+    out += line;
+}
+
+void Metrics::writeJSONSection(MetricsCursor& cursor, String& out) {
+    char line[160];
+
+    if (cursor.section == 0) {
+        snprintf(line, sizeof(line), "{\"uptimeMs\":%lu,\"freeHeap\":%u,\"minFreeHeap\":%u,\"bucketBoundsUs\":[",
+                 millis(), ESP.getFreeHeap(), ESP.getMinFreeHeap());
+        out += line;
+        for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS - 1; i++) {
+            if (i > 0) out += ",";
+            out += String(Histogram::upperBoundUs(i));
+        }
+        out += "],\"routes\":[";
+        return;
+    }
+
+    if (cursor.section <= routeCount) {
+        const Route& route = routes[cursor.section - 1];
+        if (isIdle(route)) return;
+
+        snprintf(line, sizeof(line),
+                 "%s{\"route\":\"%s\",\"method\":\"%s\",\"bytes\":%u,\"maxBytes\":%u,\"errors\":%u,\"bodyUs\":%u,\"latency\":",
+                 cursor.first ? "" : ",", route.uri, methodName(route.method),
+                 route.bytes.load(), route.maxBytes.load(), route.errors.load(), route.bodyUs.load());
+        out += line;
+        writeHistogramJSON(out, route.latency);
+        out += "}";
+        cursor.first = false;
+        return;
+    }
+
+    out += "],\"fanout\":";
+    writeHistogramJSON(out, fanout);
+    snprintf(line, sizeof(line), ",\"fanoutMessages\":%u,\"fanoutBytes\":%u,\"fanoutSkipped\":%u,\"i2cFlush\":",
+             fanoutMessages.load(), fanoutBytes.load(), fanoutSkipped.load());
+    out += line;
+    writeHistogramJSON(out, i2cFlush);
+    out += ",\"aiHandshake\":";
+    writeHistogramJSON(out, aiHandshake);
+    out += ",\"aiRequest\":";
+    writeHistogramJSON(out, aiRequest);
+    out += ",\"aiFirstText\":";
+    writeHistogramJSON(out, aiFirstText);
+    snprintf(line, sizeof(line), ",\"aiReused\":%u,\"aiRetries\":%u,\"aiCache\":{\"hits\":%u,\"misses\":%u}",
+             aiReused.load(), aiRetries.load(), aiCacheHits.load(), aiCacheMisses.load());
+    out += line;
+    snprintf(line, sizeof(line), ",\"nvs\":{\"reads\":%u,\"writes\":%u}}",
+             nvsReads.load(), nvsWrites.load());
+    out += line;
+}
+
+void Metrics::writeHistogram(String& out, const char* name, const char* labels, const Histogram& histogram) {
+    char line[192];
+    const char* separator = labels[0] != '\0' ? "," : "";
+
+    // Prometheus buckets are cumulative
+    uint32_t cumulative = 0;
+    for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        cumulative += histogram.bucket(i);
+        if (i < METRICS_HISTOGRAM_BUCKETS - 1) {
+            snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"%.6f\"} %u\n",
+                     name, labels, separator, Histogram::upperBoundUs(i) / 1000000.0, cumulative);
+        } else {
+            snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, separator, cumulative);
+        }
+        out += line;
+    }
+
+    const char* open = labels[0] != '\0' ? "{" : "";
+    const char* close = labels[0] != '\0' ? "}" : "";
+    snprintf(line, sizeof(line), "%s_sum%s%s%s %.6f\n%s_count%s%s%s %u\n",
+             name, open, labels, close, histogram.sumUs() / 1000000.0,
+             name, open, labels, close, histogram.count());
+    out += line;
+}
+
+void Metrics::writeRouteCounter(String& out, const char* name, const char* type, int counter) {
+    char line[192];
+    char labels[96];
+
+    snprintf(line, sizeof(line), "# TYPE %s %s\n", name, type);
+    out += line;
+
+    for (int i = 0; i < routeCount; i++) {
+        const Route& route = routes[i];
+        if (isIdle(route)) continue;
+        formatLabels(labels, sizeof(labels), route);
+
+        switch (counter) {
+            case 0:
+                snprintf(line, sizeof(line), "%s{%s} %u\n", name, labels, route.bytes.load());
+                break;
+            case 1:
+                snprintf(line, sizeof(line), "%s{%s} %u\n", name, labels, route.maxBytes.load());
+                break;
+            case 2:
+                snprintf(line, sizeof(line), "%s{%s} %u\n", name, labels, route.errors.load());
+                break;
+            default:
+                snprintf(line, sizeof(line), "%s{%s} %.6f\n", name, labels, route.bodyUs.load() / 1000000.0);
+                break;
+        }
+        out += line;
+    }
+}
+
+void Metrics::writeHistogramJSON(String& out, const Histogram& histogram) {
+    char line[80];
+
+    snprintf(line, sizeof(line), "{\"count\":%u,\"sumUs\":%llu,\"buckets\":[",
+             histogram.count(), (unsigned long long)histogram.sumUs());
+    out += line;
+    for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        if (i > 0) out += ",";
+        out += String(histogram.bucket(i));
+    }
+    out += "]}";
+}
+
+void Metrics::formatLabels(char* labels, size_t size, const Route& route) {
+    snprintf(labels, size, "method=\"%s\",route=\"%s\"", methodName(route.method), route.uri);
+}
+
+bool Metrics::isIdle(const Route& route) {
+    return route.latency.count() == 0 && route.bodyUs.load(std::memory_order_relaxed) == 0;
+}
+
+const char* Metrics::methodName(WebRequestMethodComposite method) {
+    switch (method) {
+        case HTTP_GET:
+            return "GET";
+        case HTTP_POST:
+            return "POST";
+        case HTTP_PUT:
+            return "PUT";
+        case HTTP_DELETE:
+            return "DELETE";
+        case HTTP_PATCH:
+            return "PATCH";
+        default:
+            return "ANY";
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ArduinoJson.h>
+#include <atomic>
+#include "config.h"
+
+// Duration histogram with fixed log-scale (power of two) buckets. Every
+// field is a 32-bit atomic so any task can record without taking a lock
+// (a 64-bit one goes through libatomic, which disables interrupts on the
+// Xtensa cores); readers may see a count and its buckets a sample apart.
+class Histogram {
+public:
+    Histogram();
+    void record(uint32_t us);
+    void reset();
+    void writeJSON(JsonObject target) const;
+    uint32_t bucket(int index) const;
+    uint32_t count() const;
+    uint64_t sumUs() const;
+    static uint32_t upperBoundUs(int index);
+
+private:
+    std::atomic<uint32_t> buckets[METRICS_HISTOGRAM_BUCKETS];
+    std::atomic<uint32_t> total;
+    // The us sum wraps after ~71 minutes, so its upper half is rebuilt
+    // from the number of times bit 31 has flipped
+    std::atomic<uint32_t> sumLow;
+    std::atomic<uint32_t> sumHalves;
+};
+
+// Read position of a metrics report that is streamed out in chunks
+struct MetricsCursor {
+    bool json;
+    int section;
+    bool first;
+    String frame;
+    size_t offset;
+};
+
+// Request, fan-out, NVS, I2C and AI provider instrumentation. Routes are registered
+// during setup(); everything else may be called from any task.
+class Metrics {
+public:
+    Metrics();
+    int addRoute(const char* uri, WebRequestMethodComposite method);
+    void enterRoute(int route);
+    void exitRoute(int route, uint32_t us);
+    void recordBody(int route, uint32_t us);
+    void recordResponse(int status, size_t bytes);
+    void recordFanout(uint32_t us, uint32_t messages, uint32_t bytes, uint32_t skipped);
+    void recordI2CFlush(uint32_t us);
+    void recordAIHandshake(uint32_t us);
+    void recordAIRequest(uint32_t us, bool reused);
+    void recordAIFirstText(uint32_t us);
+    void countAIRetry();
+    void countAICacheLookup(bool hit);
+    void countNvsRead();
+    void countNvsWrite(uint32_t writes = 1);
+
+    void beginReport(MetricsCursor& cursor, bool json);
+    size_t readReport(MetricsCursor& cursor, uint8_t* buffer, size_t maxLen);
+
+private:
+    struct Route {
+        const char* uri;
+        WebRequestMethodComposite method;
+        Histogram latency;
+        std::atomic<uint32_t> bodyUs;
+        std::atomic<uint32_t> errors;
+        std::atomic<uint32_t> bytes;
+        std::atomic<uint32_t> maxBytes;
+    };
+
+    Route routes[METRICS_MAX_ROUTES];
+    int routeCount;
+    volatile int currentRoute;   // Route whose handler is running (async_tcp)
+
+    Histogram fanout;
+    std::atomic<uint32_t> fanoutMessages;
+    std::atomic<uint32_t> fanoutBytes;
+    std::atomic<uint32_t> fanoutSkipped;   // Snapshots a slow client never got
+    Histogram i2cFlush;
+    Histogram aiHandshake;
+    Histogram aiRequest;
+    Histogram aiFirstText;                 // Chat message submitted to the first streamed words
+    std::atomic<uint32_t> aiReused;        // Requests sent on a connection kept from before
+    std::atomic<uint32_t> aiRetries;       // Requests repeated after a kept connection failed
+    std::atomic<uint32_t> aiCacheHits;     // Replies served from the response cache
+    std::atomic<uint32_t> aiCacheMisses;
+    std::atomic<uint32_t> nvsReads;
+    std::atomic<uint32_t> nvsWrites;
+
+    bool writeSection(MetricsCursor& cursor, String& out);
+    void writePrometheusSection(int section, String& out);
+    void writeJSONSection(MetricsCursor& cursor, String& out);
+    void writeHistogram(String& out, const char* name, const char* labels, const Histogram& histogram);
+    void writeRouteCounter(String& out, const char* name, const char* type, int counter);
+    void writeHistogramJSON(String& out, const Histogram& histogram);
+    void formatLabels(char* labels, size_t size, const Route& route);
+    bool isIdle(const Route& route);
+    static const char* methodName(WebRequestMethodComposite method);
+};
+
+#endif // METRICS_H
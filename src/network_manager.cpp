@@ -0,0 +1,281 @@
+#include "network_manager.h"
+#include "logger.h"
+#include <WiFi.h>
+#include "metered_preferences.h"
+#include <time.h>
+
+extern MeteredPreferences preferences;
+
+NetworkManager::NetworkManager() {
+    state = NET_IDLE;
+    reconnectRequested = false;
+    stateStartTime = 0;
+    everConnected = false;
+    stationRetry = false;
+    timeConfigured = false;
+    timeSynced = false;
+    timeSyncLate = false;
+    timeConfigTime = 0;
+    onlineFlag = false;
+    syncedFlag = false;
+}
+
+void NetworkManager::begin() {
+    LOG_INFO("📶 Setting up WiFi in the background...");
+
+    // Credentials live in our own namespace; keep the WiFi driver from
+    // rewriting its copy in flash on every connect
+    WiFi.persistent(false);
+    WiFi.setAutoReconnect(true);
+
+    startConnect(true);
+}
+
+void NetworkManager::connect(const String& ssid, const String& password) {
+    // Called from request handlers: store the credentials and let update()
+    // restart the connection from loop()
+    preferences.putString(KEY_WIFI_SSID, ssid);
+    preferences.putString(KEY_WIFI_PASSWORD, password);
+    preferences.remove(KEY_WIFI_BSSID);
+    preferences.remove(KEY_WIFI_CHANNEL);
+
+    LOG_INFO("🔄 Attempting WiFi connection to: %s", ssid.c_str());
+    reconnectRequested = true;
+}
+
+void NetworkManager::update() {
+    if (reconnectRequested) {
+        reconnectRequested = false;
+        // New credentials get one try before the access point comes back
+        everConnected = false;
+        startConnect(false);
+        return;
+    }
+
+    unsigned long elapsed = millis() - stateStartTime;
+
+    switch (state) {
+        case NET_FAST_CONNECT:
+            if (WiFi.status() == WL_CONNECTED) {
+                onConnected();
+            } else if (elapsed >= WIFI_FAST_CONNECT_TIMEOUT) {
+                LOG_WARN("⚠️ Fast reconnect failed, trying a full connect");
+                startConnect(false);
+            }
+            break;
+
+        case NET_CONNECTING:
+            if (WiFi.status() == WL_CONNECTED) {
+                onConnected();
+            } else if (elapsed >= WIFI_CONNECT_TIMEOUT && everConnected) {
+                // The network worked before and is only gone for now
+                LOG_WARN("⚠️ WiFi still down, trying again");
+                startConnect(false);
+            } else if (elapsed >= WIFI_CONNECT_TIMEOUT) {
+                LOG_ERROR("❌ Failed to connect to stored WiFi");
+                startAccessPoint();
+            }
+            break;
+
+        case NET_CONNECTED:
+            if (WiFi.status() != WL_CONNECTED) {
+                // The driver reconnects on its own; full connects follow
+                // if it does not manage within the connect timeout
+                LOG_WARN("⚠️ WiFi connection lost, reconnecting...");
+                setState(NET_CONNECTING);
+            }
+            break;
+
+        case NET_AP_MODE:
+            if (stationRetry && WiFi.status() == WL_CONNECTED) {
+                // The stored network is back: the access point goes
+                stationRetry = false;
+                WiFi.mode(WIFI_STA);
+                onConnected();
+            } else if (stationRetry && elapsed >= WIFI_CONNECT_TIMEOUT) {
+                // Stop the station scanning, which takes the radio off the
+                // access point's channel
+                stationRetry = false;
+                WiFi.disconnect();
+                stateStartTime = millis();
+            } else if (!stationRetry && elapsed >= WIFI_RETRY_INTERVAL) {
+                retryStation();
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    updateTimeSync();
+}
+
+bool NetworkManager::isOnline() {
+    return state == NET_CONNECTED || state == NET_AP_MODE;
+}
+
+bool NetworkManager::isConnected() {
+    return state == NET_CONNECTED;
+}
+
+bool NetworkManager::isConnecting() {
+    return state == NET_FAST_CONNECT || state == NET_CONNECTING || stationRetry || reconnectRequested;
+}
+
+bool NetworkManager::isTimeSynced() {
+    return timeSynced;
+}
+
+bool NetworkManager::wasOnline() {
+    if (onlineFlag) {
+        onlineFlag = false; // Reset flag after checking
+        return true;
+    }
+    return false;
+}
+
+bool NetworkManager::wasTimeSynced() {
+    if (syncedFlag) {
+        syncedFlag = false; // Reset flag after checking
+        return true;
+    }
+    return false;
+}
+
+NetworkState NetworkManager::getState() {
+    return state;
+}
+
+const char* NetworkManager::getStateName() {
+    switch (state) {
+        case NET_IDLE:
+            return "idle";
+        case NET_FAST_CONNECT:
+            return "fastConnect";
+        case NET_CONNECTING:
+            return "connecting";
+        case NET_CONNECTED:
+            return "connected";
+        case NET_AP_MODE:
+            return "accessPoint";
+        default:
+            return "unknown";
+    }
+}
+
+void NetworkManager::setState(NetworkState newState) {
+    state = newState;
+    stateStartTime = millis();
+}
+
+void NetworkManager::startConnect(bool fast) {
+    String ssid = preferences.getString(KEY_WIFI_SSID, "");
+    String password = preferences.getString(KEY_WIFI_PASSWORD, "");
+
+    if (ssid.length() == 0) {
+        startAccessPoint();
+        return;
+    }
+
+    WiFi.mode(WIFI_STA);
+
+    // Joining a known BSSID on a known channel skips the all-channel scan,
+    // which is most of the time a normal connect takes
+    uint8_t bssid[6];
+    uint8_t channel = preferences.getUChar(KEY_WIFI_CHANNEL, 0);
+    bool cached = fast && channel > 0 && preferences.getBytes(KEY_WIFI_BSSID, bssid, sizeof(bssid)) == sizeof(bssid);
+
+    if (cached) {
+        LOG_INFO("⚡ Fast reconnect to %s (channel %d)", ssid.c_str(), channel);
+        WiFi.begin(ssid.c_str(), password.c_str(), channel, bssid);
+        setState(NET_FAST_CONNECT);
+    } else {
+        LOG_INFO("🔄 Attempting to connect to stored WiFi: %s", ssid.c_str());
+        WiFi.disconnect();
+        WiFi.begin(ssid.c_str(), password.c_str());
+        setState(NET_CONNECTING);
+    }
+}
+
+void NetworkManager::startAccessPoint() {
+    LOG_INFO("📶 Starting WiFi Access Point...");
+    stationRetry = false;
+    // With stored credentials the station stays up for the retries
+    bool stored = preferences.getString(KEY_WIFI_SSID, "").length() > 0;
+    WiFi.disconnect();
+    WiFi.mode(stored ? WIFI_AP_STA : WIFI_AP);
+
+    if (WiFi.softAP(AP_SSID, AP_PASSWORD)) {
+        IPAddress ip = WiFi.softAPIP();
+        LOG_INFO("✅ WiFi AP started: %s", AP_SSID);
+        LOG_INFO("📱 Web interface: http://%s", ip.toString().c_str());
+        LOG_INFO("🔐 Password: %s", AP_PASSWORD);
+        setState(NET_AP_MODE);
+        onlineFlag = true;
+    } else {
+        LOG_ERROR("❌ Failed to start WiFi AP!");
+        setState(NET_IDLE);
+    }
+}
+
+void NetworkManager::retryStation() {
+    String ssid = preferences.getString(KEY_WIFI_SSID, "");
+    String password = preferences.getString(KEY_WIFI_PASSWORD, "");
+
+    stateStartTime = millis();
+    if (ssid.length() == 0) return;
+
+    LOG_INFO("🔄 Trying stored WiFi again: %s", ssid.c_str());
+    WiFi.begin(ssid.c_str(), password.c_str());
+    stationRetry = true;
+}
+
+void NetworkManager::onConnected() {
+    LOG_INFO("✅ Connected to WiFi in %lu ms", millis() - stateStartTime);
+    LOG_INFO("📱 IP Address: %s", WiFi.localIP().toString().c_str());
+    setState(NET_CONNECTED);
+    everConnected = true;
+    onlineFlag = true;
+
+    // Remember where the access point was for the next boot; only written
+    // when it changed to spare the flash
+    uint8_t* bssid = WiFi.BSSID();
+    uint8_t channel = WiFi.channel();
+    if (bssid != NULL) {
+        uint8_t stored[6];
+        bool known = preferences.getUChar(KEY_WIFI_CHANNEL, 0) == channel &&
+                     preferences.getBytes(KEY_WIFI_BSSID, stored, sizeof(stored)) == sizeof(stored) &&
+                     memcmp(stored, bssid, sizeof(stored)) == 0;
+        if (!known) {
+            preferences.putBytes(KEY_WIFI_BSSID, bssid, sizeof(stored));
+            preferences.putUChar(KEY_WIFI_CHANNEL, channel);
+        }
+    }
+
+    if (!timeConfigured) {
+        LOG_INFO("🕒 Setting up time synchronization...");
+        configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+        timeConfigured = true;
+        timeConfigTime = millis();
+    }
+}
+
+void NetworkManager::updateTimeSync() {
+    if (!timeConfigured || timeSynced) return;
+
+    if (time(nullptr) > 1000000000L) {
+        timeSynced = true;
+        syncedFlag = true;
+        LOG_INFO("✅ Time synchronized with NTP in %lu ms", millis() - timeConfigTime);
+
+        struct tm timeinfo;
+        if (getLocalTime(&timeinfo, 0)) {
+            LOG_INFO("📅 Current time: %04d-%02d-%02d %02d:%02d:%02d",
+                         timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
+                         timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+        }
+    } else if (!timeSyncLate && millis() - timeConfigTime >= NTP_SYNC_TIMEOUT) {
+        timeSyncLate = true;
+        LOG_WARN("⚠️ NTP has not synchronized yet, still trying in the background");
+    }
+}
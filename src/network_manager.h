@@ -0,0 +1,57 @@
+#ifndef NETWORK_MANAGER_H
+#define NETWORK_MANAGER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+enum NetworkState {
+    NET_IDLE,
+    NET_FAST_CONNECT,   // Joining the cached access point on its known channel
+    NET_CONNECTING,     // Full connect (scans all channels)
+    NET_CONNECTED,
+    NET_AP_MODE
+};
+
+// Brings Wi-Fi and NTP up in the background so boot never waits on the
+// network. begin() only starts the first attempt; update() runs in loop()
+// and walks fast reconnect -> full connect -> access point fallback. Only
+// a network that never connected falls back: a lost connection is retried
+// for as long as it takes, and AP mode keeps trying the stored network
+// every WIFI_RETRY_INTERVAL alongside the access point.
+class NetworkManager {
+public:
+    NetworkManager();
+    void begin();
+    void update();
+    void connect(const String& ssid, const String& password);
+    bool isOnline();
+    bool isConnected();
+    bool isConnecting();
+    bool isTimeSynced();
+    bool wasOnline();
+    bool wasTimeSynced();
+    NetworkState getState();
+    const char* getStateName();
+
+private:
+    volatile NetworkState state;
+    volatile bool reconnectRequested;
+    unsigned long stateStartTime;
+    bool everConnected;          // With the stored credentials, since boot
+    bool stationRetry;           // AP mode is trying the stored network
+    bool timeConfigured;
+    bool timeSynced;
+    bool timeSyncLate;
+    unsigned long timeConfigTime;
+    bool onlineFlag;
+    bool syncedFlag;
+
+    void setState(NetworkState newState);
+    void startConnect(bool fast);
+    void startAccessPoint();
+    void retryStation();
+    void onConnected();
+    void updateTimeSync();
+};
+
+#endif // NETWORK_MANAGER_H
@@ -0,0 +1,194 @@
+#include "response_cache.h"
+#include "metrics.h"
+#include "logger.h"
+
+extern Metrics metrics;
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t hashBytes(uint64_t hash, const char* bytes, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)bytes[i]) * FNV_PRIME;
+    }
+    // Ends each field, so "ab"+"c" and "a"+"bc" differ
+    return (hash ^ 0xFF) * FNV_PRIME;
+}
+
+ResponseCache::ResponseCache() {
+    lock = NULL;
+    text = NULL;
+    inPsram = false;
+    capacity = 0;
+    uses = 0;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+    expirations = 0;
+
+    for (int i = 0; i < AI_CACHE_ENTRIES; i++) {
+        entries[i].key = 0;
+        entries[i].storedAt = 0;
+        entries[i].usedAt = 0;
+        entries[i].length = 0;
+    }
+}
+
+void ResponseCache::begin() {
+    lock = xSemaphoreCreateMutex();
+
+    if (psramFound()) {
+        text = (char*)ps_malloc(AI_CACHE_ENTRIES * AI_CACHE_REPLY_BYTES);
+        inPsram = text != NULL;
+    }
+    if (text != NULL) {
+        capacity = AI_CACHE_ENTRIES;
+    } else {
+        text = (char*)malloc(AI_CACHE_ENTRIES_INTERNAL * AI_CACHE_REPLY_BYTES);
+        capacity = text != NULL ? AI_CACHE_ENTRIES_INTERNAL : 0;
+    }
+
+    if (capacity == 0) {
+        LOG_WARN("⚠️ No memory for the AI response cache; replies will not be cached");
+    } else {
+        LOG_INFO("🗃️ AI response cache ready (%d replies in %s)", capacity, inPsram ? "PSRAM" : "internal RAM");
+    }
+}
+
+void ResponseCache::clear() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (int i = 0; i < capacity; i++) {
+        entries[i].length = 0;
+    }
+    xSemaphoreGive(lock);
+}
+
+uint64_t ResponseCache::key(const String& provider, const String& personality, const String& trigger,
+                            const String& message, uint64_t context) {
+    uint64_t hash = FNV_OFFSET;
+    hash = hashBytes(hash, provider.c_str(), provider.length());
+    hash = hashBytes(hash, personality.c_str(), personality.length());
+    hash = hashBytes(hash, trigger.c_str(), trigger.length());
+
+    // The message in lower case, without apostrophes, its words separated
+    // by single spaces: "I'm stressed!" and "im  STRESSED" are the same
+    bool started = false;
+    bool space = false;
+    for (const char* p = message.c_str(); *p != '\0'; p++) {
+        uint8_t c = *p;
+        if (c == '\'') continue;
+        bool word = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80;
+        if (!word) {
+            space = started;
+            continue;
+        }
+        if (space) {
+            hash = (hash ^ ' ') * FNV_PRIME;
+        }
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        hash = (hash ^ c) * FNV_PRIME;
+        started = true;
+        space = false;
+    }
+    hash = hashBytes(hash, "", 0);
+    hash = hashBytes(hash, (const char*)&context, sizeof(context));
+
+    // 0 marks "not cached" to callers
+    return hash == 0 ? 1 : hash;
+}
+
+bool ResponseCache::lookup(uint64_t key, String& reply) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = find(key);
+    if (slot >= 0 && millis() - entries[slot].storedAt > AI_CACHE_TTL) {
+        entries[slot].length = 0;
+        expirations++;
+        slot = -1;
+    }
+    if (slot < 0) {
+        misses++;
+        xSemaphoreGive(lock);
+        metrics.countAICacheLookup(false);
+        return false;
+    }
+
+    Entry& entry = entries[slot];
+    entry.usedAt = ++uses;
+    reply = String();
+    reply.reserve(entry.length);
+    reply.concat(text + slot * AI_CACHE_REPLY_BYTES, entry.length);
+    hits++;
+    xSemaphoreGive(lock);
+    metrics.countAICacheLookup(true);
+    return true;
+}
+
+void ResponseCache::store(uint64_t key, const String& reply) {
+    if (key == 0 || reply.length() == 0 || reply.length() > AI_CACHE_REPLY_BYTES) {
+        return;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int slot = find(key);
+    if (slot < 0) {
+        // A free slot, else an expired one, else the least recently used
+        unsigned long now = millis();
+        bool evicting = true;
+        for (int i = 0; i < capacity; i++) {
+            Entry& entry = entries[i];
+            if (entry.length == 0 || now - entry.storedAt > AI_CACHE_TTL) {
+                if (entry.length > 0) expirations++;
+                slot = i;
+                evicting = false;
+                break;
+            }
+            if (slot < 0 || entry.usedAt < entries[slot].usedAt) {
+                slot = i;
+            }
+        }
+        if (slot < 0) {
+            xSemaphoreGive(lock);
+            return;
+        }
+        if (evicting) evictions++;
+    }
+
+    Entry& entry = entries[slot];
+    memcpy(text + slot * AI_CACHE_REPLY_BYTES, reply.c_str(), reply.length());
+    entry.key = key;
+    entry.length = reply.length();
+    entry.storedAt = millis();
+    entry.usedAt = ++uses;
+    xSemaphoreGive(lock);
+}
+
+void ResponseCache::writeJSON(JsonDocument& doc) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    int used = 0;
+    uint32_t bytes = 0;
+    for (int i = 0; i < capacity; i++) {
+        if (entries[i].length > 0) {
+            used++;
+            bytes += entries[i].length;
+        }
+    }
+    doc["memory"] = inPsram ? "psram" : "internal";
+    doc["capacity"] = capacity;
+    doc["entries"] = used;
+    doc["bytes"] = bytes;
+    doc["ttl"] = AI_CACHE_TTL / 1000;
+    doc["hits"] = hits;
+    doc["misses"] = misses;
+    doc["evictions"] = evictions;
+    doc["expirations"] = expirations;
+    xSemaphoreGive(lock);
+}
+
+int ResponseCache::find(uint64_t key) {
+    for (int i = 0; i < capacity; i++) {
+        if (entries[i].length > 0 && entries[i].key == key) {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,54 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// Replies from the AI providers, kept so a message that was answered
+// before is answered again without a round trip. The key covers the
+// provider and model, the personality, the trigger, the message with case,
+// punctuation and spacing ignored, and the conversation before it, so only
+// a reply given in the same place is reused. Entries expire after
+// AI_CACHE_TTL; when the cache is full the one used least recently makes
+// room. Their text lives in one block of PSRAM (AI_CACHE_ENTRIES slots of
+// AI_CACHE_REPLY_BYTES), or of internal RAM with AI_CACHE_ENTRIES_INTERNAL
+// slots on boards without it. Any task may call in.
+class ResponseCache {
+public:
+    ResponseCache();
+    void begin();
+    void clear();
+
+    static uint64_t key(const String& provider, const String& personality, const String& trigger,
+                        const String& message, uint64_t context);
+    bool lookup(uint64_t key, String& reply);
+    void store(uint64_t key, const String& reply);
+
+    void writeJSON(JsonDocument& doc);
+
+private:
+    struct Entry {
+        uint64_t key;
+        uint32_t storedAt;
+        uint32_t usedAt;         // Of the use counter, for the LRU order
+        uint16_t length;         // 0 for a free slot
+    };
+
+    SemaphoreHandle_t lock;
+    char* text;                  // capacity slots of AI_CACHE_REPLY_BYTES
+    bool inPsram;
+    Entry entries[AI_CACHE_ENTRIES];
+    int capacity;
+    uint32_t uses;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t expirations;
+
+    int find(uint64_t key);
+};
+
+extern ResponseCache responseCache;
+
+#endif // RESPONSE_CACHE_H
@@ -0,0 +1,303 @@
+#include "response_catalog.h"
+
+// Everything below is const, so it is linked into flash and read from there
+// through the cache; nothing is copied to RAM at boot or per reply.
+//
+// Templates may hold placeholders, expanded as the reply is written:
+//   {opening}   the personality's opening line for the trigger analysis
+//   {reason}    what the personality says about the trigger
+//   {focus}     what the reflection summary says the trigger is about
+//   {minutes}   minutes spent reflecting
+
+static const char* const kTriggerNames[CATALOG_OTHER_TRIGGER] = {"stress", "boredom", "anger", "habit"};
+static const char* const kPersonalityNames[CATALOG_OTHER_PERSONALITY] = {"supportive", "strict", "understanding", "professional"};
+
+// First message: by personality
+static const char* const kWelcome[CATALOG_PERSONALITIES] = {
+    "Hi there. I can sense you're having a tough moment right now, and I want you to know that reaching out shows incredible strength. Let's work through this together. What's going on that's making you want to smoke right now?",
+    "Hold on. Before we go any further, I need you to remember why you started this journey. You made a commitment to yourself for a reason. What was that reason, and why are you willing to throw it away right now?",
+    "Hey, I'm here with you. No judgment, no lectures - just someone who gets that this is really hard. Take a deep breath and tell me what's happening in your world right now that's making this craving feel so intense.",
+    "Good evening. What you're experiencing right now is a completely normal part of the neuroplasticity process during smoking cessation. Let's examine the triggers and develop a cognitive strategy. Can you describe the specific circumstances that led to this craving?",
+    "I'm here to help you through this moment. What's triggering this craving?"
+};
+
+// Second message: the personality's opening, then its take on the trigger
+static const char kAnalysis[] = "{opening}{reason}Let me ask you something that might help us understand this better...";
+
+static const char* const kAnalysisOpening[CATALOG_PERSONALITIES] = {
+    "Thank you for sharing that with me. I can hear in your words that this is genuinely difficult. ",
+    "I hear what you're saying, but let me challenge you on something. ",
+    "I really appreciate you being honest with me about what's going on. ",
+    "Based on your description, we can identify specific neural pathways being activated. ",
+    ""
+};
+
+static const char* const kAnalysisReason[CATALOG_PERSONALITIES][CATALOG_TRIGGERS] = {
+    {
+        "Stress can make everything feel overwhelming, but smoking won't actually solve what's stressing you - it just adds another layer of complexity. ",
+        "Boredom can be surprisingly challenging because our minds start seeking familiar patterns, and smoking has been one of those patterns. ",
+        "Anger is such a powerful emotion, and it makes sense that you'd want to do something with that energy. ",
+        "Habits are deeply ingrained patterns, and it takes real awareness to even notice when they're activated. ",
+        ""
+    },
+    {
+        "Stress is a part of life - successful people learn to handle it without crutches. When you smoke during stress, you're teaching your brain that you can't handle life's challenges. ",
+        "Boredom is a choice. There are literally thousands of things you could do right now instead of smoking. The fact that you're choosing the destructive option tells me something about your priorities. ",
+        "Anger is energy. You can use that energy to destroy your progress, or you can channel it into something that actually solves the problem. ",
+        "Habits are just repeated choices. Every time you choose to smoke, you're choosing to stay trapped in the same pattern. ",
+        ""
+    },
+    {
+        "Stress is one of the hardest triggers because it feels so immediate and overwhelming. Your brain is looking for the fastest relief it knows. ",
+        "Boredom hits different when you're trying to quit because suddenly you have all this time and mental space that used to be filled with smoking. ",
+        "Anger can feel like it needs an immediate outlet, and smoking has probably been that outlet for a while. ",
+        "Habitual cravings are tricky because they can hit you even when you don't really want to smoke - it's just what your brain expects to do. ",
+        ""
+    },
+    {
+        "Stress activates the hypothalamic-pituitary-adrenal axis, which has been conditioned to expect nicotine as a coping mechanism. ",
+        "Dopamine-seeking behavior often manifests during understimulation, when the brain seeks familiar reward patterns. ",
+        "Emotional dysregulation often triggers conditioned responses that were developed as self-soothing mechanisms. ",
+        "Automatic behavioral patterns stored in the basal ganglia are being activated by environmental or temporal cues. ",
+        ""
+    },
+    {
+        "",
+        "",
+        "",
+        "",
+        ""
+    }
+};
+
+// Third message, and the reflection session: by trigger
+static const char* const kQuestions[CATALOG_TRIGGERS][CATALOG_QUESTIONS] = {
+    {
+        "If you could solve the stress you're feeling right now without smoking, what would that solution look like?",
+        "Think back to a time when you handled stress really well without smoking. What was different about that situation?",
+        "What's the worst thing that would happen if you just sat with this stress for 10 more minutes without doing anything?",
+        "If your best friend was feeling this exact stress, what advice would you give them?",
+        "How will you feel about smoking in exactly one hour from now?"
+    },
+    {
+        "What's something you've been putting off that you could tackle right now instead?",
+        "If you had to choose between being bored for 10 minutes or disappointed in yourself for hours, which would you pick?",
+        "What activities used to excite you before smoking became your go-to boredom fix?",
+        "If someone gave you $50 to stay busy for the next hour without smoking, what would you do?",
+        "What would happen if you just let yourself be bored for a few minutes without trying to fix it?"
+    },
+    {
+        "What are you really angry about - the situation, or feeling like you need a cigarette to handle it?",
+        "If you smoke right now, will you be less angry, or just angry AND disappointed in yourself?",
+        "What would handling this anger like a complete badass look like?",
+        "What's the angriest you've ever been when you handled it perfectly without smoking?",
+        "Will the thing you're angry about matter in a week? Will breaking your quit attempt matter in a week?"
+    },
+    {
+        "What usually happens right before this habitual moment that we could change?",
+        "If you had to replace this smoking habit with a different 5-minute habit, what would it be?",
+        "What's the real reward your brain is seeking right now - the nicotine, or the break/pause/ritual?",
+        "How could you give yourself the same mental break without the cigarette?",
+        "What would your future self, who successfully quit, tell you about this moment?"
+    },
+    {
+        "What specific situation or feeling triggered this craving right now?",
+        "How has smoking helped you in similar situations before, and did it actually solve the underlying issue?",
+        "What would you do right now if smoking wasn't an option at all?",
+        "What's one thing you could do in the next 5 minutes that would make you feel proud of yourself?",
+        "If you successfully resist this craving, how will you feel about yourself tomorrow?"
+    }
+};
+
+// Fourth message: by personality
+static const char* const kFollowUp[CATALOG_PERSONALITIES] = {
+    "That's a really thoughtful answer. I can see you're genuinely thinking about this, which shows you care about your success. "
+        "What you just shared actually gives us a path forward. Instead of smoking, what if we tried to address what you identified? "
+        "Here's what I'd like you to try instead...",
+    "Good. Now you're thinking instead of just reacting. That's exactly the mental discipline you need to succeed. "
+        "You have the answer right there - you just need to act on it instead of taking the easy way out. "
+        "Here's what I'd like you to try instead...",
+    "Thank you for really considering that question. Your answer tells me you have more insight into this than you might realize. "
+        "It sounds like there might be a way to handle this situation that honors both your feelings and your commitment to quitting. "
+        "Here's what I'd like you to try instead...",
+    "Your response indicates good self-awareness and cognitive flexibility. This suggests your prefrontal cortex is engaging effectively. "
+        "Let's build on this insight with a specific behavioral intervention strategy. "
+        "Here's what I'd like you to try instead...",
+    "Here's what I'd like you to try instead..."
+};
+
+// Fifth message: by trigger and personality
+static const char* const kCoping[CATALOG_TRIGGERS][CATALOG_PERSONALITIES] = {
+    {
+        "Let's do a quick stress-release technique together. First, take 3 deep breaths - in for 4 counts, hold for 4, out for 6. Then, write down or mentally list 3 things that are within your control right now, even if they're small. Focus on just one of those things for the next 10 minutes.",
+        "Stop making excuses and start making solutions. Right now: 1) Stand up and do 20 jumping jacks, 2) Write down exactly what's stressing you, 3) Write down one action you can take today to improve it, 4) Take that action. Stress doesn't give you permission to quit your quit.",
+        "It's okay to feel stressed - that's part of being human. Try this: place your hand on your chest and feel your heartbeat. Remind yourself that this stress will pass, just like all the other stresses you've survived. Maybe do something that usually comforts you - listen to music, take a warm shower, or call someone who cares about you.",
+        "Implement a structured stress response protocol: 1) Progressive muscle relaxation (tense and release each muscle group for 5 seconds), 2) Cognitive reframing (identify the specific stressor and three potential solutions), 3) Grounding technique (name 5 things you can see, 4 you can touch, 3 you can hear).",
+        ""
+    },
+    {
+        "Boredom is actually a gift - it means your mind is ready for something new. How about: text someone you haven't talked to in a while, organize one small area of your space, or spend 10 minutes learning something random online. The goal isn't to be productive, just to redirect your brain's energy.",
+        "Boredom is a luxury problem. Do 50 push-ups right now, then clean something, then learn something. If you have time to be bored, you have time to improve yourself. Make this craving cost you something positive instead of something destructive.",
+        "Being bored when you're trying to quit can feel really uncomfortable because you're used to filling that space with smoking. It's okay to just sit with the boredom for a minute. Maybe try a gentle activity like stretching, making tea, or just looking out the window and noticing what you see.",
+        "Engage your dopamine system through novel, low-commitment activities: 1) Learn three new facts about a topic that interests you, 2) Rearrange your immediate environment, 3) Practice a brief mindfulness exercise focusing on sensory input rather than thought suppression.",
+        ""
+    },
+    {
+        "That anger is real and valid. Let's channel it constructively: try doing vigorous exercise for 2-3 minutes, punch a pillow, or write an angry letter you'll never send. Your anger doesn't need a cigarette to be heard - it needs movement and expression.",
+        "Use that anger as fuel. Angry at the situation? Fix it. Angry at yourself? Prove you're stronger. Angry at others? Show them what you're made of by succeeding. Channel that fire into determination, not destruction.",
+        "Anger can feel so intense and urgent. It's completely understandable that you'd want to do something with that energy. Try this: set a timer for 5 minutes and let yourself feel angry without judging it. Sometimes anger just needs to be acknowledged before it can pass.",
+        "Implement emotional regulation through physiological intervention: 1) Cold water on wrists and face to activate the dive response, 2) Bilateral stimulation (alternate tapping left and right sides of your body), 3) Expressive writing for 90 seconds to process the emotional content.",
+        ""
+    },
+    {
+        "Habits are so automatic, which is why they're extra tricky. Let's interrupt the pattern: do the first part of your smoking routine, but replace the cigarette with something else - hold a pen like a cigarette, step outside but do jumping jacks instead, or take the break but drink water.",
+        "Habits are just weak excuses. You control your actions, not the other way around. Right now: do the opposite of what the habit wants. If you normally smoke sitting down, stand up and pace. If you smoke outside, stay inside. Break the pattern by choosing differently.",
+        "Habitual cravings can sneak up on you because they're not really about wanting to smoke - they're about the familiar routine. Try keeping most of the routine but swapping out the cigarette: take the same break, go to the same place, but chew gum or do breathing exercises instead.",
+        "Disrupt the automated behavior chain through pattern interruption: 1) Change your physical position/location, 2) Perform a competing behavior (if you normally use your hands, keep them busy), 3) Introduce a 2-minute delay before any smoking-related action to reactivate conscious decision-making.",
+        ""
+    },
+    {
+        "Try this immediate action plan: 1) Change your environment (move to a different room or go outside), 2) Do something physical for 2 minutes (walk, stretch, clean), 3) Engage your senses (smell something pleasant, listen to music, taste mint gum), 4) Connect with your motivation (look at a photo that reminds you why you're quitting).",
+        "Try this immediate action plan: 1) Change your environment (move to a different room or go outside), 2) Do something physical for 2 minutes (walk, stretch, clean), 3) Engage your senses (smell something pleasant, listen to music, taste mint gum), 4) Connect with your motivation (look at a photo that reminds you why you're quitting).",
+        "Try this immediate action plan: 1) Change your environment (move to a different room or go outside), 2) Do something physical for 2 minutes (walk, stretch, clean), 3) Engage your senses (smell something pleasant, listen to music, taste mint gum), 4) Connect with your motivation (look at a photo that reminds you why you're quitting).",
+        "Try this immediate action plan: 1) Change your environment (move to a different room or go outside), 2) Do something physical for 2 minutes (walk, stretch, clean), 3) Engage your senses (smell something pleasant, listen to music, taste mint gum), 4) Connect with your motivation (look at a photo that reminds you why you're quitting).",
+        "Try this immediate action plan: 1) Change your environment (move to a different room or go outside), 2) Do something physical for 2 minutes (walk, stretch, clean), 3) Engage your senses (smell something pleasant, listen to music, taste mint gum), 4) Connect with your motivation (look at a photo that reminds you why you're quitting)."
+    }
+};
+
+// Every later message: by personality
+static const char* const kEncouragement[CATALOG_PERSONALITIES] = {
+    "You've been talking with me for several minutes now, which means you're already winning. Every second you delay is your brain building new, healthier pathways. I'm proud of how you're handling this. "
+        "Here are three things you could do right now instead: 1) Take a hot shower, 2) Call someone who makes you laugh, 3) Go for a walk around the block. Which one feels most appealing?",
+    "You've proven you can resist for this long, which means you're stronger than your addiction. Don't waste that strength now. "
+        "Your options: 1) Go exercise until you're tired, 2) Do something productive you've been avoiding, 3) Face this craving head-on and prove you're in control. What's it going to be?",
+    "Look how far you've come in this conversation. That's not accident - that's your real self choosing your long-term happiness over short-term relief. "
+        "Some gentle alternatives: 1) Make yourself a special drink (tea, coffee, smoothie), 2) Put on music that makes you feel good, 3) Do something nice for someone else. What sounds good to you?",
+    "You've successfully extended the decision-making window and engaged higher-order cognitive processes. This indicates strong executive function and impulse control capacity. "
+        "Evidence-based alternatives include: 1) 4-7-8 breathing technique (proven to reduce cortisol), 2) Progressive muscle relaxation (activates parasympathetic nervous system), 3) Brief high-intensity exercise (releases endorphins naturally). Which intervention appeals to your current psychological state?",
+    ""
+};
+
+// Closes the reflection session
+static const char kSummary[] =
+    "You've spent {minutes} minutes reflecting on this craving. "
+    "Based on your responses, it seems like the core issue is about {focus}\n\nYou have the insights you need - now it's about choosing to act on them instead of smoking. "
+    "What specific action will you take right now to honor the reflection work you've just done?";
+
+static const char* const kFocus[CATALOG_TRIGGERS] = {
+    "finding better ways to manage pressure without smoking. ",
+    "creating more engaging activities in your daily routine. ",
+    "channeling your anger into constructive actions rather than destructive habits. ",
+    "building new, healthier automatic responses to replace old patterns. ",
+    "understanding your triggers and developing personalized coping strategies. "
+};
+
+CatalogTrigger catalogTrigger(const String& trigger) {
+    for (uint8_t i = 0; i < CATALOG_OTHER_TRIGGER; i++) {
+        if (trigger == kTriggerNames[i]) {
+            return (CatalogTrigger)i;
+        }
+    }
+    return CATALOG_OTHER_TRIGGER;
+}
+
+const char* catalogTriggerName(CatalogTrigger trigger) {
+    return trigger < CATALOG_OTHER_TRIGGER ? kTriggerNames[trigger] : "general";
+}
+
+CatalogPersonality catalogPersonality(const String& personality) {
+    for (uint8_t i = 0; i < CATALOG_OTHER_PERSONALITY; i++) {
+        if (personality == kPersonalityNames[i]) {
+            return (CatalogPersonality)i;
+        }
+    }
+    return CATALOG_OTHER_PERSONALITY;
+}
+
+CatalogStage catalogStage(int messageCount) {
+    if (messageCount < 1) {
+        return CATALOG_NONE;
+    }
+    if (messageCount >= 6) {
+        return CATALOG_ENCOURAGEMENT;
+    }
+    return (CatalogStage)messageCount;
+}
+
+static const char* catalogTemplate(const CatalogRequest& request) {
+    switch (request.stage) {
+        case CATALOG_WELCOME:
+            return kWelcome[request.personality];
+        case CATALOG_ANALYSIS:
+            return kAnalysis;
+        case CATALOG_QUESTION:
+            return kQuestions[request.trigger][request.question % CATALOG_QUESTIONS];
+        case CATALOG_FOLLOW_UP:
+            return kFollowUp[request.personality];
+        case CATALOG_COPING:
+            return kCoping[request.trigger][request.personality];
+        case CATALOG_ENCOURAGEMENT:
+            return kEncouragement[request.personality];
+        case CATALOG_SUMMARY:
+            return kSummary;
+        default:
+            return "";
+    }
+}
+
+// Appends text to the reply, counting what does not fit
+static void put(const char* text, size_t length, char* out, size_t size, size_t& written) {
+    if (written + 1 < size) {
+        size_t room = size - 1 - written;
+        memcpy(out + written, text, length < room ? length : room);
+    }
+    written += length;
+}
+
+static void putPlaceholder(const char* name, size_t length, const CatalogRequest& request,
+                           char* out, size_t size, size_t& written) {
+    if (length == 7 && memcmp(name, "opening", 7) == 0) {
+        const char* text = kAnalysisOpening[request.personality];
+        put(text, strlen(text), out, size, written);
+    } else if (length == 6 && memcmp(name, "reason", 6) == 0) {
+        const char* text = kAnalysisReason[request.personality][request.trigger];
+        put(text, strlen(text), out, size, written);
+    } else if (length == 5 && memcmp(name, "focus", 5) == 0) {
+        const char* text = kFocus[request.trigger];
+        put(text, strlen(text), out, size, written);
+    } else if (length == 7 && memcmp(name, "minutes", 7) == 0) {
+        char digits[12];
+        int count = snprintf(digits, sizeof(digits), "%lu", (unsigned long)request.minutes);
+        put(digits, count, out, size, written);
+    }
+}
+
+size_t writeCatalogReply(const CatalogRequest& request, char* out, size_t size) {
+    CatalogRequest clamped = request;
+    if (clamped.trigger >= CATALOG_TRIGGERS) clamped.trigger = CATALOG_OTHER_TRIGGER;
+    if (clamped.personality >= CATALOG_PERSONALITIES) clamped.personality = CATALOG_OTHER_PERSONALITY;
+
+    size_t written = 0;
+    const char* text = catalogTemplate(clamped);
+    while (*text) {
+        const char* open = strchr(text, '{');
+        if (open == NULL) {
+            put(text, strlen(text), out, size, written);
+            break;
+        }
+        put(text, open - text, out, size, written);
+
+        const char* close = strchr(open, '}');
+        if (close == NULL) {
+            put(open, strlen(open), out, size, written);
+            break;
+        }
+        putPlaceholder(open + 1, close - open - 1, clamped, out, size, written);
+        text = close + 1;
+    }
+
+    if (size > 0) {
+        out[written < size ? written : size - 1] = '\0';
+    }
+    return written;
+}
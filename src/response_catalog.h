@@ -0,0 +1,62 @@
+#ifndef RESPONSE_CATALOG_H
+#define RESPONSE_CATALOG_H
+
+#include <Arduino.h>
+#include "config.h"
+
+enum CatalogTrigger : uint8_t {
+    CATALOG_STRESS = 0,
+    CATALOG_BOREDOM,
+    CATALOG_ANGER,
+    CATALOG_HABIT,
+    CATALOG_OTHER_TRIGGER,
+    CATALOG_TRIGGERS
+};
+
+enum CatalogPersonality : uint8_t {
+    CATALOG_SUPPORTIVE = 0,
+    CATALOG_STRICT,
+    CATALOG_UNDERSTANDING,
+    CATALOG_PROFESSIONAL,
+    CATALOG_OTHER_PERSONALITY,
+    CATALOG_PERSONALITIES
+};
+
+enum CatalogStage : uint8_t {
+    CATALOG_NONE = 0,            // Nothing to say
+    CATALOG_WELCOME,
+    CATALOG_ANALYSIS,
+    CATALOG_QUESTION,
+    CATALOG_FOLLOW_UP,
+    CATALOG_COPING,
+    CATALOG_ENCOURAGEMENT,
+    CATALOG_SUMMARY,
+    CATALOG_STAGES
+};
+
+#define CATALOG_QUESTIONS 5      // Reflection questions per trigger
+
+struct CatalogRequest {
+    CatalogStage stage;
+    CatalogTrigger trigger;
+    CatalogPersonality personality;
+    uint8_t question;            // CATALOG_QUESTION: which one, wraps around
+    uint32_t minutes;            // CATALOG_SUMMARY: time spent reflecting
+};
+
+// The built-in counselor's replies. The text lives in const tables, so it
+// stays in flash, indexed by stage, trigger and personality; a reply is
+// written straight into the caller's buffer with its placeholders expanded,
+// without touching the heap.
+CatalogTrigger catalogTrigger(const String& trigger);
+// "general" for CATALOG_OTHER_TRIGGER
+const char* catalogTriggerName(CatalogTrigger trigger);
+CatalogPersonality catalogPersonality(const String& personality);
+// Which reply a chat's nth message gets
+CatalogStage catalogStage(int messageCount);
+
+// Writes at most size - 1 characters and a terminating NUL, like snprintf,
+// and returns the length of the whole reply; AI_CANNED_REPLY_MAX holds any
+size_t writeCatalogReply(const CatalogRequest& request, char* out, size_t size);
+
+#endif // RESPONSE_CATALOG_H
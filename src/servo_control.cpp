@@ -1,9 +1,10 @@
 #include "servo_control.h"
+#include "logger.h"
 #include "config.h"
 #include <ESP32Servo.h>
-#include <Preferences.h>
+#include "metered_preferences.h"
 
-extern Preferences preferences;
+extern MeteredPreferences preferences;
 
 ServoControl::ServoControl() {
     servoPin = SERVO_PIN;
@@ -17,11 +18,10 @@ void ServoControl::begin() {
     servo.attach(servoPin);
     
     // Load calibrated positions from preferences
-    lockedPosition = preferences.getInt("servo_locked_pos", SERVO_LOCKED_POSITION);
-    unlockedPosition = preferences.getInt("servo_unlocked_pos", SERVO_UNLOCKED_POSITION);
+    reloadCalibration();
     
     lock(); // Start in locked position
-    Serial.printf("🔧 Servo initialized on pin %d (Locked: %d°, Unlocked: %d°)\n", 
+    LOG_INFO("🔧 Servo initialized on pin %d (Locked: %d°, Unlocked: %d°)", 
                   servoPin, lockedPosition, unlockedPosition);
 }
 
@@ -29,14 +29,14 @@ void ServoControl::lock() {
     servo.write(lockedPosition);
     currentPosition = lockedPosition;
     locked = true;
-    Serial.printf("🔒 Box locked (position: %d°)\n", lockedPosition);
+    LOG_INFO("🔒 Box locked (position: %d°)", lockedPosition);
 }
 
 void ServoControl::unlock() {
     servo.write(unlockedPosition);
     currentPosition = unlockedPosition;
     locked = false;
-    Serial.printf("🔓 Box unlocked (position: %d°)\n", unlockedPosition);
+    LOG_INFO("🔓 Box unlocked (position: %d°)", unlockedPosition);
 }
 
 bool ServoControl::isLocked() {
@@ -47,7 +47,7 @@ void ServoControl::moveTo(int position) {
     if (position >= 0 && position <= 180) {
         servo.write(position);
         currentPosition = position;
-        Serial.printf("🎯 Servo moved to %d°\n", position);
+        LOG_INFO("🎯 Servo moved to %d°", position);
         delay(500); // Allow servo to reach position
     }
 }
@@ -59,16 +59,16 @@ int ServoControl::getCurrentPosition() {
 void ServoControl::setLockedPosition(int position) {
     if (position >= 0 && position <= 180) {
         lockedPosition = position;
-        preferences.putInt("servo_locked_pos", position);
-        Serial.printf("🔧 Locked position set to %d°\n", position);
+        preferences.putInt(KEY_SERVO_LOCKED_POS, position);
+        LOG_INFO("🔧 Locked position set to %d°", position);
     }
 }
 
 void ServoControl::setUnlockedPosition(int position) {
     if (position >= 0 && position <= 180) {
         unlockedPosition = position;
-        preferences.putInt("servo_unlocked_pos", position);
-        Serial.printf("🔧 Unlocked position set to %d°\n", position);
+        preferences.putInt(KEY_SERVO_UNLOCKED_POS, position);
+        LOG_INFO("🔧 Unlocked position set to %d°", position);
     }
 }
 
@@ -78,4 +78,9 @@ int ServoControl::getLockedPosition() {
 
 int ServoControl::getUnlockedPosition() {
     return unlockedPosition;
+}
+
+void ServoControl::reloadCalibration() {
+    lockedPosition = preferences.getInt(KEY_SERVO_LOCKED_POS, SERVO_LOCKED_POSITION);
+    unlockedPosition = preferences.getInt(KEY_SERVO_UNLOCKED_POS, SERVO_UNLOCKED_POSITION);
 }
\ No newline at end of file
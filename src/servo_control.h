@@ -17,6 +17,7 @@ public:
     void setUnlockedPosition(int position);
     int getLockedPosition();
     int getUnlockedPosition();
+    void reloadCalibration();
 
 private:
     Servo servo;
@@ -0,0 +1,553 @@
+#include "settings_store.h"
+#include "logger.h"
+#include "metered_preferences.h"
+#include <nvs.h>
+
+extern MeteredPreferences preferences;
+
+namespace {
+
+enum FieldResult {
+    FIELD_ABSENT,
+    FIELD_OK,
+    FIELD_INVALID
+};
+
+const char* const kSections[] = {"timer", "cost", "language", "ai", "security", "servo"};
+const char* const kProviders[] = {"simple", "openai", "local"};
+const char* const kPersonalities[] = {"supportive", "strict", "understanding", "professional"};
+
+bool fail(String& error, const char* section, const char* field, const char* reason) {
+    error = String(section) + "." + field + ": " + reason;
+    return false;
+}
+
+bool isOneOf(const char* value, const char* const* options, size_t optionCount) {
+    for (size_t i = 0; i < optionCount; i++) {
+        if (strcmp(value, options[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+FieldResult readInt(JsonObjectConst section, const char* field, long minValue, long maxValue, int32_t& out) {
+    JsonVariantConst value = section[field];
+    if (value.isNull()) return FIELD_ABSENT;
+    if (!value.is<long>()) return FIELD_INVALID;
+    long parsed = value.as<long>();
+    if (parsed < minValue || parsed > maxValue) return FIELD_INVALID;
+    out = parsed;
+    return FIELD_OK;
+}
+
+FieldResult readFloat(JsonObjectConst section, const char* field, float minValue, float maxValue, float& out) {
+    JsonVariantConst value = section[field];
+    if (value.isNull()) return FIELD_ABSENT;
+    if (!value.is<float>()) return FIELD_INVALID;
+    float parsed = value.as<float>();
+    if (isnan(parsed) || parsed < minValue || parsed > maxValue) return FIELD_INVALID;
+    out = parsed;
+    return FIELD_OK;
+}
+
+FieldResult readBool(JsonObjectConst section, const char* field, bool& out) {
+    JsonVariantConst value = section[field];
+    if (value.isNull()) return FIELD_ABSENT;
+    if (!value.is<bool>()) return FIELD_INVALID;
+    out = value.as<bool>();
+    return FIELD_OK;
+}
+
+FieldResult readString(JsonObjectConst section, const char* field, size_t maxLength, String& out) {
+    JsonVariantConst value = section[field];
+    if (value.isNull()) return FIELD_ABSENT;
+    if (!value.is<const char*>()) return FIELD_INVALID;
+    const char* parsed = value.as<const char*>();
+    if (strlen(parsed) > maxLength) return FIELD_INVALID;
+    out = parsed;
+    return FIELD_OK;
+}
+
+// Network lists are stored as JSON array strings; accept either form
+FieldResult readNetworkList(JsonObjectConst section, const char* field, String& out) {
+    JsonVariantConst value = section[field];
+    if (value.isNull()) return FIELD_ABSENT;
+
+    if (value.is<const char*>()) {
+        DynamicJsonDocument listDoc(512);
+        if (deserializeJson(listDoc, value.as<const char*>()) || !listDoc.is<JsonArray>()) {
+            return FIELD_INVALID;
+        }
+        out = "";
+        serializeJson(listDoc, out);
+    } else if (value.is<JsonArrayConst>()) {
+        out = "";
+        serializeJson(value, out);
+    } else {
+        return FIELD_INVALID;
+    }
+
+    return out.length() <= 480 ? FIELD_OK : FIELD_INVALID;
+}
+
+bool stageTimer(JsonObjectConst section, SettingsTransaction& tx, String& error) {
+    int32_t value;
+    FieldResult result;
+
+    if ((result = readInt(section, "timerMode", FIXED_INTERVAL, CUSTOM_SCHEDULE, value)) == FIELD_INVALID) {
+        return fail(error, "timer", "timerMode", "unknown mode");
+    } else if (result == FIELD_OK && !tx.putInt(KEY_TIMER_MODE, value)) {
+        return fail(error, "timer", "timerMode", "too many changes");
+    }
+
+    if ((result = readInt(section, "intervalMinutes", MIN_TIMER_MINUTES, MAX_TIMER_MINUTES, value)) == FIELD_INVALID) {
+        return fail(error, "timer", "intervalMinutes", "out of range");
+    } else if (result == FIELD_OK && !tx.putInt(KEY_INTERVAL_MINUTES, value)) {
+        return fail(error, "timer", "intervalMinutes", "too many changes");
+    }
+
+    if ((result = readInt(section, "dailyLimit", 0, 100, value)) == FIELD_INVALID) {
+        return fail(error, "timer", "dailyLimit", "out of range");
+    } else if (result == FIELD_OK && !tx.putInt(KEY_DAILY_LIMIT, value)) {
+        return fail(error, "timer", "dailyLimit", "too many changes");
+    }
+
+    if ((result = readInt(section, "scheduleHour", 0, 23, value)) == FIELD_INVALID) {
+        return fail(error, "timer", "scheduleHour", "out of range");
+    } else if (result == FIELD_OK && !tx.putInt(KEY_DAILY_HOUR, value)) {
+        return fail(error, "timer", "scheduleHour", "too many changes");
+    }
+
+    if ((result = readInt(section, "scheduleMinute", 0, 59, value)) == FIELD_INVALID) {
+        return fail(error, "timer", "scheduleMinute", "out of range");
+    } else if (result == FIELD_OK && !tx.putInt(KEY_DAILY_MINUTE, value)) {
+        return fail(error, "timer", "scheduleMinute", "too many changes");
+    }
+
+    if ((result = readInt(section, "unlockDuration", 1, MAX_TIMER_MINUTES, value)) == FIELD_INVALID) {
+        return fail(error, "timer", "unlockDuration", "out of range");
+    } else if (result == FIELD_OK && !tx.putInt(KEY_UNLOCK_DURATION, value)) {
+        return fail(error, "timer", "unlockDuration", "too many changes");
+    }
+
+    if ((result = readInt(section, "weekDay", 0, 6, value)) == FIELD_INVALID) {
+        return fail(error, "timer", "weekDay", "out of range");
+    } else if (result == FIELD_OK && !tx.putInt(KEY_WEEKLY_DAY, value)) {
+        return fail(error, "timer", "weekDay", "too many changes");
+    }
+
+    return true;
+}
+
+bool stageCost(JsonObjectConst section, SettingsTransaction& tx, String& error) {
+    String text;
+    float amount;
+    int32_t count;
+    bool flag;
+    FieldResult result;
+
+    if ((result = readString(section, "productName", 32, text)) == FIELD_INVALID) {
+        return fail(error, "cost", "productName", "must be a string of at most 32 characters");
+    } else if (result == FIELD_OK && !tx.putString(KEY_PRODUCT_NAME, text)) {
+        return fail(error, "cost", "productName", "too many changes");
+    }
+
+    if ((result = readString(section, "currency", 8, text)) == FIELD_INVALID) {
+        return fail(error, "cost", "currency", "must be a string of at most 8 characters");
+    } else if (result == FIELD_OK && !tx.putString(KEY_CURRENCY, text)) {
+        return fail(error, "cost", "currency", "too many changes");
+    }
+
+    if ((result = readBool(section, "usePackPrice", flag)) == FIELD_INVALID) {
+        return fail(error, "cost", "usePackPrice", "must be a boolean");
+    } else if (result == FIELD_OK && !tx.putBool(KEY_USE_PACK_PRICE, flag)) {
+        return fail(error, "cost", "usePackPrice", "too many changes");
+    }
+
+    if ((result = readFloat(section, "cigaretteCost", 0.0f, 1000.0f, amount)) == FIELD_INVALID) {
+        return fail(error, "cost", "cigaretteCost", "out of range");
+    } else if (result == FIELD_OK && !tx.putFloat(KEY_CIGARETTE_COST, amount)) {
+        return fail(error, "cost", "cigaretteCost", "too many changes");
+    }
+
+    if ((result = readFloat(section, "packCost", 0.0f, 10000.0f, amount)) == FIELD_INVALID) {
+        return fail(error, "cost", "packCost", "out of range");
+    } else if (result == FIELD_OK && !tx.putFloat(KEY_PACK_COST, amount)) {
+        return fail(error, "cost", "packCost", "too many changes");
+    }
+
+    if ((result = readInt(section, "cigarettesPerPack", 1, 100, count)) == FIELD_INVALID) {
+        return fail(error, "cost", "cigarettesPerPack", "out of range");
+    } else if (result == FIELD_OK && !tx.putInt(KEY_CIGARETTES_PER_PACK, count)) {
+        return fail(error, "cost", "cigarettesPerPack", "too many changes");
+    }
+
+    return true;
+}
+
+bool stageLanguage(JsonObjectConst section, SettingsTransaction& tx, String& error) {
+    String language;
+    FieldResult result = readString(section, "currentLanguage", 8, language);
+
+    if (result == FIELD_INVALID) {
+        return fail(error, "language", "currentLanguage", "must be a language code");
+    }
+
+    if (result == FIELD_OK) {
+        String supported = "," + preferences.getString(KEY_SUPPORTED_LANGUAGES, "en,pt,es,fr,de") + ",";
+        if (language.length() == 0 || supported.indexOf("," + language + ",") < 0) {
+            return fail(error, "language", "currentLanguage", "unsupported language");
+        }
+        if (!tx.putString(KEY_CURRENT_LANGUAGE, language)) {
+            return fail(error, "language", "currentLanguage", "too many changes");
+        }
+    }
+
+    return true;
+}
+
+bool stageAI(JsonObjectConst section, SettingsTransaction& tx, String& error) {
+    String text;
+    int32_t minutes;
+    int32_t milliseconds;
+    int32_t seconds;
+    bool flag;
+    FieldResult result;
+
+    if ((result = readBool(section, "enabled", flag)) == FIELD_INVALID) {
+        return fail(error, "ai", "enabled", "must be a boolean");
+    } else if (result == FIELD_OK && !tx.putBool(KEY_AI_ENABLED, flag)) {
+        return fail(error, "ai", "enabled", "too many changes");
+    }
+
+    if ((result = readString(section, "provider", 16, text)) == FIELD_INVALID ||
+        (result == FIELD_OK && !isOneOf(text.c_str(), kProviders, sizeof(kProviders) / sizeof(kProviders[0])))) {
+        return fail(error, "ai", "provider", "unknown provider");
+    } else if (result == FIELD_OK && !tx.putString(KEY_AI_PROVIDER, text)) {
+        return fail(error, "ai", "provider", "too many changes");
+    }
+
+    if ((result = readString(section, "apiKey", 200, text)) == FIELD_INVALID) {
+        return fail(error, "ai", "apiKey", "must be a string of at most 200 characters");
+    } else if (result == FIELD_OK && !tx.putString(KEY_AI_API_KEY, text)) {
+        return fail(error, "ai", "apiKey", "too many changes");
+    }
+
+    if ((result = readInt(section, "delayMinutes", 1, 60, minutes)) == FIELD_INVALID) {
+        return fail(error, "ai", "delayMinutes", "out of range");
+    } else if (result == FIELD_OK && !tx.putInt(KEY_AI_DELAY_MINUTES, minutes)) {
+        return fail(error, "ai", "delayMinutes", "too many changes");
+    }
+
+    if ((result = readString(section, "personality", 16, text)) == FIELD_INVALID ||
+        (result == FIELD_OK && !isOneOf(text.c_str(), kPersonalities, sizeof(kPersonalities) / sizeof(kPersonalities[0])))) {
+        return fail(error, "ai", "personality", "unknown personality");
+    } else if (result == FIELD_OK && !tx.putString(KEY_AI_PERSONALITY, text)) {
+        return fail(error, "ai", "personality", "too many changes");
+    }
+
+    if ((result = readString(section, "localUrl", 96, text)) == FIELD_INVALID ||
+        (result == FIELD_OK && text.length() > 0 && !text.startsWith("http://") && !text.startsWith("https://"))) {
+        return fail(error, "ai", "localUrl", "must be an http:// or https:// URL of at most 96 characters");
+    } else if (result == FIELD_OK && !tx.putString(KEY_AI_LOCAL_URL, text)) {
+        return fail(error, "ai", "localUrl", "too many changes");
+    }
+
+    if ((result = readString(section, "localModel", 48, text)) == FIELD_INVALID ||
+        (result == FIELD_OK && text.length() == 0)) {
+        return fail(error, "ai", "localModel", "must be a model name of at most 48 characters");
+    } else if (result == FIELD_OK && !tx.putString(KEY_AI_LOCAL_MODEL, text)) {
+        return fail(error, "ai", "localModel", "too many changes");
+    }
+
+    if ((result = readInt(section, "localConnectTimeout", 100, 10000, milliseconds)) == FIELD_INVALID) {
+        return fail(error, "ai", "localConnectTimeout", "out of range (100-10000 ms)");
+    } else if (result == FIELD_OK && !tx.putInt(KEY_AI_LOCAL_CONNECT, milliseconds)) {
+        return fail(error, "ai", "localConnectTimeout", "too many changes");
+    }
+
+    // A job fails after AI_JOB_TIMEOUT whatever the server does
+    if ((result = readInt(section, "localTimeout", 1, AI_JOB_TIMEOUT / 1000, seconds)) == FIELD_INVALID) {
+        return fail(error, "ai", "localTimeout", "out of range");
+    } else if (result == FIELD_OK && !tx.putInt(KEY_AI_LOCAL_TIMEOUT, seconds)) {
+        return fail(error, "ai", "localTimeout", "too many changes");
+    }
+
+    return true;
+}
+
+bool stageSecurity(JsonObjectConst section, SettingsTransaction& tx, String& error) {
+    String list;
+    bool flag;
+    FieldResult result;
+
+    if ((result = readNetworkList(section, "allowedNetworks", list)) == FIELD_INVALID) {
+        return fail(error, "security", "allowedNetworks", "must be an array of network names");
+    } else if (result == FIELD_OK && !tx.putString(KEY_ALLOWED_NETWORKS, list)) {
+        return fail(error, "security", "allowedNetworks", "too many changes");
+    }
+
+    if ((result = readNetworkList(section, "blockedNetworks", list)) == FIELD_INVALID) {
+        return fail(error, "security", "blockedNetworks", "must be an array of network names");
+    } else if (result == FIELD_OK && !tx.putString(KEY_BLOCKED_NETWORKS, list)) {
+        return fail(error, "security", "blockedNetworks", "too many changes");
+    }
+
+    if ((result = readBool(section, "blockOnPublic", flag)) == FIELD_INVALID) {
+        return fail(error, "security", "blockOnPublic", "must be a boolean");
+    } else if (result == FIELD_OK && !tx.putBool(KEY_BLOCK_ON_PUBLIC, flag)) {
+        return fail(error, "security", "blockOnPublic", "too many changes");
+    }
+
+    return true;
+}
+
+bool stageServo(JsonObjectConst section, SettingsTransaction& tx, String& error) {
+    int32_t position;
+    FieldResult result;
+
+    if ((result = readInt(section, "locked", 0, 180, position)) == FIELD_INVALID) {
+        return fail(error, "servo", "locked", "out of range (0-180)");
+    } else if (result == FIELD_OK && !tx.putInt(KEY_SERVO_LOCKED_POS, position)) {
+        return fail(error, "servo", "locked", "too many changes");
+    }
+
+    if ((result = readInt(section, "unlocked", 0, 180, position)) == FIELD_INVALID) {
+        return fail(error, "servo", "unlocked", "out of range (0-180)");
+    } else if (result == FIELD_OK && !tx.putInt(KEY_SERVO_UNLOCKED_POS, position)) {
+        return fail(error, "servo", "unlocked", "too many changes");
+    }
+
+    return true;
+}
+
+} // namespace
+
+SettingsTransaction::SettingsTransaction() {
+    count = 0;
+    overflowed = false;
+    version = getSettingsVersion();
+}
+
+SettingsTransaction::Entry* SettingsTransaction::stage(const char* key, EntryType type) {
+    // A later value for the same key replaces the earlier one
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(entries[i].key, key) == 0) {
+            entries[i].type = type;
+            return &entries[i];
+        }
+    }
+
+    if (count >= SETTINGS_MAX_PENDING) {
+        overflowed = true;
+        return nullptr;
+    }
+
+    Entry* entry = &entries[count++];
+    entry->key = key;
+    entry->type = type;
+    return entry;
+}
+
+bool SettingsTransaction::putInt(const char* key, int32_t value) {
+    if (preferences.isKey(key) && preferences.getInt(key, value) == value) {
+        return !overflowed;
+    }
+
+    Entry* entry = stage(key, ENTRY_INT);
+    if (!entry) return false;
+    entry->intValue = value;
+    return true;
+}
+
+bool SettingsTransaction::putBool(const char* key, bool value) {
+    if (preferences.isKey(key) && preferences.getBool(key, value) == value) {
+        return !overflowed;
+    }
+
+    Entry* entry = stage(key, ENTRY_BOOL);
+    if (!entry) return false;
+    entry->intValue = value ? 1 : 0;
+    return true;
+}
+
+bool SettingsTransaction::putFloat(const char* key, float value) {
+    if (preferences.isKey(key) && preferences.getFloat(key, value) == value) {
+        return !overflowed;
+    }
+
+    Entry* entry = stage(key, ENTRY_FLOAT);
+    if (!entry) return false;
+    entry->floatValue = value;
+    return true;
+}
+
+bool SettingsTransaction::putString(const char* key, const String& value) {
+    if (preferences.isKey(key) && preferences.getString(key, value) == value) {
+        return !overflowed;
+    }
+
+    Entry* entry = stage(key, ENTRY_STRING);
+    if (!entry) return false;
+    entry->stringValue = value;
+    return true;
+}
+
+size_t SettingsTransaction::pendingCount() const {
+    return count;
+}
+
+bool SettingsTransaction::commit() {
+    if (overflowed) return false;
+    if (count == 0) return true; // Nothing changed, keep the current version
+
+    // Preferences commits after every put; write through our own handle on
+    // the same namespace so the whole batch shares one commit. Types match
+    // what Preferences uses so its getters keep reading these keys.
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(PREF_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        LOG_ERROR("❌ Settings transaction: nvs_open failed (%d)", err);
+        return false;
+    }
+
+    for (size_t i = 0; i < count && err == ESP_OK; i++) {
+        const Entry& entry = entries[i];
+        switch (entry.type) {
+            case ENTRY_INT:
+                err = nvs_set_i32(handle, entry.key, entry.intValue);
+                break;
+            case ENTRY_BOOL:
+                err = nvs_set_u8(handle, entry.key, (uint8_t)entry.intValue);
+                break;
+            case ENTRY_FLOAT:
+                err = nvs_set_blob(handle, entry.key, &entry.floatValue, sizeof(float));
+                break;
+            case ENTRY_STRING:
+                err = nvs_set_str(handle, entry.key, entry.stringValue.c_str());
+                break;
+        }
+        if (err != ESP_OK) {
+            LOG_ERROR("❌ Settings transaction: writing %s failed (%d)", entry.key, err);
+        }
+    }
+
+    // The version is written last so it only moves once every value landed
+    if (err == ESP_OK) {
+        err = nvs_set_u32(handle, KEY_CONFIG_VERSION, version + 1);
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (err != ESP_OK) {
+        return false;
+    }
+
+    metrics.countNvsWrite(count + 1);
+    version++;
+    LOG_INFO("💾 Settings transaction committed: %u keys, version %u", (unsigned)count, version);
+    return true;
+}
+
+uint32_t SettingsTransaction::getVersion() const {
+    return version;
+}
+
+uint32_t getSettingsVersion() {
+    return preferences.getUInt(KEY_CONFIG_VERSION, 0);
+}
+
+void writeSettingsJSON(JsonDocument& doc) {
+    doc["version"] = getSettingsVersion();
+
+    JsonObject timerSettings = doc.createNestedObject("timer");
+    timerSettings["timerMode"] = preferences.getInt(KEY_TIMER_MODE, FIXED_INTERVAL);
+    timerSettings["intervalMinutes"] = preferences.getInt(KEY_INTERVAL_MINUTES, DEFAULT_TIMER_MINUTES);
+    timerSettings["dailyLimit"] = preferences.getInt(KEY_DAILY_LIMIT, 10);
+    timerSettings["scheduleHour"] = preferences.getInt(KEY_DAILY_HOUR, 22);
+    timerSettings["scheduleMinute"] = preferences.getInt(KEY_DAILY_MINUTE, 0);
+    timerSettings["unlockDuration"] = preferences.getInt(KEY_UNLOCK_DURATION, 30);
+    timerSettings["weekDay"] = preferences.getInt(KEY_WEEKLY_DAY, 0);
+
+    JsonObject cost = doc.createNestedObject("cost");
+    cost["productName"] = preferences.getString(KEY_PRODUCT_NAME, "Cigarettes");
+    cost["currency"] = preferences.getString(KEY_CURRENCY, "EUR");
+    cost["usePackPrice"] = preferences.getBool(KEY_USE_PACK_PRICE, false);
+    cost["cigaretteCost"] = preferences.getFloat(KEY_CIGARETTE_COST, DEFAULT_CIGARETTE_COST);
+    cost["packCost"] = preferences.getFloat(KEY_PACK_COST, 10.00);
+    cost["cigarettesPerPack"] = preferences.getInt(KEY_CIGARETTES_PER_PACK, 20);
+
+    JsonObject language = doc.createNestedObject("language");
+    language["currentLanguage"] = preferences.getString(KEY_CURRENT_LANGUAGE, "en");
+    language["supportedLanguages"] = preferences.getString(KEY_SUPPORTED_LANGUAGES, "en,pt,es,fr,de");
+
+    JsonObject ai = doc.createNestedObject("ai");
+    ai["enabled"] = preferences.getBool(KEY_AI_ENABLED, false);
+    ai["provider"] = preferences.getString(KEY_AI_PROVIDER, "simple");
+    ai["apiKey"] = preferences.getString(KEY_AI_API_KEY, "");
+    ai["delayMinutes"] = preferences.getInt(KEY_AI_DELAY_MINUTES, AI_EMERGENCY_DELAY_MINUTES);
+    ai["personality"] = preferences.getString(KEY_AI_PERSONALITY, "supportive");
+    ai["localUrl"] = preferences.getString(KEY_AI_LOCAL_URL, "");
+    ai["localModel"] = preferences.getString(KEY_AI_LOCAL_MODEL, AI_LOCAL_MODEL);
+    ai["localConnectTimeout"] = preferences.getInt(KEY_AI_LOCAL_CONNECT, AI_LOCAL_CONNECT_TIMEOUT);
+    ai["localTimeout"] = preferences.getInt(KEY_AI_LOCAL_TIMEOUT, AI_LOCAL_REPLY_TIMEOUT);
+
+    JsonObject security = doc.createNestedObject("security");
+    security["allowedNetworks"] = preferences.getString(KEY_ALLOWED_NETWORKS, "[]");
+    security["blockedNetworks"] = preferences.getString(KEY_BLOCKED_NETWORKS, "[]");
+    security["blockOnPublic"] = preferences.getBool(KEY_BLOCK_ON_PUBLIC, false);
+
+    JsonObject servo = doc.createNestedObject("servo");
+    servo["locked"] = preferences.getInt(KEY_SERVO_LOCKED_POS, SERVO_LOCKED_POSITION);
+    servo["unlocked"] = preferences.getInt(KEY_SERVO_UNLOCKED_POS, SERVO_UNLOCKED_POSITION);
+}
+
+bool stageSettingsPatch(JsonVariantConst patch, SettingsTransaction& tx, String& error) {
+    JsonObjectConst root = patch.as<JsonObjectConst>();
+    if (root.isNull()) {
+        error = "Settings must be a JSON object";
+        return false;
+    }
+
+    // Reject unknown sections instead of silently dropping a typo
+    for (JsonPairConst section : root) {
+        const char* name = section.key().c_str();
+        if (strcmp(name, "version") == 0 || strcmp(name, "baseVersion") == 0) continue;
+        if (!isOneOf(name, kSections, sizeof(kSections) / sizeof(kSections[0]))) {
+            error = String("Unknown settings section: ") + name;
+            return false;
+        }
+        if (!section.value().is<JsonObjectConst>()) {
+            error = String(name) + ": must be an object";
+            return false;
+        }
+    }
+
+    return stageTimer(root["timer"], tx, error) &&
+           stageCost(root["cost"], tx, error) &&
+           stageLanguage(root["language"], tx, error) &&
+           stageAI(root["ai"], tx, error) &&
+           stageSecurity(root["security"], tx, error) &&
+           stageServo(root["servo"], tx, error);
+}
+
+bool stageSettingsSection(const char* name, JsonVariantConst values, SettingsTransaction& tx, String& error) {
+    JsonObjectConst section = values.as<JsonObjectConst>();
+    if (section.isNull()) {
+        error = String(name) + ": must be an object";
+        return false;
+    }
+
+    if (strcmp(name, "timer") == 0) return stageTimer(section, tx, error);
+    if (strcmp(name, "cost") == 0) return stageCost(section, tx, error);
+    if (strcmp(name, "language") == 0) return stageLanguage(section, tx, error);
+    if (strcmp(name, "ai") == 0) return stageAI(section, tx, error);
+    if (strcmp(name, "security") == 0) return stageSecurity(section, tx, error);
+    if (strcmp(name, "servo") == 0) return stageServo(section, tx, error);
+
+    error = String("Unknown settings section: ") + name;
+    return false;
+}
@@ -0,0 +1,47 @@
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// Stages preference writes in RAM and applies them with a single NVS commit.
+// Values equal to what is already stored are dropped while staging, so an
+// unchanged settings page costs no flash writes at all.
+class SettingsTransaction {
+public:
+    SettingsTransaction();
+    bool putInt(const char* key, int32_t value);
+    bool putBool(const char* key, bool value);
+    bool putFloat(const char* key, float value);
+    bool putString(const char* key, const String& value);
+    size_t pendingCount() const;
+    bool commit();
+    uint32_t getVersion() const;
+
+private:
+    enum EntryType { ENTRY_INT, ENTRY_BOOL, ENTRY_FLOAT, ENTRY_STRING };
+
+    struct Entry {
+        const char* key;
+        EntryType type;
+        int32_t intValue;
+        float floatValue;
+        String stringValue;
+    };
+
+    Entry entries[SETTINGS_MAX_PENDING];
+    size_t count;
+    bool overflowed;
+    uint32_t version;
+
+    Entry* stage(const char* key, EntryType type);
+};
+
+uint32_t getSettingsVersion();
+void writeSettingsJSON(JsonDocument& doc);
+bool stageSettingsPatch(JsonVariantConst patch, SettingsTransaction& tx, String& error);
+// One section on its own, for the older per-area endpoints
+bool stageSettingsSection(const char* name, JsonVariantConst values, SettingsTransaction& tx, String& error);
+
+#endif // SETTINGS_STORE_H
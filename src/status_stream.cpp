@@ -0,0 +1,327 @@
+#include "status_stream.h"
+#include "logger.h"
+#include "metrics.h"
+
+extern Metrics metrics;
+
+StatusStream::StatusStream() : ws("/ws") {
+    lock = NULL;
+    lastHeartbeat = 0;
+
+    for (int t = 0; t < TOPIC_COUNT; t++) {
+        seq[t] = 0;
+    }
+
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        socketClients[i].used = false;
+        eventClients[i].used = false;
+        eventClients[i].request = NULL;
+    }
+}
+
+void StatusStream::begin(AsyncWebServer& server) {
+    // Recursive: closing a reaped event client can run its disconnect
+    // handler, which takes the lock again, before close() returns
+    lock = xSemaphoreCreateRecursiveMutex();
+
+    ws.onEvent([this](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+        onSocketEvent(client, type);
+    });
+    server.addHandler(&ws);
+
+    server.on("/api/events", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        openEventClient(request);
+    });
+
+    LOG_INFO("📡 Status stream ready (/ws, /api/events, max %d clients each)", STREAM_MAX_CLIENTS);
+}
+
+void StatusStream::publish(StreamTopic topic, const String& payload) {
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    payloads[topic] = payload;
+    seq[topic]++;
+    xSemaphoreGiveRecursive(lock);
+}
+
+void StatusStream::update() {
+    unsigned long now = millis();
+
+    flushSockets(now);
+    reapEventClients(now);
+
+    if (now - lastHeartbeat >= STREAM_HEARTBEAT_INTERVAL) {
+        lastHeartbeat = now;
+        ws.pingAll();
+        ws.cleanupClients(STREAM_MAX_CLIENTS);
+    }
+}
+
+size_t StatusStream::clientCount() {
+    size_t count = ws.count();
+
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        if (eventClients[i].used) count++;
+    }
+    xSemaphoreGiveRecursive(lock);
+
+    return count;
+}
+
+AsyncWebSocket& StatusStream::socket() {
+    return ws;
+}
+
+void StatusStream::onSocketEvent(AsyncWebSocketClient* client, AwsEventType type) {
+    // Runs in the async_tcp task
+    unsigned long now = millis();
+
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+
+    if (type == WS_EVT_CONNECT) {
+        SocketClient* slot = NULL;
+        for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+            if (!socketClients[i].used) {
+                slot = &socketClients[i];
+                break;
+            }
+        }
+
+        if (slot == NULL) {
+            xSemaphoreGiveRecursive(lock);
+            LOG_WARN("🚫 WebSocket client #%u rejected: client limit reached", client->id());
+            client->close(1013, "Too many clients");
+            return;
+        }
+
+        slot->used = true;
+        slot->id = client->id();
+        slot->lastSeen = now;
+        for (int t = 0; t < TOPIC_COUNT; t++) {
+            slot->sentSeq[t] = 0;
+        }
+    } else {
+        for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+            SocketClient& slot = socketClients[i];
+            if (!slot.used || slot.id != client->id()) continue;
+
+            if (type == WS_EVT_DISCONNECT) {
+                slot.used = false;
+            } else if (type == WS_EVT_PONG || type == WS_EVT_DATA) {
+                slot.lastSeen = now;
+            }
+            break;
+        }
+    }
+
+    xSemaphoreGiveRecursive(lock);
+}
+
+void StatusStream::flushSockets(unsigned long now) {
+    unsigned long start = micros();
+    uint32_t messages = 0;
+    uint32_t bytes = 0;
+    uint32_t skipped = 0;
+
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        SocketClient& slot = socketClients[i];
+        if (!slot.used) continue;
+
+        AsyncWebSocketClient* client = ws.client(slot.id);
+        if (client == NULL) {
+            slot.used = false;
+            continue;
+        }
+
+        // Browsers answer pings automatically; a tab that stopped answering is gone
+        if (now - slot.lastSeen > STREAM_CLIENT_TIMEOUT) {
+            LOG_INFO("🔌 Reaping silent WebSocket client #%u", slot.id);
+            client->close();
+            slot.used = false;
+            continue;
+        }
+
+        for (int t = 0; t < TOPIC_COUNT; t++) {
+            if (slot.sentSeq[t] == seq[t]) continue;
+
+            // Only hand over a snapshot once the previous one has drained;
+            // until then newer snapshots simply replace the pending one
+            const String& payload = payloads[t];
+            if (!client->canSend() || client->client()->space() < payload.length() + 16) {
+                break;
+            }
+
+            if (t == TOPIC_STATUS) {
+                client->text(payload);
+                bytes += payload.length();
+            } else {
+                String message = String("{\"type\":\"") + topicName((StreamTopic)t) + "\",\"data\":" + payload + "}";
+                client->text(message);
+                bytes += message.length();
+            }
+            // Snapshots replaced while this client was still draining
+            if (slot.sentSeq[t] != 0) {
+                skipped += seq[t] - slot.sentSeq[t] - 1;
+            }
+            slot.sentSeq[t] = seq[t];
+            messages++;
+        }
+    }
+
+    xSemaphoreGiveRecursive(lock);
+
+    if (messages > 0) {
+        metrics.recordFanout(micros() - start, messages, bytes, skipped);
+    }
+}
+
+void StatusStream::openEventClient(AsyncWebServerRequest* request) {
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+
+    EventClient* slot = NULL;
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        if (!eventClients[i].used) {
+            slot = &eventClients[i];
+            break;
+        }
+    }
+
+    if (slot == NULL) {
+        xSemaphoreGiveRecursive(lock);
+        AsyncWebServerResponse *response = request->beginResponse(503, "text/plain", "Too many event clients");
+        response->addHeader("Retry-After", String(STREAM_CLIENT_TIMEOUT / 1000));
+        request->send(response);
+        return;
+    }
+
+    slot->used = true;
+    slot->request = request;
+    slot->lastPull = millis();
+    slot->lastSend = slot->lastPull;
+    slot->frame = "retry: 5000\n\n";
+    slot->offset = 0;
+    for (int t = 0; t < TOPIC_COUNT; t++) {
+        slot->sentSeq[t] = 0;
+    }
+
+    xSemaphoreGiveRecursive(lock);
+
+    // The server pulls from the filler whenever the socket has room, so a
+    // client that stops reading simply stops being fed
+    AsyncWebServerResponse *response = request->beginChunkedResponse("text/event-stream",
+        [this, request](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            return fillEventClient(request, buffer, maxLen);
+        });
+    response->addHeader("Cache-Control", "no-cache");
+    request->onDisconnect([this, request]() {
+        closeEventClient(request);
+    });
+    request->send(response);
+}
+
+void StatusStream::closeEventClient(AsyncWebServerRequest* request) {
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        if (eventClients[i].used && eventClients[i].request == request) {
+            eventClients[i].used = false;
+            eventClients[i].request = NULL;
+            eventClients[i].frame = String();
+        }
+    }
+    xSemaphoreGiveRecursive(lock);
+}
+
+size_t StatusStream::fillEventClient(AsyncWebServerRequest* request, uint8_t* buffer, size_t maxLen) {
+    // Runs in the async_tcp task whenever the connection can take more data
+    unsigned long now = millis();
+
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+
+    EventClient* slot = NULL;
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        if (eventClients[i].used && eventClients[i].request == request) {
+            slot = &eventClients[i];
+            break;
+        }
+    }
+
+    if (slot == NULL) {
+        xSemaphoreGiveRecursive(lock);
+        return 0; // Reaped: ends the response
+    }
+
+    slot->lastPull = now;
+
+    if (slot->offset >= slot->frame.length()) {
+        slot->frame = String();
+        slot->offset = 0;
+
+        for (int t = 0; t < TOPIC_COUNT; t++) {
+            if (slot->sentSeq[t] != seq[t]) {
+                slot->frame = String("event: ") + topicName((StreamTopic)t) + "\ndata: " + payloads[t] + "\n\n";
+                slot->sentSeq[t] = seq[t];
+                break;
+            }
+        }
+
+        if (slot->frame.length() == 0 && now - slot->lastSend >= STREAM_HEARTBEAT_INTERVAL) {
+            slot->frame = ": ping\n\n";
+        }
+
+        if (slot->frame.length() == 0) {
+            xSemaphoreGiveRecursive(lock);
+            return RESPONSE_TRY_AGAIN;
+        }
+
+        slot->lastSend = now;
+    }
+
+    size_t length = slot->frame.length() - slot->offset;
+    if (length > maxLen) {
+        length = maxLen;
+    }
+    memcpy(buffer, slot->frame.c_str() + slot->offset, length);
+    slot->offset += length;
+
+    xSemaphoreGiveRecursive(lock);
+    return length;
+}
+
+void StatusStream::reapEventClients(unsigned long now) {
+    // A healthy client is polled at least twice a second and must accept a
+    // heartbeat every STREAM_HEARTBEAT_INTERVAL. One that has not pulled for
+    // longer than the timeout is dropped along with its connection, which
+    // would otherwise stay open with the unsent data queued on it.
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        EventClient& slot = eventClients[i];
+        if (slot.used && now - slot.lastPull > STREAM_CLIENT_TIMEOUT) {
+            LOG_INFO("🔌 Reaping stalled event stream client");
+            AsyncWebServerRequest* request = slot.request;
+            slot.used = false;
+            slot.request = NULL;
+            slot.frame = String();
+            // Still alive: its disconnect handler needs the lock we hold.
+            // It may be gone once close() returns.
+            request->client()->close(true);
+        }
+    }
+    xSemaphoreGiveRecursive(lock);
+}
+
+const char* StatusStream::topicName(StreamTopic topic) {
+    switch (topic) {
+        case TOPIC_STATUS:
+            return "status";
+        case TOPIC_WIFI_SCAN:
+            return "wifiScan";
+        case TOPIC_AI_REPLY:
+            return "aiReply";
+        case TOPIC_AI_PARTIAL:
+            return "aiPartial";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef STATUS_STREAM_H
+#define STATUS_STREAM_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "config.h"
+
+// Topics a client can be behind on. Each one only ever holds its latest
+// payload, so a slow client skips stale snapshots instead of queueing them.
+// An AI reply skipped that way can still be fetched from /api/ai/job, and
+// a partial one always carries the whole text so far.
+enum StreamTopic {
+    TOPIC_STATUS = 0,
+    TOPIC_WIFI_SCAN,
+    TOPIC_AI_REPLY,
+    TOPIC_AI_PARTIAL,
+    TOPIC_COUNT
+};
+
+// Fans status snapshots out to WebSocket (/ws) and Server-Sent Events
+// (/api/events) clients with per-client backpressure, heartbeats and a
+// client cap. publish() may be called from any task; update() runs in loop().
+class StatusStream {
+public:
+    StatusStream();
+    void begin(AsyncWebServer& server);
+    void update();
+    void publish(StreamTopic topic, const String& payload);
+    size_t clientCount();
+    AsyncWebSocket& socket();
+
+private:
+    struct SocketClient {
+        bool used;
+        uint32_t id;
+        unsigned long lastSeen;
+        uint32_t sentSeq[TOPIC_COUNT];
+    };
+
+    struct EventClient {
+        bool used;
+        AsyncWebServerRequest* request;
+        unsigned long lastPull;
+        unsigned long lastSend;
+        uint32_t sentSeq[TOPIC_COUNT];
+        String frame;   // Frame being written; the only per-client buffer
+        size_t offset;
+    };
+
+    AsyncWebSocket ws;
+    SemaphoreHandle_t lock;
+    String payloads[TOPIC_COUNT];
+    uint32_t seq[TOPIC_COUNT];
+    SocketClient socketClients[STREAM_MAX_CLIENTS];
+    EventClient eventClients[STREAM_MAX_CLIENTS];
+    unsigned long lastHeartbeat;
+
+    void onSocketEvent(AsyncWebSocketClient* client, AwsEventType type);
+    void openEventClient(AsyncWebServerRequest* request);
+    void closeEventClient(AsyncWebServerRequest* request);
+    size_t fillEventClient(AsyncWebServerRequest* request, uint8_t* buffer, size_t maxLen);
+    void flushSockets(unsigned long now);
+    void reapEventClients(unsigned long now);
+    static const char* topicName(StreamTopic topic);
+};
+
+#endif // STATUS_STREAM_H
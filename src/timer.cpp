@@ -1,8 +1,9 @@
 #include "timer.h"
-#include <Preferences.h>
+#include "logger.h"
+#include "metered_preferences.h"
 #include <time.h>
 
-extern Preferences preferences;
+extern MeteredPreferences preferences;
 
 Timer::Timer() {
     startTime = 0;
@@ -20,7 +21,7 @@ Timer::Timer() {
 }
 
 void Timer::begin() {
-    Serial.println("⏱️ Timer system initialized");
+    LOG_INFO("⏱️ Timer system initialized");
     // Load schedule from preferences if needed
     // This is called after preferences are initialized
 }
@@ -30,13 +31,13 @@ void Timer::start(unsigned long durationMs) {
     duration = durationMs;
     running = true;
     triggered = false;
-    Serial.printf("⏱️ Timer started for %lu ms\n", durationMs);
+    LOG_INFO("⏱️ Timer started for %lu ms", durationMs);
 }
 
 void Timer::stop() {
     running = false;
     triggered = false;
-    Serial.println("⏱️ Timer stopped");
+    LOG_INFO("⏱️ Timer stopped");
 }
 
 bool Timer::wasTriggered() {
@@ -77,7 +78,7 @@ void Timer::update() {
     if (running && millis() - startTime >= duration) {
         running = false;
         triggered = true;
-        Serial.println("⏰ Timer expired - box should unlock");
+        LOG_INFO("⏰ Timer expired - box should unlock");
     }
     
     // Check scheduled unlocks
@@ -89,7 +90,7 @@ void Timer::update() {
             
             if (shouldUnlockNow()) {
                 triggered = true;
-                Serial.println("📅 Scheduled unlock triggered");
+                LOG_INFO("📅 Scheduled unlock triggered");
             }
         }
     }
@@ -106,7 +107,7 @@ void Timer::setDailySchedule(int hour, int minute, int unlockDurationMinutes) {
     preferences.putInt(KEY_DAILY_MINUTE, minute);
     preferences.putInt(KEY_UNLOCK_DURATION, unlockDurationMinutes);
     
-    Serial.printf("📅 Daily schedule set: %02d:%02d for %d minutes\n", hour, minute, unlockDurationMinutes);
+    LOG_INFO("📅 Daily schedule set: %02d:%02d for %d minutes", hour, minute, unlockDurationMinutes);
 }
 
 void Timer::setWeeklySchedule(int weekDay, int hour, int minute, int unlockDurationMinutes) {
@@ -123,16 +124,25 @@ void Timer::setWeeklySchedule(int weekDay, int hour, int minute, int unlockDurat
     preferences.putInt(KEY_UNLOCK_DURATION, unlockDurationMinutes);
     
     const char* dayNames[] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
-    Serial.printf("📅 Weekly schedule set: %s at %02d:%02d for %d minutes\n", 
+    LOG_INFO("📅 Weekly schedule set: %s at %02d:%02d for %d minutes", 
                   dayNames[weekDay], hour, minute, unlockDurationMinutes);
 }
 
+void Timer::applySchedule(TimerMode mode, int weekDay, int hour, int minute, int unlockDurationMinutes) {
+    // Same as the setters above, but for values that are already persisted
+    schedule.weekDay = weekDay;
+    schedule.hour = hour;
+    schedule.minute = minute;
+    schedule.unlockDurationMinutes = unlockDurationMinutes;
+    schedule.isActive = (mode == DAILY_SCHEDULE || mode == WEEKLY_SCHEDULE);
+}
+
 bool Timer::shouldUnlockNow() {
     if (!schedule.isActive) return false;
     
     struct tm timeinfo;
     if (!getLocalTime(&timeinfo)) {
-        Serial.println("⚠️ Failed to get local time");
+        LOG_WARN("⚠️ Failed to get local time");
         return false;
     }
     
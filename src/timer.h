@@ -27,6 +27,7 @@ public:
     // Schedule-based methods
     void setDailySchedule(int hour, int minute, int unlockDurationMinutes);
     void setWeeklySchedule(int weekDay, int hour, int minute, int unlockDurationMinutes);
+    void applySchedule(TimerMode mode, int weekDay, int hour, int minute, int unlockDurationMinutes);
     bool shouldUnlockNow();
     unsigned long getTimeUntilNextScheduledUnlock();
     String getNextUnlockTime();
@@ -0,0 +1,182 @@
+#include "wifi_scanner.h"
+#include "logger.h"
+#include <WiFi.h>
+
+WifiScanner::WifiScanner() {
+    lock = NULL;
+    networkCount = 0;
+    scanRequested = false;
+    scanning = false;
+    updated = false;
+    scanStartTime = 0;
+    lastScanTime = 0;
+}
+
+void WifiScanner::begin() {
+    lock = xSemaphoreCreateMutex();
+}
+
+bool WifiScanner::requestScan(bool force) {
+    // Called from request handlers: never scans here, only flags loop()
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool stale = lastScanTime == 0 || millis() - lastScanTime >= WIFI_SCAN_CACHE_TTL;
+    if (!scanning && (stale || force)) {
+        scanRequested = true;
+    }
+    bool busy = scanning || scanRequested;
+    xSemaphoreGive(lock);
+    return busy;
+}
+
+bool WifiScanner::isScanning() {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool busy = scanning || scanRequested;
+    xSemaphoreGive(lock);
+    return busy;
+}
+
+bool WifiScanner::wasUpdated() {
+    if (updated) {
+        updated = false; // Reset flag after checking
+        return true;
+    }
+    return false;
+}
+
+void WifiScanner::update() {
+    if (scanRequested && !scanning) {
+        startScan();
+        return;
+    }
+
+    if (!scanning) return;
+
+    int16_t result = WiFi.scanComplete();
+    if (result == WIFI_SCAN_RUNNING) {
+        if (millis() - scanStartTime < WIFI_SCAN_TIMEOUT) return;
+        LOG_WARN("⚠️ WiFi scan timed out");
+        result = WIFI_SCAN_FAILED;
+    }
+
+    if (result >= 0) {
+        collectResults(result);
+    } else {
+        LOG_WARN("⚠️ WiFi scan failed");
+    }
+
+    WiFi.scanDelete();
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    scanning = false;
+    lastScanTime = millis();
+    updated = true;
+    xSemaphoreGive(lock);
+}
+
+void WifiScanner::startScan() {
+    // Asynchronous scan; results are collected by update()
+    int16_t result = WiFi.scanNetworks(true);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    scanRequested = false;
+    scanning = (result == WIFI_SCAN_RUNNING);
+    scanStartTime = millis();
+    xSemaphoreGive(lock);
+
+    if (scanning) {
+        LOG_INFO("📡 WiFi scan started");
+    } else {
+        LOG_WARN("⚠️ WiFi scan could not start (%d)", result);
+    }
+}
+
+void WifiScanner::collectResults(int found) {
+    unsigned long now = millis();
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    for (int i = 0; i < found; i++) {
+        mergeNetwork(WiFi.SSID(i), WiFi.RSSI(i), WiFi.channel(i), WiFi.encryptionType(i) != WIFI_AUTH_OPEN, now);
+    }
+
+    // Forget networks that have not shown up for a while
+    int kept = 0;
+    for (int i = 0; i < networkCount; i++) {
+        if (now - networks[i].lastSeen <= WIFI_SCAN_ENTRY_TTL) {
+            networks[kept++] = networks[i];
+        }
+    }
+    networkCount = kept;
+
+    // Strongest first (insertion sort, the list is short and mostly sorted)
+    for (int i = 1; i < networkCount; i++) {
+        ScannedNetwork current = networks[i];
+        int j = i - 1;
+        while (j >= 0 && networks[j].rssi < current.rssi) {
+            networks[j + 1] = networks[j];
+            j--;
+        }
+        networks[j + 1] = current;
+    }
+
+    xSemaphoreGive(lock);
+
+    LOG_INFO("📡 WiFi scan complete: %d found, %d cached", found, networkCount);
+}
+
+void WifiScanner::mergeNetwork(const String& ssid, int32_t rssi, uint8_t channel, bool secure, unsigned long now) {
+    if (ssid.length() == 0) return; // Hidden networks can't be picked anyway
+
+    for (int i = 0; i < networkCount; i++) {
+        if (strcmp(networks[i].ssid, ssid.c_str()) == 0) {
+            // Several access points can share an SSID; track the strongest
+            // one per scan and smooth it against the previous scans
+            if (networks[i].lastSeen == now) {
+                if (rssi > networks[i].rssi) networks[i].rssi = rssi;
+            } else {
+                networks[i].rssi += (rssi - networks[i].rssi) * WIFI_SCAN_RSSI_SMOOTHING;
+            }
+            networks[i].channel = channel;
+            networks[i].secure = secure;
+            networks[i].lastSeen = now;
+            return;
+        }
+    }
+
+    if (networkCount >= WIFI_SCAN_MAX_NETWORKS) {
+        // Replace the weakest entry if the newcomer is stronger
+        int weakest = 0;
+        for (int i = 1; i < networkCount; i++) {
+            if (networks[i].rssi < networks[weakest].rssi) weakest = i;
+        }
+        if (networks[weakest].rssi >= rssi) return;
+        networkCount--;
+        networks[weakest] = networks[networkCount];
+    }
+
+    ScannedNetwork& entry = networks[networkCount++];
+    strncpy(entry.ssid, ssid.c_str(), sizeof(entry.ssid) - 1);
+    entry.ssid[sizeof(entry.ssid) - 1] = '\0';
+    entry.rssi = rssi;
+    entry.channel = channel;
+    entry.secure = secure;
+    entry.lastSeen = now;
+}
+
+void WifiScanner::writeJSON(JsonDocument& doc) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    doc["scanning"] = scanning || scanRequested;
+    doc["age"] = lastScanTime > 0 ? (long)(millis() - lastScanTime) : -1;
+
+    JsonArray list = doc.createNestedArray("networks");
+    for (int i = 0; i < networkCount; i++) {
+        JsonObject network = list.createNestedObject();
+        network["ssid"] = (const char*)networks[i].ssid;
+        network["rssi"] = (int)lroundf(networks[i].rssi);
+        network["channel"] = networks[i].channel;
+        network["secure"] = networks[i].secure;
+    }
+
+    xSemaphoreGive(lock);
+}
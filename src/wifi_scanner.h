@@ -0,0 +1,44 @@
+#ifndef WIFI_SCANNER_H
+#define WIFI_SCANNER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+struct ScannedNetwork {
+    char ssid[33];
+    float rssi;              // Smoothed across scans
+    uint8_t channel;
+    bool secure;
+    unsigned long lastSeen;
+};
+
+// Runs Wi-Fi scans in the background and keeps a cached, RSSI-smoothed list.
+// Handlers only ever read the cache and ask for a refresh; the scan itself
+// is started and collected from loop() via update().
+class WifiScanner {
+public:
+    WifiScanner();
+    void begin();
+    void update();
+    bool requestScan(bool force = false);
+    bool isScanning();
+    bool wasUpdated();
+    void writeJSON(JsonDocument& doc);
+
+private:
+    SemaphoreHandle_t lock;
+    ScannedNetwork networks[WIFI_SCAN_MAX_NETWORKS];
+    int networkCount;
+    bool scanRequested;
+    bool scanning;
+    bool updated;
+    unsigned long scanStartTime;
+    unsigned long lastScanTime;
+
+    void startScan();
+    void collectResults(int found);
+    void mergeNetwork(const String& ssid, int32_t rssi, uint8_t channel, bool secure, unsigned long now);
+};
+
+#endif // WIFI_SCANNER_H